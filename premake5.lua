@@ -150,7 +150,7 @@ function ShaderValidation()
 	
 	filter("configurations:*")
 		postbuildcommands({
-			path.translate(cwd.."/build/ShaderValidator/%{cfg.longname}/ShaderValidator"..ext.." "..cwd.."/resources/", sep)
+			path.translate(cwd.."/build/ShaderValidator/%{cfg.longname}/ShaderValidator"..ext.." "..cwd.."/resources/ "..cwd.."/cache/", sep)
 		})
 	filter({})
 end	
@@ -251,6 +251,19 @@ project("ControllerTest")
 	ExecutableSetup()
 	files({ "src/tools/ControllerTest.cpp" })
 
+project("CullingBenchmark")
+	ExecutableSetup()
+	files({ "src/tools/CullingBenchmark.cpp" })
+
+project("NoiseBenchmark")
+	ExecutableSetup()
+	files({ "src/tools/NoiseBenchmark.cpp" })
+
+project("TerrainBenchmark")
+	ExecutableSetup()
+	includedirs({ "src/apps/island" })
+	files({ "src/tools/TerrainBenchmark.cpp", "src/apps/island/Terrain.cpp", "src/apps/island/Terrain.hpp", "src/apps/island/VirtualHeightMap.cpp", "src/apps/island/VirtualHeightMap.hpp" })
+
 project("ImageViewer")
 	ExecutableSetup()
 	ShaderValidation()
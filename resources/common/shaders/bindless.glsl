@@ -0,0 +1,12 @@
+
+layout(set = 4, binding = 0) uniform texture2D textures[]; ///< Global texture table, indexed by the slots returned by GPU::registerBindlessTexture.
+
+/** Sample a texture from the global texture table.
+\param index the texture slot in the table
+\param samp the sampler to use
+\param uv the texture coordinates
+\return the sampled value
+*/
+vec4 textureBindless(uint index, sampler samp, vec2 uv){
+	return texture(sampler2D(textures[nonuniformEXT(index)], samp), uv);
+}
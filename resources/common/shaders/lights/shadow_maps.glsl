@@ -10,16 +10,18 @@
 	\param lightSpacePosition fragment position in light space
 	\param smap the shadow map
 	\param layer the texture layer to read from
+	\param region the region of the layer containing the shadow map (min and max UVs)
 	\param bias the bias to apply
 	\return the lighting factor (0.0 = in shadow)
 */
-float shadowBasic(vec3 lightSpacePosition, texture2DArray smap, uint layer, float bias){
+float shadowBasic(vec3 lightSpacePosition, texture2DArray smap, uint layer, vec4 region, float bias){
 	// Avoid shadows when falling outside the shadow map.
 	if(any(greaterThan(abs(lightSpacePosition.xy-0.5), vec2(0.5)))){
 		return 1.0;
 	}
 	// Read depth from shadow map.
-	float depth = textureLod(sampler2DArray(smap, sClampLinear), vec3(lightSpacePosition.xy, layer), 0.0).r;
+	vec2 uv = mix(region.xy, region.zw, lightSpacePosition.xy);
+	float depth = textureLod(sampler2DArray(smap, sClampLinear), vec3(uv, layer), 0.0).r;
 	if(depth >= 1.0){
 		// No information in the depthmap: no occluder.
 		return 1.0;
@@ -54,10 +56,11 @@ float shadowBasicCube(vec3 lightToPosDir, textureCubeArray smap, uint layer, flo
 	\param lightSpacePosition fragment position in light space
 	\param smap the shadow map
 	\param layer the texture layer to read from
+	\param region the region of the layer containing the shadow map (min and max UVs)
 	\param bias the bias to apply
 	\return the lighting factor (0.0 = in shadow)
 */
-float shadowPCF(vec3 lightSpacePosition, texture2DArray smap, uint layer, float bias){
+float shadowPCF(vec3 lightSpacePosition, texture2DArray smap, uint layer, vec4 region, float bias){
 	// Avoid shadows when falling outside the shadow map.
 	if(any(greaterThan(abs(lightSpacePosition.xy-0.5), vec2(0.5)))){
 		return 1.0;
@@ -65,6 +68,10 @@ float shadowPCF(vec3 lightSpacePosition, texture2DArray smap, uint layer, float
 
 	vec2 textureSize = textureSize(smap, 0).xy;
 	vec2 texelSize = 1.0 / textureSize;
+	vec2 uv = mix(region.xy, region.zw, lightSpacePosition.xy);
+	// Gathered texels should stay in the region.
+	vec2 minCoords = region.xy + texelSize;
+	vec2 maxCoords = region.zw - texelSize;
 
 	float totalOcclusion = 0.0;
 	float totalWeight = 0.0;
@@ -73,7 +80,7 @@ float shadowPCF(vec3 lightSpacePosition, texture2DArray smap, uint layer, float
 	for(int y = -1; y <= 1; y += 1){
 		for(int x = -1; x <= 1; x += 1){
 
-			vec2 coords = lightSpacePosition.xy + vec2(x,y) * texelSize;
+			vec2 coords = clamp(uv + vec2(x,y) * texelSize, minCoords, maxCoords);
 			vec4 depths = textureGather(sampler2DArray(smap, sClampNear), vec3(coords, layer), 0);
 			bvec4 valids = lessThan(depths, vec4(1.0));
 			float invWeight = (abs(x)+abs(y)) * 0.1 + 1.0;
@@ -210,16 +217,18 @@ float shadowPCFCube(vec3 lightToPosDir, textureCubeArray smap, uint layer, float
 	\param lightSpacePosition fragment position in light space
 	\param smap the shadow map
 	\param layer the texture layer to read from
+	\param region the region of the layer containing the shadow map (min and max UVs)
 	\return the lighting factor (0.0 = in shadow)
 */
-float shadowVSM(vec3 lightSpacePosition, texture2DArray smap, uint layer){
+float shadowVSM(vec3 lightSpacePosition, texture2DArray smap, uint layer, vec4 region){
 	// Avoid shadows when falling outside the shadow map.
 	if(any(greaterThan(abs(lightSpacePosition.xy-0.5), vec2(0.5)))){
 		return 1.0;
 	}
 	float probabilityMax = 1.0;
 	// Read first and second moment from shadow map.
-	vec2 moments = textureLod(sampler2DArray(smap, sClampLinear), vec3(lightSpacePosition.xy, layer), 0.0).rg;
+	vec2 uv = mix(region.xy, region.zw, lightSpacePosition.xy);
+	vec2 moments = textureLod(sampler2DArray(smap, sClampLinear), vec3(uv, layer), 0.0).rg;
 	if(moments.x >= 1.0){
 		// No information in the depthmap: no occluder.
 		return 1.0;
@@ -277,18 +286,19 @@ float shadowVSMCube(vec3 lightToPosDir, textureCubeArray smap, uint layer, float
 	\param lightSpacePosition fragment position in light space
 	\param smap the shadow map
 	\param layer the texture layer to read from
+	\param region the region of the layer containing the shadow map (min and max UVs)
 	\param bias the bias to apply
 	\return the lighting factor (0.0 = in shadow)
 */
-float shadow(uint mode, vec3 lightSpacePosition, texture2DArray smap, uint layer, float bias){
+float shadow(uint mode, vec3 lightSpacePosition, texture2DArray smap, uint layer, vec4 region, float bias){
 	if(mode == SHADOW_BASIC){
-		return shadowBasic(lightSpacePosition, smap, layer, bias);
+		return shadowBasic(lightSpacePosition, smap, layer, region, bias);
 	}
 	if(mode == SHADOW_PCF){
-		return shadowPCF(lightSpacePosition, smap, layer, bias);
+		return shadowPCF(lightSpacePosition, smap, layer, region, bias);
 	}
 	if(mode == SHADOW_VARIANCE) {
-		return shadowVSM(lightSpacePosition, smap, layer);
+		return shadowVSM(lightSpacePosition, smap, layer, region);
 	}
 	return 1.0;
 }
@@ -44,6 +44,7 @@ struct Light {
 	uint shadowMode; ///< Shadow mode.
 	uint layer; ///< Shadow map layer.
 	float bias; ///< Shadow bias
+	vec4 region; ///< Shadow map region in the layer (min and max UVs).
 };
 
 /** Fresnel approximation.
@@ -710,7 +711,7 @@ bool applyDirectionalLight(Light light, vec3 viewSpacePos, vec3 viewSpaceN, text
 		// Bias
 		float f = max(0.0, dot(l, viewSpaceN));
 		float bias = light.bias * mix(5.0, 1.0, f);
-		shadowing *= shadow(light.shadowMode, lightSpacePosition, shadowMap, light.layer, bias);
+		shadowing *= shadow(light.shadowMode, lightSpacePosition, shadowMap, light.layer, light.region, bias);
 	}
 
 	return true;
@@ -758,7 +759,7 @@ bool applySpotLight(Light light, vec3 viewSpacePos, vec3 viewSpaceN, texture2DAr
 		// Bias
 		float f = max(0.0, dot(l, viewSpaceN));
 		float bias = light.bias * mix(2.0, 1.0, f);
-		shadowing *= shadow(light.shadowMode, lightSpacePosition.xyz, shadowMap, light.layer, bias);		
+		shadowing *= shadow(light.shadowMode, lightSpacePosition.xyz, shadowMap, light.layer, light.region, bias);		
 	}
 	return true;
 }
@@ -0,0 +1,47 @@
+
+#define GROUP_SIZE 16 ///< Side of a workgroup, in invocations.
+#define BLUR_RADIUS 2 ///< Radius of the box filter.
+#define TILE_SIZE (GROUP_SIZE + 2 * BLUR_RADIUS) ///< Side of the tile of input texels needed by a workgroup.
+
+shared vec4 tile[TILE_SIZE][TILE_SIZE]; ///< Input texels covered by the workgroup, with a border.
+shared vec4 rows[TILE_SIZE][GROUP_SIZE]; ///< Horizontal sums for each row of the tile.
+
+/** Perform a 5x5 box blur for the current invocation pixel, using the workgroup shared memory.
+ The blur is separable: the tile is loaded once, summed horizontally and then vertically.
+ \param size the input image size
+ \return the blurred color
+ \note This function contains barriers, all invocations of the workgroup should call it.
+ */
+vec4 boxBlur(ivec2 size){
+	const ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy) * GROUP_SIZE - BLUR_RADIUS;
+	const uint localId = gl_LocalInvocationIndex;
+	const uint groupCount = GROUP_SIZE * GROUP_SIZE;
+
+	// Load the tile, clamping to the image edges.
+	for(uint id = localId; id < TILE_SIZE * TILE_SIZE; id += groupCount){
+		const ivec2 local = ivec2(id % TILE_SIZE, id / TILE_SIZE);
+		tile[local.y][local.x] = fetchInput(clamp(tileOrigin + local, ivec2(0), size - 1));
+	}
+	barrier();
+
+	// Horizontal sums.
+	for(uint id = localId; id < TILE_SIZE * GROUP_SIZE; id += groupCount){
+		const uint x = id % GROUP_SIZE;
+		const uint y = id / GROUP_SIZE;
+		vec4 sum = vec4(0.0);
+		for(uint dx = 0; dx <= 2 * BLUR_RADIUS; ++dx){
+			sum += tile[y][x + dx];
+		}
+		rows[y][x] = sum;
+	}
+	barrier();
+
+	// Vertical sums.
+	const uvec2 local = gl_LocalInvocationID.xy;
+	vec4 sum = vec4(0.0);
+	for(uint dy = 0; dy <= 2 * BLUR_RADIUS; ++dy){
+		sum += rows[local.y + dy][local.x];
+	}
+	const float count = float((2 * BLUR_RADIUS + 1) * (2 * BLUR_RADIUS + 1));
+	return sum / count;
+}
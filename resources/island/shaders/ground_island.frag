@@ -3,15 +3,25 @@
 layout(location = 0) in INTERFACE {
 	vec4 pos; ///< World position
 	vec2 uv; ///< Texture coordinates
+	float lod; ///< Level of detail used for the height.
 } In ;
 
 layout(set = 0, binding = 0) uniform UniformBlock {
 	vec3 lightDirection; ///< Sun light direction.
 	bool debugCol; ///< Use debug color instead of shading.
 	vec3 camPos; ///< Camera world position.
+#ifdef VIRTUAL_TERRAIN
+	float virtualSize; ///< Virtual map size in texels.
+	float pageSize; ///< Virtual map page size in texels.
+	float pageBorder; ///< Virtual map page border in texels.
+	float invCacheSize; ///< Virtual map cache inverse size.
+	uint pageCount; ///< Number of pages along a side of the finest level.
+	uint levelCount; ///< Number of levels in the virtual map.
+	uint slotsPerSide; ///< Number of pages along a side of the cache.
+#endif
 };
 
-layout(set = 2, binding = 0) uniform texture2D heightMap; ///< Terrain height map, height in R, normals in GBA.
+#include "terrain_sampling.glsl"
 layout(set = 2, binding = 1) uniform texture2D shadowMap; ///<Terrain shadowing factor, ground level in R, water level in G.
 layout(set = 2, binding = 2) uniform texture2D surfaceNoise; ///< Noise surface normal map.
 layout(set = 2, binding = 3) uniform texture2D glitterNoise; ///< Noise specular map.
@@ -28,7 +38,11 @@ void main(){
 	fragWorldPos.w = 1.0;
 
 	// Get clean normal and height.
-	vec4 heightAndNor = textureLod(sampler2D(heightMap, sClampLinear), In.uv, 0.0);
+#ifdef VIRTUAL_TERRAIN
+	vec4 heightAndNor = terrainSample(In.uv, terrainLod(dFdx(In.uv), dFdy(In.uv)));
+#else
+	vec4 heightAndNor = terrainSample(In.uv, 0.0);
+#endif
 	vec3 n = normalize(heightAndNor.yzw);
 	vec3 v = normalize(camPos - fragWorldPos.xyz);
 
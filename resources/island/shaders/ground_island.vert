@@ -1,7 +1,7 @@
 #include "samplers.glsl"
 
 // Attributes
-layout(location = 0) in vec3 v; ///< Position.
+layout(location = 0) in vec3 v; ///< Position in the cell patch, in units of the cell level.
 
 layout(set = 0, binding = 1) uniform UniformBlock {
 	mat4 mvp; ///< MVP transformation matrix.
@@ -9,13 +9,28 @@ layout(set = 0, binding = 1) uniform UniformBlock {
 	float texelSize; ///< Height map texel world size.
 	float invMapSize; ///< Height map inverse size.
 	float invGridSize; ///< Grid mesh inverse size.
+#ifdef VIRTUAL_TERRAIN
+	float virtualSize; ///< Virtual map size in texels.
+	float pageSize; ///< Virtual map page size in texels.
+	float pageBorder; ///< Virtual map page border in texels.
+	float invCacheSize; ///< Virtual map cache inverse size.
+	uint pageCount; ///< Number of pages along a side of the finest level.
+	uint levelCount; ///< Number of levels in the virtual map.
+	uint slotsPerSide; ///< Number of pages along a side of the cache.
+#endif
 };
 
-layout(set = 2, binding = 0) uniform texture2D heightMap; ///< Terrain height map, height in R, normals in GBA.
+#include "terrain_sampling.glsl"
+
+/// Visible cells, origin of the patch in grid units (XY) and level (Z).
+layout(std430, set = 3, binding = 1) readonly buffer Cells {
+	vec4 cells[];
+};
 
 layout(location = 0) out INTERFACE {
 	vec4 pos; ///< World position.
 	vec2 uv; ///< Texture coordinates.
+	float lod; ///< Level of detail used for the height.
 } Out ;
 
 /** Apply the transformation to the input vertex.
@@ -23,9 +38,14 @@ layout(location = 0) out INTERFACE {
  */
 void main(){
 
+	// Position in the grid.
+	vec4 cell = cells[gl_InstanceIndex];
+	float cellSize = exp2(cell.z);
+	vec3 gridPos = vec3(cell.x + cellSize * v.x, cell.z, cell.y + cellSize * v.z);
+
 	// Compute discretization level to move grid in lockstep.
-	float levelSize = exp2(v.y) * texelSize;
-	vec3 worldPos = texelSize * v + round(shift/levelSize)*levelSize;
+	float levelSize = cellSize * texelSize;
+	vec3 worldPos = texelSize * gridPos + round(shift/levelSize)*levelSize;
 
 	// Compute LOD level to read from the heightmap.
 	vec2 dpos = abs(worldPos.xz - shift.xz);
@@ -34,20 +54,27 @@ void main(){
 	float baseLod = floor(fetchLod);
 	float nextLod = baseLod + 1.0;
 	float fracLod = fetchLod - baseLod;
+	vec2 uv = (worldPos.xz/texelSize);
+#ifdef VIRTUAL_TERRAIN
+	// Pages of each level are aligned with texel centers.
+	vec2 baseCoords = (uv + 0.5) * invMapSize + 0.5;
+	vec2 nextCoords = baseCoords;
+#else
 	// Half texel offset, to only read inbetween texels.
 	float halfTexNext = exp2(baseLod);
 	float halfTexBase = halfTexNext*0.5;
 	// Shifted UVs.
-	vec2 uv = (worldPos.xz/texelSize);
 	vec2 baseCoords = (uv + halfTexBase) * invMapSize + 0.5;
 	vec2 nextCoords = (uv + halfTexNext) * invMapSize + 0.5;
+#endif
 	// Custom trilinear 
-	float lowHeight  = textureLod(sampler2D(heightMap, sClampLinearLinear), baseCoords, baseLod).r;
-	float nextHeight = textureLod(sampler2D(heightMap, sClampLinearLinear), nextCoords, nextLod).r;
+	float lowHeight  = terrainSample(baseCoords, baseLod).r;
+	float nextHeight = terrainSample(nextCoords, nextLod).r;
 	// Final height and projected position.
 	worldPos.y = mix(lowHeight, nextHeight, fracLod);
     gl_Position = mvp * vec4(worldPos, 1.0);
 	Out.uv = (uv + 0.5) * invMapSize + 0.5;
 	Out.pos.xyz = worldPos;
 	Out.pos.w = 0.0;
+	Out.lod = baseLod;
 }
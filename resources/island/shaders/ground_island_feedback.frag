@@ -0,0 +1,30 @@
+#define VIRTUAL_TERRAIN
+#include "samplers.glsl"
+
+layout(location = 0) in INTERFACE {
+	vec4 pos; ///< World position
+	vec2 uv; ///< Texture coordinates
+	float lod; ///< Level of detail used for the height.
+} In ;
+
+layout(set = 0, binding = 0) uniform UniformBlock {
+	float lodBias; ///< Level of detail shift from the feedback resolution to the rendering resolution.
+	float virtualSize; ///< Virtual map size in texels.
+	float pageSize; ///< Virtual map page size in texels.
+	float pageBorder; ///< Virtual map page border in texels.
+	float invCacheSize; ///< Virtual map cache inverse size.
+	uint pageCount; ///< Number of pages along a side of the finest level.
+	uint levelCount; ///< Number of levels in the virtual map.
+	uint slotsPerSide; ///< Number of pages along a side of the cache.
+};
+
+#include "terrain_sampling.glsl"
+
+layout (location = 0) out vec4 fragPage; ///< Requested page coordinates and level, and coverage.
+
+/** Output the virtual map page needed to render the terrain at this location, for both the vertex heights and the shading. */
+void main(){
+	const float lod = terrainLod(dFdx(In.uv), dFdy(In.uv)) + lodBias;
+	const uint level = virtualLevel(min(lod, In.lod));
+	fragPage = vec4(vec2(virtualPage(In.uv, level)), float(level), 1.0);
+}
@@ -0,0 +1,2 @@
+#define VIRTUAL_TERRAIN
+#include "ground_island.frag"
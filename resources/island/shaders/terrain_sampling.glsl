@@ -0,0 +1,79 @@
+// Terrain height and normal map sampling, from the regular map or the virtual map.
+// The uniform block declaring the virtual map parameters should be included before.
+
+layout(set = 2, binding = 0) uniform texture2D heightMap; ///< Terrain height map (or virtual map cache), height in R, normals in GBA.
+
+#ifdef VIRTUAL_TERRAIN
+
+/// For each page of each level of the virtual map, slot (low 24 bits) and level (high 8 bits) of the finest resident page covering it.
+layout(std430, set = 3, binding = 0) readonly buffer PageTable {
+	uint pages[];
+};
+
+/** Find the page of the virtual map covering a location at a given level.
+ \param uv the location in the map
+ \param level the virtual map level
+ \return the page coordinates in the level
+ */
+uvec2 virtualPage(vec2 uv, uint level){
+	const float side = float(pageCount >> level);
+	const vec2 texel = uv * virtualSize / exp2(float(level));
+	return uvec2(clamp(floor(texel / pageSize), vec2(0.0), vec2(side - 1.0)));
+}
+
+/** Convert a level of detail to a virtual map level.
+ \param lod the level of detail
+ \return the virtual map level
+ */
+uint virtualLevel(float lod){
+	return min(uint(max(lod, 0.0)), levelCount - 1u);
+}
+
+/** Estimate the level of detail needed to sample the virtual map at a location, from its screen space derivatives.
+ \param uvDx the location derivative along the screen horizontal axis
+ \param uvDy the location derivative along the screen vertical axis
+ \return the level of detail
+ */
+float terrainLod(vec2 uvDx, vec2 uvDy){
+	const vec2 dx = uvDx * virtualSize;
+	const vec2 dy = uvDy * virtualSize;
+	return 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+}
+
+/** Sample the virtual map, falling back to a coarser level if the page is not resident.
+ \param uv the location in the map
+ \param lod the level of detail
+ \return the height in R and normal in GBA
+ */
+vec4 terrainSample(vec2 uv, float lod){
+	const uint level = virtualLevel(lod);
+	const uvec2 page = virtualPage(uv, level);
+	uint offset = 0u;
+	for(uint lid = 0u; lid < level; ++lid){
+		const uint side = pageCount >> lid;
+		offset += side * side;
+	}
+	const uint entry = pages[offset + page.y * (pageCount >> level) + page.x];
+	const uint slot = entry & 0xFFFFFFu;
+	const uint residentLevel = entry >> 24u;
+	// Position in the resident page.
+	const vec2 residentPage = vec2(virtualPage(uv, residentLevel));
+	const vec2 texel = uv * virtualSize / exp2(float(residentLevel)) - residentPage * pageSize;
+	// Stay in the page and its border at the map edges.
+	const vec2 slotTexel = clamp(texel, vec2(-0.5), vec2(pageSize + 0.5)) + pageBorder;
+	const vec2 slotOrigin = vec2(slot % slotsPerSide, slot / slotsPerSide) * (pageSize + 2.0 * pageBorder);
+	return textureLod(sampler2D(heightMap, sClampLinear), (slotOrigin + slotTexel) * invCacheSize, 0.0);
+}
+
+#else
+
+/** Sample the terrain map.
+ \param uv the location in the map
+ \param lod the level of detail
+ \return the height in R and normal in GBA
+ */
+vec4 terrainSample(vec2 uv, float lod){
+	return textureLod(sampler2D(heightMap, sClampLinearLinear), uv, lod);
+}
+
+#endif
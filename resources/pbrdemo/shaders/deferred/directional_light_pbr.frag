@@ -23,6 +23,7 @@ layout(set = 0, binding = 0) uniform UniformBlock {
 	float shadowBias; ///< shadow depth bias.
 	int shadowMode; ///< The shadow map technique.
 	int shadowLayer; ///< The shadow map layer.
+	vec4 shadowRegion; ///< The shadow map region in the layer (min and max UVs).
 };
 
 layout(location = 0) out vec3 fragColor; ///< Color.
@@ -51,6 +52,7 @@ void main(){
 	light.shadowMode = shadowMode;
 	light.layer = shadowLayer;
 	light.bias = shadowBias;
+	light.region = shadowRegion;
 
 	// Light shadowing and attenuation.
 	vec3 l;
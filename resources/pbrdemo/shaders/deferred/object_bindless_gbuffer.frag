@@ -0,0 +1,57 @@
+#include "samplers.glsl"
+#include "bindless.glsl"
+#include "materials.glsl"
+#include "utils.glsl"
+
+layout(location = 0) in INTERFACE {
+    mat4 tbn; ///< Normal to view matrix.
+	vec4 uv; ///< UV coordinates.
+} In ;
+
+/// Store the materials texture slots in the global table (SSBO): albedo, normal map, effects map.
+layout(std430, set = 3, binding = 0) readonly buffer MaterialTextures {
+	uvec4 materialTextures[];
+};
+
+layout (location = 0) out vec4 fragColor; ///< Color.
+layout (location = 1) out vec4 fragNormal; ///< View space normal.
+layout (location = 2) out vec4 fragEffects; ///< Effects.
+
+layout(set = 0, binding = 0) uniform UniformBlock {
+	bool hasUV; ///< Does the mesh have texture coordinates.
+	uint materialId; ///< Index of the material in the materials buffer.
+};
+
+/** Transfer albedo and effects (read from the global texture table) along with the material ID, and output the final normal 
+	(combining geometry normal and normal map) in view space. */
+void main(){
+	
+	uvec4 textureIds = materialTextures[materialId];
+	vec4 color = textureBindless(textureIds.x, sRepeatLinearLinear, In.uv.xy);
+	if(color.a <= 0.01){
+		discard;
+	}
+	
+	// Flip the up of the local frame for back facing fragments.
+	mat3 tbn = mat3(In.tbn);
+	tbn[2] *= (gl_FrontFacing ? 1.0 : -1.0);
+	// Compute the normal at the fragment using the tangent space matrix and the normal read in the normal map.
+	vec3 n;
+	if(hasUV){
+		n = textureBindless(textureIds.y, sRepeatLinearLinear, In.uv.xy).rgb;
+		n = normalize(n * 2.0 - 1.0);
+		n = normalize(tbn * n);
+	} else {
+		n = normalize(tbn[2]);
+	}
+	
+	// Store values.
+	fragColor.rgb = color.rgb;
+	fragColor.a = encodeMaterial(MATERIAL_STANDARD);
+	fragNormal.rg = encodeNormal(n);
+	fragNormal.ba = vec2(0.0);
+	vec3 infos = textureBindless(textureIds.z, sRepeatLinearLinear, In.uv.xy).rgb;
+	fragEffects.rb = infos.rb;
+	fragEffects.g = encodeMetalnessAndParameter(infos.g, 0.0);
+	fragEffects.a = 0.0;
+}
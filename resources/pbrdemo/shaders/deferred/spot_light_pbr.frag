@@ -21,6 +21,7 @@ layout(set = 0, binding = 0) uniform UniformBlock {
 	float shadowBias; ///< shadow depth bias.
 	int shadowMode; ///< The shadow map technique.
 	int shadowLayer; ///< The shadow map layer.
+	vec4 shadowRegion; ///< The shadow map region in the layer (min and max UVs).
 };
 
 layout(location = 0) out vec3 fragColor; ///< Color.
@@ -53,6 +54,7 @@ void main(){
 	light.shadowMode = shadowMode;
 	light.layer = shadowLayer;
 	light.bias = shadowBias;
+	light.region = shadowRegion;
 
 	// Light shadowing and attenuation.
 	vec3 l;
@@ -3,9 +3,15 @@
 #include "shadow_maps.glsl"
 #include "common_pbr.glsl"
 
-#define MAX_LIGHTS_COUNT 50
+#define MAX_LIGHTS_COUNT 2048
 #define MAX_PROBES_COUNT 4
 
+#define CLUSTERS_X 16
+#define CLUSTERS_Y 9
+#define CLUSTERS_Z 24
+#define MAX_CLUSTER_LIGHTS 64
+#define NO_CLUSTER 0xFFFFFFFFu
+
 /** \brief Represent a light in the forward renderer. */
 struct GPUPackedLight {
 	mat4 viewToLight; ///< View to light matrix.
@@ -14,6 +20,7 @@ struct GPUPackedLight {
 	vec4 directionAndPlane; ///< Light direction and far plane distance.
 	vec4 typeModeLayer; ///< Light type, shadow mode and shadow map layer.
 	vec4 angles; ///< Cone inner and outer angles.
+	vec4 shadowRegion; ///< Shadow map region in the layer (min and max UVs).
 };
 
 /** \brief Represent an environment probe. */
@@ -24,6 +31,70 @@ struct GPUPackedProbe {
 	vec4 extentAndSin; ///< The cubemap parallax box half size, and the cubemap parallax box orientation (precomputed sin).
 };
 
+/** \brief Lights and probes affecting a cluster of the view frustum. */
+struct GPUPackedCluster {
+	uint lightCount; ///< Number of lights.
+	uint probeMask; ///< Bitmask of the probes.
+	uint pad0; ///< Padding.
+	uint pad1; ///< Padding.
+	uint lights[MAX_CLUSTER_LIGHTS / 2]; ///< Light indices, packed two by two (16 bits each).
+};
+
+#ifndef CLUSTERS_ASSIGNMENT
+
+/// Per-cluster lists of lights and probes (SSBO).
+layout(std430, set = 3, binding = 5) readonly buffer Clusters {
+	GPUPackedCluster clusters[];
+};
+
+/** Find the cluster containing a fragment.
+ \param screenUV the fragment position in screen space
+ \param viewDepth the fragment distance along the view axis
+ \param zParams the slicing scale and bias, or zero if clustering is disabled
+ \return the cluster index, or NO_CLUSTER
+ */
+uint clusterIndex(vec2 screenUV, float viewDepth, vec2 zParams){
+	if(zParams.x == 0.0){
+		return NO_CLUSTER;
+	}
+	const int slice = clamp(int(log(max(viewDepth, 1e-4)) * zParams.x + zParams.y), 0, CLUSTERS_Z - 1);
+	const ivec2 tile = clamp(ivec2(screenUV * vec2(CLUSTERS_X, CLUSTERS_Y)), ivec2(0), ivec2(CLUSTERS_X - 1, CLUSTERS_Y - 1));
+	return uint((slice * CLUSTERS_Y + tile.y) * CLUSTERS_X + tile.x);
+}
+
+/** Number of lights to evaluate for a fragment.
+ \param cluster the fragment cluster
+ \param lightsCount the total number of lights
+ \return the number of lights
+ */
+uint clusterLightsCount(uint cluster, int lightsCount){
+	return cluster == NO_CLUSTER ? uint(lightsCount) : clusters[cluster].lightCount;
+}
+
+/** Retrieve the index of the i-th light to evaluate for a fragment.
+ \param cluster the fragment cluster
+ \param i the light rank
+ \return the light index in the lights buffer
+ */
+uint clusterLight(uint cluster, uint i){
+	if(cluster == NO_CLUSTER){
+		return i;
+	}
+	const uint pair = clusters[cluster].lights[i / 2];
+	return (i % 2 == 0) ? (pair & 0xFFFF) : (pair >> 16);
+}
+
+/** Check if a probe can affect a fragment.
+ \param cluster the fragment cluster
+ \param pid the probe index
+ \return true if the probe has to be evaluated
+ */
+bool clusterHasProbe(uint cluster, int pid){
+	return cluster == NO_CLUSTER || ((clusters[cluster].probeMask & (1u << uint(pid))) != 0u);
+}
+
+#endif
+
 /** Convert a forward renderer packed probe to the generic shader representation.
  \param srcProbe the packed probe
  \return the populated probe
@@ -57,6 +128,7 @@ Light unpackLight(GPUPackedLight srcLight){
 	light.shadowMode = uint(srcLight.typeModeLayer[1]);
 	light.layer = uint(srcLight.typeModeLayer[2]);
 	light.bias = srcLight.colorAndBias.w;
+	light.region = srcLight.shadowRegion;
 	return light;
 }
 
@@ -23,12 +23,13 @@ layout(set = 0, binding = 0) uniform UniformBlock {
 	vec2 invScreenSize; ///< Destination size.
 	int lightsCount; ///< Number of active lights.
 	int probesCount; ///< Number of active envmaps.
+	vec2 clustersParams; ///< Clusters depth slicing scale and bias (zero if disabled).
 	bool hasUV; ///< Does the mesh have UV coordinates.
 };
 
-/// Store the lights in a continuous buffer (UBO).
-layout(std140, set = 3, binding = 0) uniform Lights {
-	GPUPackedLight lights[MAX_LIGHTS_COUNT];
+/// Store the lights in a continuous buffer (SSBO).
+layout(std430, set = 3, binding = 0) readonly buffer Lights {
+	GPUPackedLight lights[];
 };
 
 /// Store the probes in a continuous buffer (UBO).
@@ -85,12 +86,17 @@ void main(){
 	vec3 v = normalize(-In.viewSpacePosition.xyz);
 	vec3 worldP = vec3(inverseV * vec4(In.viewSpacePosition.xyz, 1.0));
 
+	// Lights and probes affecting the fragment.
+	const uint cluster = clusterIndex(gl_FragCoord.xy * invScreenSize, -In.viewSpacePosition.z, clustersParams);
 	// Accumulate envmaps contributions.
 	fragColor = vec4(0.0);
 	for(int pid = 0; pid < MAX_PROBES_COUNT; ++pid){
 		if(pid >= probesCount){
 			break;
 		}
+		if(!clusterHasProbe(cluster, pid)){
+			continue;
+		}
 		Probe probe = unpackProbe(probes[pid]);
 		float weight = probeWeight(worldP, probe);
 
@@ -105,10 +111,9 @@ void main(){
 	}
 
 	// Accumulate direct lighting contributions.
-	for(int lid = 0; lid < MAX_LIGHTS_COUNT; ++lid){
-		if(lid >= lightsCount){
-			break;
-		}
+	const uint clusterLightCount = clusterLightsCount(cluster, lightsCount);
+	for(uint cid = 0; cid < clusterLightCount; ++cid){
+		const uint lid = clusterLight(cluster, cid);
 		float shadowing;
 		vec3 l;
 		if(!applyLight(lights[lid], In.viewSpacePosition.xyz, material.normal, shadowMapsCube, shadowMaps2D, l, shadowing)){
@@ -28,6 +28,7 @@ FilteringApp::FilteringApp(RenderingConfig & config, Window & window) :
 	_gaussianBlur	  = std::unique_ptr<GaussianBlur>(new GaussianBlur(_blurLevel, 1, "Filter"));
 	_boxBlur		   = std::unique_ptr<BoxBlur>(new BoxBlur(false, "Filter"));
 	_floodFill		   = std::unique_ptr<FloodFiller>(new FloodFiller(renderWidth, renderHeight));
+	updateImplementation();
 
 	_painter = std::unique_ptr<PaintingTool>(new PaintingTool(renderWidth, renderHeight));
 
@@ -73,6 +74,7 @@ void FilteringApp::draw() {
 
 	const Texture * finalTexID = srcTexID;
 
+	_filterTime.begin();
 	switch(_mode) {
 		case Processing::FILL:
 			_pyramidFiller->process(*srcTexID);
@@ -98,6 +100,7 @@ void FilteringApp::draw() {
 			// Show the input.
 			break;
 	}
+	_filterTime.end();
 
 	// Render the output on screen.
 	GPU::setDepthState(false);
@@ -120,6 +123,7 @@ void FilteringApp::update() {
 		// Infos.
 		ImGui::Text("%.1f ms, %.1f fps", frameTime() * 1000.0f, frameRate());
 		ImGui::Text("Input resolution: %ix%i", _sceneColor.width, _sceneColor.height);
+		ImGui::Text("Filter: %.3fms", float(_filterTime.value())/1000000.0f);
 		ImGui::Separator();
 
 		// View settings.
@@ -181,6 +185,9 @@ void FilteringApp::update() {
 
 void FilteringApp::showModeOptions() {
 	ImGui::Combo("Mode", reinterpret_cast<int *>(&_mode), "Input\0Poisson fill\0Integrate\0Box blur\0Gaussian blur\0Flood fill\0\0");
+	if(ImGui::Checkbox("Compute shaders", &_useCompute)) {
+		updateImplementation();
+	}
 
 	const glm::vec2 renderRes = _config.renderingResolution();
 	const unsigned int width  = uint(renderRes[0]);
@@ -191,6 +198,7 @@ void FilteringApp::showModeOptions() {
 			if(ImGui::InputInt("Levels", &_blurLevel, 1, 2)) {
 				_blurLevel = std::min(std::max(1, _blurLevel), 10);
 				_gaussianBlur.reset(new GaussianBlur(_blurLevel, 1, "Filter"));
+				updateImplementation();
 			}
 			break;
 		case Processing::FILL:
@@ -198,6 +206,7 @@ void FilteringApp::showModeOptions() {
 			if(ImGui::InputInt("Pyramid downscale", &_fillDownscale, 1, 2)) {
 				_fillDownscale = std::max(_fillDownscale, 1);
 				_pyramidFiller = std::unique_ptr<PoissonFiller>(new PoissonFiller(width, height, _fillDownscale));
+				updateImplementation();
 			}
 			break;
 		case Processing::INTEGRATE:
@@ -205,6 +214,7 @@ void FilteringApp::showModeOptions() {
 			if(ImGui::InputInt("Pyramid downscale", &_intDownscale, 1, 2)) {
 				_intDownscale = std::max(_intDownscale, 1);
 				_pyramidIntegrator = std::unique_ptr<LaplacianIntegrator>(new LaplacianIntegrator(width, height, _intDownscale));
+				updateImplementation();
 			}
 			break;
 		case Processing::FLOODFILL:
@@ -215,6 +225,14 @@ void FilteringApp::showModeOptions() {
 	}
 }
 
+void FilteringApp::updateImplementation() {
+	_pyramidFiller->useCompute(_useCompute);
+	_pyramidIntegrator->useCompute(_useCompute);
+	_gaussianBlur->useCompute(_useCompute);
+	_boxBlur->useCompute(_useCompute);
+	_floodFill->useCompute(_useCompute);
+}
+
 void FilteringApp::physics(double, double) {
 }
 
@@ -64,6 +64,9 @@ private:
 	/** Display mode-specific GUI options. */
 	void showModeOptions();
 
+	/** Apply the selected implementation (rasterization or compute shaders) to all filters. */
+	void updateImplementation();
+
 	Texture _sceneColor; ///< Scene rendering color texture.
 	Texture _sceneDepth; ///< Scene rendering depth texture.
 
@@ -86,4 +89,6 @@ private:
 	int _intDownscale   = 1;	 ///< Integrator internal resolution downscaling.
 	int _fillDownscale  = 1;	 ///< Poisson filling internal resolution downscaling.
 	bool _showProcInput = false; ///< Option to show the input for both convolution filters.
+	bool _useCompute	= false; ///< Use compute shaders implementations of the filters.
+	GPUQuery _filterTime;		 ///< Timing for the current filter.
 };
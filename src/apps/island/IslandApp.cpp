@@ -34,6 +34,8 @@ IslandApp::IslandApp(RenderingConfig & config, Window & window) : CameraApp(conf
 	// Atmosphere screen quad.
 	_skyProgram = Resources::manager().getProgram("atmosphere_island", "background_infinity", "atmosphere_island");
 	_groundProgram = Resources::manager().getProgram("ground_island");
+	_groundVirtualProgram = Resources::manager().getProgram("ground_island_virtual");
+	_groundFeedbackProgram = Resources::manager().getProgram("ground_island_feedback", "ground_island_virtual", "ground_island_feedback");
 	_oceanProgram = Resources::manager().getProgram("ocean_island", "ocean_island", "ocean_island", "ocean_island", "ocean_island");
 	_farOceanProgram = Resources::manager().getProgram("far_ocean_island", "far_ocean_island", "ocean_island");
 	_waterCopy = Resources::manager().getProgram2D("water_copy");
@@ -184,6 +186,35 @@ void IslandApp::draw() {
 		_shouldUpdateSky = false;
 	}
 
+	// Clamp the terrain grid center based on the terrain heightmap dimensions in world space.
+	const float extent = 0.25f * std::abs(float(_terrain->mapSize()) * _terrain->texelSize() - 0.5f*_terrain->meshSize());
+	glm::vec3 frontPosClamped = glm::clamp(camPos + camDir, -extent, extent);
+	frontPosClamped[1] = 0.0f;
+	if(_showTerrain){
+		_terrain->cull(mvp, camPos, frontPosClamped);
+	}
+
+	// Generate missing virtual map pages, and request the ones needed by the current view.
+	_terrain->update();
+	VirtualHeightMap * virtualMap = _terrain->virtualMap();
+	if(_showTerrain && virtualMap && virtualMap->beginFeedback()){
+		GPU::setDepthState(true, TestFunction::LESS, true);
+		GPU::setCullState(true, Faces::BACK);
+		GPU::setBlendState(false);
+
+		_groundFeedbackProgram->use();
+		_groundFeedbackProgram->uniform("mvp", mvp);
+		_groundFeedbackProgram->uniform("shift", frontPosClamped);
+		_groundFeedbackProgram->uniform("texelSize", _terrain->texelSize());
+		_groundFeedbackProgram->uniform("invMapSize", 1.0f/float(_terrain->mapSize()));
+		_groundFeedbackProgram->uniform("invGridSize", 1.0f/float(_terrain->gridSize()));
+		// Derivatives are larger at the feedback resolution.
+		_groundFeedbackProgram->uniform("lodBias", std::log2(float(virtualMap->feedback().width) / float(_sceneColor.width)));
+		virtualMap->bind(*_groundFeedbackProgram, 0, 0);
+		drawTerrainCells(*_groundFeedbackProgram, false);
+		virtualMap->endFeedback();
+	}
+
 	GPU::beginRender(1.0f, Load::Operation::DONTCARE, &_sceneDepth, glm::vec4(0.0f), &_sceneColor, &_scenePosition);
 	GPU::setViewport(_sceneColor);
 	
@@ -193,57 +224,29 @@ void IslandApp::draw() {
 
 	// Render the ground.
 	if(_showTerrain){
-
-		const glm::vec3 frontPos = camPos + camDir;
-		// Clamp based on the terrain heightmap dimensions in world space.
-		const float extent = 0.25f * std::abs(float(_terrain->map().width) * _terrain->texelSize() - 0.5f*_terrain->meshSize());
-		glm::vec3 frontPosClamped = glm::clamp(frontPos, -extent, extent);
-		frontPosClamped[1] = 0.0f;
-
-		// Compensate for grid translation.
-		const Frustum camFrustum(mvp);
-
-		_groundProgram->use();
-		_groundProgram->uniform("mvp", mvp);
-		_groundProgram->uniform("shift", frontPosClamped);
-		_groundProgram->uniform("lightDirection", _lightDirection);
-		_groundProgram->uniform("camDir", camDir);
-		_groundProgram->uniform("camPos", camPos);
-		_groundProgram->uniform("texelSize", _terrain->texelSize());
-		_groundProgram->uniform("invMapSize", 1.0f/float(_terrain->map().width));
-		_groundProgram->uniform("invGridSize", 1.0f/float(_terrain->gridSize()));
-
-		_groundProgram->texture(_terrain->map(), 0);
-		_groundProgram->texture(_terrain->shadowMap(), 1);
-		_groundProgram->texture(_surfaceNoise, 2);
-		_groundProgram->texture(_glitterNoise, 3);
-		_groundProgram->texture(_sandMapSteep, 4);
-		_groundProgram->texture(_sandMapFlat, 5);
-
-
-		for(const Terrain::Cell & cell : _terrain->cells()){
-			// Compute equivalent of vertex shader vertex transformation.
-			const float levelSize = std::exp2(float(cell.level)) * _terrain->texelSize();
-			glm::vec3 mini = _terrain->texelSize() * cell.mesh.bbox.minis + glm::round(frontPosClamped/levelSize) * levelSize;
-			glm::vec3 maxi = _terrain->texelSize() * cell.mesh.bbox.maxis + glm::round(frontPosClamped/levelSize) * levelSize;
-			mini[1] = -5.0f; maxi[1] = 5.0f;
-			BoundingBox box(mini, maxi);
-			if(!camFrustum.intersects(box)){
-				continue;
-			}
-			_groundProgram->uniform("debugCol", false);
-			GPU::drawMesh(cell.mesh);
-
-			// Debug view.
-			if(_showWire){
-				GPU::setPolygonState(PolygonMode::LINE);
-				GPU::setDepthState(true, TestFunction::LEQUAL, true);
-				_groundProgram->uniform("debugCol", true);
-				GPU::drawMesh(cell.mesh);
-				GPU::setPolygonState(PolygonMode::FILL);
-				GPU::setDepthState(true, TestFunction::LESS, true);
-			}
+		Program * groundProgram = virtualMap ? _groundVirtualProgram : _groundProgram;
+		groundProgram->use();
+		groundProgram->uniform("mvp", mvp);
+		groundProgram->uniform("shift", frontPosClamped);
+		groundProgram->uniform("lightDirection", _lightDirection);
+		groundProgram->uniform("camDir", camDir);
+		groundProgram->uniform("camPos", camPos);
+		groundProgram->uniform("texelSize", _terrain->texelSize());
+		groundProgram->uniform("invMapSize", 1.0f/float(_terrain->mapSize()));
+		groundProgram->uniform("invGridSize", 1.0f/float(_terrain->gridSize()));
+
+		if(virtualMap){
+			virtualMap->bind(*groundProgram, 0, 0);
+		} else {
+			groundProgram->texture(_terrain->map(), 0);
 		}
+		groundProgram->texture(_terrain->shadowMap(), 1);
+		groundProgram->texture(_surfaceNoise, 2);
+		groundProgram->texture(_glitterNoise, 3);
+		groundProgram->texture(_sandMapSteep, 4);
+		groundProgram->texture(_sandMapFlat, 5);
+
+		drawTerrainCells(*groundProgram, _showWire);
 	}
 	
 	// Render the sky.
@@ -315,7 +318,7 @@ void IslandApp::draw() {
 		_oceanProgram->uniform("time", time);
 		_oceanProgram->uniform("invTargetSize", invRenderSize);
 		_oceanProgram->uniform("invTexelSize", 1.0f/_terrain->texelSize());
-		_oceanProgram->uniform("invMapSize", 1.0f/float(_terrain->map().width));
+		_oceanProgram->uniform("invMapSize", 1.0f/float(_terrain->mapSize()));
 		_oceanProgram->uniform("useTerrain", _showTerrain);
 
 		_oceanProgram->buffer(_waves, 0);
@@ -408,7 +411,7 @@ void IslandApp::draw() {
 			_farOceanProgram->uniform("invTargetSize", invRenderSize);
 			_farOceanProgram->uniform("underwater", isUnderwater);
 			_farOceanProgram->uniform("invTexelSize", 1.0f/_terrain->texelSize());
-			_farOceanProgram->uniform("invMapSize", 1.0f/float(_terrain->map().width));
+			_farOceanProgram->uniform("invMapSize", 1.0f/float(_terrain->mapSize()));
 			_farOceanProgram->uniform("useTerrain", _showTerrain);
 
 			_farOceanProgram->buffer(_waves, 0);
@@ -452,6 +455,22 @@ void IslandApp::draw() {
 	GPU::endRender();
 }
 
+void IslandApp::drawTerrainCells(Program & program, bool showWire){
+	program.buffer(_terrain->cellsBuffer(), 1);
+	program.uniform("debugCol", false);
+	_terrain->drawCells();
+
+	// Debug view.
+	if(showWire){
+		GPU::setPolygonState(PolygonMode::LINE);
+		GPU::setDepthState(true, TestFunction::LEQUAL, true);
+		program.uniform("debugCol", true);
+		_terrain->drawCells();
+		GPU::setPolygonState(PolygonMode::FILL);
+		GPU::setDepthState(true, TestFunction::LESS, true);
+	}
+}
+
 void IslandApp::update() {
 	CameraApp::update();
 
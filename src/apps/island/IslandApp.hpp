@@ -54,6 +54,12 @@ private:
 	/** Generate waves with random parameters in predefined ranges. */
 	void generateWaves();
 
+	/** Draw the visible terrain grid cells with a program already set up.
+	 \param program the terrain program
+	 \param showWire should the wireframe be displayed over the cells
+	 */
+	void drawTerrainCells(Program & program, bool showWire);
+
 	// Buffers.
 	Texture _sceneColor; 		///< Scene lighting.
 	Texture _scenePosition; 	///< Scene positions.
@@ -84,6 +90,8 @@ private:
 
 	// Shaders.
 	Program * _groundProgram; ///< Terrain shader.
+	Program * _groundVirtualProgram; ///< Terrain shader, sampling the virtual map.
+	Program * _groundFeedbackProgram; ///< Virtual map pages request shader.
 	Program * _oceanProgram; ///< Ocean shader.
 	Program * _farOceanProgram; ///< Distant ocean simplified shader.
 	Program * _waterCopy; ///< Apply underwater terrain effects (caustics).
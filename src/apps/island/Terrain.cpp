@@ -1,10 +1,10 @@
 #include "Terrain.hpp"
 #include "resources/ResourcesManager.hpp"
 #include "graphics/GPU.hpp"
+#include "system/System.hpp"
 
+#include <limits>
 
-Terrain::Cell::Cell(uint l, uint x, uint z) : mesh("Cell (" + std::to_string(l) + "," + std::to_string(x) + "," + std::to_string(z) + ")"), level(l) {
-}
 
 Terrain::Terrain(uint resolution, uint seed) : _shadowMap("Terrain shadow"), _gaussBlur(2, 1, "Terrain"), _resolution(resolution), _seed(seed) {
 	generateMesh();
@@ -14,10 +14,12 @@ Terrain::Terrain(uint resolution, uint seed) : _shadowMap("Terrain shadow"), _ga
 
 void Terrain::generateMesh(){
 	// Clear any existing mesh.
-	for(Cell & cell : _cells){
-		cell.mesh.clean();
-	}
+	_grid.clean();
 	_cells.clear();
+	_patches.clear();
+	// Distinct cell geometries, relative to the cell origin and in units of the cell level.
+	std::vector<std::vector<glm::vec3>> patchPositions;
+	std::vector<std::vector<uint>> patchIndices;
 
 	const int numLevels = _mshOpts.levels;
 	const int baseLevelTexelSize = _mshOpts.size;
@@ -134,65 +136,221 @@ void Terrain::generateMesh(){
 				if(positions.empty()){
 					continue;
 				}
-				_cells.emplace_back(lid, cellX, cellZ);
-				_cells.back().level = lid;
-				Mesh & mesh = _cells.back().mesh;
-				mesh.clean();
-				mesh.positions = positions;
-				mesh.indices = indices;
+				Cell cell;
+				cell.level = lid;
+				cell.origin = glm::vec2(bounds[cellX], bounds[cellZ]);
+				cell.bbox = BoundingBox(positions[0], positions[0]);
+				for(const glm::vec3 & pos : positions){
+					cell.bbox.merge(pos);
+				}
+				// Cells with the same geometry relative to their origin share the same patch.
+				const float invSize = 1.0f / float(currSize);
+				for(glm::vec3 & pos : positions){
+					pos = glm::vec3((pos.x - cell.origin.x) * invSize, 0.0f, (pos.z - cell.origin.y) * invSize);
+				}
+				cell.patch = 0;
+				while(cell.patch < patchPositions.size() && (patchPositions[cell.patch] != positions || patchIndices[cell.patch] != indices)){
+					++cell.patch;
+				}
+				if(cell.patch == patchPositions.size()){
+					patchPositions.push_back(positions);
+					patchIndices.push_back(indices);
+				}
+				_cells.push_back(cell);
 			}
 		}
 	}
-	for(Cell & cell : _cells){
-		cell.mesh.computeBoundingBox();
-		cell.mesh.upload();
+	// Instances of a patch have to be contiguous.
+	std::stable_sort(_cells.begin(), _cells.end(), [](const Cell & a, const Cell & b){
+		return a.patch < b.patch;
+	});
+
+	// Gather all patches in the same mesh.
+	for(size_t pid = 0; pid < patchPositions.size(); ++pid){
+		Patch patch;
+		patch.firstIndex = uint(_grid.indices.size());
+		patch.indexCount = uint(patchIndices[pid].size());
+		const uint firstVertex = uint(_grid.positions.size());
+		for(const uint index : patchIndices[pid]){
+			_grid.indices.push_back(firstVertex + index);
+		}
+		_grid.positions.insert(_grid.positions.end(), patchPositions[pid].begin(), patchPositions[pid].end());
+		_patches.push_back(patch);
+	}
+	_grid.computeBoundingBox();
+	_grid.upload();
+
+	// One copy of the visible cells and draw commands per frame in flight.
+	_frames.clear();
+	_frames.resize(GPU::framesInFlight());
+	for(FrameData & frame : _frames){
+		frame.instances.reset(new Buffer(std::max(_cells.size(), size_t(1)) * sizeof(glm::vec4), BufferType::INDIRECT, "Terrain cells"));
+		frame.commands.reset(new Buffer(std::max(_patches.size(), size_t(1)) * sizeof(DrawCommand), BufferType::INDIRECT, "Terrain commands"));
 	}
+	_instances.reserve(_cells.size());
+	_commands.resize(_patches.size());
 }
 
-void Terrain::generateMap(){
+void Terrain::cull(const glm::mat4 & vp, const glm::vec3 & eye, const glm::vec3 & shift){
+	_current = GPU::frameIndex();
+	FrameData & frame = _frames[_current];
+
+	for(size_t pid = 0; pid < _patches.size(); ++pid){
+		DrawCommand & command = _commands[pid];
+		command.indexCount = _patches[pid].indexCount;
+		command.instanceCount = 0;
+		command.firstIndex = _patches[pid].firstIndex;
+		command.vertexOffset = 0;
+		command.firstInstance = 0;
+	}
+	_instances.clear();
+
+	// Margin for the filtering of heights in the vertex shader.
+	const float margin = 0.1f;
+	const Frustum frustum(vp);
+	for(const Cell & cell : _cells){
+		// Compute equivalent of vertex shader vertex transformation.
+		const float levelSize = std::exp2(float(cell.level)) * _texelSize;
+		const glm::vec3 gridShift = glm::round(shift/levelSize) * levelSize;
+		glm::vec3 mini = _texelSize * cell.bbox.minis + gridShift;
+		glm::vec3 maxi = _texelSize * cell.bbox.maxis + gridShift;
+		const glm::vec2 heights = heightRange(glm::vec2(mini.x, mini.z), glm::vec2(maxi.x, maxi.z));
+		mini.y = heights[0] - margin;
+		maxi.y = heights[1] + margin;
+		const BoundingBox box(mini, maxi);
+		if(!frustum.intersects(box) || hiddenByHorizon(box, eye, margin)){
+			continue;
+		}
+		DrawCommand & command = _commands[cell.patch];
+		if(command.instanceCount == 0){
+			command.firstInstance = uint(_instances.size());
+		}
+		++command.instanceCount;
+		_instances.emplace_back(cell.origin, float(cell.level), 0.0f);
+	}
+	_visibleCells = uint(_instances.size());
 
-	Random::seed(_seed);
+	if(!_instances.empty()){
+		frame.instances->upload(_instances);
+	}
+	if(!_commands.empty()){
+		frame.commands->upload(_commands);
+	}
+}
 
-	Image heightMap(_resolution, _resolution, 1);
-	// Generate FBM noise with multiple layers of Perlin noise.
-	_perlin.generateLayers(heightMap, 0, _genOpts.octaves, _genOpts.gain, _genOpts.lacunarity, _genOpts.scale);
+void Terrain::drawCells() const {
+	GPU::drawIndirect(_grid, *_frames[_current].commands, 0, uint(_patches.size()));
+}
 
-	// Adjust to create the island overall shape and scale.
-	const float invSize = 1.0f/float(heightMap.width);
-	for(uint y = 0; y < heightMap.height; ++y){
-		for(uint x = 0; x < heightMap.width; ++x){
-			// Compute UV.
-			const glm::vec2 uv = 2.0f * invSize * glm::vec2(x,y) - 1.0f;
-			const float dst2 = glm::dot(uv, uv);
-			const float scale = _genOpts.rescale * std::pow(std::max(1.0f - dst2, 0.0f), _genOpts.falloff);
-			const float val = heightMap.r(x,y);
-			heightMap.r(x,y) = _genOpts.maxHeight * (scale * (val + 1.0f) - 1.0f);
+bool Terrain::hiddenByHorizon(const BoundingBox & box, const glm::vec3 & eye, float margin) const {
+	const glm::vec2 eyePos(eye.x, eye.z);
+	const glm::vec2 center(0.5f * (box.minis.x + box.maxis.x), 0.5f * (box.minis.z + box.maxis.z));
+	const float radius = 0.5f * glm::length(glm::vec2(box.maxis.x - box.minis.x, box.maxis.z - box.minis.z));
+	if(glm::distance(eyePos, center) <= radius){
+		return false;
+	}
+	const int sampleCount = 8;
+	for(int sid = 1; sid < sampleCount; ++sid){
+		// Section of the cone from the viewpoint to the box footprint.
+		const float t = float(sid) / float(sampleCount);
+		const glm::vec2 sectionCenter = glm::mix(eyePos, center, t);
+		const float sectionRadius = t * radius;
+		const float lowest = heightRange(sectionCenter - sectionRadius, sectionCenter + sectionRadius)[0] - margin;
+		// All rays toward the box pass below the terrain in this section.
+		if(lowest > eye.y + t * (box.maxis.y - eye.y)){
+			return true;
 		}
 	}
+	return false;
+}
 
-	// Then smooth to avoid pinches.
-	Image dst(heightMap.width, heightMap.height, 1);
-	for(int y = 0; y < int(heightMap.height); ++y){
-		for(int x = 0; x < int(heightMap.width); ++x){
-			const int xm = std::max(x-1, 0);
-			const int xp = std::min(x+1, int(heightMap.width)-1);
-			const int ym = std::max(y-1, 0);
-			const int yp = std::min(y+1, int(heightMap.height)-1);
-			const float & rN = heightMap.r(xm, y);
-			const float & rS = heightMap.r(xp, y);
-			const float & rW = heightMap.r(x, ym);
-			const float & rE = heightMap.r(x, yp);
-			const float & r  = heightMap.r(x,y);
-			const float newHeight = 0.35f * r + 0.25f * 0.65f * (rN + rS + rW + rE);
-			dst.r(x,y) = newHeight;
+glm::vec2 Terrain::heightRange(const glm::vec2 & mini, const glm::vec2 & maxi) const {
+	// Texels of the low res map covering the region.
+	const int size = int(_minHeights[0].width);
+	const float scale = float(size) / float(mapSize());
+	const float halfMapSize = 0.5f * float(mapSize());
+	const glm::ivec2 maxPos(size - 1);
+	glm::ivec2 first = glm::clamp(glm::ivec2(glm::floor((mini / _texelSize + halfMapSize) * scale)), glm::ivec2(0), maxPos);
+	glm::ivec2 last = glm::clamp(glm::ivec2(glm::floor((maxi / _texelSize + halfMapSize) * scale)), glm::ivec2(0), maxPos);
+	// Pick the level at which the region covers at most 2x2 texels.
+	size_t level = 0;
+	while(level + 1 < _minHeights.size() && ((last.x >> level) - (first.x >> level) > 1 || (last.y >> level) - (first.y >> level) > 1)){
+		++level;
+	}
+	first = glm::ivec2(first.x >> level, first.y >> level);
+	last = glm::ivec2(last.x >> level, last.y >> level);
+
+	glm::vec2 range(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+	for(int y = first.y; y <= last.y; ++y){
+		for(int x = first.x; x <= last.x; ++x){
+			range[0] = std::min(range[0], _minHeights[level].r(x, y));
+			range[1] = std::max(range[1], _maxHeights[level].r(x, y));
 		}
 	}
-	// Final copy.
-	for(int y = 0; y < int(heightMap.height); ++y){
-		for(int x = 0; x < int(heightMap.width); ++x){
-			heightMap.r(x,y) = dst.r(x,y);
+	return range;
+}
+
+void Terrain::buildHeightBounds(){
+	while(_minHeights.back().width > 1 || _minHeights.back().height > 1){
+		const size_t lid = _minHeights.size();
+		const int prevWidth = int(_minHeights[lid-1].width);
+		const int prevHeight = int(_minHeights[lid-1].height);
+		const int w = std::max((prevWidth + 1) / 2, 1);
+		const int h = std::max((prevHeight + 1) / 2, 1);
+		_minHeights.emplace_back(w, h, 1);
+		_maxHeights.emplace_back(w, h, 1);
+		const Image & prevMin = _minHeights[lid-1];
+		const Image & prevMax = _maxHeights[lid-1];
+		Image & currMin = _minHeights[lid];
+		Image & currMax = _maxHeights[lid];
+		for(int y = 0; y < h; ++y){
+			for(int x = 0; x < w; ++x){
+				const int x0 = 2 * x;
+				const int y0 = 2 * y;
+				const int x1 = std::min(x0 + 1, prevWidth - 1);
+				const int y1 = std::min(y0 + 1, prevHeight - 1);
+				currMin.r(x,y) = std::min(std::min(prevMin.r(x0, y0), prevMin.r(x1, y0)), std::min(prevMin.r(x0, y1), prevMin.r(x1, y1)));
+				currMax.r(x,y) = std::max(std::max(prevMax.r(x0, y0), prevMax.r(x1, y0)), std::max(prevMax.r(x0, y1), prevMax.r(x1, y1)));
+			}
 		}
 	}
+}
+
+void Terrain::generateMap(){
+
+	Random::seed(_seed);
+
+	if(_virtOpts.enabled){
+		// The full resolution map is replaced by pages generated on demand.
+		_map.clean();
+		_virtualMap.reset(new VirtualHeightMap(uint(_virtOpts.size), 128, uint(_virtOpts.cacheSize), [this](const glm::ivec2 & first, uint level, Image & tile){
+			generateTile(first, level, tile);
+		}));
+		// Low res version covering the whole virtual map, for shadows.
+		const uint lowResSize = uint(_resolution/2);
+		_mapLowRes.width = _mapLowRes.height = lowResSize;
+		_mapLowRes.levels = _mapLowRes.depth = 1;
+		_mapLowRes.shape = TextureShape::D2;
+		_mapLowRes.clean();
+		_mapLowRes.images.emplace_back(lowResSize, lowResSize, 1);
+		const float step = float(_virtualMap->size()) / float(lowResSize);
+		Image & lowRes = _mapLowRes.images[0];
+		generateHeights(lowRes, glm::vec2(0.5f * step - 0.5f), step);
+		_mapLowRes.upload(Layout::R32F, false);
+		// Height bounds for culling are approximated from the low res samples.
+		_minHeights.clear();
+		_maxHeights.clear();
+		_minHeights.emplace_back(lowResSize, lowResSize, 1);
+		_maxHeights.emplace_back(lowResSize, lowResSize, 1);
+		_minHeights[0].pixels = lowRes.pixels;
+		_maxHeights[0].pixels = lowRes.pixels;
+		buildHeightBounds();
+		return;
+	}
+	_virtualMap.reset();
+
+	Image heightMap(_resolution, _resolution, 1);
+	generateHeights(heightMap, glm::vec2(0.0f), 1.0f);
 
 	// Erosion.
 	if(_erOpts.apply){
@@ -204,102 +362,234 @@ void Terrain::generateMap(){
 
 }
 
+void Terrain::update(){
+	if(_virtualMap){
+		_virtualMap->update(uint(std::max(_virtOpts.pagesPerFrame, 1)));
+	}
+}
+
+uint Terrain::mapSize() const {
+	return _virtualMap ? _virtualMap->size() : uint(_resolution);
+}
+
+void Terrain::generateHeights(Image & heightMap, const glm::vec2 & origin, float step){
+
+	// Generate FBM noise with multiple layers of Perlin noise.
+	_perlin.generateLayers(heightMap, 0, _genOpts.octaves, _genOpts.gain, _genOpts.lacunarity, _genOpts.scale, origin, step);
+
+	// Adjust to create the island overall shape and scale.
+	const int width = int(heightMap.width);
+	const int height = int(heightMap.height);
+	const float invSize = 1.0f/float(mapSize());
+	System::forParallel(0, height, [&heightMap, &origin, step, width, invSize, this](size_t y){
+		float * row = &heightMap.r(0, int(y));
+		const float v = 2.0f * invSize * (origin.y + step * float(y)) - 1.0f;
+		for(int x = 0; x < width; ++x){
+			// Compute UV.
+			const float u = 2.0f * invSize * (origin.x + step * float(x)) - 1.0f;
+			const float dst2 = u * u + v * v;
+			const float scale = _genOpts.rescale * std::pow(std::max(1.0f - dst2, 0.0f), _genOpts.falloff);
+			row[x] = _genOpts.maxHeight * (scale * (row[x] + 1.0f) - 1.0f);
+		}
+	});
+
+	// Then smooth to avoid pinches.
+	Image dst(heightMap.width, heightMap.height, 1);
+	System::forParallel(0, height, [&heightMap, &dst, width, height](size_t y){
+		const int ym = std::max(int(y)-1, 0);
+		const int yp = std::min(int(y)+1, height-1);
+		const float * rowM = &heightMap.r(0, ym);
+		const float * row = &heightMap.r(0, int(y));
+		const float * rowP = &heightMap.r(0, yp);
+		float * dstRow = &dst.r(0, int(y));
+		// Borders are clamped.
+		const int last = width - 1;
+		dstRow[0] = 0.35f * row[0] + 0.25f * 0.65f * (row[0] + row[std::min(1, last)] + rowM[0] + rowP[0]);
+		for(int x = 1; x < last; ++x){
+			dstRow[x] = 0.35f * row[x] + 0.25f * 0.65f * (row[x-1] + row[x+1] + rowM[x] + rowP[x]);
+		}
+		if(last > 0){
+			dstRow[last] = 0.35f * row[last] + 0.25f * 0.65f * (row[last-1] + row[last] + rowM[last] + rowP[last]);
+		}
+	});
+	std::swap(heightMap.pixels, dst.pixels);
+}
+
+void Terrain::generateTile(const glm::ivec2 & first, uint level, Image & tile){
+	// Extra texels around the tile so that smoothing (one texel) and normals (four texels)
+	// don't reach the clamped borders.
+	const int margin = 5;
+	const float step = float(1u << level);
+	Image heightMap(tile.width + 2 * margin, tile.height + 2 * margin, 1);
+	// Texel centers of the level, in texels of the finest level.
+	const glm::vec2 origin = (glm::vec2(first - margin) + 0.5f) * step - 0.5f;
+	generateHeights(heightMap, origin, step);
+	computeNormals(heightMap, tile, margin, step * _texelSize);
+}
+
 void Terrain::erode(Image & img){
 
 	const glm::ivec2 maxPos = glm::ivec2(img.width-1);
-	for(int did = 0; did < _erOpts.dropsCount; ++did){
-		// Draw a point at random.
-		glm::vec2 pos(Random::Float(0.0f, float(maxPos[0])), Random::Float(0.0f, float(maxPos[1])));
-		glm::vec2 dir(0.0f, 0.0f);
-		float velocity = 1.0f;
-		float water = 1.0f;
-		float sediment = 0.0f;
-
-		for(int sid = 0; sid < _erOpts.stepsMax; ++sid){
-			if(water < 0.00001f){
-				break;
-			}
-			// Gradient computation based on the four surrounding texels.
-			glm::ivec2 ipos = glm::floor(pos); // nodeXY
-			ipos = glm::clamp(ipos, glm::ivec2(0), maxPos);
-			const glm::ivec2 inpos = glm::min(ipos+1, maxPos);
-
-			const glm::vec2 dpos = pos - glm::vec2(ipos); // cellOffset
-			const float h00 = img.r( ipos[0],  ipos[1]);
-			const float h10 = img.r(inpos[0],  ipos[1]);
-			const float h01 = img.r( ipos[0], inpos[1]);
-			const float h11 = img.r(inpos[0], inpos[1]);
-			const glm::vec2 grad((h10 - h00) * (1.0f - dpos.y) + (h11 - h01) * (dpos.y),
-								 (h01 - h00) * (1.0f - dpos.x) + (h11 - h10) * (dpos.x));
-
-			// We go down the slope, with some inertia.
-			dir = _erOpts.inertia * dir - (1.0f - _erOpts.inertia) * grad;
-			if(dir[0] != 0.0f || dir[1] != 0.0f){
-				dir = glm::normalize(dir);
-			}
+	const int height = int(img.height);
 
-			const glm::vec2 oldPos = pos;
-			pos += dir;
+	// Draw all starting points at random first, so that the result only depends on the seed.
+	std::vector<glm::vec2> starts(std::max(_erOpts.dropsCount, 0));
+	for(glm::vec2 & start : starts){
+		start[0] = Random::Float(0.0f, float(maxPos[0]));
+		start[1] = Random::Float(0.0f, float(maxPos[1]));
+	}
 
-			if((dir[0] == 0.0f && dir[1] == 0.0f) || pos[0] < 0.0f || pos[1] < 0.0f || pos[0] >= maxPos[0] || pos[1] >= maxPos[1]){
-				break;
-			}
-			const float oldHeight = h00 * (1.0f - dpos.x) * (1.0f - dpos.y) + h10 * (1.0f - dpos.y) * dpos.x + h01 * (1.0f - dpos.x) * dpos.y + h11 * dpos.x * dpos.y;
-			float newHeight = oldHeight;
-			{
-				glm::ivec2 nipos = glm::floor(pos);
-				nipos = glm::clamp(nipos, glm::ivec2(0), maxPos);
-				const glm::ivec2 ninpos = glm::min(nipos+1, maxPos);
-				const glm::vec2 ndpos = pos - glm::vec2(nipos);
-				const float nh00 = img.r( nipos[0],  nipos[1]);
-				const float nh10 = img.r(ninpos[0],  nipos[1]);
-				const float nh01 = img.r( nipos[0], ninpos[1]);
-				const float nh11 = img.r(ninpos[0], ninpos[1]);
-				newHeight = nh00 * (1.0f - ndpos.x) * (1.0f - ndpos.y) + nh10 * (1.0f - ndpos.y) * ndpos.x + nh01 * (1.0f - ndpos.x) * ndpos.y + nh11 * ndpos.x * ndpos.y;
-			}
+	// Precompute the gathering kernel, decreasing linearly with the distance.
+	const int rad = std::max(_erOpts.gatherRadius, 0);
+	const int tsize = 2*rad+1;
+	std::vector<float> kernel(tsize * tsize);
+	float total = 0.0f;
+	for(int dy = -rad; dy <= rad; ++dy){
+		for(int dx = -rad; dx <= rad; ++dx){
+			const float wi = std::max(0.0f, float(rad) - std::sqrt(float(dx * dx + dy * dy)));
+			kernel[(dy+rad) * tsize + (dx+rad)] = wi;
+			total += wi;
+		}
+	}
+	for(float & wi : kernel){
+		wi /= std::max(total, 1e-6f);
+	}
 
-			const float dHeight = newHeight - oldHeight;
-			const float capacity = std::max(-dHeight, _erOpts.minSlope) * velocity * water * _erOpts.capacityBase;
-
-			if(sediment > capacity || dHeight > 0.0){
-				// Deposit at the old location.
-				const float deposit = dHeight > 0.0 ? std::min(sediment, dHeight) : ((sediment - capacity) * _erOpts.deposition);
-				sediment -= deposit;
-				img.r( ipos[0],  ipos[1]) += (1.0f - dpos.x) * (1.0f - dpos.y) * deposit;
-				img.r( ipos[0], inpos[1]) += (1.0f - dpos.x) * (dpos.y) * deposit;
-				img.r(inpos[0],  ipos[1]) += (dpos.x) * (1.0f - dpos.y) * deposit;
-				img.r(inpos[0], inpos[1]) += (dpos.x) * (dpos.y) * deposit;
-			} else {
+	// Droplets of a batch are simulated in parallel on the same map state. Instead of modifying the map,
+	// each droplet records its deposits and gatherings in the bands of rows they cover. At the end of the batch,
+	// each band is updated by a single thread, in droplet order: only touched texels are visited, and the result
+	// only depends on the seed and settings, not on thread scheduling.
+	struct Change {
+		glm::ivec2 pos; ///< Texel at the top-left corner of a deposit or at the center of a gathering.
+		glm::vec2 offset; ///< Droplet position in the texel, for deposits.
+		float amount; ///< Deposited or gathered height.
+		bool deposit; ///< Is the change a deposit or a gathering.
+	};
+	const int bandHeight = std::max(64, 2 * rad + 2);
+	const size_t bandCount = size_t((height + bandHeight - 1) / bandHeight);
+	const size_t batchSize = size_t(std::max(_erOpts.batchSize, 1));
+	// Changes of each droplet of a batch, for each band.
+	std::vector<std::vector<Change>> changes(batchSize * bandCount);
+
+	const Image & map = img;
+	for(size_t firstDrop = 0; firstDrop < starts.size(); firstDrop += batchSize){
+		const size_t dropCount = std::min(batchSize, starts.size() - firstDrop);
+		System::forParallel(0, dropCount, [&](size_t did){
+			std::vector<Change> * dropChanges = &changes[did * bandCount];
+			// Register a change in all the bands covering the rows it modifies.
+			const auto record = [dropChanges, bandHeight, bandCount](const Change & change, int minY, int maxY){
+				const size_t lastBand = std::min(size_t(maxY / bandHeight), bandCount - 1);
+				for(size_t bid = size_t(std::max(minY, 0) / bandHeight); bid <= lastBand; ++bid){
+					dropChanges[bid].push_back(change);
+				}
+			};
 
-				// Take some from the old location surroundings.
-				float gather = std::min((capacity - sediment) * _erOpts.erosion, -dHeight);
-				sediment += gather;
-				float total = 0.0f;
-				const int rad = _erOpts.gatherRadius;
-				const int tsize = 2*rad+1;
-				std::vector<std::vector<float>> wis(tsize, std::vector<float>(tsize));
-				for(int dy = -rad; dy <= rad; ++dy){
-					for(int dx = -rad; dx <= rad; ++dx){
-						const float wi = std::max(0.0f, rad - glm::distance(glm::vec2(ipos[0]+dx, ipos[1]+dy), oldPos));
-						total += wi;
-						wis[dy+rad][dx+rad] = wi;
-					}
+			glm::vec2 pos = starts[firstDrop + did];
+			glm::vec2 dir(0.0f, 0.0f);
+			float velocity = 1.0f;
+			float water = 1.0f;
+			float sediment = 0.0f;
+
+			for(int sid = 0; sid < _erOpts.stepsMax; ++sid){
+				if(water < 0.00001f){
+					break;
+				}
+				// Gradient computation based on the four surrounding texels.
+				glm::ivec2 ipos = glm::floor(pos); // nodeXY
+				ipos = glm::clamp(ipos, glm::ivec2(0), maxPos);
+				const glm::ivec2 inpos = glm::min(ipos+1, maxPos);
+
+				const glm::vec2 dpos = pos - glm::vec2(ipos); // cellOffset
+				const float h00 = map.r( ipos[0],  ipos[1]);
+				const float h10 = map.r(inpos[0],  ipos[1]);
+				const float h01 = map.r( ipos[0], inpos[1]);
+				const float h11 = map.r(inpos[0], inpos[1]);
+				const glm::vec2 grad((h10 - h00) * (1.0f - dpos.y) + (h11 - h01) * (dpos.y),
+									 (h01 - h00) * (1.0f - dpos.x) + (h11 - h10) * (dpos.x));
+
+				// We go down the slope, with some inertia.
+				dir = _erOpts.inertia * dir - (1.0f - _erOpts.inertia) * grad;
+				if(dir[0] != 0.0f || dir[1] != 0.0f){
+					dir = glm::normalize(dir);
+				}
+
+				pos += dir;
+
+				if((dir[0] == 0.0f && dir[1] == 0.0f) || pos[0] < 0.0f || pos[1] < 0.0f || pos[0] >= maxPos[0] || pos[1] >= maxPos[1]){
+					break;
 				}
-				for(int dy = -rad; dy <= rad; ++dy){
-					for(int dx = -rad; dx <= rad; ++dx){
-						const glm::ivec2 nnpos = ipos + glm::ivec2(dx, dy);
-						if(nnpos[0] < 0 || nnpos[1] < 0 || nnpos[0] > maxPos[0] || nnpos[1] > maxPos[1]){
-							continue;
+				const float oldHeight = h00 * (1.0f - dpos.x) * (1.0f - dpos.y) + h10 * (1.0f - dpos.y) * dpos.x + h01 * (1.0f - dpos.x) * dpos.y + h11 * dpos.x * dpos.y;
+				float newHeight = oldHeight;
+				{
+					glm::ivec2 nipos = glm::floor(pos);
+					nipos = glm::clamp(nipos, glm::ivec2(0), maxPos);
+					const glm::ivec2 ninpos = glm::min(nipos+1, maxPos);
+					const glm::vec2 ndpos = pos - glm::vec2(nipos);
+					const float nh00 = map.r( nipos[0],  nipos[1]);
+					const float nh10 = map.r(ninpos[0],  nipos[1]);
+					const float nh01 = map.r( nipos[0], ninpos[1]);
+					const float nh11 = map.r(ninpos[0], ninpos[1]);
+					newHeight = nh00 * (1.0f - ndpos.x) * (1.0f - ndpos.y) + nh10 * (1.0f - ndpos.y) * ndpos.x + nh01 * (1.0f - ndpos.x) * ndpos.y + nh11 * ndpos.x * ndpos.y;
+				}
+
+				const float dHeight = newHeight - oldHeight;
+				const float capacity = std::max(-dHeight, _erOpts.minSlope) * velocity * water * _erOpts.capacityBase;
+
+				if(sediment > capacity || dHeight > 0.0){
+					// Deposit at the old location.
+					const float deposit = dHeight > 0.0 ? std::min(sediment, dHeight) : ((sediment - capacity) * _erOpts.deposition);
+					sediment -= deposit;
+					record({ipos, dpos, deposit, true}, ipos[1], inpos[1]);
+				} else {
+					// Take some from the old location surroundings.
+					const float gather = std::min((capacity - sediment) * _erOpts.erosion, -dHeight);
+					sediment += gather;
+					record({ipos, glm::vec2(0.0f), gather, false}, ipos[1] - rad, ipos[1] + rad);
+				}
+				water *= (1.0f - _erOpts.evaporation);
+				velocity = std::sqrt(std::max(0.0f, velocity*velocity + dHeight * _erOpts.gravity));
+			}
+		});
+
+		// Apply the batch changes, each band in parallel.
+		System::forParallel(0, bandCount, [&](size_t bid){
+			const int minY = int(bid) * bandHeight;
+			const int maxY = std::min(minY + bandHeight, height) - 1;
+			const auto add = [&img, minY, maxY](int x, int y, float value){
+				if(y >= minY && y <= maxY){
+					img.r(x, y) += value;
+				}
+			};
+			for(size_t did = 0; did < dropCount; ++did){
+				std::vector<Change> & bandChanges = changes[did * bandCount + bid];
+				for(const Change & change : bandChanges){
+					const glm::ivec2 & ipos = change.pos;
+					if(change.deposit){
+						// Deposit at the old location.
+						const glm::ivec2 inpos = glm::min(ipos+1, maxPos);
+						const glm::vec2 & dpos = change.offset;
+						add( ipos[0],  ipos[1], (1.0f - dpos.x) * (1.0f - dpos.y) * change.amount);
+						add( ipos[0], inpos[1], (1.0f - dpos.x) * (dpos.y) * change.amount);
+						add(inpos[0],  ipos[1], (dpos.x) * (1.0f - dpos.y) * change.amount);
+						add(inpos[0], inpos[1], (dpos.x) * (dpos.y) * change.amount);
+						continue;
+					}
+					// Take some from the old location surroundings, only in the band rows.
+					const int dyMin = std::max(-rad, minY - ipos[1]);
+					const int dyMax = std::min(rad, maxY - ipos[1]);
+					for(int dy = dyMin; dy <= dyMax; ++dy){
+						for(int dx = -rad; dx <= rad; ++dx){
+							const int nx = ipos[0] + dx;
+							if(nx < 0 || nx > maxPos[0]){
+								continue;
+							}
+							img.r(nx, ipos[1] + dy) += -change.amount * kernel[(dy+rad) * tsize + (dx+rad)];
 						}
-						img.r(nnpos[0], nnpos[1]) -= gather * wis[dy+rad][dx+rad]/total;
 					}
 				}
-
+				bandChanges.clear();
 			}
-			water *= (1.0f - _erOpts.evaporation);
-			velocity = std::sqrt(std::max(0.0f, velocity*velocity + dHeight * _erOpts.gravity));
-		}
-
+		});
 	}
 }
 
@@ -311,104 +601,142 @@ void Terrain::transferAndUpdateMap(Image & heightMap){
 	_map.clean();
 
 	_map.images.emplace_back(_map.width, _map.height, 4);
+	computeNormals(heightMap, _map.images[0], 0, _texelSize);
 	const glm::ivec2 maxPos = glm::ivec2(_map.width-1);
-	const int rad = 4;
-	const float dWorld = 2.0f * float(rad) * _texelSize;
-	for(uint y = 0; y < _map.height; ++y){
-		for(uint x = 0; x < _map.width; ++x){
-			// Compute normal using smooth finite differences.
-			glm::vec2 dh(0.0f);
-			float total = 0.0f;
-			for(int ds = -2; ds < 2; ++ds){
-				const float weight = 1.0f / (std::abs(ds) + 1.0f);
-				total += weight;
-				for(int dds = 1; dds <= rad; ++dds){
-
-					const glm::ivec2 pixXp = glm::clamp(glm::ivec2(x + dds, y + ds), glm::ivec2(0), maxPos);
-					const float heightXp = heightMap.r(pixXp[0], pixXp[1]);
-					const glm::ivec2 pixXm = glm::clamp(glm::ivec2(x - dds, y - ds), glm::ivec2(0), maxPos);
-					const float heightXm = heightMap.r(pixXm[0], pixXm[1]);
-					dh[0] += weight * (heightXp - heightXm);
-
-					const glm::ivec2 pixZp = glm::clamp(glm::ivec2(x + ds, y + dds), glm::ivec2(0), maxPos);
-					const float heightZp = heightMap.r(pixZp[0], pixZp[1]);
-					const glm::ivec2 pixZm = glm::clamp(glm::ivec2(x - ds, y - dds), glm::ivec2(0), maxPos);
-					const float heightZm = heightMap.r(pixZm[0], pixZm[1]);
-					dh[1] += weight * (heightZp - heightZm);
-				}
-			}
-			dh /= (float(rad) * total);
-
-			glm::vec3 n = glm::cross(glm::vec3(0.0f, dh[1], dWorld), glm::vec3(dWorld, dh[0], 0.0f));
-			n = glm::normalize(n);
 
-			_map.images[0].rgba(x,y) = glm::vec4(heightMap.r(x,y), n);
+	// Build low res version, with conservative depth estimation.
+	_mapLowRes.width = _mapLowRes.height = _resolution/2;
+	_mapLowRes.levels = _mapLowRes.depth = 1;
+	_mapLowRes.shape = TextureShape::D2;
+	_mapLowRes.clean();
+	_mapLowRes.images.emplace_back(_mapLowRes.width, _mapLowRes.height, 1);
+	Image & lowRes = _mapLowRes.images[0];
+	// Minimum and maximum heights for culling, at the same resolution.
+	_minHeights.clear();
+	_maxHeights.clear();
+	_minHeights.emplace_back(_mapLowRes.width, _mapLowRes.height, 1);
+	_maxHeights.emplace_back(_mapLowRes.width, _mapLowRes.height, 1);
+	Image & lowResMin = _minHeights[0];
 
-		}
-	}
-	
 	// Build mipmaps.
 	_map.levels = _map.getMaxMipLevel();
-	std::array<float, 9> weights = {1.0f/16.0f, 1.0f/8.0f, 1.0f/16.0f,
+	const std::array<float, 9> weights = {1.0f/16.0f, 1.0f/8.0f, 1.0f/16.0f,
 									1.0f/8.0f, 1.0f/4.0f, 1.0f/8.0f,
 									1.0f/16.0f, 1.0f/8.0f, 1.0f/16.0f};
 	for(uint lid = 1; lid < _map.levels; ++lid){
-		const uint w = _map.width / (1 << lid);
-		const uint h = _map.height / (1 << lid);
+		const int w = int(_map.width / (1 << lid));
+		const int h = int(_map.height / (1 << lid));
 		_map.images.emplace_back(w, h, 4);
-		const glm::ivec2 maxPos(w*2-1, h*2-1);
+		const glm::ivec2 maxPrevPos(w*2-1, h*2-1);
 		Image & currImg = _map.images[lid];
-		Image & prevImg = _map.images[lid-1];
-
-		for(uint y = 0; y < h; ++y){
-			for(uint x = 0; x < w; ++x){
-				const glm::vec2 prevCoords = 2.0f * glm::vec2(x,y) + 0.5f;
+		const Image & prevImg = _map.images[lid-1];
+		// The low res version has the same size as the first mip level, fill it in the same pass.
+		const bool fillLowRes = lid == 1;
+
+		System::forParallel(0, size_t(h), [&](size_t yy){
+			const int y = int(yy);
+			for(int x = 0; x < w; ++x){
+				// Taps are centered on the bottom-right texel of the 2x2 footprint.
+				const glm::ivec2 prevCoords = 2 * glm::ivec2(x,y) + 1;
 				glm::vec4 total(0.0f);
 				for(int dy = -1; dy <= 1; ++dy){
 					for(int dx = -1; dx <= 1; ++dx){
-						glm::ivec2 coords = glm::ivec2(glm::round(prevCoords + glm::vec2(dx, dy)));
-						coords = glm::clamp(coords, glm::ivec2(0), maxPos);
+						const glm::ivec2 coords = glm::clamp(prevCoords + glm::ivec2(dx, dy), glm::ivec2(0), maxPrevPos);
 						const float & weight = weights[3*(dy+1) + (dx+1)];
 						total += weight * prevImg.rgba(coords[0], coords[1]);
 					}
 				}
 				currImg.rgba(x,y) = total;
+
+				if(fillLowRes){
+					const glm::ivec2 pix(2*x, 2*y);
+					const glm::ivec2 pixi = glm::min(pix+1, maxPos);
+					const float & h00 = prevImg.r( pix.x,  pix.y);
+					const float & h10 = prevImg.r(pixi.x,  pix.y);
+					const float & h01 = prevImg.r( pix.x, pixi.y);
+					const float & h11 = prevImg.r(pixi.x, pixi.y);
+					lowRes.r(x,y) = std::max(std::max(h00, h01), std::max(h10, h11));
+					lowResMin.r(x,y) = std::min(std::min(h00, h01), std::min(h10, h11));
+				}
 			}
-		}
+		});
 	}
-	
+
 	// Send to the GPU.
 	_map.upload(Layout::RGBA32F, false);
+	_mapLowRes.upload(Layout::R32F, false);
+	_maxHeights[0].pixels = lowRes.pixels;
+	buildHeightBounds();
+}
 
-	// Build low res version, with conservative depth estimation.
-	_mapLowRes.width = _mapLowRes.height = _resolution/2;
-	_mapLowRes.levels = _mapLowRes.depth = 1;
-	_mapLowRes.shape = TextureShape::D2;
-	_mapLowRes.clean();
-	_mapLowRes.images.emplace_back(_mapLowRes.width, _mapLowRes.height, 1);
+void Terrain::computeNormals(const Image & heightMap, Image & map, int margin, float spacing) const {
+
+	const int width = int(heightMap.width);
+	const int height = int(heightMap.height);
+	const glm::ivec2 maxPos = glm::ivec2(width-1, height-1);
+	const int rad = 4;
+	const float dWorld = 2.0f * float(rad) * spacing;
+	// Weights and offsets for the smooth finite differences.
+	const std::array<int, 4> offsets = {-2, -1, 0, 1};
+	const std::array<float, 4> offsetWeights = {1.0f/3.0f, 1.0f/2.0f, 1.0f, 1.0f/2.0f};
+	const float normalization = 1.0f / (float(rad) * (offsetWeights[0] + offsetWeights[1] + offsetWeights[2] + offsetWeights[3]));
+
+	const int dstWidth = int(map.width);
+	System::forParallel(0, map.height, [&](size_t yy){
+		const int y = int(yy) + margin;
+		// Away from the borders, all taps are in the map and don't need clamping.
+		const bool interiorRow = y >= rad && y < height - rad;
+		const float * heights = &heightMap.r(0, 0);
+		for(int tx = 0; tx < dstWidth; ++tx){
+			const int x = tx + margin;
+			// Compute normal using smooth finite differences.
+			glm::vec2 dh(0.0f);
+			if(interiorRow && x >= rad && x < width - rad){
+				const float * center = heights + y * width + x;
+				for(size_t did = 0; did < offsets.size(); ++did){
+					const int ds = offsets[did];
+					const float weight = offsetWeights[did];
+					float dx = 0.0f;
+					float dz = 0.0f;
+					for(int dds = 1; dds <= rad; ++dds){
+						dx += center[ds * width + dds] - center[-ds * width - dds];
+						dz += center[dds * width + ds] - center[-dds * width - ds];
+					}
+					dh[0] += weight * dx;
+					dh[1] += weight * dz;
+				}
+			} else {
+				for(size_t did = 0; did < offsets.size(); ++did){
+					const int ds = offsets[did];
+					const float weight = offsetWeights[did];
+					for(int dds = 1; dds <= rad; ++dds){
+						const glm::ivec2 pixXp = glm::clamp(glm::ivec2(x + dds, y + ds), glm::ivec2(0), maxPos);
+						const glm::ivec2 pixXm = glm::clamp(glm::ivec2(x - dds, y - ds), glm::ivec2(0), maxPos);
+						dh[0] += weight * (heightMap.r(pixXp[0], pixXp[1]) - heightMap.r(pixXm[0], pixXm[1]));
+
+						const glm::ivec2 pixZp = glm::clamp(glm::ivec2(x + ds, y + dds), glm::ivec2(0), maxPos);
+						const glm::ivec2 pixZm = glm::clamp(glm::ivec2(x - ds, y - dds), glm::ivec2(0), maxPos);
+						dh[1] += weight * (heightMap.r(pixZp[0], pixZp[1]) - heightMap.r(pixZm[0], pixZm[1]));
+					}
+				}
+			}
+			dh *= normalization;
+
+			glm::vec3 n = glm::cross(glm::vec3(0.0f, dh[1], dWorld), glm::vec3(dWorld, dh[0], 0.0f));
+			n = glm::normalize(n);
 
-	for(uint y = 0; y < _mapLowRes.height; ++y){
-		for(uint x = 0; x < _mapLowRes.width; ++x){
-			const glm::ivec2 pix(2*x, 2*y);
-			const glm::ivec2 pixi = glm::min(pix+1, maxPos);
-			const float & h00 = _map.images[0].r( pix.x,  pix.y);
-			const float & h10 = _map.images[0].r(pixi.x,  pix.y);
-			const float & h01 = _map.images[0].r( pix.x, pixi.y);
-			const float & h11 = _map.images[0].r(pixi.x, pixi.y);
-			_mapLowRes.images[0].r(x,y) = std::max(std::max(h00, h01), std::max(h10, h11));
+			map.rgba(tx, int(yy)) = glm::vec4(heightMap.r(x,y), n);
 		}
-	}
-	_mapLowRes.upload(Layout::R32F, false);
+	});
 }
 
-
 void Terrain::generateShadowMap(const glm::vec3 & lightDir){
 
 	const auto prog = Resources::manager().getProgram2D("shadow_island");
 
 	const Texture & map = _mapLowRes;
 	// Adjust texel size for potentially smaller map.
-	const float texelSize = _texelSize * float(_map.width) / float(map.width);
+	const float texelSize = _texelSize * float(mapSize()) / float(map.width);
 	const uint stepCount = 2 * std::max(map.width, map.height);
 	// Make sure light direction is normalized.
 	const glm::vec3 lDir = glm::normalize(lightDir);
@@ -436,6 +764,7 @@ bool Terrain::interface(){
 	if(ImGui::TreeNode("Mesh")){
 		ImGui::InputInt("Grid size", &_mshOpts.size);
 		ImGui::InputInt("Grid levels", &_mshOpts.levels);
+		ImGui::Text("Cells: %u/%u visible, %u patches", _visibleCells, uint(_cells.size()), uint(_patches.size()));
 
 		if(ImGui::Button("Update mesh")){
 			generateMesh();
@@ -458,10 +787,23 @@ bool Terrain::interface(){
 		ImGui::TreePop();
 	}
 
+	if(ImGui::TreeNode("Virtual map")){
+		dirtyTerrain = ImGui::Checkbox("Enabled", &_virtOpts.enabled) || dirtyTerrain;
+		dirtyTerrain = ImGui::InputInt("Virtual size", &_virtOpts.size) || dirtyTerrain;
+		dirtyTerrain = ImGui::InputInt("Cache pages", &_virtOpts.cacheSize) || dirtyTerrain;
+		ImGui::InputInt("Pages per frame", &_virtOpts.pagesPerFrame);
+		if(_virtualMap){
+			const VirtualHeightMap::Statistics & stats = _virtualMap->statistics();
+			ImGui::Text("Pages: %u resident, %u requested, %u missing", stats.resident, stats.requested, stats.missing);
+		}
+		ImGui::TreePop();
+	}
+
 	if(ImGui::TreeNode("Erosion")){
 		dirtyErosion = ImGui::Checkbox("Apply erosion", &_erOpts.apply) || dirtyErosion;
 		dirtyErosion = ImGui::InputInt("Drops count", &_erOpts.dropsCount) || dirtyErosion;
 		dirtyErosion = ImGui::InputInt("Drop step", &_erOpts.stepsMax) || dirtyErosion;
+		dirtyErosion = ImGui::InputInt("Drops batch", &_erOpts.batchSize) || dirtyErosion;
 		dirtyErosion = ImGui::InputInt("Gather radius", &_erOpts.gatherRadius) || dirtyErosion;
 		dirtyErosion = ImGui::SliderFloat("Inertia", &_erOpts.inertia, 0.0f, 1.0f) || dirtyErosion;
 		dirtyErosion = ImGui::SliderFloat("Gravity", &_erOpts.gravity, 2.0f, 18.0f) || dirtyErosion;
@@ -480,7 +822,5 @@ bool Terrain::interface(){
 }
 
 Terrain::~Terrain() {
-	for(Cell & cell : _cells){
-		cell.mesh.clean();
-	}
+	_grid.clean();
 }
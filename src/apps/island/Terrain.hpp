@@ -2,29 +2,29 @@
 #include "resources/Image.hpp"
 #include "resources/Texture.hpp"
 #include "resources/Mesh.hpp"
+#include "resources/Buffer.hpp"
+#include "resources/Bounds.hpp"
+#include "graphics/GPUTypes.hpp"
 #include "processing/GaussianBlur.hpp"
 #include "generation/PerlinNoise.hpp"
 #include "generation/Random.hpp"
+#include "VirtualHeightMap.hpp"
 #include "Common.hpp"
 
 /** \brief Generate a terrain with Perlin noise and erosion.
  Represent the terrain, regrouping elevation and shadow data and the underlying GPU representation to render it.
+ The terrain can also be stored in a virtual map much larger than the regular one, whose pages are generated on demand (without erosion).
  \ingroup Island
  */
 class Terrain {
 public:
 
-	/** Terrain mesh cell. */
+	/** Terrain grid cell, an instance of one of the grid patches. */
 	struct Cell {
-		Mesh mesh; ///< The geometry covering this cell.
-		uint level; ///< The density level used to generate the mesh of this cell.
-
-		/** Constructor.
-		 \param l the level of detail
-		 \param x cell x coordinate
-		 \param z cell z coordinate
-		 */
-		Cell(uint l, uint x, uint z);
+		BoundingBox bbox; ///< Cell bounds in grid units, before shifting.
+		glm::vec2 origin; ///< Position of the patch origin in grid units.
+		uint level; ///< The density level used to generate the patch of this cell.
+		uint patch; ///< Index of the patch geometry used by this cell.
 	};
 
 	/** Constructor
@@ -39,6 +39,20 @@ public:
 	/** Generate the terrain map for the current seed. */
 	void generateMap();
 
+	/** Generate the virtual map pages requested by the last feedback, if the virtual map is enabled. Should be called each frame before rendering. */
+	void update();
+
+	/** Select the grid cells visible from a viewpoint, testing them against the view frustum and the terrain horizon.
+	 \param vp the view projection matrix
+	 \param eye the viewpoint position
+	 \param shift the grid center position
+	 \note Should be called each frame before drawing the cells.
+	 */
+	void cull(const glm::mat4 & vp, const glm::vec3 & eye, const glm::vec3 & shift);
+
+	/** Draw the visible grid cells in a single indirect call, with a program already set up. The cells buffer should be bound to the program. */
+	void drawCells() const;
+
 	/** Generate the shadow map for the current terrain and a sun direction.
 	 \param lightDir the sun direction
 	 */
@@ -67,6 +81,14 @@ public:
 		return _meshSize * _texelSize;
 	}
 
+	/** \return the size of the terrain map, in texels (regular or virtual). */
+	uint mapSize() const;
+
+	/** \return the virtual terrain map, or null if the regular map is used. */
+	VirtualHeightMap * virtualMap() const {
+		return _virtualMap.get();
+	}
+
 	/** \return the terrain height and normal map. */
 	const Texture & map() const {
 		return _map;
@@ -82,13 +104,58 @@ public:
 		return _cells;
 	}
 
+	/** \return the visible cells data for the current frame, with the origin in XY and the level in Z. */
+	const Buffer & cellsBuffer() const {
+		return *_frames[_current].instances;
+	}
+
 private:
 
-	/** Apply erosion on a height map.
+	/** Apply erosion on a height map. Droplets are simulated in parallel by batches, the result only depends on the seed and settings.
 	 \param img the map to erode, in place
 	 */
 	void erode(Image & img);
 
+	/** Build coarser levels of the minimum and maximum height maps, used for culling. */
+	void buildHeightBounds();
+
+	/** Query the range of heights in a region of the terrain, conservatively at the low res map resolution.
+	 \param mini the minimal corner of the region, in world space
+	 \param maxi the maximal corner of the region, in world space
+	 \return the minimum and maximum heights
+	 */
+	glm::vec2 heightRange(const glm::vec2 & mini, const glm::vec2 & maxi) const;
+
+	/** Check if a box is hidden behind the terrain from a viewpoint. The terrain in each section of the cone from the viewpoint to the box is compared to the highest ray toward the box.
+	 \param box the box to test, in world space
+	 \param eye the viewpoint position
+	 \param margin the height margin to apply to the terrain
+	 \return true if the box is hidden
+	 */
+	bool hiddenByHorizon(const BoundingBox & box, const glm::vec3 & eye, float margin) const;
+
+	/** Generate the island heights for a grid of locations of the map, with noise, falloff and smoothing.
+	 \param heightMap the image to fill, with preset dimensions
+	 \param origin the position of the first pixel, in map texels
+	 \param step the distance between successive pixels, in map texels
+	 */
+	void generateHeights(Image & heightMap, const glm::vec2 & origin, float step);
+
+	/** Compute terrain normals from height.
+	 \param heightMap the heights
+	 \param map will receive the height and normals, should be smaller than heightMap by margin texels on each side
+	 \param margin the number of height texels around the region to compute
+	 \param spacing the world space distance between height texels
+	 */
+	void computeNormals(const Image & heightMap, Image & map, int margin, float spacing) const;
+
+	/** Generate a page of the virtual map.
+	 \param first the coordinates of the first texel of the tile in the level
+	 \param level the virtual map level
+	 \param tile the tile to fill with height and normals, with preset dimensions
+	 */
+	void generateTile(const glm::ivec2 & first, uint level, Image & tile);
+
 	/** Compute terrain normals from height and uplaod the result to the GPU, with custom mip-map and low-res version.
 	 \param heightMap the map to update and upload
 	 */
@@ -121,21 +188,53 @@ private:
 		float evaporation = 0.02f; ///< Evaporation speed.
 		float deposition = 0.2f; ///< Deposition speed.
 		int gatherRadius = 3; ///< Gathering radius for contributions.
-		int dropsCount = 50000; ///< Number of droplets to sequentially simulate.
+		int dropsCount = 50000; ///< Number of droplets to simulate.
 		int stepsMax = 256; ///< Number of steps for each droplet simulation.
+		int batchSize = 256; ///< Number of droplets simulated in parallel on the same map state.
 		bool apply = true; ///< Should erosion be applied.
 	};
 
+	/** Virtual map options. */
+	struct VirtualSettings {
+		int size = 16384; ///< Virtual map size, in texels.
+		int cacheSize = 16; ///< Number of pages along each side of the cache.
+		int pagesPerFrame = 4; ///< Maximum number of pages generated each frame.
+		bool enabled = false; ///< Should the virtual map be used.
+	};
+
+	/** Range of indices of a patch in the grid mesh. */
+	struct Patch {
+		uint firstIndex; ///< First index.
+		uint indexCount; ///< Number of indices.
+	};
+
+	/** \brief Per-frame in flight storage. */
+	struct FrameData {
+		std::unique_ptr<Buffer> instances; ///< Visible cells data.
+		std::unique_ptr<Buffer> commands; ///< Draw commands, one per patch.
+	};
+
 	PerlinNoise _perlin; ///< Perlin noise generator.
-	std::vector<Cell> _cells; ///< Grid mesh cells.
+	std::vector<Cell> _cells; ///< Grid mesh cells, sorted by patch.
+	std::vector<Patch> _patches; ///< Distinct cell geometries.
+	Mesh _grid = Mesh("Terrain grid"); ///< All patches geometry.
+	std::vector<glm::vec4> _instances; ///< Visible cells data.
+	std::vector<DrawCommand> _commands; ///< Draw commands.
+	std::vector<FrameData> _frames; ///< Per-frame in flight storage.
+	uint _current = 0; ///< Current frame storage.
+	uint _visibleCells = 0; ///< Number of cells visible in the last culling.
+	std::vector<Image> _minHeights; ///< Minimum height pyramid, at the low res map resolution.
+	std::vector<Image> _maxHeights; ///< Maximum height pyramid, at the low res map resolution.
 	Texture _map = Texture("Terrain"); ///< Terrain map, height in R channel, normals in GBA channels.
 	Texture _mapLowRes = Texture("Terrain low-res");///< Low resolution min-height terrain map.
 	Texture _shadowMap; ///< Shadow map generation texture.
+	std::unique_ptr<VirtualHeightMap> _virtualMap; ///< Virtual terrain map, if enabled.
 	GaussianBlur _gaussBlur; ///< Gaussian blur.
 
 	GenerationSettings _genOpts; ///< Terrain generations settings.
 	MeshSettings _mshOpts; ///< Grid mesh options.
 	ErosionSettings _erOpts; ///< Erosion options.
+	VirtualSettings _virtOpts; ///< Virtual map options.
 
 	int _resolution; ///< Height map resolution.
 	uint _seed; ///< Current generation seed.
@@ -0,0 +1,252 @@
+#include "VirtualHeightMap.hpp"
+#include "resources/ResourcesManager.hpp"
+#include "graphics/GPU.hpp"
+
+#include <algorithm>
+
+VirtualHeightMap::VirtualHeightMap(uint size, uint pageSize, uint slotsPerSide, const Generator & generator) :
+	_generator(generator), _pageSize(std::max(pageSize, 1u)), _cache("Terrain cache"), _feedback("Terrain feedback"), _feedbackDepth("Terrain feedback depth") {
+
+	// Round the size to a power of two number of pages.
+	_pagesPerSide = 1;
+	_levels = 1;
+	while(_pagesPerSide * _pageSize < size){
+		_pagesPerSide *= 2;
+		++_levels;
+	}
+	_size = _pagesPerSide * _pageSize;
+
+	// Pages are stored level after level, from the finest one.
+	uint pageCount = 0;
+	for(uint lid = 0; lid < _levels; ++lid){
+		_levelOffsets.push_back(pageCount);
+		const uint side = _pagesPerSide >> lid;
+		pageCount += side * side;
+	}
+	_pageTable.resize(pageCount, 0u);
+	_residency.resize(pageCount, -1);
+
+	// The last three levels (at most 4x4 pages) are always resident, and generated all at once.
+	_pinnedLevel = _levels > 3 ? _levels - 3 : 0;
+	const uint pinnedCount = pageCount - _levelOffsets[_pinnedLevel];
+	_uploadCapacity = std::max(_uploadCapacity, pinnedCount);
+	// Leave room for at least as many pages as the pinned ones.
+	_slotsPerSide = std::max(slotsPerSide, 1u);
+	while(_slotsPerSide * _slotsPerSide < 2 * pinnedCount){
+		++_slotsPerSide;
+	}
+	_slots.resize(_slotsPerSide * _slotsPerSide);
+
+	const uint slotSide = _pageSize + 2 * _border;
+	_cache.setupAsDrawable(Layout::RGBA32F, _slotsPerSide * slotSide, _slotsPerSide * slotSide);
+	_tile = Image(slotSide, slotSide, 4);
+	// The feedback doesn't need to match the screen aspect ratio, only to cover the view.
+	_feedback.setupAsDrawable(Layout::RGBA32F, 256, 144);
+	_feedbackDepth.setupAsDrawable(Layout::DEPTH_COMPONENT32F, 256, 144);
+	_copyProgram = Resources::manager().getProgramCompute("terrain_tile_copy");
+
+	// One copy of the page table and uploaded tiles per frame in flight.
+	_frames.resize(GPU::framesInFlight());
+	const size_t tileSize = _tile.pixels.size() * sizeof(float);
+	for(FrameData & frame : _frames){
+		frame.pageTable.reset(new Buffer(_pageTable.size() * sizeof(uint), BufferType::INDIRECT, "Terrain page table"));
+		frame.tiles.reset(new Buffer(_uploadCapacity * tileSize, BufferType::INDIRECT, "Terrain tiles"));
+	}
+}
+
+long VirtualHeightMap::pageIndex(uint level, const glm::ivec2 & coords) const {
+	const long side = long(_pagesPerSide >> level);
+	return long(_levelOffsets[level]) + long(coords.y) * side + long(coords.x);
+}
+
+void VirtualHeightMap::decode(long page, uint & level, glm::ivec2 & coords) const {
+	level = 0;
+	while(level + 1 < _levels && page >= long(_levelOffsets[level + 1])){
+		++level;
+	}
+	const long local = page - long(_levelOffsets[level]);
+	const long side = long(_pagesPerSide >> level);
+	coords = glm::ivec2(int(local % side), int(local / side));
+}
+
+void VirtualHeightMap::update(uint budget){
+	++_frame;
+	_current = GPU::frameIndex();
+	FrameData & frame = _frames[_current];
+
+	// Pages needed: the always resident levels, the requested pages and all their ancestors,
+	// so that a page is never loaded before its parent.
+	_missing.clear();
+	for(long pid = long(_levelOffsets[_pinnedLevel]); pid < long(_residency.size()); ++pid){
+		if(_residency[pid] < 0){
+			_missing.push_back(pid);
+		}
+	}
+	for(const long page : _requests){
+		uint level;
+		glm::ivec2 coords;
+		decode(page, level, coords);
+		for(; level < _pinnedLevel; ++level, coords /= 2){
+			const long pid = pageIndex(level, coords);
+			const int slot = _residency[pid];
+			if(slot >= 0){
+				_slots[slot].lastUsed = _frame;
+			} else {
+				_missing.push_back(pid);
+			}
+		}
+	}
+	// Coarser levels are stored last, load them first.
+	std::sort(_missing.begin(), _missing.end(), std::greater<long>());
+	_missing.erase(std::unique(_missing.begin(), _missing.end()), _missing.end());
+
+	uint loaded = 0;
+	for(const long page : _missing){
+		const bool pinned = page >= long(_levelOffsets[_pinnedLevel]);
+		if(loaded == _uploadCapacity || (!pinned && loaded >= budget)){
+			break;
+		}
+		// Use a free slot, or evict the least recently used page that is not needed this frame.
+		size_t best = _slots.size();
+		for(size_t sid = 0; sid < _slots.size(); ++sid){
+			const Slot & slot = _slots[sid];
+			if(slot.pinned){
+				continue;
+			}
+			if(slot.page < 0){
+				best = sid;
+				break;
+			}
+			if(slot.lastUsed < _frame && (best == _slots.size() || slot.lastUsed < _slots[best].lastUsed)){
+				best = sid;
+			}
+		}
+		if(best == _slots.size()){
+			break;
+		}
+		load(page, best, frame, loaded);
+		_slots[best].pinned = pinned;
+		++loaded;
+	}
+
+	if(loaded != 0){
+		updatePageTable();
+		for(FrameData & otherFrame : _frames){
+			otherFrame.upToDate = false;
+		}
+	}
+	if(!frame.upToDate){
+		frame.pageTable->upload(_pageTable);
+		frame.upToDate = true;
+	}
+
+	_statistics.requested = uint(_requests.size());
+	_statistics.missing = uint(_missing.size()) - loaded;
+	_statistics.loaded = loaded;
+	_statistics.resident = 0;
+	for(const Slot & slot : _slots){
+		_statistics.resident += slot.page >= 0 ? 1 : 0;
+	}
+}
+
+void VirtualHeightMap::load(long page, size_t slot, FrameData & frame, uint tile){
+	uint level;
+	glm::ivec2 coords;
+	decode(page, level, coords);
+
+	Slot & entry = _slots[slot];
+	if(entry.page >= 0){
+		_residency[entry.page] = -1;
+	}
+	entry.page = page;
+	entry.lastUsed = _frame;
+	_residency[page] = int(slot);
+
+	// Generate the page and its border.
+	_generator(coords * int(_pageSize) - int(_border), level, _tile);
+	const size_t tileSize = _tile.pixels.size() * sizeof(float);
+	frame.tiles->upload(tileSize, reinterpret_cast<unsigned char *>(_tile.pixels.data()), tile * tileSize);
+
+	// Copy it in its slot.
+	const uint slotSide = _pageSize + 2 * _border;
+	const glm::ivec2 destination = int(slotSide) * glm::ivec2(int(slot % _slotsPerSide), int(slot / _slotsPerSide));
+	_copyProgram->use();
+	_copyProgram->uniform("tileOffset", uint(tile * slotSide * slotSide));
+	_copyProgram->uniform("tileSide", slotSide);
+	_copyProgram->uniform("destination", destination);
+	_copyProgram->buffer(*frame.tiles, 0);
+	_copyProgram->texture(_cache, 0, 0);
+	GPU::dispatch(slotSide, slotSide, 1);
+}
+
+void VirtualHeightMap::updatePageTable(){
+	// From the coarsest level, each page points to itself if resident, else to the same entry as its parent.
+	for(int lid = int(_levels) - 1; lid >= 0; --lid){
+		const uint level = uint(lid);
+		const int side = int(_pagesPerSide >> level);
+		for(int y = 0; y < side; ++y){
+			for(int x = 0; x < side; ++x){
+				const long pid = pageIndex(level, glm::ivec2(x, y));
+				const int slot = _residency[pid];
+				if(slot >= 0){
+					_pageTable[pid] = uint(slot) | (level << 24u);
+				} else if(level + 1 < _levels){
+					_pageTable[pid] = _pageTable[pageIndex(level + 1, glm::ivec2(x / 2, y / 2))];
+				} else {
+					_pageTable[pid] = 0u;
+				}
+			}
+		}
+	}
+}
+
+bool VirtualHeightMap::beginFeedback(){
+	if(_feedbackPending){
+		return false;
+	}
+	GPU::beginRender(1.0f, Load::Operation::DONTCARE, &_feedbackDepth, glm::vec4(0.0f), &_feedback);
+	GPU::setViewport(_feedback);
+	return true;
+}
+
+void VirtualHeightMap::endFeedback(){
+	GPU::endRender();
+	_feedbackPending = true;
+	_feedbackTask = GPU::downloadTextureAsync(_feedback, glm::uvec2(0), glm::uvec2(_feedback.width, _feedback.height), 1, [this](const Texture & result){
+		// Each covered pixel contains the page coordinates and level it needs.
+		const Image & image = result.images[0];
+		_requests.clear();
+		for(uint y = 0; y < image.height; ++y){
+			for(uint x = 0; x < image.width; ++x){
+				const glm::vec4 & request = image.rgba(int(x), int(y));
+				if(request.a == 0.0f){
+					continue;
+				}
+				const uint level = std::min(uint(request.b), _levels - 1);
+				const int side = int(_pagesPerSide >> level);
+				const glm::ivec2 coords = glm::clamp(glm::ivec2(request.r, request.g), glm::ivec2(0), glm::ivec2(side - 1));
+				_requests.push_back(pageIndex(level, coords));
+			}
+		}
+		std::sort(_requests.begin(), _requests.end());
+		_requests.erase(std::unique(_requests.begin(), _requests.end()), _requests.end());
+		_feedbackPending = false;
+	});
+}
+
+void VirtualHeightMap::bind(Program & program, uint textureSlot, uint bufferSlot) const {
+	const uint slotSide = _pageSize + 2 * _border;
+	program.uniform("virtualSize", float(_size));
+	program.uniform("pageSize", float(_pageSize));
+	program.uniform("pageBorder", float(_border));
+	program.uniform("pageCount", _pagesPerSide);
+	program.uniform("levelCount", _levels);
+	program.uniform("slotsPerSide", _slotsPerSide);
+	program.uniform("invCacheSize", 1.0f / float(_slotsPerSide * slotSide));
+	program.texture(_cache, textureSlot);
+	program.buffer(*_frames[_current].pageTable, bufferSlot);
+}
+
+VirtualHeightMap::~VirtualHeightMap(){
+	GPU::cancelAsyncOperation(_feedbackTask);
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "resources/Image.hpp"
+#include "resources/Texture.hpp"
+#include "resources/Buffer.hpp"
+#include "graphics/Program.hpp"
+#include "graphics/GPUTypes.hpp"
+#include "Common.hpp"
+
+#include <functional>
+
+/** \brief Virtual terrain map, split in pages of height and normal data generated on demand and stored in a fixed-size GPU cache.
+ \details The virtual map is a mip pyramid of pages: at each level a page covers pageSize x pageSize texels, the coarsest level being a single page covering the whole map. Pages are generated on the CPU when needed and copied in a slot of the cache texture, with a one texel border for filtering. A page table buffer gives, for each page of each level, the slot and level of the finest resident page covering it, so that shaders can always fall back to a coarser page. The pages needed are determined by rendering the terrain in a small feedback target, read back asynchronously, and the least recently used pages are evicted when the cache is full. The coarsest levels are always resident.
+ \note CPU and GPU memory are bounded by the cache size, except for the page table that stores one 32 bits entry per page.
+ \ingroup Island
+ */
+class VirtualHeightMap {
+public:
+
+	/** Page generation function, filling a tile of texels of a level of the virtual map.
+	 The first parameter is the coordinates, in texels of the level, of the first texel of the tile (can be negative), the second is the level, the third the tile to fill (preallocated, with four channels).
+	 */
+	using Generator = std::function<void(const glm::ivec2 &, uint, Image &)>;
+
+	/** \brief Residency statistics. */
+	struct Statistics {
+		uint resident = 0; ///< Number of pages in the cache.
+		uint requested = 0; ///< Number of pages requested by the last feedback.
+		uint missing = 0; ///< Number of requested pages not yet resident.
+		uint loaded = 0; ///< Number of pages generated during the last update.
+	};
+
+	/** Constructor.
+	 \param size the virtual map size in texels, will be rounded to a power of two multiple of the page size
+	 \param pageSize the size of a page in texels
+	 \param slotsPerSide the number of pages stored along each side of the cache texture
+	 \param generator the function generating the page content
+	 */
+	VirtualHeightMap(uint size, uint pageSize, uint slotsPerSide, const Generator & generator);
+
+	/** Generate the pages that have been requested and are not resident yet, and update the page table.
+	 \param budget the maximum number of pages to generate, the always resident levels are generated at once
+	 \note Should be called each frame before rendering with the virtual map.
+	 */
+	void update(uint budget);
+
+	/** Start rendering to the feedback target, if the previous feedback has been received.
+	 \return true if the feedback target is ready, in which case the terrain should be rendered with a feedback program, and endFeedback called.
+	 */
+	bool beginFeedback();
+
+	/** Finish rendering to the feedback target and schedule its readback. */
+	void endFeedback();
+
+	/** Bind the cache texture, page table and associated uniforms to a program.
+	 \param program the program to bind the virtual map to
+	 \param textureSlot the slot of the cache texture
+	 \param bufferSlot the slot of the page table buffer
+	 */
+	void bind(Program & program, uint textureSlot, uint bufferSlot) const;
+
+	/** \return the feedback target */
+	const Texture & feedback() const { return _feedback; }
+
+	/** \return the virtual map size in texels */
+	uint size() const { return _size; }
+
+	/** \return the residency statistics */
+	const Statistics & statistics() const { return _statistics; }
+
+	/** Destructor. */
+	~VirtualHeightMap();
+
+	/** Copy constructor (disabled). */
+	VirtualHeightMap(const VirtualHeightMap &) = delete;
+
+	/** Copy assignment (disabled).
+	 \return a reference to the object assigned to
+	 */
+	VirtualHeightMap & operator=(const VirtualHeightMap &) = delete;
+
+	/** Move constructor (disabled). */
+	VirtualHeightMap(VirtualHeightMap &&) = delete;
+
+	/** Move assignment (disabled).
+	 \return a reference to the object assigned to
+	 */
+	VirtualHeightMap & operator=(VirtualHeightMap &&) = delete;
+
+private:
+
+	/** \brief A location in the cache texture. */
+	struct Slot {
+		long page = -1; ///< Page stored in the slot, or -1.
+		uint64_t lastUsed = 0; ///< Last update during which the page was requested.
+		bool pinned = false; ///< Should the page never be evicted.
+	};
+
+	/** \brief Per-frame in flight storage. */
+	struct FrameData {
+		std::unique_ptr<Buffer> pageTable; ///< Page table.
+		std::unique_ptr<Buffer> tiles; ///< Texels of the pages generated in the frame.
+		bool upToDate = false; ///< Is the page table in sync with the CPU copy.
+	};
+
+	/** Compute the index of a page.
+	 \param level the page level
+	 \param coords the page coordinates in the level
+	 \return the page index
+	 */
+	long pageIndex(uint level, const glm::ivec2 & coords) const;
+
+	/** Convert a page index to a level and coordinates.
+	 \param page the page index
+	 \param level will contain the page level
+	 \param coords will contain the page coordinates in the level
+	 */
+	void decode(long page, uint & level, glm::ivec2 & coords) const;
+
+	/** Generate a page and copy it in a cache slot.
+	 \param page the page index
+	 \param slot the slot index
+	 \param frame the current frame storage
+	 \param tile the index of the tile in the frame upload buffer
+	 */
+	void load(long page, size_t slot, FrameData & frame, uint tile);
+
+	/** Rebuild the page table, pointing each page to its finest resident ancestor. */
+	void updatePageTable();
+
+	Generator _generator; ///< Page content generator.
+	uint _size; ///< Virtual map size in texels.
+	uint _pageSize; ///< Page size in texels.
+	uint _border = 1; ///< Border around each page in the cache, in texels.
+	uint _slotsPerSide; ///< Number of slots along each side of the cache.
+	uint _pagesPerSide; ///< Number of pages along each side of the finest level.
+	uint _levels; ///< Number of levels.
+	uint _pinnedLevel; ///< First level that is always resident.
+	uint _uploadCapacity = 8; ///< Maximum number of pages copied each frame.
+
+	Texture _cache; ///< Cache texture, height in R, normals in GBA.
+	Texture _feedback; ///< Feedback target, page coordinates and level requested for each pixel.
+	Texture _feedbackDepth; ///< Feedback depth buffer.
+	Program * _copyProgram; ///< Copy a page in the cache.
+	Image _tile; ///< Page generation storage.
+
+	std::vector<uint> _levelOffsets; ///< Index of the first page of each level.
+	std::vector<uint> _pageTable; ///< For each page, slot (low 24 bits) and level (high 8 bits) of the page to sample.
+	std::vector<int> _residency; ///< For each page, its slot or -1.
+	std::vector<Slot> _slots; ///< Cache slots.
+	std::vector<long> _requests; ///< Pages requested by the last feedback.
+	std::vector<long> _missing; ///< Pages to generate.
+	std::vector<FrameData> _frames; ///< Per-frame in flight storage.
+	uint _current = 0; ///< Current frame storage.
+
+	Statistics _statistics; ///< Residency statistics.
+	uint64_t _frame = 0; ///< Update counter.
+	GPUAsyncTask _feedbackTask = 0; ///< Feedback readback task.
+	bool _feedbackPending = false; ///< Is a readback in progress.
+};
@@ -47,6 +47,7 @@ void DeferredLight::draw(const SpotLight * light) {
 	if(light->castsShadow() && (shadowInfos.map != nullptr)) {
 		_spotProgram->texture(shadowInfos.map, uint(_textures.size()));
 		_spotProgram->uniform("shadowLayer", int(shadowInfos.layer));
+		_spotProgram->uniform("shadowRegion", glm::vec4(shadowInfos.minUV, shadowInfos.maxUV));
 		_spotProgram->uniform("shadowBias", shadowInfos.bias);
 		_spotProgram->uniform("shadowMode", int(shadowInfos.mode));
 	} else {
@@ -117,6 +118,7 @@ void DeferredLight::draw(const DirectionalLight * light) {
 	if(light->castsShadow() && (shadowInfos.map != nullptr)) {
 		_dirProgram->texture(shadowInfos.map, uint(_textures.size()));
 		_dirProgram->uniform("shadowLayer", int(shadowInfos.layer));
+		_dirProgram->uniform("shadowRegion", glm::vec4(shadowInfos.minUV, shadowInfos.maxUV));
 		_dirProgram->uniform("shadowBias", shadowInfos.bias);
 		_dirProgram->uniform("shadowMode", int(shadowInfos.mode));
 	} else {
@@ -35,6 +35,7 @@ DeferredRenderer::DeferredRenderer(const glm::vec2 & resolution, bool ssao, cons
 	_atmoProgram		= Resources::manager().getProgram("atmosphere_gbuffer", "background_infinity", "atmosphere_gbuffer");
 	_parallaxProgram	= Resources::manager().getProgram("object_parallax_gbuffer");
 	_objectProgram		= Resources::manager().getProgram("object_gbuffer");
+	_bindlessProgram	= GPU::supportsBindless() ? Resources::manager().getProgram("object_bindless_gbuffer", "object_gbuffer", "object_bindless_gbuffer") : nullptr;
 	_clearCoatProgram	= Resources::manager().getProgram("object_clearcoat_gbuffer", "object_gbuffer", "object_clearcoat_gbuffer");
 	_anisotropicProgram	= Resources::manager().getProgram("object_anisotropic_gbuffer", "object_gbuffer", "object_anisotropic_gbuffer");
 	_sheenProgram		= Resources::manager().getProgram("object_sheen_gbuffer", "object_gbuffer", "object_sheen_gbuffer");
@@ -58,9 +59,15 @@ void DeferredRenderer::setScene(const std::shared_ptr<Scene> & scene) {
 		return;
 	}
 	_scene = scene;
-	_culler.reset(new Culler(_scene->objects));
+	_culler.reset(new Culler(_scene->objects, &_scene->hierarchy()));
 	_fwdLightsGPU.reset(new ForwardLight(_scene->lights.size()));
 	_fwdProbesGPU.reset(new ForwardProbe(_scene->probes.size()));
+	_fwdClusters.reset(new ForwardClusters());
+	_materials.reset(GPU::supportsBindless() ? new MaterialTable(_scene->materials, _name) : nullptr);
+	// Fallback to binding textures for each draw call.
+	if(_materials && !_materials->valid()){
+		_materials.reset();
+	}
 }
 
 void DeferredRenderer::renderOpaque(const Culler::List & visibles, const glm::mat4 & view, const glm::mat4 & proj) {
@@ -91,6 +98,8 @@ void DeferredRenderer::renderOpaque(const Culler::List & visibles, const glm::ma
 		const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(MV)));
 
 		Program* program = nullptr;
+		// Regular materials can fetch their textures from the global table.
+		const bool useTable = _bindless && _materials && (material.type() == Material::Regular);
 
 		// Select the program (and shaders).
 		switch(material.type()) {
@@ -107,13 +116,13 @@ void DeferredRenderer::renderOpaque(const Culler::List & visibles, const glm::ma
 				_parallaxProgram->uniform("normalMatrix", glm::mat4(normalMatrix));
 				break;
 			case Material::Regular:
-				_objectProgram->use();
-				program = _objectProgram;
+				program = useTable ? _bindlessProgram : _objectProgram;
+				program->use();
 				// Upload the MVP matrix.
-				_objectProgram->uniform("mvp", MVP);
+				program->uniform("mvp", MVP);
 				// Upload the normal matrix.
-				_objectProgram->uniform("normalMatrix", glm::mat4(normalMatrix));
-				_objectProgram->uniform("hasUV", object.useTexCoords());
+				program->uniform("normalMatrix", glm::mat4(normalMatrix));
+				program->uniform("hasUV", object.useTexCoords());
 				break;
 			case Material::Clearcoat:
 				_clearCoatProgram->use();
@@ -176,9 +185,14 @@ void DeferredRenderer::renderOpaque(const Culler::List & visibles, const glm::ma
 		// Backface culling state.
 		GPU::setCullState(!material.twoSided(), Faces::BACK);
 
-		// Bind the textures.
-		program->textures(material.textures());
-		GPU::drawMesh(*object.mesh());
+		// Bind the textures, or the material index in the table.
+		if(useTable){
+			program->uniform("materialId", _materials->index(material));
+			program->buffer(_materials->data(), 0);
+		} else {
+			program->textures(material.textures());
+		}
+		GPU::drawMesh(*object.mesh(), _culler->ranges(objectId));
 	}
 
 }
@@ -204,6 +218,7 @@ void DeferredRenderer::renderTransparent(const Culler::List & visibles, const gl
 		program->uniform("lightsCount", int(_fwdLightsGPU->count()));
 		program->uniform("probesCount", int(_fwdProbesGPU->count()));
 		program->uniform("invScreenSize", invScreenSize);
+		program->uniform("clustersParams", _fwdClusters->parameters());
 
 		// This is because after a change of scene shadow maps and probes are reset, but the conditional setup of textures on
 		// the program means that descriptors can still reference the deleted textures.
@@ -252,6 +267,7 @@ void DeferredRenderer::renderTransparent(const Culler::List & visibles, const gl
 		currentProgram->buffer(_fwdLightsGPU->data(), 0);
 		currentProgram->buffer(_fwdProbesGPU->data(), 1);
 		currentProgram->bufferArray(_fwdProbesGPU->shCoeffs(), 2);
+		currentProgram->buffer(_fwdClusters->data(), 5);
 		
 		// Bind the textures.
 		currentProgram->texture(_textureBrdf, 0);
@@ -347,6 +363,7 @@ void DeferredRenderer::draw(const Camera & camera, Texture* dstColor, Texture* d
 
 	// Request list of visible objects from culler.
 	const auto & visibles = _culler->cullAndSort(view, proj, pos);
+	_culler->cullClusters(visibles, pos);
 
 	// Render opaque objects and the background to the Gbuffer.
 	{
@@ -427,6 +444,8 @@ void DeferredRenderer::draw(const Camera & camera, Texture* dstColor, Texture* d
 			_fwdProbesGPU->draw(probe);
 		}
 		_fwdProbesGPU->data().upload();
+		// Assign them to clusters.
+		_fwdClusters->update(*_fwdLightsGPU, *_fwdProbesGPU, view, proj);
 		// Now render transparent effects in a forward fashion.
 		GPU::beginRender(Load::Operation::LOAD, Load::Operation::DONTCARE, &_depthCopy, Load::Operation::LOAD, &_lighting);
 		GPU::setViewport(_lighting);
@@ -439,6 +458,19 @@ void DeferredRenderer::draw(const Camera & camera, Texture* dstColor, Texture* d
 
 }
 
+void DeferredRenderer::prepareViews(const std::vector<const Camera *> & cameras){
+	if(!_culler){
+		return;
+	}
+	// Cull all views in a single pass.
+	std::vector<glm::mat4> viewProjs;
+	viewProjs.reserve(cameras.size());
+	for(const Camera * camera : cameras){
+		viewProjs.push_back(camera->projection() * camera->view());
+	}
+	_culler->prepare(viewProjs);
+}
+
 void DeferredRenderer::resize(uint width, uint height) {
 	// Resize the textures.
 	const glm::vec2 nSize(width, height);
@@ -461,6 +493,12 @@ void DeferredRenderer::interface(){
 		ImGui::Combo("Blur quality", reinterpret_cast<int*>(&_ssaoPass->quality()), "Low\0Medium\0High\0\0");
 		ImGui::InputFloat("Radius", &_ssaoPass->radius(), 0.5f);
 	}
+	if(_materials){
+		ImGui::Checkbox("Bindless textures", &_bindless);
+	}
+	if(_fwdClusters){
+		ImGui::Combo("Transparent light clusters", reinterpret_cast<int*>(&_fwdClusters->mode()), "Disabled\0CPU\0Compute\0\0");
+	}
 	if(_culler){
 		_culler->interface();
 	}
@@ -8,6 +8,7 @@
 #include "scene/Scene.hpp"
 #include "renderers/Renderer.hpp"
 #include "renderers/Culler.hpp"
+#include "renderers/MaterialTable.hpp"
 
 #include "resources/Texture.hpp"
 #include "input/ControllableCamera.hpp"
@@ -36,7 +37,7 @@
  | :--------- | :---------------: | :---------------: | :---------------: | :---------------: |
  | 1: RGB10A2 |                                      ||                                      ||
  | 2: RGBA8   |     Roughness     |   Metalness(5)    | Ambient occlusion |                   |
- \see GPUShaders::Frag::Object_gbuffer, GPUShaders::Frag::Object_parallax_gbuffer
+ \see GPUShaders::Frag::Object_gbuffer, GPUShaders::Frag::Object_parallax_gbuffer, GPUShaders::Frag::Object_bindless_gbuffer
 
  __Clearcoat:__
  |            | _______Red‏‏‎_______ | ______Green______ | _______Blue______ | ______Alpha______ |
@@ -105,6 +106,9 @@ public:
 	/** \copydoc Renderer::draw */
 	void draw(const Camera & camera, Texture* dstColor, Texture* dstDepth, uint layer = 0) override;
 
+	/** \copydoc Renderer::prepareViews */
+	void prepareViews(const std::vector<const Camera *> & cameras) override;
+
 	/** \copydoc Renderer::resize
 	 */
 	void resize(uint width, uint height) override;
@@ -150,8 +154,10 @@ private:
 	std::unique_ptr<DeferredProbe> _probeRenderer;	///< The probes renderer.
 	std::unique_ptr<ForwardLight> _fwdLightsGPU;	///< The lights forward renderer for transparent objects.
 	std::unique_ptr<ForwardProbe> _fwdProbesGPU;	///< The probes forward renderer for transparent objects.
+	std::unique_ptr<ForwardClusters> _fwdClusters;	///< The lights and probes clusters for transparent objects.
 
 	Program * _objectProgram;		///< Basic PBR program
+	Program * _bindlessProgram;		///< Basic PBR program using the global texture table
 	Program * _parallaxProgram;		///< Parallax mapping PBR program
 	Program * _clearCoatProgram;	///< Basic PBR program with an additional clear coat specular layer.
 	Program * _anisotropicProgram;	///< Basic PBR with anisotropic roughness.
@@ -171,6 +177,8 @@ private:
 
 	std::shared_ptr<Scene> _scene;	///< The scene to render
 	std::unique_ptr<Culler>	_culler;	///< Objects culler.
+	std::unique_ptr<MaterialTable> _materials; ///< Scene materials textures in the global table.
 
 	bool _applySSAO			 = true;  ///< Screen space ambient occlusion.
+	bool _bindless			 = false; ///< Read regular materials textures from the global table.
 };
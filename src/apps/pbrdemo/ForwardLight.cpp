@@ -1,7 +1,8 @@
 #include "ForwardLight.hpp"
 #include "graphics/GPU.hpp"
+#include "resources/ResourcesManager.hpp"
 
-const size_t ForwardLight::_maxLightCount = 50;
+const size_t ForwardLight::_maxLightCount = 2048;
 
 ForwardLight::ForwardLight(size_t count) :
 	_lightsData(_maxLightCount, UniformFrequency::VIEW, "Forward lights") {
@@ -13,6 +14,7 @@ ForwardLight::ForwardLight(size_t count) :
 	// Initial buffers creation and allocation.
 	_lightsData.upload();
 	_shadowMaps.resize(2, nullptr);
+	_bounds.resize(std::min(_currentCount, _maxLightCount), glm::vec4(0.0f));
 }
 
 void ForwardLight::updateCameraInfos(const glm::mat4 & viewMatrix, const glm::mat4 & projMatrix) {
@@ -42,9 +44,12 @@ void ForwardLight::draw(const SpotLight * light) {
 	currentLight.typeModeLayer[0] = float(LightType::SPOT);
 	currentLight.typeModeLayer[1] = float(light->castsShadow() ? mapInfos.mode : ShadowMode::NONE);
 	currentLight.typeModeLayer[2] = float(mapInfos.layer);
+	currentLight.shadowRegion = glm::vec4(mapInfos.minUV, mapInfos.maxUV);
 
 	currentLight.angles[0] = glm::cos(light->angles()[0]);
 	currentLight.angles[1] = glm::cos(light->angles()[1]);
+	// The cone is contained in the sphere of the light radius.
+	_bounds[selectedId] = currentLight.positionAndRadius;
 
 	if(light->castsShadow() && (mapInfos.map != nullptr)){
 		_shadowMaps[0] = mapInfos.map;
@@ -71,6 +76,8 @@ void ForwardLight::draw(const PointLight * light) {
 	currentLight.typeModeLayer[0] = float(LightType::POINT);
 	currentLight.typeModeLayer[1] = float(light->castsShadow() ? mapInfos.mode : ShadowMode::NONE);
 	currentLight.typeModeLayer[2] = float(mapInfos.layer);
+	currentLight.shadowRegion = glm::vec4(mapInfos.minUV, mapInfos.maxUV);
+	_bounds[selectedId] = currentLight.positionAndRadius;
 
 	if(light->castsShadow() && (mapInfos.map != nullptr)){
 		_shadowMaps[1] = mapInfos.map;
@@ -96,6 +103,9 @@ void ForwardLight::draw(const DirectionalLight * light) {
 	currentLight.typeModeLayer[0] = float(LightType::DIRECTIONAL);
 	currentLight.typeModeLayer[1] = float(light->castsShadow() ? mapInfos.mode : ShadowMode::NONE);
 	currentLight.typeModeLayer[2] = float(mapInfos.layer);
+	currentLight.shadowRegion = glm::vec4(mapInfos.minUV, mapInfos.maxUV);
+	// Affects the whole scene.
+	_bounds[selectedId] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
 
 	if(light->castsShadow() && (mapInfos.map != nullptr)){
 		_shadowMaps[0] = mapInfos.map;
@@ -116,6 +126,7 @@ ForwardProbe::ForwardProbe(size_t count) :
 	_probesData.upload();
 	_probesMaps.resize(count, nullptr);
 	_probesCoeffs.resize(count, nullptr);
+	_bounds.resize(std::min(_currentCount, _maxProbeCount), glm::vec4(0.0f));
 }
 
 void ForwardProbe::draw(const LightProbe & probe) {
@@ -136,4 +147,200 @@ void ForwardProbe::draw(const LightProbe & probe) {
 
 	_probesMaps[selectedId] = probe.map();
 	_probesCoeffs[selectedId] = probe.shCoeffs().get();
+	// The effect region is a box with a fading margin.
+	_bounds[selectedId] = glm::vec4(probe.position(), glm::length(probe.size()) + probe.fade());
+}
+
+
+const glm::uvec3 ForwardClusters::_gridSize = glm::uvec3(16, 9, 24);
+const uint ForwardClusters::_maxClusterLights = 64;
+
+ForwardClusters::ForwardClusters() :
+	_clustersData(_gridSize.x * _gridSize.y * _gridSize.z, UniformFrequency::VIEW, "Forward clusters") {
+	_boxes.resize(_gridSize.x * _gridSize.y * _gridSize.z);
+	_assignProgram = Resources::manager().getProgramCompute("forward_clusters");
+	// Initial buffers creation and allocation.
+	_clustersData.upload();
+}
+
+void ForwardClusters::update(ForwardLight & lights, ForwardProbe & probes, const glm::mat4 & viewMatrix, const glm::mat4 & projMatrix){
+	_parameters = glm::vec2(0.0f);
+	// Only perspective projections are supported.
+	if(_mode == Mode::DISABLED || projMatrix[2][3] == 0.0f){
+		return;
+	}
+	// Retrieve the clipping planes.
+	const float near = projMatrix[3][2] / projMatrix[2][2];
+	const float far = projMatrix[3][2] / (projMatrix[2][2] + 1.0f);
+	// Slice index is log(depth) * scale + bias.
+	_parameters[0] = float(_gridSize.z) / std::log(far / near);
+	_parameters[1] = -std::log(near) * _parameters[0];
+
+	if(_mode == Mode::COMPUTE){
+		// The compute shader will fill the next copy of the clusters.
+		_clustersData.advance();
+		_assignProgram->use();
+		_assignProgram->uniform("v", viewMatrix);
+		_assignProgram->uniform("projParams", glm::vec4(projMatrix[0][0], projMatrix[1][1], projMatrix[2][0], projMatrix[2][1]));
+		_assignProgram->uniform("depthRange", glm::vec2(near, far));
+		_assignProgram->uniform("lightsCount", int(lights.count()));
+		_assignProgram->uniform("probesCount", int(probes.count()));
+		_assignProgram->buffer(lights.data(), 0);
+		_assignProgram->buffer(probes.data(), 1);
+		_assignProgram->buffer(_clustersData, 2);
+		GPU::dispatch(uint(_boxes.size()), 1, 1);
+		return;
+	}
+
+	if(projMatrix != _proj){
+		_proj = projMatrix;
+		updateBoxes(near, far);
+	}
+
+	for(size_t cid = 0; cid < _boxes.size(); ++cid){
+		_clustersData[cid].lightCount = 0;
+		_clustersData[cid].probeMask = 0;
+	}
+
+	// Lights.
+	const std::vector<glm::vec4> & lightsBounds = lights.bounds();
+	for(uint lid = 0; lid < uint(lights.count()); ++lid){
+		const glm::vec3 center(lightsBounds[lid]);
+		const float radius = lightsBounds[lid][3];
+		// Lights affecting the whole scene are added everywhere.
+		if(radius < 0.0f){
+			for(size_t cid = 0; cid < _boxes.size(); ++cid){
+				addLight(cid, lid);
+			}
+			continue;
+		}
+		glm::uvec3 minCluster, maxCluster;
+		if(!clustersRange(center, radius, minCluster, maxCluster)){
+			continue;
+		}
+		for(uint z = minCluster.z; z <= maxCluster.z; ++z){
+			for(uint y = minCluster.y; y <= maxCluster.y; ++y){
+				for(uint x = minCluster.x; x <= maxCluster.x; ++x){
+					const size_t cid = (z * _gridSize.y + y) * _gridSize.x + x;
+					if(intersects(cid, center, radius)){
+						addLight(cid, lid);
+					}
+				}
+			}
+		}
+	}
+
+	// Probes.
+	const std::vector<glm::vec4> & probesBounds = probes.bounds();
+	for(uint pid = 0; pid < uint(probes.count()); ++pid){
+		const glm::vec3 center = glm::vec3(viewMatrix * glm::vec4(glm::vec3(probesBounds[pid]), 1.0f));
+		const float radius = probesBounds[pid][3];
+		glm::uvec3 minCluster, maxCluster;
+		if(!clustersRange(center, radius, minCluster, maxCluster)){
+			continue;
+		}
+		for(uint z = minCluster.z; z <= maxCluster.z; ++z){
+			for(uint y = minCluster.y; y <= maxCluster.y; ++y){
+				for(uint x = minCluster.x; x <= maxCluster.x; ++x){
+					const size_t cid = (z * _gridSize.y + y) * _gridSize.x + x;
+					if(intersects(cid, center, radius)){
+						_clustersData[cid].probeMask |= (1u << pid);
+					}
+				}
+			}
+		}
+	}
+	_clustersData.upload();
+}
+
+void ForwardClusters::updateBoxes(float near, float far){
+	const float ratio = far / near;
+	const glm::vec2 scale(_proj[0][0], _proj[1][1]);
+	const glm::vec2 shift(_proj[2][0], _proj[2][1]);
+
+	for(uint z = 0; z < _gridSize.z; ++z){
+		// Exponential distribution of slices in depth.
+		const float zNear = near * std::pow(ratio, float(z) / float(_gridSize.z));
+		const float zFar = near * std::pow(ratio, float(z + 1) / float(_gridSize.z));
+		for(uint y = 0; y < _gridSize.y; ++y){
+			for(uint x = 0; x < _gridSize.x; ++x){
+				const glm::vec2 ndcMin = 2.0f * glm::vec2(x, y) / glm::vec2(_gridSize) - 1.0f;
+				const glm::vec2 ndcMax = 2.0f * glm::vec2(x + 1, y + 1) / glm::vec2(_gridSize) - 1.0f;
+				BoundingBox & box = _boxes[(z * _gridSize.y + y) * _gridSize.x + x];
+				box = BoundingBox();
+				// Unproject the corners of the cluster.
+				for(uint i = 0; i < 8; ++i){
+					const glm::vec2 ndc((i & 1) ? ndcMax.x : ndcMin.x, (i & 2) ? ndcMax.y : ndcMin.y);
+					const float depth = (i & 4) ? zFar : zNear;
+					const glm::vec2 xy = depth * (ndc + shift) / scale;
+					box.merge(glm::vec3(xy, -depth));
+				}
+			}
+		}
+	}
+}
+
+bool ForwardClusters::clustersRange(const glm::vec3 & center, float radius, glm::uvec3 & minCluster, glm::uvec3 & maxCluster) const {
+	// Depth range.
+	const float depthMin = -center.z - radius;
+	const float depthMax = -center.z + radius;
+	const float sliceMin = std::log(std::max(depthMin, 1e-4f)) * _parameters[0] + _parameters[1];
+	const float sliceMax = std::log(std::max(depthMax, 1e-4f)) * _parameters[0] + _parameters[1];
+	if(sliceMax < 0.0f || sliceMin >= float(_gridSize.z)){
+		return false;
+	}
+	minCluster.z = uint(glm::clamp(sliceMin, 0.0f, float(_gridSize.z - 1)));
+	maxCluster.z = uint(glm::clamp(sliceMax, 0.0f, float(_gridSize.z - 1)));
+
+	// Screen range, conservatively using the projected bounding box of the sphere.
+	minCluster.x = minCluster.y = 0;
+	maxCluster.x = _gridSize.x - 1;
+	maxCluster.y = _gridSize.y - 1;
+	// If the sphere crosses the near plane, use the whole screen.
+	const float near = _proj[3][2] / _proj[2][2];
+	if(depthMin <= near){
+		return true;
+	}
+	glm::vec2 ndcMin(std::numeric_limits<float>::max());
+	glm::vec2 ndcMax(std::numeric_limits<float>::lowest());
+	for(uint i = 0; i < 8; ++i){
+		const glm::vec3 corner = center + radius * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+		const glm::vec4 clip = _proj * glm::vec4(corner, 1.0f);
+		const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+	if(ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f){
+		return false;
+	}
+	const glm::vec2 gridSize(_gridSize);
+	const glm::vec2 tileMin = glm::clamp((0.5f * ndcMin + 0.5f) * gridSize, glm::vec2(0.0f), gridSize - 1.0f);
+	const glm::vec2 tileMax = glm::clamp((0.5f * ndcMax + 0.5f) * gridSize, glm::vec2(0.0f), gridSize - 1.0f);
+	minCluster.x = uint(tileMin.x);
+	minCluster.y = uint(tileMin.y);
+	maxCluster.x = uint(tileMax.x);
+	maxCluster.y = uint(tileMax.y);
+	return true;
+}
+
+bool ForwardClusters::intersects(size_t clusterId, const glm::vec3 & center, float radius) const {
+	const BoundingBox & box = _boxes[clusterId];
+	const glm::vec3 closest = glm::clamp(center, box.minis, box.maxis);
+	const glm::vec3 delta = closest - center;
+	return glm::dot(delta, delta) <= radius * radius;
+}
+
+void ForwardClusters::addLight(size_t clusterId, uint lightId){
+	GPUCluster & cluster = _clustersData[clusterId];
+	if(cluster.lightCount >= _maxClusterLights){
+		return;
+	}
+	// Pack two indices per entry.
+	const uint entry = cluster.lightCount / 2;
+	if(cluster.lightCount % 2 == 0){
+		cluster.lights[entry] = lightId;
+	} else {
+		cluster.lights[entry] |= (lightId << 16);
+	}
+	++cluster.lightCount;
 }
@@ -9,12 +9,15 @@
 #include "scene/lights/DirectionalLight.hpp"
 #include "scene/lights/SpotLight.hpp"
 #include "resources/Buffer.hpp"
+#include "graphics/Program.hpp"
+#include "resources/Bounds.hpp"
 
 #include "Common.hpp"
 
 
 /**
  \brief Store lights data for forward rendering in a GPU buffer.
+ \details The view space bounding sphere of each light is also kept on the CPU, for clustering (see ForwardClusters).
  \ingroup PBRDemo
  */
 class ForwardLight final : public LightRenderer {
@@ -29,6 +32,7 @@ public:
 		glm::vec4 directionAndPlane; ///< Light direction and far plane distance.
 		glm::vec4 typeModeLayer; ///< Light type, shadow mode and shadow map layer.
 		glm::vec4 angles; ///< Cone inner and outer angles.
+		glm::vec4 shadowRegion; ///< Shadow map region in the layer (min and max UVs).
 	};
 
 	/** Constructor.
@@ -60,7 +64,12 @@ public:
 
 	/** \return the current number of lights */
 	size_t count() const {
-		return _currentCount;
+		return std::min(_currentCount, _maxLightCount);
+	}
+
+	/** \return the view space bounding sphere of each light (center and radius, negative for lights affecting the whole scene) */
+	const std::vector<glm::vec4> & bounds() const {
+		return _bounds;
 	}
 
 	/** \return the shadow maps used by the lights */
@@ -79,6 +88,7 @@ private:
 	size_t _currentCount = 0; ///< Number of lights to store.
 	const static size_t _maxLightCount; ///< Maximum allowed number of lights (see forward_lights.glsl).
 	UniformBuffer<GPULight> _lightsData; ///< GPU buffer.
+	std::vector<glm::vec4> _bounds; ///< Lights bounding spheres in view space.
 
 	glm::mat4 _view = glm::mat4(1.0f); ///< Cached camera view matrix.
 	glm::mat4 _proj = glm::mat4(1.0f); ///< Cached camera projection matrix.
@@ -116,7 +126,12 @@ public:
 
 	/** \return the current number of probes */
 	size_t count() const {
-		return _currentCount;
+		return std::min(_currentCount, _maxProbeCount);
+	}
+
+	/** \return the world space bounding sphere of each probe effect region */
+	const std::vector<glm::vec4> & bounds() const {
+		return _bounds;
 	}
 
 	/** \return the cubemaps used by the recorded probes */
@@ -140,7 +155,104 @@ private:
 	size_t _currentCount = 0; ///< Number of probes to store.
 	const static size_t _maxProbeCount; ///< Maximum allowed number of probes (see forward_lights.glsl).
 	UniformBuffer<GPUProbe> _probesData; ///< GPU buffer.
+	std::vector<glm::vec4> _bounds; ///< Probes effect bounding spheres in world space.
 
 	std::vector<const Texture *> _probesMaps; ///< Environment maps list.
 	std::vector<const Buffer *> _probesCoeffs; ///< Environment SH coeffs list.
 };
+
+
+/**
+ \brief Assign lights and probes to the clusters of a view frustum, for forward rendering.
+ \details The view frustum is divided in a grid of froxels, exponentially distributed in depth. Each cluster stores the list of lights whose bounding sphere intersects it, and a mask of the probes that can affect it. Fragment shaders then only evaluate the lights and probes of their cluster. Assignment can be performed on the CPU or in a compute shader. At most 64 lights are stored per cluster.
+ \see GPUShaders::Comp::Forward_clusters
+ \ingroup PBRDemo
+ */
+class ForwardClusters {
+
+public:
+
+	/** \brief Lights and probes assignment method. */
+	enum class Mode : int {
+		DISABLED = 0, ///< Each fragment evaluates all lights and probes.
+		CPU, ///< Assignment on the CPU.
+		COMPUTE ///< Assignment in a compute shader.
+	};
+
+	/** \brief Represent a cluster on the GPU. */
+	struct GPUCluster {
+		uint lightCount; ///< Number of lights in the cluster.
+		uint probeMask; ///< Bitmask of the probes affecting the cluster.
+		uint pad0; ///< Padding.
+		uint pad1; ///< Padding.
+		uint lights[32]; ///< Light indices, packed two by two (16 bits each).
+	};
+
+	/** Constructor. */
+	ForwardClusters();
+
+	/** Assign the recorded lights and probes to the clusters of a view. This has to be called outside of a render pass.
+	 \param lights the lights, recorded for this view
+	 \param probes the probes, recorded for this view
+	 \param viewMatrix the camera view matrix
+	 \param projMatrix the camera projection matrix
+	 \note Clustering is disabled for non-perspective projections.
+	 */
+	void update(ForwardLight & lights, ForwardProbe & probes, const glm::mat4 & viewMatrix, const glm::mat4 & projMatrix);
+
+	/** \return the depth slicing scale and bias to pass to shaders (zero if clustering is disabled) */
+	const glm::vec2 & parameters() const {
+		return _parameters;
+	}
+
+	/** \return the GPU clusters buffer */
+	UniformBuffer<GPUCluster> & data(){
+		return _clustersData;
+	}
+
+	/** \return the assignment method */
+	Mode & mode(){
+		return _mode;
+	}
+
+private:
+
+	/** Compute the view space bounding box of each cluster.
+	 \param near the near plane distance
+	 \param far the far plane distance
+	 */
+	void updateBoxes(float near, float far);
+
+	/** Find the range of clusters that a view space sphere might intersect.
+	 \param center the sphere center
+	 \param radius the sphere radius
+	 \param minCluster will contain the first cluster coordinates
+	 \param maxCluster will contain the last cluster coordinates
+	 \return false if the sphere is outside of the view frustum
+	 */
+	bool clustersRange(const glm::vec3 & center, float radius, glm::uvec3 & minCluster, glm::uvec3 & maxCluster) const;
+
+	/** Check if a view space sphere intersects a cluster bounding box.
+	 \param clusterId the cluster index
+	 \param center the sphere center
+	 \param radius the sphere radius
+	 \return true if they intersect
+	 */
+	bool intersects(size_t clusterId, const glm::vec3 & center, float radius) const;
+
+	/** Append a light to a cluster list, if there is room left.
+	 \param clusterId the cluster index
+	 \param lightId the light index
+	 */
+	void addLight(size_t clusterId, uint lightId);
+
+	const static glm::uvec3 _gridSize; ///< Number of clusters along each axis (see forward_lights.glsl).
+	const static uint _maxClusterLights; ///< Maximum number of lights per cluster (see forward_lights.glsl).
+
+	UniformBuffer<GPUCluster> _clustersData; ///< GPU buffer.
+	std::vector<BoundingBox> _boxes; ///< Clusters view space bounding boxes.
+	Program * _assignProgram; ///< Compute assignment program.
+	glm::mat4 _proj = glm::mat4(0.0f); ///< Projection used to compute the clusters boxes.
+	glm::vec2 _parameters = glm::vec2(0.0f); ///< Depth slicing scale and bias.
+	Mode _mode = Mode::CPU; ///< Assignment method.
+};
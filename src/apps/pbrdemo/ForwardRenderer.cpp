@@ -16,9 +16,14 @@ ForwardRenderer::ForwardRenderer(const glm::vec2 & resolution, bool ssao, const
 	_sceneDepth.setupAsDrawable(Layout::DEPTH_COMPONENT32F, renderWidth, renderHeight);
 	_ssaoPass		  = std::unique_ptr<SSAO>(new SSAO(renderWidth, renderHeight, 2, 0.5f, _name));
 	_colorFormat 	  = Layout::RGBA16F;
+	_clusters.reset(new ForwardClusters());
 
 	_depthPrepass 		= Resources::manager().getProgram("object_prepass_forward");
 	_objectProgram		= Resources::manager().getProgram("object_forward");
+	_bindlessProgram	= GPU::supportsBindless() ? Resources::manager().getProgram("object_bindless_forward", "object_forward", "object_bindless_forward") : nullptr;
+	_instancedProgram	= Resources::manager().getProgram("object_instanced_forward", "object_instanced_forward", "object_forward");
+	_instancedBindlessProgram = GPU::supportsBindless() ? Resources::manager().getProgram("object_instanced_bindless_forward", "object_instanced_forward", "object_bindless_forward") : nullptr;
+	_batcher.reset(new DrawBatcher(name + "Batches"));
 	_parallaxProgram	= Resources::manager().getProgram("object_parallax_forward");
 	_emissiveProgram	= Resources::manager().getProgram("object_emissive_forward", "object_forward", "object_emissive_forward");
 	_transparentProgram = Resources::manager().getProgram("object_transparent_forward", "object_forward", "object_transparent_forward");
@@ -42,9 +47,24 @@ void ForwardRenderer::setScene(const std::shared_ptr<Scene> & scene) {
 		return;
 	}
 	_scene = scene;
-	_culler.reset(new Culler(_scene->objects));
+	_culler.reset(new Culler(_scene->objects, &_scene->hierarchy()));
 	_lightsGPU.reset(new ForwardLight(_scene->lights.size()));
 	_probesGPU.reset(new ForwardProbe(_scene->probes.size()));
+	_materials.reset(GPU::supportsBindless() ? new MaterialTable(_scene->materials, _name) : nullptr);
+	// Fallback to binding textures for each draw call.
+	if(_materials && !_materials->valid()){
+		_materials.reset();
+	}
+	_gpuCuller.reset();
+	if(GPU::supportsDrawIndirectCount()){
+		std::vector<long> selection;
+		for(size_t oid = 0; oid < _scene->objects.size(); ++oid){
+			if(_scene->objects[oid].material().type() == Material::Regular){
+				selection.push_back(long(oid));
+			}
+		}
+		_gpuCuller.reset(new GPUCuller(_scene->objects, selection, _name + "GPU culling"));
+	}
 }
 
 void ForwardRenderer::renderDepth(const Culler::List & visibles, const glm::mat4 & view, const glm::mat4 & proj){
@@ -63,6 +83,7 @@ void ForwardRenderer::renderDepth(const Culler::List & visibles, const glm::mat4
 
 	_depthPrepass->use();
 	_depthPrepass->defaultTexture(0);
+	const bool gpuCulling = _gpuCulling && _gpuCuller;
 	
 	for(const long & objectId : visibles) {
 		// Once we get a -1, there is no other object to render.
@@ -78,6 +99,10 @@ void ForwardRenderer::renderDepth(const Culler::List & visibles, const glm::mat4
 		if(material.type() == Material::Parallax || material.type() == Material::Transparent || material.type() == Material::Type::TransparentIrid){
 			continue;
 		}
+		// Objects culled on the GPU write their depth in the opaque pass.
+		if(gpuCulling && material.type() == Material::Regular){
+			continue;
+		}
 
 		// Upload the matrices.
 		const glm::mat4 MV	= view * object.model();
@@ -95,7 +120,7 @@ void ForwardRenderer::renderDepth(const Culler::List & visibles, const glm::mat4
 		}
 		// Backface culling state.
 		GPU::setCullState(!material.twoSided(), Faces::BACK);
-		GPU::drawMesh(*object.mesh());
+		GPU::drawMesh(*object.mesh(), _culler->ranges(objectId));
 	}
 	GPU::endRender();
 }
@@ -109,6 +134,8 @@ void ForwardRenderer::renderOpaque(const Culler::List & visibles, const glm::mat
 	GPU::setBlendState(false);
 
 	const auto & shadowMaps = _lightsGPU->shadowMaps();
+	const bool gpuCulling = _gpuCulling && _gpuCuller;
+	_batcher->clear();
 
 	// Scene objects.
 	for(const long & objectId : visibles) {
@@ -123,6 +150,17 @@ void ForwardRenderer::renderOpaque(const Culler::List & visibles, const glm::mat
 		if((material.type() == Material::Type::Transparent) || (material.type() == Material::Type::TransparentIrid)){
 			continue;
 		}
+		// Regular objects culled on the GPU are drawn in groups afterwards.
+		if(gpuCulling && (material.type() == Material::Regular)){
+			continue;
+		}
+		// Regular materials can fetch their textures from the global table.
+		const bool useTable = _bindless && _materials && (material.type() == Material::Regular);
+		// And be batched with other objects sharing the same mesh and material.
+		if(_instancing && (material.type() == Material::Regular)){
+			_batcher->add(useTable ? _instancedBindlessProgram : _instancedProgram, object, view, proj, _culler->ranges(objectId));
+			continue;
+		}
 
 		// Combine the three matrices.
 		const glm::mat4 MV	= view * object.model();
@@ -135,7 +173,7 @@ void ForwardRenderer::renderOpaque(const Culler::List & visibles, const glm::mat
 				currentProgram = _parallaxProgram;
 				break;
 			case Material::Regular:
-				currentProgram = _objectProgram;
+				currentProgram = useTable ? _bindlessProgram : _objectProgram;
 				break;
 			case Material::Clearcoat:
 				currentProgram = _clearCoatProgram;
@@ -176,6 +214,7 @@ void ForwardRenderer::renderOpaque(const Culler::List & visibles, const glm::mat
 		currentProgram->buffer(_lightsGPU->data(), 0);
 		currentProgram->buffer(_probesGPU->data(), 1);
 		currentProgram->bufferArray(_probesGPU->shCoeffs(), 2);
+		currentProgram->buffer(_clusters->data(), 5);
 		// Bind the textures.
 		currentProgram->texture(_textureBrdf, 0);
 		currentProgram->textureArray(_probesGPU->envmaps(), 1);
@@ -187,11 +226,116 @@ void ForwardRenderer::renderOpaque(const Culler::List & visibles, const glm::mat
 			currentProgram->texture(shadowMaps[1], 3);
 		}
 		currentProgram->texture(_ssaoPass->texture(), 4);
-		currentProgram->textures(material.textures(), 5);
+		if(useTable){
+			currentProgram->uniform("materialId", _materials->index(material));
+			currentProgram->buffer(_materials->data(), 3);
+		} else {
+			currentProgram->textures(material.textures(), 5);
+		}
 		
-		GPU::drawMesh(*object.mesh());
+		GPU::drawMesh(*object.mesh(), _culler->ranges(objectId));
+	}
+
+	renderBatches();
+	if(gpuCulling){
+		renderCulledGroups();
+	}
+}
+
+void ForwardRenderer::renderBatches(){
+	_batcher->upload();
+	if(_batcher->batches().empty()){
+		return;
+	}
+
+	GPUMarker marker("Batched objects");
+	const auto & shadowMaps = _lightsGPU->shadowMaps();
+
+	for(const DrawBatcher::Batch & batch : _batcher->batches()){
+		const Object & object = *batch.object;
+		const Material & material = object.material();
+		Program * currentProgram = batch.program;
+
+		currentProgram->use();
+		currentProgram->uniform("hasUV", object.useTexCoords());
+		// Transformations are stored per instance.
+		currentProgram->buffer(_batcher->instances(), 4);
+
+		// Backface culling state.
+		GPU::setCullState(!material.twoSided(), Faces::BACK);
+		// Bind the lights.
+		currentProgram->buffer(_lightsGPU->data(), 0);
+		currentProgram->buffer(_probesGPU->data(), 1);
+		currentProgram->bufferArray(_probesGPU->shCoeffs(), 2);
+		currentProgram->buffer(_clusters->data(), 5);
+		// Bind the textures.
+		currentProgram->texture(_textureBrdf, 0);
+		currentProgram->textureArray(_probesGPU->envmaps(), 1);
+		// Bind available shadow maps.
+		if(shadowMaps[0]){
+			currentProgram->texture(shadowMaps[0], 2);
+		}
+		if(shadowMaps[1]){
+			currentProgram->texture(shadowMaps[1], 3);
+		}
+		currentProgram->texture(_ssaoPass->texture(), 4);
+		if(currentProgram == _instancedBindlessProgram){
+			currentProgram->uniform("materialId", _materials->index(material));
+			currentProgram->buffer(_materials->data(), 3);
+		} else {
+			currentProgram->textures(material.textures(), 5);
+		}
+
+		_batcher->draw(batch);
+	}
+}
+
+void ForwardRenderer::renderCulledGroups(){
+	if(_gpuCuller->groups().empty()){
+		return;
 	}
 
+	GPUMarker marker("GPU culled objects");
+	const auto & shadowMaps = _lightsGPU->shadowMaps();
+
+	for(const GPUCuller::Group & group : _gpuCuller->groups()){
+		const Object & object = *group.object;
+		const Material & material = object.material();
+		const bool useTable = _bindless && _materials;
+		Program * currentProgram = useTable ? _instancedBindlessProgram : _instancedProgram;
+
+		currentProgram->use();
+		currentProgram->uniform("hasUV", object.useTexCoords());
+		// Transformations of visible items are written by the culling.
+		currentProgram->buffer(_gpuCuller->instances(), 4);
+
+		// Backface culling state.
+		GPU::setCullState(!material.twoSided(), Faces::BACK);
+		// Bind the lights.
+		currentProgram->buffer(_lightsGPU->data(), 0);
+		currentProgram->buffer(_probesGPU->data(), 1);
+		currentProgram->bufferArray(_probesGPU->shCoeffs(), 2);
+		currentProgram->buffer(_clusters->data(), 5);
+		// Bind the textures.
+		currentProgram->texture(_textureBrdf, 0);
+		currentProgram->textureArray(_probesGPU->envmaps(), 1);
+		// Bind available shadow maps.
+		if(shadowMaps[0]){
+			currentProgram->texture(shadowMaps[0], 2);
+		}
+		if(shadowMaps[1]){
+			currentProgram->texture(shadowMaps[1], 3);
+		}
+		currentProgram->texture(_ssaoPass->texture(), 4);
+		if(useTable){
+			currentProgram->uniform("materialId", _materials->index(material));
+			currentProgram->buffer(_materials->data(), 3);
+		} else {
+			currentProgram->textures(material.textures(), 5);
+		}
+
+		_gpuCuller->draw(group);
+	}
 }
 
 void ForwardRenderer::renderTransparent(const Culler::List & visibles, const glm::mat4 & view, const glm::mat4 & proj){
@@ -245,6 +389,7 @@ void ForwardRenderer::renderTransparent(const Culler::List & visibles, const glm
 		currentProgram->buffer(_lightsGPU->data(), 0);
 		currentProgram->buffer(_probesGPU->data(), 1);
 		currentProgram->bufferArray(_probesGPU->shCoeffs(), 2);
+		currentProgram->buffer(_clusters->data(), 5);
 		// Bind the textures.
 		currentProgram->texture(_textureBrdf, 0);
 		currentProgram->textureArray(_probesGPU->envmaps(), 1);
@@ -347,8 +492,17 @@ void ForwardRenderer::draw(const Camera & camera, Texture* dstColor, Texture* ds
 	}
 	_probesGPU->data().upload();
 
+	// --- Assign lights and probes to clusters
+	_clusters->update(*_lightsGPU, *_probesGPU, view, proj);
+
 	// Select visible objects.
 	const auto & visibles = _culler->cullAndSort(view, proj, pos);
+	_culler->cullClusters(visibles, pos);
+	// Regular objects can be culled on the GPU, using the depth of the previous frame.
+	const bool gpuCulling = _gpuCulling && _gpuCuller;
+	if(gpuCulling){
+		_gpuCuller->cull(view, proj, pos);
+	}
 
 	// Depth and normas prepass.
 	renderDepth(visibles, view, proj);
@@ -365,13 +519,19 @@ void ForwardRenderer::draw(const Camera & camera, Texture* dstColor, Texture* ds
 		const glm::mat4 invView = glm::inverse(view);
 		const glm::vec2 invScreenSize = 1.0f / glm::vec2(_sceneColor.width, _sceneColor.height);
 		// Update shared data for the three programs.
-		Program * programs[] = {_parallaxProgram, _objectProgram, _clearCoatProgram, _transparentProgram, _transpIridProgram, _emissiveProgram, _anisotropicProgram, _sheenProgram, _iridescentProgram, _subsurfaceProgram };
+		std::vector<Program *> programs = {_parallaxProgram, _objectProgram, _clearCoatProgram, _transparentProgram, _transpIridProgram, _emissiveProgram, _anisotropicProgram, _sheenProgram, _iridescentProgram, _subsurfaceProgram };
+		programs.push_back(_instancedProgram);
+		if(_bindlessProgram){
+			programs.push_back(_bindlessProgram);
+			programs.push_back(_instancedBindlessProgram);
+		}
 		for(Program * prog : programs){
 			prog->use();
 			prog->uniform("inverseV", invView);
 			prog->uniform("probesCount", int(_probesGPU->count()));
 			prog->uniform("lightsCount", int(_lightsGPU->count()));
 			prog->uniform("invScreenSize", invScreenSize);
+			prog->uniform("clustersParams", _clusters->parameters());
 			/// This is because after a change of scene shadow maps and probes are reset, but the conditional setup of textures on
 			/// the program means that descriptors can still reference the deleted textures.
 			/// \todo Currently there is no mechanism to "unregister" a texture for each shader using it, when deleting the texture.
@@ -396,10 +556,28 @@ void ForwardRenderer::draw(const Camera & camera, Texture* dstColor, Texture* ds
 	renderTransparent(visibles, view, proj);
 	GPU::endRender();
 
+	// Prepare occlusion culling for the next frame.
+	if(gpuCulling){
+		_gpuCuller->updateDepth(_sceneDepth, view, proj);
+	}
+
 	// Final composite pass
 	GPU::blit(_sceneColor, *dstColor, 0, layer, Filter::LINEAR);
 }
 
+void ForwardRenderer::prepareViews(const std::vector<const Camera *> & cameras){
+	if(!_culler){
+		return;
+	}
+	// Cull all views in a single pass.
+	std::vector<glm::mat4> viewProjs;
+	viewProjs.reserve(cameras.size());
+	for(const Camera * camera : cameras){
+		viewProjs.push_back(camera->projection() * camera->view());
+	}
+	_culler->prepare(viewProjs);
+}
+
 void ForwardRenderer::resize(uint width, uint height) {
 	// Resize the textures.
 	_ssaoPass->resize(width / 2, height / 2);
@@ -415,6 +593,17 @@ void ForwardRenderer::interface(){
 		ImGui::Combo("Blur quality", reinterpret_cast<int*>(&_ssaoPass->quality()), "Low\0Medium\0High\0\0");
 		ImGui::InputFloat("Radius", &_ssaoPass->radius(), 0.5f);
 	}
+	ImGui::Combo("Light clusters", reinterpret_cast<int*>(&_clusters->mode()), "Disabled\0CPU\0Compute\0\0");
+	if(_materials){
+		ImGui::Checkbox("Bindless textures", &_bindless);
+	}
+	ImGui::Checkbox("Batch regular objects", &_instancing);
+	if(_gpuCuller){
+		ImGui::Checkbox("GPU culling", &_gpuCulling);
+		if(_gpuCulling){
+			_gpuCuller->interface();
+		}
+	}
 	if(_culler){
 		_culler->interface();
 	}
@@ -7,6 +7,9 @@
 #include "scene/Scene.hpp"
 #include "renderers/Renderer.hpp"
 #include "renderers/Culler.hpp"
+#include "renderers/MaterialTable.hpp"
+#include "renderers/DrawBatcher.hpp"
+#include "renderers/GPUCuller.hpp"
 
 #include "resources/Texture.hpp"
 #include "input/ControllableCamera.hpp"
@@ -20,9 +23,19 @@
  \brief A renderer that shade each object as it is drawn in the scene directly.
  \sa ForwardLight
 
- Lights and probes information is stored in large data buffers that each object shader iterates over, summing their lighting contribution and outputing the final result.
+ Lights and probes information is stored in large data buffers that each object shader iterates over, summing their lighting contribution and outputing the final result. Lights and probes are assigned to clusters of the view frustum beforehand, so that each fragment only iterates over the ones that can affect it.
+ \see ForwardClusters
  \see GPUShaders::Frag::Object_forward, GPUShaders::Frag::Object_parallax_forward, GPUShaders::Frag::Object_clearcoat_forward, GPUShaders::Frag::Object_anisotropic_forward, GPUShaders::Frag::Object_sheen_forward, GPUShaders::Frag::Object_iridescent_forward,  GPUShaders::Frag::Object_subsurface_forward, GPUShaders::Frag::Object_emissive_forward, GPUShaders::Frag::Object_transparent_forward, GPUShaders::Frag::Object_transparent_irid_forward
 
+ If supported, regular materials can read their textures from the global texture table instead of rebinding them for each object.
+ \see GPUShaders::Frag::Object_bindless_forward
+
+ Objects with regular materials can also be batched by mesh and material, and drawn using instanced indirect draw calls.
+ \see GPUShaders::Vert::Object_instanced_forward
+
+ If supported, these objects can instead be culled on the GPU against the view frustum and the previous frame depth, and drawn with one indirect call per mesh and material. They are then skipped by the depth prepass (and ignored by screen space ambient occlusion).
+ \see GPUCuller
+
  A depth prepass is used to avoid wasting lighting computations on surfaces that are occluded by other objects drawn later in the frame.
  \see GPUShaders::Frag::Object_prepass_forward
 
@@ -46,6 +59,9 @@ public:
 	/** \copydoc Renderer::draw */
 	void draw(const Camera & camera, Texture* dstColor, Texture* dstDepth, uint layer = 0) override;
 
+	/** \copydoc Renderer::prepareViews */
+	void prepareViews(const std::vector<const Camera *> & cameras) override;
+
 	/** \copydoc Renderer::resize
 	 */
 	void resize(uint width, uint height) override;
@@ -73,6 +89,12 @@ private:
 	 */
 	void renderOpaque(const Culler::List & visibles, const glm::mat4 & view, const glm::mat4 & proj);
 
+	/** Render the opaque objects batches gathered while rendering opaque objects. */
+	void renderBatches();
+
+	/** Render the opaque objects culled on the GPU. */
+	void renderCulledGroups();
+
 	/** Render the scene transparent objects.
 	 \param visibles list of indices of visible objects 
 	 \param view the camera view matrix
@@ -92,8 +114,12 @@ private:
 	std::unique_ptr<SSAO> _ssaoPass;				///< SSAO processing.
 	std::unique_ptr<ForwardLight> _lightsGPU;	///< The lights renderer.
 	std::unique_ptr<ForwardProbe> _probesGPU;	///< The probes renderer.
+	std::unique_ptr<ForwardClusters> _clusters;	///< The lights and probes clusters.
 
 	Program * _objectProgram;		///< Basic PBR program
+	Program * _bindlessProgram;		///< Basic PBR program using the global texture table
+	Program * _instancedProgram;	///< Basic PBR program with per-instance transformations
+	Program * _instancedBindlessProgram; ///< Basic PBR program with per-instance transformations, using the global texture table
 	Program * _parallaxProgram;	 	///< Parallax mapping PBR program
 	Program * _emissiveProgram;	 	///< Parallax mapping PBR program
 	Program * _transparentProgram;	///< Transparent PBR program
@@ -113,8 +139,14 @@ private:
 
 	std::shared_ptr<Scene>  _scene;  ///< The scene to render
 	std::unique_ptr<Culler> _culler; ///<Objects culler.
+	std::unique_ptr<MaterialTable> _materials; ///< Scene materials textures in the global table.
+	std::unique_ptr<DrawBatcher> _batcher; ///< Opaque objects batches.
+	std::unique_ptr<GPUCuller> _gpuCuller; ///< Regular objects culled on the GPU.
 
 	bool _applySSAO			 = true;  ///< Screen space ambient occlusion.
+	bool _bindless			 = false; ///< Read regular materials textures from the global table.
+	bool _instancing		 = false; ///< Batch regular objects in instanced draw calls.
+	bool _gpuCulling		 = false; ///< Cull and draw regular objects from the GPU.
 
 
 };
@@ -18,6 +18,7 @@ PBRDemo::PBRDemo(RenderingConfig & config, Window & window) :
 	_finalProgram = Resources::manager().getProgram2D("sharpening");
 	
 	_probesRenderer.reset(new DeferredRenderer(glm::vec2(128,128), false, "Probes"));
+	_probesScheduler.setBudget(_probesBudget);
 
 	// Load all existing scenes, with associated names.
 	std::vector<Resources::FileInfos> sceneInfos;
@@ -74,12 +75,16 @@ void PBRDemo::setScene(const std::shared_ptr<Scene> & scene) {
 		probe.reset();
 	}
 	_probes.clear();
+	_probesScheduler.clear();
 	// Allocate probes.
 	for(LightProbe& probe : scene->probes){
 		if(probe.type() != LightProbe::Type::DYNAMIC){
 			continue;
 		}
 		_probes.emplace_back(new Probe(probe, _probesRenderer, 128, 6, glm::vec2(0.01f, 1000.0f)));
+		// Probe convolutions are performed on the async compute queue if available.
+		_probes.back()->useAsyncCompute(GPU::supportsAsyncCompute());
+		_probesScheduler.add(*_probes.back());
 	}
 
 	// Trigger one-shot data update.
@@ -87,32 +92,52 @@ void PBRDemo::setScene(const std::shared_ptr<Scene> & scene) {
 	for(uint i = 0; i < 3; ++i){
 		for(auto & probe : _probes) {
 			probe->update(probe->totalBudget());
+			probe->updateCompute();
 			GPU::flush();
 		}
 	}
 }
 
 void PBRDemo::updateMaps(){
-	// Light shadows pass.
+	// The scheduler only updates probes whose surroundings have changed.
+	const bool updateProbes = !_probes.empty();
+
+	// Probes whose faces have all been drawn are convolved on the async compute queue,
+	// overlapping with the shadow maps rendering. Skip the queue split if there is nothing to convolve.
+	if(updateProbes && _probesScheduler.pendingCompute()){
+		GPU::beginAsyncCompute();
+		_probesScheduler.updateCompute();
+		GPU::endAsyncCompute();
+	}
+
+	// Light shadows pass, only views that have changed are updated.
 	{
 		GPUMarker marker("Shadow maps");
 		_shadowTime.begin();
+		const bool animated = _scenes[_currentScene]->animated() && !_paused;
 		for(const auto & map : _shadowMaps) {
+			// Maps without cache are fully redrawn, only do it if something could have changed.
+			if(!animated && !map->cachesStatic()){
+				continue;
+			}
+			map->setViewpoint(_userCamera);
+			map->setAnimated(animated);
 			map->draw(*_scenes[_currentScene]);
 		}
 		_shadowTime.end();
 	}
 
+	if(!updateProbes){
+		return;
+	}
+	// Probes faces drawing, the renderer will use the convolved probes.
+	GPU::waitAsyncCompute();
 
 	// Probes pass.
 	{
 		GPUMarker marker("Probes");
 		_probesTime.begin();
-		for(auto & probe : _probes) {
-			// For now, ensure each dynamic probe is entirely updated over frameCount frames.
-			const uint budget = probe->totalBudget() / _frameCount;
-			probe->update(budget);
-		}
+		_probesScheduler.update(*_scenes[_currentScene], _userCamera, !_paused);
 		_probesTime.end();
 	}
 
@@ -130,9 +155,7 @@ void PBRDemo::draw() {
 
 	_totalTime.begin();
 	
-	if((_scenes[_currentScene]->animated() && !_paused)){
-		updateMaps();
-	}
+	updateMaps();
 
 	// Renderer and postproc passes.
 	_rendererTime.begin();
@@ -179,6 +202,9 @@ void PBRDemo::update() {
 		ImGui::Text("Total CPU time: %05.1fms", float(_totalTime.value())/1000000.0f);
 		ImGui::Text("Shadow maps update: %05.1fms", float(_shadowTime.value())/1000000.0f);
 		ImGui::Text("Probes update: %05.1fms", float(_probesTime.value())/1000000.0f);
+		const ProbeScheduler::Statistics & probesStats = _probesScheduler.statistics();
+		ImGui::Text("Probes outdated: %u/%u, updated: %u (%u steps, %.2fms/step)", probesStats.outdated, probesStats.probes, probesStats.updated, probesStats.steps, probesStats.stepCost);
+		ImGui::Text("Probes wait: %.1f frames avg., %u max.", probesStats.averageAge, probesStats.maxAge);
 		ImGui::Text("Probes integration: %05.1fms", float(_inteTime.value())/1000000.0f);
 		ImGui::Text("Probes copy: %05.1fms", float(_copyTime.value())/1000000.0f);
 		ImGui::Text("Probes copy CPU: %05.1fms", float(_copyTimeCPU.value()) / 1000000.0f);
@@ -240,6 +266,15 @@ void PBRDemo::update() {
 			if(ImGui::Combo("Shadow technique", reinterpret_cast<int*>(&_shadowMode), "None\0Basic\0PCF\0Variance\0\0")){
 				createShadowMaps(_shadowMode);
 			}
+			if(ImGui::InputInt("Shadow views budget", &_shadowBudget, 1, 6)){
+				_shadowBudget = std::max(0, _shadowBudget);
+				for(auto & map : _shadowMaps){
+					map->setBudget(uint(_shadowBudget));
+				}
+			}
+			if(ImGui::SliderFloat("Probes budget (ms)", &_probesBudget, 0.1f, 8.0f)){
+				_probesScheduler.setBudget(_probesBudget);
+			}
 			
 			if(_mode == RendererMode::DEFERRED){
 				_defRenderer->interface();
@@ -312,7 +347,7 @@ void PBRDemo::createShadowMaps(ShadowMode mode){
 		}
 	} else if(mode == ShadowMode::BASIC || mode == ShadowMode::PCF){
 		if(!lights2D.empty()){
-			_shadowMaps.emplace_back(new BasicShadowMap2DArray(lights2D, glm::vec2(512), mode));
+			_shadowMaps.emplace_back(new BasicShadowMapAtlas(lights2D, 2048, mode));
 		}
 		if(!lightsCube.empty()){
 			_shadowMaps.emplace_back(new BasicShadowMapCubeArray(lightsCube, 512, mode));
@@ -328,6 +363,8 @@ void PBRDemo::createShadowMaps(ShadowMode mode){
 
 	// Shadow pass.
 	for(const auto & map : _shadowMaps) {
+		map->setBudget(uint(_shadowBudget));
+		map->setViewpoint(_userCamera);
 		map->draw(*_scenes[_currentScene]);
 	}
 }
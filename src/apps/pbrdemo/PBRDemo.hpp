@@ -9,6 +9,7 @@
 #include "scene/Scene.hpp"
 #include "renderers/Renderer.hpp"
 #include "renderers/Probe.hpp"
+#include "renderers/ProbeScheduler.hpp"
 #include "renderers/shadowmaps/ShadowMap.hpp"
 #include "input/ControllableCamera.hpp"
 #include "system/Query.hpp"
@@ -57,11 +58,12 @@ private:
 	 */
 	void createShadowMaps(ShadowMode mode);
 
-	/** Update the real-time shadow maps and probes. */
+	/** Update the shadow maps, and the real-time probes whose surroundings have changed. */
 	void updateMaps();
 
 	std::vector<std::unique_ptr<ShadowMap>> _shadowMaps; ///< The lights shadow maps.
 	std::vector<std::unique_ptr<Probe>> _probes; ///< The environment probes.
+	ProbeScheduler _probesScheduler; ///< Distribute the probes updates over frames.
 	std::unique_ptr<DeferredRenderer> _defRenderer; ///< Deferred PBR renderer.
 	std::unique_ptr<ForwardRenderer> _forRenderer;	 ///< Forward PBR renderer.
 	std::unique_ptr<PostProcessStack> _postprocess; ///< Post-process renderer.
@@ -85,7 +87,8 @@ private:
 	RendererMode _mode	 = RendererMode::DEFERRED; ///< Active renderer.
 	ShadowMode _shadowMode = ShadowMode::VARIANCE; ///< The shadow rendering technique.
 	size_t _currentScene = 0; ///< Currently selected scene.
-	const int _frameCount = 2;	 ///< Number of frames to update a probe over.
+	float _probesBudget = 2.0f;	 ///< GPU time allocated to probe updates each frame, in milliseconds.
+	int _shadowBudget	= 12;	 ///< Maximum number of shadow views updated per frame (0 for no limit).
 	int _frameID		= 0; 	 ///< Current frame count (will loop)
 
 	bool _paused		= false; ///< Pause animations.
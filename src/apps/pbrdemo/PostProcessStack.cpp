@@ -5,20 +5,7 @@
 #include "graphics/GPU.hpp"
 
 
-PostProcessStack::PostProcessStack(const glm::vec2 & resolution) : Renderer("Post process stack"), _bloomBuffer("Bloom"), _toneMapBuffer("Tonemap"), _dofDownscaledColor("DoF Downscale"), _dofCocAndDepth("DoF CoC"), _dofGatherBuffer("DoF gather"), _resultTexture("Postproc. result") {
-
-	const uint renderWidth	= uint(resolution[0]);
-	const uint renderHeight	= uint(resolution[1]);
-	_bloomBuffer.setupAsDrawable(Layout::RGBA16F, renderWidth, renderHeight);
-	_toneMapBuffer.setupAsDrawable(Layout::RGBA16F, renderWidth, renderHeight);
-	_resultTexture.setupAsDrawable(Layout::RGBA16F, renderWidth, renderHeight);
-
-	const uint halfRenderWidth = renderWidth/2;
-	const uint halfRenderHeight = renderHeight/2;
-	// Depth of field is performed at half resolution.
-	_dofDownscaledColor.setupAsDrawable(Layout::RGBA16F, halfRenderWidth, halfRenderHeight);
-	_dofCocAndDepth.setupAsDrawable(Layout::RG16F, halfRenderWidth, halfRenderHeight);
-	_dofGatherBuffer.setupAsDrawable(Layout::RGBA16F, halfRenderWidth, halfRenderHeight);
+PostProcessStack::PostProcessStack(const glm::vec2 & resolution) : Renderer("Post process stack"), _graph("Post process stack"), _resolution(resolution) {
 
 	_blur		= std::unique_ptr<GaussianBlur>(new GaussianBlur(_settings.bloomRadius, 2, "Bloom"));
 	_colorFormat = Layout::RGBA16F;
@@ -37,113 +24,137 @@ void PostProcessStack::process(const Texture& src, const glm::mat4 & proj, const
 
 	const glm::vec2 invRenderSize = 1.0f / glm::vec2(dst.width, dst.height);
 
-
-	GPUMarker marker("Post process");
-	GPU::setDepthState(false);
-	GPU::setBlendState(false);
-	GPU::setCullState(true, Faces::BACK);
+	// Declare the passes for the current settings.
+	_graph.reset();
+	const RenderGraph::Resource srcTex = _graph.importTexture(src);
+	const RenderGraph::Resource depthTex = _graph.importTexture(depth);
+	const RenderGraph::Resource dstTex = _graph.importTexture(dst);
+	// In-progress result of the stack.
+	const RenderGraph::Resource result = _graph.createTexture("Postproc. result", Layout::RGBA16F, _resolution.x, _resolution.y);
 
 	if(_settings.dof){
-		GPUMarker marker("Depth of field");
-		// --- DoF pass ------
+		// Depth of field is performed at half resolution.
+		const glm::uvec2 halfRes = _resolution / 2u;
+		const RenderGraph::Resource downscaledColor = _graph.createTexture("DoF Downscale", Layout::RGBA16F, halfRes.x, halfRes.y);
+		const RenderGraph::Resource cocAndDepth = _graph.createTexture("DoF CoC", Layout::RG16F, halfRes.x, halfRes.y);
+		const RenderGraph::Resource gather = _graph.createTexture("DoF gather", Layout::RGBA16F, halfRes.x, halfRes.y);
+
 		// Compute circle of confidence along with the depth and downscaled color.
-		GPU::beginRender(Load::Operation::DONTCARE, &_dofDownscaledColor, &_dofCocAndDepth);
-		GPU::setViewport(_dofDownscaledColor);
-		_dofCocProgram->use();
-		_dofCocProgram->uniform("projParams", glm::vec2(proj[2][2], proj[3][2]));
-		_dofCocProgram->uniform("focusDist", _settings.focusDist);
-		_dofCocProgram->uniform("focusScale", _settings.focusScale);
-		_dofCocProgram->texture(src, 0);
-		_dofCocProgram->texture(depth, 1);
-		GPU::drawQuad();
-		GPU::endRender();
+		_graph.addPass("DoF CoC", { srcTex, depthTex }, { downscaledColor, cocAndDepth }, [this, srcTex, depthTex, downscaledColor, cocAndDepth, proj](){
+			GPU::beginRender(Load::Operation::DONTCARE, &_graph.texture(downscaledColor), &_graph.texture(cocAndDepth));
+			GPU::setViewport(_graph.texture(downscaledColor));
+			_dofCocProgram->use();
+			_dofCocProgram->uniform("projParams", glm::vec2(proj[2][2], proj[3][2]));
+			_dofCocProgram->uniform("focusDist", _settings.focusDist);
+			_dofCocProgram->uniform("focusScale", _settings.focusScale);
+			_dofCocProgram->texture(_graph.texture(srcTex), 0);
+			_dofCocProgram->texture(_graph.texture(depthTex), 1);
+			GPU::drawQuad();
+			GPU::endRender();
+		});
 		// Gather from neighbor samples.
-		GPU::beginRender(Load::Operation::DONTCARE, &_dofGatherBuffer);
-		GPU::setViewport(_dofGatherBuffer);
-		_dofGatherProgram->use();
-		_dofGatherProgram->uniform("invSize", 1.0f/glm::vec2(_dofCocAndDepth.width, _dofCocAndDepth.height));
-		_dofGatherProgram->texture(_dofDownscaledColor, 0);
-		_dofGatherProgram->texture(_dofCocAndDepth, 1);
-		GPU::drawQuad();
-		GPU::endRender();
+		_graph.addPass("DoF gather", { downscaledColor, cocAndDepth }, { gather }, [this, downscaledColor, cocAndDepth, gather](){
+			const Texture & coc = _graph.texture(cocAndDepth);
+			GPU::beginRender(Load::Operation::DONTCARE, &_graph.texture(gather));
+			GPU::setViewport(_graph.texture(gather));
+			_dofGatherProgram->use();
+			_dofGatherProgram->uniform("invSize", 1.0f/glm::vec2(coc.width, coc.height));
+			_dofGatherProgram->texture(_graph.texture(downscaledColor), 0);
+			_dofGatherProgram->texture(coc, 1);
+			GPU::drawQuad();
+			GPU::endRender();
+		});
 		// Finally composite back with full res image.
-		GPU::beginRender(Load::Operation::DONTCARE, &_resultTexture);
-		GPU::setViewport(_resultTexture);
-		_dofCompositeProgram->use();
-		_dofCompositeProgram->texture(src, 0);
-		_dofCompositeProgram->texture(_dofGatherBuffer, 1);
-		GPU::drawQuad();
-		GPU::endRender();
+		_graph.addPass("DoF composite", { srcTex, gather }, { result }, [this, srcTex, gather, result](){
+			GPU::beginRender(Load::Operation::DONTCARE, &_graph.texture(result));
+			GPU::setViewport(_graph.texture(result));
+			_dofCompositeProgram->use();
+			_dofCompositeProgram->texture(_graph.texture(srcTex), 0);
+			_dofCompositeProgram->texture(_graph.texture(gather), 1);
+			GPU::drawQuad();
+			GPU::endRender();
+		});
 	} else {
 		// Else just copy the input texture to our internal result.
-		GPU::beginRender(Load::Operation::DONTCARE, &_resultTexture);
-		GPU::setViewport(_resultTexture);
-		Resources::manager().getProgram2D("passthrough-pixelperfect")->use();
-		Resources::manager().getProgram2D("passthrough-pixelperfect")->texture(src, 0);
-		GPU::drawQuad();
-		GPU::endRender();
+		_graph.addPass("Copy", { srcTex }, { result }, [this, srcTex, result](){
+			GPU::beginRender(Load::Operation::DONTCARE, &_graph.texture(result));
+			GPU::setViewport(_graph.texture(result));
+			Resources::manager().getProgram2D("passthrough-pixelperfect")->use();
+			Resources::manager().getProgram2D("passthrough-pixelperfect")->texture(_graph.texture(srcTex), 0);
+			GPU::drawQuad();
+			GPU::endRender();
+		});
 	}
 
 	if(_settings.bloom) {
-		GPUMarker marker("Bloom");
-
+		const RenderGraph::Resource bloom = _graph.createTexture("Bloom", Layout::RGBA16F, _resolution.x, _resolution.y);
 		// --- Bloom selection pass ------
-		{
-			GPUMarker marker("Extraction");
-			GPU::beginRender(Load::Operation::DONTCARE, &_bloomBuffer);
-			GPU::setViewport(_bloomBuffer);
+		_graph.addPass("Bloom extraction", { result }, { bloom }, [this, result, bloom](){
+			GPU::beginRender(Load::Operation::DONTCARE, &_graph.texture(bloom));
+			GPU::setViewport(_graph.texture(bloom));
 			_bloomProgram->use();
 			_bloomProgram->uniform("luminanceTh", _settings.bloomTh);
-			_bloomProgram->texture(_resultTexture, 0);
+			_bloomProgram->texture(_graph.texture(result), 0);
 			GPU::drawQuad();
 			GPU::endRender();
-		}
-		
+		});
+
 		// --- Bloom blur pass ------
-		_blur->process(_bloomBuffer, _bloomBuffer);
-		
+		_blur->process(_graph, bloom, bloom);
+
 		// Add back the scene content.
-		{
-			GPUMarker marker("Compositing");
-			GPU::beginRender(Load::Operation::LOAD, &_resultTexture);
-			GPU::setViewport(_resultTexture);
+		_graph.addPass("Bloom compositing", { bloom, result }, { result }, [this, bloom, result](){
+			GPU::beginRender(Load::Operation::LOAD, &_graph.texture(result));
+			GPU::setViewport(_graph.texture(result));
 			GPU::setBlendState(true, BlendEquation::ADD, BlendFunction::ONE, BlendFunction::ONE);
 			_bloomComposite->use();
 			_bloomComposite->uniform("scale", _settings.bloomMix);
-			_bloomComposite->texture(_bloomBuffer, 0);
+			_bloomComposite->texture(_graph.texture(bloom), 0);
 			GPU::drawQuad();
 			GPU::setBlendState(false);
 			GPU::endRender();
-		}
+		});
 		// Steps below ensures that we will always have an intermediate target.
 	}
 
 	// --- Tonemapping pass ------
-	{
-		GPUMarker marker("Tonemap");
-		GPU::beginRender(Load::Operation::DONTCARE, &_toneMapBuffer);
-		GPU::setViewport(_toneMapBuffer);
+	const RenderGraph::Resource toneMap = _graph.createTexture("Tonemap", Layout::RGBA16F, _resolution.x, _resolution.y);
+	_graph.addPass("Tonemap", { result }, { toneMap }, [this, result, toneMap](){
+		GPU::beginRender(Load::Operation::DONTCARE, &_graph.texture(toneMap));
+		GPU::setViewport(_graph.texture(toneMap));
 		_toneMappingProgram->use();
 		_toneMappingProgram->uniform("customExposure", _settings.exposure);
 		_toneMappingProgram->uniform("apply", _settings.tonemap);
-		_toneMappingProgram->texture(_resultTexture, 0);
+		_toneMappingProgram->texture(_graph.texture(result), 0);
 		GPU::drawQuad();
 		GPU::endRender();
-	}
+	});
 
 	if(_settings.fxaa) {
-		GPUMarker marker("FXAA");
-		GPU::beginRender(layer, 0, Load::Operation::LOAD, &dst);
-		GPU::setViewport(dst);
-		_fxaaProgram->use();
-		_fxaaProgram->uniform("inverseScreenSize", invRenderSize);
-		_fxaaProgram->texture(_toneMapBuffer, 0);
-		GPU::drawQuad();
-		GPU::endRender();
+		_graph.addPass("FXAA", { toneMap }, { dstTex }, [this, toneMap, dstTex, layer, invRenderSize](){
+			const Texture & output = _graph.texture(dstTex);
+			GPU::beginRender(layer, 0, Load::Operation::LOAD, &output);
+			GPU::setViewport(output);
+			_fxaaProgram->use();
+			_fxaaProgram->uniform("inverseScreenSize", invRenderSize);
+			_fxaaProgram->texture(_graph.texture(toneMap), 0);
+			GPU::drawQuad();
+			GPU::endRender();
+		});
 	} else {
-		GPU::blit(_toneMapBuffer, dst, 0, layer, Filter::LINEAR);
+		_graph.addPass("Copy output", { toneMap }, { dstTex }, [this, toneMap, dstTex, layer](){
+			GPU::blit(_graph.texture(toneMap), _graph.texture(dstTex), 0, layer, Filter::LINEAR);
+		});
 	}
 
+	// Allocate intermediate buffers if needed, and run the passes.
+	_graph.compile();
+
+	GPUMarker marker("Post process");
+	GPU::setDepthState(false);
+	GPU::setBlendState(false);
+	GPU::setCullState(true, Faces::BACK);
+	_graph.execute();
 }
 
 void PostProcessStack::updateBlurPass(){
@@ -151,13 +162,8 @@ void PostProcessStack::updateBlurPass(){
 }
 
 void PostProcessStack::resize(uint width, uint height) {
-	const glm::ivec2 renderRes(width, height);
-	_toneMapBuffer.resize(renderRes);
-	_bloomBuffer.resize(renderRes);
-	_resultTexture.resize(renderRes);
-	_dofGatherBuffer.resize(renderRes/2);
-	_dofDownscaledColor.resize(renderRes/2);
-	_dofCocAndDepth.resize(renderRes/2);
+	// Intermediate buffers will be reallocated at the next frame.
+	_resolution = glm::uvec2(width, height);
 }
 
 void PostProcessStack::interface(){
@@ -193,4 +199,8 @@ void PostProcessStack::interface(){
 		ImGui::SliderFloat("Exposure", &_settings.exposure, 0.1f, 10.0f);
 		ImGui::PopItemWidth();
 	}
+
+	const RenderGraph::Statistics & stats = _graph.statistics();
+	const double mb = 1.0 / (1024.0 * 1024.0);
+	ImGui::Text("Buffers: %.1fMB (%.1fMB unaliased), %u passes", double(stats.aliasedMemory) * mb, double(stats.separateMemory) * mb, stats.passes);
 }
@@ -6,12 +6,13 @@
 
 #include "resources/Texture.hpp"
 #include "processing/GaussianBlur.hpp"
+#include "renderers/RenderGraph.hpp"
 
 #include "Common.hpp"
 
 /**
  \brief Apply post process effects to a HDR rendering of a scene.
- \details The effects currently provided are:
+ \details Effects are declared as passes of a render graph each frame, intermediate buffers are transient textures sharing memory when their lifetimes do not overlap. The effects currently provided are:
 	- depth of field (scatter-as-you-gather approach as described in "Bokeh depth of field in a single pass" by Dennis Gustafsson, 2018 (http://tuxedolabs.blogspot.com/2018/05/bokeh-depth-of-field-in-single-pass.html))
 	- bloom (thresholding and blurring bright spots)
 	- tonemapping (basic Reinhardt operator)
@@ -68,12 +69,8 @@ private:
 	/** Update the bloom pass depth based on the current set radius. */
 	void updateBlurPass();
 
-	Texture _bloomBuffer; 	 				///< Bloom texture
-	Texture _toneMapBuffer; 				///< Tonemapping texture
-	Texture _dofDownscaledColor; 	 		///< DoF downscaled scene color texture
-	Texture _dofCocAndDepth; 	 			///< DoF CoC texture
-	Texture _dofGatherBuffer; 	 			///< DoF gathering texture
-	Texture _resultTexture; 				///< In-progress result of the stack.
+	RenderGraph _graph;						///< Passes and intermediate buffers.
+	glm::uvec2 _resolution;					///< Intermediate buffers resolution.
 	std::unique_ptr<GaussianBlur> _blur;	///< Bloom blur processing.
 	
 	Program * _bloomProgram;			///< Bloom program
@@ -7,41 +7,56 @@ PerlinNoise::PerlinNoise() {
 }
 
 void PerlinNoise::generate(Image & image, uint channel, float scale, float z, const glm::vec3 & offset){
-
-	System::forParallel(0, size_t(image.height), [&image, channel, z, scale, &offset, this](size_t y){
-		for(uint x = 0; x < image.width; ++x){
-			const glm::vec3 p = offset + scale * glm::vec3(x,y,z);
-			image.rgba(int(x), int(y))[channel] = perlin(p);
-		}
-	});
+	fill(image, channel, 1, 1.0f, 1.0f, scale, z, offset, glm::vec2(0.0f), 1.0f, glm::ivec3(kHashTableSize-1), false);
 }
 
 void PerlinNoise::generatePeriodic(Image & image, uint channel, float scale, float z, const glm::vec3 & offset){
 	const float cellCount = std::floor(scale * image.width);
 	const float realScale = cellCount / float(image.width);
 	const glm::ivec3 period((int(cellCount)));
-
-	System::forParallel(0, size_t(image.height), [&image, channel, z, realScale, &offset, &period, this](size_t y){
-		for(uint x = 0; x < image.width; ++x){
-			const glm::vec3 p = offset + realScale * glm::vec3(x,y,z);
-			image.rgba(int(x), int(y))[channel] = perlin(p, period);
-		}
-	});
+	fill(image, channel, 1, 1.0f, 1.0f, realScale, z, offset, glm::vec2(0.0f), 1.0f, period, false);
 }
 
 void PerlinNoise::generateLayers(Image & image, uint channel, int octaves, float gain, float lacunarity, float scale, const glm::vec3 & offset){
-	float weight = 1.0f;
-	for(int i = 0; i < octaves; ++i){
-		Image img(image.width, image.height, 1);
-		generate(img, 0, scale, 0.0f, offset);
-		System::forParallel(0, size_t(image.height), [&image, channel, weight, &img](size_t y){
-			for(uint x = 0; x < image.width; ++x){
-				image.rgba(x, uint(y))[channel] += weight * img.rgba(x, uint(y))[0];
+	fill(image, channel, octaves, gain, lacunarity, scale, 0.0f, offset, glm::vec2(0.0f), 1.0f, glm::ivec3(kHashTableSize-1), true);
+}
+
+void PerlinNoise::generateLayers(Image & image, uint channel, int octaves, float gain, float lacunarity, float scale, const glm::vec2 & origin, float step){
+	fill(image, channel, octaves, gain, lacunarity, scale, 0.0f, glm::vec3(0.0f), origin, step, glm::ivec3(kHashTableSize-1), true);
+}
+
+void PerlinNoise::fill(Image & image, uint channel, int octaves, float gain, float lacunarity, float scale, float z, const glm::vec3 & offset, const glm::vec2 & origin, float step, const glm::ivec3 & w, bool accumulate) const {
+
+	System::forParallel(0, size_t(image.height), [&image, channel, octaves, gain, lacunarity, scale, z, &offset, &origin, step, &w, accumulate, this](size_t y){
+		const float py = origin.y + step * float(y);
+		Batch points;
+		std::array<float, kBatchSize> values;
+		std::array<float, kBatchSize> sums;
+		for(uint x0 = 0; x0 < image.width; x0 += kBatchSize){
+			sums.fill(0.0f);
+			float layerScale = scale;
+			float weight = 1.0f;
+			for(int i = 0; i < octaves; ++i){
+				for(int pid = 0; pid < kBatchSize; ++pid){
+					points.x[pid] = offset.x + layerScale * (origin.x + step * float(x0 + pid));
+					points.y[pid] = offset.y + layerScale * py;
+					points.z[pid] = offset.z + layerScale * z;
+				}
+				perlin(points, w, values);
+				for(int pid = 0; pid < kBatchSize; ++pid){
+					sums[pid] += weight * values[pid];
+				}
+				layerScale *= lacunarity;
+				weight *= gain;
 			}
-		});
-		scale *= lacunarity;
-		weight *= gain;
-	}
+			// The last batch of the row can be incomplete.
+			const uint count = std::min(uint(kBatchSize), image.width - x0);
+			for(uint pid = 0; pid < count; ++pid){
+				float & pixel = image.rgba(int(x0 + pid), int(y))[channel];
+				pixel = accumulate ? (pixel + sums[pid]) : sums[pid];
+			}
+		}
+	});
 }
 
 void PerlinNoise::reseed(){
@@ -58,43 +73,73 @@ void PerlinNoise::reseed(){
 	}
 
 	// Sample random unit directions on the sphere.
-	_directions = Image(64, 64, 3);
-	for(uint y = 0; y < _directions.height; ++y){
-		for(uint x = 0; x < _directions.width; ++x){
-			_directions.rgb(int(x), int(y)) = glm::normalize(Random::sampleSphere());
-		}
+	// Only the first four columns of a 64x64 grid are used, keep the same random sequence as a full grid.
+	const int gridSize = 64;
+	std::vector<glm::vec3> directions(gridSize * gridSize);
+	for(glm::vec3 & direction : directions){
+		direction = glm::normalize(Random::sampleSphere());
+	}
+	for(int id = 0; id < kHashTableSize; ++id){
+		const glm::vec3 & direction = directions[(id % gridSize) * gridSize + (id / gridSize)];
+		_gradientsX[id] = direction.x;
+		_gradientsY[id] = direction.y;
+		_gradientsZ[id] = direction.z;
 	}
 }
 
-float PerlinNoise::dotGrad(const glm::ivec3 & ip, const glm::vec3 & dp){
-	const int id = _hashes[_hashes[_hashes[ip.x] + ip.y] + ip.z];
-	const glm::vec3 & grad = _directions.rgb(id/64, id%64);
-	return glm::dot(grad, dp);
-}
-
-float PerlinNoise::perlin(const glm::vec3 & p, const glm::ivec3 & w){
-	const glm::vec3 x = p;
-	const glm::ivec3 ix = glm::ivec3(glm::floor(x));
-	const glm::vec3 dx = x - glm::vec3(ix);
+void PerlinNoise::perlin(const Batch & points, const glm::ivec3 & w, std::array<float, kBatchSize> & results) const {
+	const int mask = kHashTableSize - 1;
+	// Cell coordinates and position in the cell.
+	std::array<int, kBatchSize> ix0, iy0, iz0, ix1, iy1, iz1;
+	Batch d;
+	for(int pid = 0; pid < kBatchSize; ++pid){
+		const float fx = std::floor(points.x[pid]);
+		const float fy = std::floor(points.y[pid]);
+		const float fz = std::floor(points.z[pid]);
+		d.x[pid] = points.x[pid] - fx;
+		d.y[pid] = points.y[pid] - fy;
+		d.z[pid] = points.z[pid] - fz;
+		const int ix = int(fx);
+		const int iy = int(fy);
+		const int iz = int(fz);
+		ix0[pid] = (ix % w.x) & mask;
+		iy0[pid] = (iy % w.y) & mask;
+		iz0[pid] = (iz % w.z) & mask;
+		ix1[pid] = ((ix + 1) % w.x) & mask;
+		iy1[pid] = ((iy + 1) % w.y) & mask;
+		iz1[pid] = ((iz + 1) % w.z) & mask;
+	}
 
-	const glm::ivec3 ix0 = (ix % w) & (kHashTableSize-1);
-	const glm::ivec3 ix1 = ((ix+1) % w) & (kHashTableSize-1);
-	// Fetch cell gradients.
-	glm::vec4 g0s, g1s;
-	g0s[0] = dotGrad(ix0        , dx        );
-	g0s[1] = dotGrad(glm::ivec3(ix0.x, ix1.y, ix0.z), dx - glm::vec3(0, 1, 0));
-	g0s[2] = dotGrad(glm::ivec3(ix0.x, ix0.y, ix1.z), dx - glm::vec3(0, 0, 1));
-	g0s[3] = dotGrad(glm::ivec3(ix0.x, ix1.y, ix1.z), dx - glm::vec3(0, 1, 1));
-	g1s[0] = dotGrad(glm::ivec3(ix1.x, ix0.y, ix0.z), dx - glm::vec3(1, 0, 0));
-	g1s[1] = dotGrad(glm::ivec3(ix1.x, ix1.y, ix0.z), dx - glm::vec3(1, 1, 0));
-	g1s[2] = dotGrad(glm::ivec3(ix1.x, ix0.y, ix1.z), dx - glm::vec3(1, 0, 1));
-	g1s[3] = dotGrad(glm::ivec3(ix1.x, ix1.y, ix1.z), dx - glm::vec3(1, 1, 1));
+	// Dot products between the gradients at the eight cell corners and the direction to the point.
+	std::array<std::array<float, kBatchSize>, 8> dots;
+	for(int cid = 0; cid < 8; ++cid){
+		const int cx = cid & 1;
+		const int cy = (cid >> 1) & 1;
+		const int cz = (cid >> 2) & 1;
+		const std::array<int, kBatchSize> & xs = cx ? ix1 : ix0;
+		const std::array<int, kBatchSize> & ys = cy ? iy1 : iy0;
+		const std::array<int, kBatchSize> & zs = cz ? iz1 : iz0;
+		std::array<int, kBatchSize> ids;
+		for(int pid = 0; pid < kBatchSize; ++pid){
+			ids[pid] = _hashes[_hashes[_hashes[xs[pid]] + ys[pid]] + zs[pid]];
+		}
+		for(int pid = 0; pid < kBatchSize; ++pid){
+			const int id = ids[pid];
+			dots[cid][pid] = _gradientsX[id] * (d.x[pid] - float(cx)) + _gradientsY[id] * (d.y[pid] - float(cy)) + _gradientsZ[id] * (d.z[pid] - float(cz));
+		}
+	}
 
-	// Compute weights.
-	const glm::vec3 dx3 = dx * dx * dx;
-	const glm::vec3 weights = ((6.0f * dx - 15.0f) * dx + 10.0f) * dx3;
-	// Final value.
-	const glm::vec4 gs = glm::mix(g0s, g1s, weights.x);
-	const glm::vec2 g = glm::mix(glm::vec2(gs.x, gs.z), glm::vec2(gs.y, gs.w), weights.y);
-	return glm::mix(g.x, g.y, weights.z);
+	// Interpolate with quintic weights.
+	for(int pid = 0; pid < kBatchSize; ++pid){
+		const float wx = ((6.0f * d.x[pid] - 15.0f) * d.x[pid] + 10.0f) * d.x[pid] * d.x[pid] * d.x[pid];
+		const float wy = ((6.0f * d.y[pid] - 15.0f) * d.y[pid] + 10.0f) * d.y[pid] * d.y[pid] * d.y[pid];
+		const float wz = ((6.0f * d.z[pid] - 15.0f) * d.z[pid] + 10.0f) * d.z[pid] * d.z[pid] * d.z[pid];
+		const float g00 = dots[0][pid] + wx * (dots[1][pid] - dots[0][pid]);
+		const float g10 = dots[2][pid] + wx * (dots[3][pid] - dots[2][pid]);
+		const float g01 = dots[4][pid] + wx * (dots[5][pid] - dots[4][pid]);
+		const float g11 = dots[6][pid] + wx * (dots[7][pid] - dots[6][pid]);
+		const float g0 = g00 + wy * (g10 - g00);
+		const float g1 = g01 + wy * (g11 - g01);
+		results[pid] = g0 + wz * (g1 - g0);
+	}
 }
@@ -38,7 +38,7 @@ public:
 	void generatePeriodic(Image & image, uint channel, float scale, float z, const glm::vec3 & offset = glm::vec3(0.0f));
 
 	/**
-	 Fill a component of an image with multi-layered Perlin noise (FBM).
+	 Fill a component of an image with multi-layered Perlin noise (FBM), adding it to the existing content. All layers are evaluated in a single pass.
 	 \param image image to fill with preset dimensions
 	 \param channel the channel of the image to fill	 
 	 \param octaves number of layers
@@ -49,27 +49,59 @@ public:
 	*/
 	void generateLayers(Image & image, uint channel, int octaves, float gain, float lacunarity, float scale, const glm::vec3 & offset = glm::vec3(0.0f));
 
+	/**
+	 Fill a component of an image with multi-layered Perlin noise (FBM) sampled on a regular grid, adding it to the existing content. Pixel (x,y) receives the value that generateLayers would produce at the (fractional) pixel position origin + step * (x,y), so that a region of a larger map can be generated at any resolution.
+	 \param image image to fill with preset dimensions
+	 \param channel the channel of the image to fill
+	 \param octaves number of layers
+	 \param gain the amplitude ratio between a layer and the previous one
+	 \param lacunarity the frequency ratio between a layer and the previous one
+	 \param scale the base frequency, in pixels
+	 \param origin the position of the first pixel, in pixels of the full map
+	 \param step the distance between successive pixels, in pixels of the full map
+	*/
+	void generateLayers(Image & image, uint channel, int octaves, float gain, float lacunarity, float scale, const glm::vec2 & origin, float step);
+
 	/** Regenerate the randomness table with new values. */
 	void reseed();
 
 private:
 
 	static const int kHashTableSize = 256; ///< Number of hashes used for the generation, limit the periodicity.
+	static const int kBatchSize = 8; ///< Number of points evaluated at once.
+
+	/** \brief Coordinates of a batch of points in noise space, stored per axis. */
+	struct Batch {
+		std::array<float, kBatchSize> x; ///< Horizontal coordinates.
+		std::array<float, kBatchSize> y; ///< Vertical coordinates.
+		std::array<float, kBatchSize> z; ///< Depth coordinates.
+	};
 
-	/** Compute the dot product between a direction vector and the gradient at a (ix, iy, iz) location on the grid.
-	 \param ip the grid vertex location
-	 \param dp the direction vector
-	 \return the dot product
+	/** Evaluate Perlin noise for a batch of locations in noise space. Each step is performed on all points of the batch without branching, so that it can be vectorized.
+	 \param points the locations
+	 \param w the tiling period to apply on each axis
+	 \param results will be filled with the noise values in [-1, 1]
 	 */
-	float dotGrad(const glm::ivec3 & ip, const glm::vec3 & dp);
+	void perlin(const Batch & points, const glm::ivec3 & w, std::array<float, kBatchSize> & results) const;
 
-	/** Evaluate Perlin noise for a given location in noise space.
-	 \param p location
+	/** Fill a component of an image with multi-layered Perlin noise, evaluating all layers for each batch of pixels.
+	 \param image image to fill with preset dimensions
+	 \param channel the channel of the image to fill
+	 \param octaves number of layers
+	 \param gain the amplitude ratio between a layer and the previous one
+	 \param lacunarity the frequency ratio between a layer and the previous one
+	 \param scale the base frequency, in pixels
+	 \param z the depth (in pixels) at which the 3D Perlin noise should be sampled
+	 \param offset the origin in sampled noise space
+	 \param origin the position of the first pixel, in pixels
+	 \param step the distance between successive pixels, in pixels
 	 \param w the tiling period to apply on each axis
-	 \return the noise value in [-1, 1]
+	 \param accumulate should the noise be added to the existing image content
 	 */
-	float perlin(const glm::vec3 & p, const glm::ivec3 & w = glm::ivec3(kHashTableSize-1));
+	void fill(Image & image, uint channel, int octaves, float gain, float lacunarity, float scale, float z, const glm::vec3 & offset, const glm::vec2 & origin, float step, const glm::ivec3 & w, bool accumulate) const;
 
 	std::array<int, 2*kHashTableSize> _hashes; ///< Permutation table.
-	Image _directions; ///< random unit sphere directions.
+	std::array<float, kHashTableSize> _gradientsX; ///< Random unit sphere directions, X coordinates.
+	std::array<float, kHashTableSize> _gradientsY; ///< Random unit sphere directions, Y coordinates.
+	std::array<float, kHashTableSize> _gradientsZ; ///< Random unit sphere directions, Z coordinates.
 };
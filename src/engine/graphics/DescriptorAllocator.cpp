@@ -36,7 +36,7 @@ DescriptorSet DescriptorAllocator::allocateSet(VkDescriptorSetLayout& setLayout)
 	// Else, try to find an existing pool where all sets have been freed.
 	bool found = false;
 	for(auto poolIt = _pools.begin(); poolIt != _pools.end(); ++poolIt){
-		if(poolIt->allocated == 0 && (poolIt->lastFrame + 2 < _context->frameIndex)){
+		if(poolIt->allocated == 0 && (poolIt->lastFrame + _context->frameCount < _context->frameIndex)){
 			// Copy the pool infos.
 			DescriptorPool pool = DescriptorPool(*poolIt);
 			VK_RET(vkResetDescriptorPool(_context->device, pool.handle, 0));
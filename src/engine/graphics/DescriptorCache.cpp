@@ -0,0 +1,124 @@
+#include "graphics/DescriptorCache.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/GPUInternal.hpp"
+#include "system/System.hpp"
+
+void DescriptorCache::init(GPUContext* context, uint lifetime){
+	_context = context;
+	// Sets can't be released while frames in flight use them.
+	_lifetime = std::max(lifetime, _context->frameCount);
+	_entries.clear();
+}
+
+VkDescriptorSet DescriptorCache::getSet(VkDescriptorSetLayout& setLayout, std::vector<VkWriteDescriptorSet>& writes, const std::string& name, uint64_t& hash){
+	buildKey(setLayout, writes, _key);
+	hash = System::hash64(_key.data(), _key.size() * sizeof(uint64_t));
+
+	auto entryIt = _entries.find(hash);
+	if(entryIt != _entries.end()){
+		Entry& entry = entryIt->second;
+		if(entry.key == _key){
+			entry.lastFrame = _context->frameIndex;
+			++GPU::_metrics.descriptorHits;
+			return entry.set.handle;
+		}
+		// Hash collision, replace the existing set.
+		_context->descriptorAllocator.freeSet(entry.set);
+		_entries.erase(entryIt);
+	}
+	++GPU::_metrics.descriptorMisses;
+
+	Entry& entry = _entries[hash];
+	entry.key = _key;
+	entry.lastFrame = _context->frameIndex;
+	entry.set = _context->descriptorAllocator.allocateSet(setLayout);
+	VkUtils::setDebugName(*_context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(entry.set.handle), "%s", name.c_str());
+
+	for(VkWriteDescriptorSet& write : writes){
+		write.dstSet = entry.set.handle;
+	}
+	vkUpdateDescriptorSets(_context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+	return entry.set.handle;
+}
+
+bool DescriptorCache::touch(uint64_t hash, VkDescriptorSet set){
+	auto entryIt = _entries.find(hash);
+	// A collision might have replaced the set with another one.
+	if(entryIt == _entries.end() || entryIt->second.set.handle != set){
+		return false;
+	}
+	entryIt->second.lastFrame = _context->frameIndex;
+	return true;
+}
+
+void DescriptorCache::evict(){
+	const uint64_t currentFrame = _context->frameIndex;
+	if(currentFrame < _lifetime){
+		return;
+	}
+	for(auto entryIt = _entries.begin(); entryIt != _entries.end();){
+		if(entryIt->second.lastFrame + _lifetime < currentFrame){
+			_context->descriptorAllocator.freeSet(entryIt->second.set);
+			entryIt = _entries.erase(entryIt);
+		} else {
+			++entryIt;
+		}
+	}
+}
+
+void DescriptorCache::invalidate(const std::unordered_set<uint64_t>& handles){
+	if(handles.empty()){
+		return;
+	}
+	for(auto entryIt = _entries.begin(); entryIt != _entries.end();){
+		bool found = false;
+		for(const uint64_t& value : entryIt->second.key){
+			if(handles.count(value) != 0){
+				found = true;
+				break;
+			}
+		}
+		// The set might still be used by frames in flight, the allocator will delay its reuse.
+		if(found){
+			_context->descriptorAllocator.freeSet(entryIt->second.set);
+			entryIt = _entries.erase(entryIt);
+		} else {
+			++entryIt;
+		}
+	}
+}
+
+void DescriptorCache::clean(){
+	for(auto& entry : _entries){
+		_context->descriptorAllocator.freeSet(entry.second.set);
+	}
+	_entries.clear();
+	_key.clear();
+}
+
+void DescriptorCache::buildKey(VkDescriptorSetLayout& setLayout, const std::vector<VkWriteDescriptorSet>& writes, std::vector<uint64_t>& key){
+	key.clear();
+	key.push_back(uint64_t(setLayout));
+	for(const VkWriteDescriptorSet& write : writes){
+		key.push_back(write.dstBinding);
+		key.push_back(write.dstArrayElement);
+		key.push_back(write.descriptorCount);
+		key.push_back(uint64_t(write.descriptorType));
+		if(write.pImageInfo){
+			for(uint did = 0; did < write.descriptorCount; ++did){
+				const VkDescriptorImageInfo& info = write.pImageInfo[did];
+				key.push_back(uint64_t(info.imageView));
+				key.push_back(uint64_t(info.sampler));
+				key.push_back(uint64_t(info.imageLayout));
+			}
+		}
+		if(write.pBufferInfo){
+			for(uint did = 0; did < write.descriptorCount; ++did){
+				const VkDescriptorBufferInfo& info = write.pBufferInfo[did];
+				key.push_back(uint64_t(info.buffer));
+				key.push_back(uint64_t(info.offset));
+				key.push_back(uint64_t(info.range));
+			}
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Common.hpp"
+#include "graphics/GPUObjects.hpp"
+
+#include <unordered_set>
+
+struct GPUContext;
+
+/** \brief Reuse descriptor sets across draws and frames, based on the resources they reference.
+ \details Sets are identified by a hash of their layout and bound resources (image views, buffers, offsets and ranges). Identical bindings retrieve the same set instead of allocating and writing a new one. Sets that have not been used for a given number of frames are released, and sets referencing destroyed resources are invalidated.
+ \ingroup Graphics
+ */
+class DescriptorCache {
+public:
+
+	/** Setup the cache.
+	 \param context the GPU context
+	 \param lifetime number of frames an unused set is kept alive
+	 */
+	void init(GPUContext* context, uint lifetime);
+
+	/** Retrieve a descriptor set with the given bindings, allocating and writing it if needed.
+	 \param setLayout the set layout
+	 \param writes the bindings to write in the set (destination sets are ignored)
+	 \param name debug name of the set if it is created
+	 \param hash will contain the hash identifying the set in the cache
+	 \return the descriptor set handle
+	 */
+	VkDescriptorSet getSet(VkDescriptorSetLayout& setLayout, std::vector<VkWriteDescriptorSet>& writes, const std::string& name, uint64_t& hash);
+
+	/** Mark a set as used in the current frame, to keep it alive while it is bound.
+	 \param hash the hash identifying the set in the cache
+	 \param set the descriptor set handle previously retrieved for this hash
+	 \return false if the set has been released (evicted, invalidated or replaced) and should be retrieved again
+	 */
+	bool touch(uint64_t hash, VkDescriptorSet set);
+
+	/** Release sets that have not been used recently. Should be called once per frame. */
+	void evict();
+
+	/** Release sets that reference any of the given objects (views, buffers or layouts) before they are destroyed.
+	 \param handles the native handles of the objects
+	 */
+	void invalidate(const std::unordered_set<uint64_t>& handles);
+
+	/** Release all sets. */
+	void clean();
+
+private:
+
+	/** \brief Cached descriptor set. */
+	struct Entry {
+		std::vector<uint64_t> key; ///< Layout and resources referenced by the set.
+		DescriptorSet set; ///< The descriptor set.
+		uint64_t lastFrame = 0; ///< Last frame the set was used.
+	};
+
+	/** Build the key identifying a set from its layout and bindings.
+	 \param setLayout the set layout
+	 \param writes the set bindings
+	 \param key will contain the key data
+	 */
+	static void buildKey(VkDescriptorSetLayout& setLayout, const std::vector<VkWriteDescriptorSet>& writes, std::vector<uint64_t>& key);
+
+	GPUContext* _context = nullptr; ///< The GPU context.
+	std::unordered_map<uint64_t, Entry> _entries; ///< Cached sets, indexed by key hash.
+	std::vector<uint64_t> _key; ///< Scratch key storage.
+	uint _lifetime = 0; ///< Number of frames an unused set is kept alive.
+};
@@ -3,10 +3,12 @@
 #include "graphics/Swapchain.hpp"
 #include "graphics/SamplerLibrary.hpp"
 #include "resources/Texture.hpp"
+#include "resources/TextureCodec.hpp"
 #include "resources/Image.hpp"
 #include "system/TextUtilities.hpp"
 #include "system/Window.hpp"
 #include "system/System.hpp"
+#include "system/Query.hpp"
 #include "graphics/GPUInternal.hpp"
 
 #define VMA_STATIC_VULKAN_FUNCTIONS 0
@@ -27,6 +29,7 @@
 #include <sstream>
 #include <GLFW/glfw3.h>
 #include <set>
+#include <map>
 
 const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" /*, "VK_LAYER_LUNARG_api_dump"*/ };
 const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,  VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,  VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME };
@@ -165,7 +168,8 @@ bool GPU::setup(const std::string & appName) {
 	}
 
 	_context.timestep = double(properties.limits.timestampPeriod);
-	_context.uniformAlignment = properties.limits.minUniformBufferOffsetAlignment;
+	// Uniform buffers can also be bound as storage buffers.
+	_context.uniformAlignment = std::max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
 	// minImageTransferGranularity is guaranteed to be (1,1,1) on graphics/compute queues
 	_context.markersEnabled = wantsMarkers;
 
@@ -191,19 +195,28 @@ bool GPU::setupWindow(Window * window){
 		return false;
 	}
 
+	// Optional queue for compute work executing concurrently with rendering.
+	int computeIndex = -1;
+	uint computeQueueIndex = 0;
+	const bool asyncCompute = window->_config.asyncCompute && VkUtils::getAsyncComputeQueue(_context.physicalDevice, graphicsIndex, computeIndex, computeQueueIndex);
+
 	// Select queues.
 	std::set<uint> families;
 	families.insert(uint(graphicsIndex));
 	families.insert(uint(presentIndex));
+	if(asyncCompute){
+		families.insert(uint(computeIndex));
+	}
 
-	float queuePriority = 1.0f;
+	const float queuePriorities[] = { 1.0f, 1.0f };
 	std::vector<VkDeviceQueueCreateInfo> queueInfos;
 	for(int queueFamily : families) {
 		VkDeviceQueueCreateInfo queueInfo = {};
 		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueInfo.queueFamilyIndex = queueFamily;
-		queueInfo.queueCount = 1;
-		queueInfo.pQueuePriorities = &queuePriority;
+		// The compute queue might be a second queue of the graphics family.
+		queueInfo.queueCount = (asyncCompute && queueFamily == computeIndex) ? (computeQueueIndex + 1) : 1;
+		queueInfo.pQueuePriorities = queuePriorities;
 		queueInfos.push_back(queueInfo);
 	}
 
@@ -218,12 +231,47 @@ bool GPU::setupWindow(Window * window){
 	features.tessellationShader = VK_TRUE;
 	features.imageCubeArray = VK_TRUE;
 	features.fillModeNonSolid = VK_TRUE;
+	// Optional features.
+	VkPhysicalDeviceFeatures availableFeatures;
+	vkGetPhysicalDeviceFeatures(_context.physicalDevice, &availableFeatures);
+	features.textureCompressionBC = availableFeatures.textureCompressionBC;
+	_context.blockCompression = availableFeatures.textureCompressionBC == VK_TRUE;
+	features.multiDrawIndirect = availableFeatures.multiDrawIndirect;
+	_context.multiDrawIndirect = availableFeatures.multiDrawIndirect == VK_TRUE;
+	features.drawIndirectFirstInstance = availableFeatures.drawIndirectFirstInstance;
+	_context.indirectFirstInstance = availableFeatures.drawIndirectFirstInstance == VK_TRUE;
 	deviceInfo.pEnabledFeatures = &features;
 
 	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeature { };
 	dynamicRenderingFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
 	dynamicRenderingFeature.dynamicRendering = VK_TRUE;
 	deviceInfo.pNext = &dynamicRenderingFeature;
+
+	// Optional descriptor indexing, for the global texture table.
+	VkPhysicalDeviceVulkan12Features availableFeatures12 { };
+	availableFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 availableFeatures2 { };
+	availableFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	availableFeatures2.pNext = &availableFeatures12;
+	vkGetPhysicalDeviceFeatures2(_context.physicalDevice, &availableFeatures2);
+	_context.bindless = availableFeatures12.descriptorIndexing && availableFeatures12.runtimeDescriptorArray
+		&& availableFeatures12.shaderSampledImageArrayNonUniformIndexing && availableFeatures12.descriptorBindingPartiallyBound
+		&& availableFeatures12.descriptorBindingSampledImageUpdateAfterBind && availableFeatures12.descriptorBindingUpdateUnusedWhilePending;
+
+	VkPhysicalDeviceVulkan12Features features12 { };
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	if(_context.bindless){
+		features12.descriptorIndexing = VK_TRUE;
+		features12.runtimeDescriptorArray = VK_TRUE;
+		features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		features12.descriptorBindingPartiallyBound = VK_TRUE;
+		features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	}
+	// Optional indirect draws with a GPU-written draw count, for GPU-driven rendering.
+	_context.drawIndirectCount = availableFeatures12.drawIndirectCount == VK_TRUE;
+	features12.drawIndirectCount = availableFeatures12.drawIndirectCount;
+	dynamicRenderingFeature.pNext = &features12;
 	
 	// Extensions.
 	auto extensions = deviceExtensions;
@@ -246,6 +294,14 @@ bool GPU::setupWindow(Window * window){
 	VkUtils::setDebugName(_context, VK_OBJECT_TYPE_QUEUE, uint64_t(_context.graphicsQueue), "Graphics");
 	VkUtils::setDebugName(_context, VK_OBJECT_TYPE_QUEUE, uint64_t(_context.presentQueue), "Present");
 
+	_context.asyncCompute = asyncCompute;
+	if(asyncCompute){
+		_context.computeId = uint(computeIndex);
+		vkGetDeviceQueue(_context.device, _context.computeId, computeQueueIndex, &_context.computeQueue);
+		VkUtils::setDebugName(_context, VK_OBJECT_TYPE_QUEUE, uint64_t(_context.computeQueue), "Async compute");
+		Log::Info() << Log::GPU << "Async compute enabled on queue family " << _context.computeId << (_context.computeId == _context.graphicsId ? " (shared with graphics)." : ".") << std::endl;
+	}
+
 	// Setup allocator.
 	VmaAllocatorCreateInfo allocatorInfo = {};
 	allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_3;
@@ -299,6 +355,64 @@ bool GPU::setupWindow(Window * window){
 
 	VkUtils::setDebugName(_context, VK_OBJECT_TYPE_COMMAND_POOL, uint64_t(_context.commandPool), "Main pool");
 
+	// Async compute command buffers have to be allocated from a pool of the compute family.
+	_context.computeCommandPool = _context.commandPool;
+	if(asyncCompute && (_context.computeId != _context.graphicsId)){
+		poolInfo.queueFamilyIndex = _context.computeId;
+		if(vkCreateCommandPool(_context.device, &poolInfo, nullptr, &_context.computeCommandPool) != VK_SUCCESS) {
+			Log::Error() << Log::GPU << "Unable to create compute command pool." << std::endl;
+			return false;
+		}
+		VkUtils::setDebugName(_context, VK_OBJECT_TYPE_COMMAND_POOL, uint64_t(_context.computeCommandPool), "Compute pool");
+	}
+
+	// Per-frame synchronization, the CPU can record up to frameCount frames ahead of the GPU.
+	// The swapchain requests three images, don't buffer more frames than that.
+	_context.frameCount = glm::clamp(window->_config.framesInFlight, 1u, 3u);
+	_context.validateSync = window->_config.validateSync;
+	_context.frameFences.resize(_context.frameCount);
+	_context.uploadSemaphores.resize(_context.frameCount);
+	if(asyncCompute){
+		_context.computeStartSemaphores.resize(_context.frameCount);
+		_context.computeEndSemaphores.resize(_context.frameCount);
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	// Start signaled, no work is pending.
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for(uint i = 0; i < _context.frameCount; ++i){
+		if(vkCreateFence(_context.device, &fenceInfo, nullptr, &_context.frameFences[i]) != VK_SUCCESS){
+			Log::Error() << Log::GPU << "Unable to create fences." << std::endl;
+			return false;
+		}
+		if(vkCreateSemaphore(_context.device, &semaphoreInfo, nullptr, &_context.uploadSemaphores[i]) != VK_SUCCESS){
+			Log::Error() << Log::GPU << "Unable to create semaphores." << std::endl;
+			return false;
+		}
+		VkUtils::setDebugName(_context, VK_OBJECT_TYPE_FENCE, uint64_t(_context.frameFences[i]), "Frame in flight %u", i);
+		VkUtils::setDebugName(_context, VK_OBJECT_TYPE_SEMAPHORE, uint64_t(_context.uploadSemaphores[i]), "Uploads complete %u", i);
+		if(!asyncCompute){
+			continue;
+		}
+		if((vkCreateSemaphore(_context.device, &semaphoreInfo, nullptr, &_context.computeStartSemaphores[i]) != VK_SUCCESS) ||
+		   (vkCreateSemaphore(_context.device, &semaphoreInfo, nullptr, &_context.computeEndSemaphores[i]) != VK_SUCCESS)){
+			Log::Error() << Log::GPU << "Unable to create semaphores." << std::endl;
+			return false;
+		}
+		VkUtils::setDebugName(_context, VK_OBJECT_TYPE_SEMAPHORE, uint64_t(_context.computeStartSemaphores[i]), "Async compute start %u", i);
+		VkUtils::setDebugName(_context, VK_OBJECT_TYPE_SEMAPHORE, uint64_t(_context.computeEndSemaphores[i]), "Async compute end %u", i);
+	}
+	if(_context.validateSync){
+		Log::Info() << Log::GPU << "Synchronization validation enabled, with " << _context.frameCount << " frames in flight." << std::endl;
+	}
+
+	// Persistent staging memory for uploads.
+	_context.stagingAllocator.init(&_context, 64 * 1024 * 1024);
+
 	// Create query pools.
 	_context.queryAllocators[GPUQuery::Type::TIME_ELAPSED].init(GPUQuery::Type::TIME_ELAPSED, 1024);
 	_context.queryAllocators[GPUQuery::Type::ANY_DRAWN].init(GPUQuery::Type::ANY_DRAWN, 1024);
@@ -311,10 +425,26 @@ bool GPU::setupWindow(Window * window){
 	_context.pipelineCache.init();
 
 	_context.descriptorAllocator.init(&_context, 1024);
+	_context.descriptorCache.init(&_context, 120);
 
 	// Create static samplers.
 	_context.samplerLibrary.init();
 
+	// Create the global texture table.
+	if(_context.bindless){
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(_context.physicalDevice, &properties);
+		const uint capacity = std::min(4096u, std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages));
+		_context.bindless = _context.textureTable.init(&_context, capacity);
+	}
+	if(!_context.bindless){
+		Log::Info() << Log::GPU << "Bindless textures are not supported on the selected device." << std::endl;
+	}
+
 	// Create basic vertex array for screenquad.
 	{
 		_quad.positions = {
@@ -332,37 +462,24 @@ void GPU::createGraphicsProgram(Program& program, const std::string & vertexCont
 
 	Log::Verbose() << Log::GPU << "Compiling " << debugInfos << "." << std::endl;
 	
-	std::string compilationLog;
-	// If vertex program code is given, compile it.
-	if(!vertexContent.empty()) {
-		ShaderCompiler::compile(vertexContent, ShaderType::VERTEX, program.stage(ShaderType::VERTEX), true, compilationLog);
-		if(!compilationLog.empty()) {
-			Log::Error() << Log::GPU << "Vertex shader (for " << program.name() << ") failed to compile:" << std::endl
-						 << compilationLog << std::endl;
-		}
-	}
-	// If fragment program code is given, compile it.
-	if(!fragmentContent.empty()) {
-		ShaderCompiler::compile(fragmentContent, ShaderType::FRAGMENT, program.stage(ShaderType::FRAGMENT), true, compilationLog);
-		if(!compilationLog.empty()) {
-			Log::Error() << Log::GPU << "Fragment shader (for " << program.name() << ") failed to compile:" << std::endl
-						 << compilationLog << std::endl;
-		}
-	}
-	// If tessellation control program code is given, compile it.
-	if(!tessControlContent.empty()) {
-		ShaderCompiler::compile(tessControlContent, ShaderType::TESSCONTROL, program.stage(ShaderType::TESSCONTROL), true, compilationLog);
-		if(!compilationLog.empty()) {
-			Log::Error() << Log::GPU << "Tessellation control shader (for " << program.name() << ") failed to compile:" << std::endl
-						 << compilationLog << std::endl;
-		}
-	}
-	// If tessellation evaluation program code is given, compile it.
-	if(!tessEvalContent.empty()) {
-		ShaderCompiler::compile(tessEvalContent, ShaderType::TESSEVAL, program.stage(ShaderType::TESSEVAL), true, compilationLog);
-		if(!compilationLog.empty()) {
-			Log::Error() << Log::GPU << "Tessellation evaluation shader (for " << program.name() << ") failed to compile:" << std::endl
-						 << compilationLog << std::endl;
+	// Compile all given stages concurrently.
+	std::vector<ShaderCompiler::Job> jobs;
+	jobs.emplace_back(vertexContent, ShaderType::VERTEX, &program.stage(ShaderType::VERTEX));
+	jobs.emplace_back(fragmentContent, ShaderType::FRAGMENT, &program.stage(ShaderType::FRAGMENT));
+	jobs.emplace_back(tessControlContent, ShaderType::TESSCONTROL, &program.stage(ShaderType::TESSCONTROL));
+	jobs.emplace_back(tessEvalContent, ShaderType::TESSEVAL, &program.stage(ShaderType::TESSEVAL));
+	ShaderCompiler::compile(jobs, true);
+
+	static const std::map<ShaderType, std::string> stageNames = {
+		{ShaderType::VERTEX, "Vertex"},
+		{ShaderType::FRAGMENT, "Fragment"},
+		{ShaderType::TESSCONTROL, "Tessellation control"},
+		{ShaderType::TESSEVAL, "Tessellation evaluation"}
+	};
+	for(const ShaderCompiler::Job & job : jobs){
+		if(!job.log.empty()) {
+			Log::Error() << Log::GPU << stageNames.at(job.type) << " shader (for " << program.name() << ") failed to compile:" << std::endl
+						 << job.log << std::endl;
 		}
 	}
 	++_metrics.programs;
@@ -424,6 +541,10 @@ void GPU::beginRender(const Window & window, const Load & depthOp, const Load &
 void GPU::bindAttachments(uint layer, uint mip, const Load& colorOp, const Load& depthOp, const Load& stencilOp, const Texture* depthStencil, const Texture* color0, const Texture* color1, const Texture* color2, const Texture* color3){
 
 	GPU::endRenderingIfNeeded();
+	// Only dispatches can be recorded on the async compute queue.
+	assert(_context.asyncStep != GPUContext::AsyncStep::COMPUTE);
+	// Restore resources used by previous dispatches before rendering.
+	GPU::restoreComputeResourcesIfNeeded();
 
 	_state.depthStencil = nullptr;
 	_state.colors.fill(nullptr);
@@ -551,7 +672,7 @@ void GPU::bindAttachments(uint layer, uint mip, const Load& colorOp, const Load&
 
 void GPU::saveTexture(Texture & texture, const std::string & path, Image::Save options) {
 	static const std::vector<Layout> hdrLayouts = {
-		Layout::R16F, Layout::RG16F, Layout::RGBA16F, Layout::R32F, Layout::RG32F, Layout::RGBA32F, Layout::A2_BGR10, Layout::A2_RGB10,
+		Layout::R16F, Layout::RG16F, Layout::RGBA16F, Layout::R32F, Layout::RG32F, Layout::RGBA32F, Layout::A2_BGR10, Layout::A2_RGB10, Layout::BC6H,
 		Layout::DEPTH_COMPONENT32F, Layout::DEPTH24_STENCIL8, Layout::DEPTH_COMPONENT16, Layout::DEPTH_COMPONENT24, Layout::DEPTH32F_STENCIL8,
 	};
 
@@ -573,7 +694,7 @@ void GPU::saveTexture(Texture & texture, const std::string & path, Image::Save o
 
 }
 
-void GPU::setupTexture(Texture & texture) {
+void GPU::setupTexture(Texture & texture, const GPUMemory * memory, uint64_t offset) {
 
 	if(texture.gpu) {
 		texture.gpu->clean();
@@ -582,21 +703,8 @@ void GPU::setupTexture(Texture & texture) {
 	texture.gpu.reset(new GPUTexture(texture.format));
 	const std::string& name = texture.name();
 
-	const bool is3D = texture.shape & TextureShape::D3;
 	const bool isCube = texture.shape & TextureShape::Cube;
 	const bool isArray = texture.shape & TextureShape::Array;
-	const bool isDepth = texture.gpu->aspect & VK_IMAGE_ASPECT_DEPTH_BIT;
-
-	VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-	if(texture.drawable){
-		usage |= isDepth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-	}
-	// Check feature support for compute access
-	VkFormatProperties formatProperties;
-	vkGetPhysicalDeviceFormatProperties(_context.physicalDevice, texture.gpu->format, &formatProperties);
-	if((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0) {
-		usage |= VK_IMAGE_USAGE_STORAGE_BIT;
-	}
 
 	const uint layers = (isCube || isArray) ? texture.depth : 1;
 
@@ -611,28 +719,17 @@ void GPU::setupTexture(Texture & texture) {
 	VkUtils::typesFromShape(texture.shape, imgType, viewType);
 
 	// Create image.
-	VkImageCreateInfo imageInfo = {};
-	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageInfo.imageType = imgType;
-	imageInfo.extent.width = static_cast<uint32_t>(texture.width);
-	imageInfo.extent.height = static_cast<uint32_t>(texture.height);
-	imageInfo.extent.depth = is3D ? texture.depth : 1;
-	imageInfo.mipLevels = texture.levels;
-	imageInfo.arrayLayers = layers;
-	imageInfo.format = texture.gpu->format;
-	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageInfo.usage = usage;
-	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageInfo.flags = 0;
-	if(isCube){
-		imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-	}
+	const VkImageCreateInfo imageInfo = VkUtils::imageInfoFromTexture(_context, texture, *texture.gpu);
 
-	VmaAllocationCreateInfo allocInfo = {};
-	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-	VK_RET(vmaCreateImage(_allocator, &imageInfo, &allocInfo, &(texture.gpu->image), &(texture.gpu->data), nullptr));
+	if(memory == nullptr){
+		VmaAllocationCreateInfo allocInfo = {};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		VK_RET(vmaCreateImage(_allocator, &imageInfo, &allocInfo, &(texture.gpu->image), &(texture.gpu->data), nullptr));
+	} else {
+		// Bind to the shared memory block, that the texture doesn't own.
+		VK_RET(vkCreateImage(_context.device, &imageInfo, nullptr, &(texture.gpu->image)));
+		VK_RET(vmaBindImageMemory2(_allocator, memory->data, offset, texture.gpu->image, nullptr));
+	}
 
 	VkUtils::setDebugName(_context, VK_OBJECT_TYPE_IMAGE, uint64_t(texture.gpu->image), "%s", name.c_str());
 
@@ -721,76 +818,127 @@ void GPU::setupTexture(Texture & texture) {
 	++_metrics.textures;
 }
 
+void GPU::getTextureRequirements(const Texture & texture, uint64_t & size, uint64_t & alignment, uint & typeBits){
+	// Create a temporary image to query its requirements.
+	const GPUTexture gpu(texture.format);
+	const VkImageCreateInfo imageInfo = VkUtils::imageInfoFromTexture(_context, texture, gpu);
+	VkImage image = VK_NULL_HANDLE;
+	VK_RET(vkCreateImage(_context.device, &imageInfo, nullptr, &image));
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(_context.device, image, &requirements);
+	vkDestroyImage(_context.device, image, nullptr);
+
+	size = requirements.size;
+	alignment = requirements.alignment;
+	typeBits = requirements.memoryTypeBits;
+}
+
+void GPU::setupMemory(GPUMemory & memory, uint64_t size, uint64_t alignment, uint typeBits){
+	if(memory.data != VK_NULL_HANDLE){
+		memory.clean();
+	}
+	VkMemoryRequirements requirements = {};
+	requirements.size = size;
+	requirements.alignment = alignment;
+	requirements.memoryTypeBits = typeBits;
+
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	VK_RET(vmaAllocateMemory(_allocator, &requirements, &allocInfo, &memory.data, nullptr));
+	memory.size = size;
+}
+
+void GPU::discardTexture(Texture & texture){
+	GPU::endRenderingIfNeeded();
+
+	GPUTexture & gpu = *texture.gpu;
+	// Wait for all previous accesses to the memory, possibly through another texture, and discard the content.
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = gpu.defaultLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = gpu.image;
+	barrier.subresourceRange.aspectMask = gpu.aspect;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+	vkCmdPipelineBarrier(_context.getRenderCommandBuffer(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	for(std::vector<VkImageLayout> & layers : gpu.layouts){
+		std::fill(layers.begin(), layers.end(), gpu.defaultLayout);
+	}
+}
+
 void GPU::uploadTexture(const Texture & texture) {
 	if(!texture.gpu) {
 		Log::Error() << Log::GPU << "Uninitialized GPU texture." << std::endl;
 		return;
 	}
-	if(texture.images.empty()) {
+	// Block-compressed textures are encoded on the CPU beforehand.
+	const Layout format = texture.format;
+	const bool isPacked = !texture.packed.empty();
+	if(TextureCodec::isCompressed(format) && !isPacked) {
+		Log::Error() << Log::GPU << "Compressed texture should be encoded before upload." << std::endl;
+		return;
+	}
+	if(texture.images.empty() && !isPacked) {
 		Log::Warning() << Log::GPU << "No images to upload." << std::endl;
 		return;
 	}
 
 	// Sanity check the texture destination format.
 	const unsigned int destChannels = texture.gpu->channels;
-	if(destChannels != texture.images[0].components) {
+	if(!isPacked && destChannels != texture.images[0].components) {
 		Log::Error() << Log::GPU << "Not enough values in source data for texture upload." << std::endl;
 		return;
 	}
 
-	// Determine if we can do the transfer without an intermediate texture.
-	const Layout format = texture.format;
-	const bool is8UB = format == Layout::R8 || format == Layout::RG8 || format == Layout::RGBA8 || format == Layout::BGRA8 || format == Layout::SRGB8_ALPHA8 || format == Layout::SBGR8_ALPHA8;
-	const bool is32F = format == Layout::R32F || format == Layout::RG32F || format == Layout::RGBA32F;
+	// Determine if we can do the transfer without an intermediate texture:
+	// either the data is already packed, or it can be packed in the destination layout on the CPU.
+	const bool isPackable = isPacked || TextureCodec::isPackable(format);
+	const Layout floatFormats[5] = {Layout(0), Layout::R32F, Layout::RG32F, Layout::RGBA32F /* no 3 channels format */, Layout::RGBA32F};
+	const Layout copyFormat = isPackable ? format : floatFormats[destChannels];
 
 	// Compute total texture size.
-	size_t totalComponentCount = 0;
-	for(const auto & img: texture.images) {
-		const size_t imgSize = img.pixels.size();
-		totalComponentCount += imgSize;
+	size_t totalSize = texture.packed.size();
+	if(!isPacked){
+		for(const auto & img: texture.images) {
+			totalSize += TextureCodec::imageSize(copyFormat, img.width, img.height);
+		}
 	}
 
-	const size_t compSize = is8UB ? sizeof(unsigned char) : sizeof(float);
-	const size_t totalSize = totalComponentCount * compSize;
-
 	Texture transferTexture("tmpTexture");
 	const Texture* dstTexture = &texture;
 	size_t currentOffset = 0;
 
-	// Transfer the complete CPU image data to a staging buffer, handling conversion..
-	Buffer transferBuffer(totalSize, BufferType::CPUTOGPU, "ImageStaging");
+	// Transfer the complete CPU image data to staging memory, handling conversion.
+	// Offsets are aligned on the largest texel size.
+	const StagingAllocator::Region staging = _context.stagingAllocator.allocate(totalSize, 16);
+	char* const stagingData = staging.mapped;
 
-	if(is8UB){
-		// Convert to uchar on the CPU.
-		for(const auto & img: texture.images) {
-			// Number of floats in the image.
-			const size_t compCount = img.pixels.size();
-			// Ideally parallelism should be moved higher up.
-			System::forParallel(0, compCount, [&img, currentOffset, &transferBuffer](size_t cid){
-				const float val = glm::clamp(img.pixels[cid], 0.0f, 1.0f);
-				*(transferBuffer.gpu->mapped + currentOffset + cid) = (unsigned char)(255.0f * val);
-			});
-			currentOffset += compCount;
-		}
+	if(isPacked){
+		std::memcpy(stagingData, texture.packed.data(), totalSize);
 	} else {
-		// Copy float arrays.
-		size_t currentOffset = 0;
+		// Pack in the final layout on the CPU, or as floats for unsupported layouts.
 		for(const auto & img: texture.images) {
-			const size_t compCount = img.pixels.size() * compSize;
-			std::memcpy(transferBuffer.gpu->mapped + currentOffset, img.pixels.data(), compCount);
-			currentOffset += compCount;
+			TextureCodec::pack(img, copyFormat, reinterpret_cast<uchar*>(stagingData + currentOffset));
+			currentOffset += TextureCodec::imageSize(copyFormat, img.width, img.height);
 		}
-		// If destination is not 32F, we need to use an intermediate 32F texture and convert
+		// If the destination layout can't be packed, we need to use an intermediate 32F texture and convert
 		// to destination format using blit.
-		if(!is32F){
+		if(!isPackable){
 			// Prepare the intermediate texture.
 			transferTexture.width = texture.width;
 			transferTexture.height = texture.height;
 			transferTexture.depth = texture.depth;
 			transferTexture.levels = texture.levels;
 			transferTexture.shape = texture.shape;
-			const Layout floatFormats[5] = {Layout(0), Layout::R32F, Layout::RG32F, Layout::RGBA32F /* no 3 channels format */, Layout::RGBA32F};
-			transferTexture.format = floatFormats[destChannels];
+			transferTexture.format = copyFormat;
 			GPU::setupTexture(transferTexture);
 			// Useful to avoid a useless transition at the very end.
 			transferTexture.gpu->defaultLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
@@ -798,6 +946,8 @@ void GPU::uploadTexture(const Texture & texture) {
 			dstTexture = &transferTexture;
 		}
 	}
+	_context.stagingAllocator.flush(staging, totalSize);
+
 	// Prepare copy destination.
 	VkCommandBuffer commandBuffer = _context.getUploadCommandBuffer();
 	VkUtils::textureLayoutBarrier(commandBuffer, *dstTexture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
@@ -805,7 +955,6 @@ void GPU::uploadTexture(const Texture & texture) {
 	// How many images in the mip level (for arrays and cubes)
 	const uint layers = texture.shape == TextureShape::D3 ? 1u : texture.depth;
 	// Copy operation for each mip level that is available on the CPU.
-	size_t currentImg = 0;
 	currentOffset = 0;
 
 	for(uint mid = 0; mid < texture.levels; ++mid) {
@@ -816,7 +965,7 @@ void GPU::uploadTexture(const Texture & texture) {
 
 		// Perform copy for this mip level.
 		VkBufferImageCopy region = {};
-		region.bufferOffset = currentOffset;
+		region.bufferOffset = staging.offset + currentOffset;
 		region.bufferRowLength = 0; // Tightly packed.
 		region.bufferImageHeight = 0; // Tightly packed.
 		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -828,15 +977,13 @@ void GPU::uploadTexture(const Texture & texture) {
 		region.imageExtent = { (uint32_t)w, (uint32_t)h, (uint32_t)d};
 
 		// Copy to the intermediate texture.
-		vkCmdCopyBufferToImage(commandBuffer, transferBuffer.gpu->buffer, dstTexture->gpu->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		vkCmdCopyBufferToImage(commandBuffer, staging.buffer, dstTexture->gpu->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
 		const uint imageCount = texture.shape == TextureShape::D3 ? d : layers;
-		// Support both 8-bits and 32-bits cases.
-		currentOffset += imageCount * w * h * destChannels * compSize;
-		currentImg += imageCount;
+		currentOffset += imageCount * TextureCodec::imageSize(copyFormat, w, h);
 		// We might have more levels allocated on the GPU than we had available on the CPU.
 		// Stop, these will be generated automatically.
-		if(currentImg >= texture.images.size()){
+		if(currentOffset >= totalSize){
 			break;
 		}
 
@@ -911,6 +1058,8 @@ void GPU::downloadTextureSync(Texture & texture, int level) {
 
 GPUAsyncTask GPU::downloadTextureAsync(const Texture& texture, const glm::uvec2& offset, const glm::uvec2& size, uint layerCount, std::function<void(const Texture&)> callback){
 	GPU::endRenderingIfNeeded();
+	// Transfers might read or overwrite the results of previous dispatches.
+	GPU::restoreComputeResourcesIfNeeded();
 	
 	const uint texLayerCount = texture.shape == TextureShape::D3 ? 1 : texture.depth;
 	const uint effectiveLayerCount = layerCount == 0 ? texLayerCount : std::min(texLayerCount, layerCount);
@@ -1035,6 +1184,8 @@ void GPU::clearTexture(const Texture & texture, const glm::vec4& color){
 	// for possibilities.
 	// End current render pass.
 	GPU::endRenderingIfNeeded();
+	// Transfers might read or overwrite the results of previous dispatches.
+	GPU::restoreComputeResourcesIfNeeded();
 
 	GPUContext* context = GPU::getInternal();
 	VkCommandBuffer& commandBuffer = context->getRenderCommandBuffer();
@@ -1062,6 +1213,8 @@ void GPU::clearDepth(const Texture & texture, float depth){
 	// for possibilities.
 	// End current render pass.
 	GPU::endRenderingIfNeeded();
+	// Transfers might read or overwrite the results of previous dispatches.
+	GPU::restoreComputeResourcesIfNeeded();
 
 	GPUContext* context = GPU::getInternal();
 	VkCommandBuffer& commandBuffer = context->getRenderCommandBuffer();
@@ -1082,6 +1235,23 @@ void GPU::clearDepth(const Texture & texture, float depth){
 	VkUtils::textureLayoutBarrier(commandBuffer, texture, texture.gpu->defaultLayout);
 }
 
+void GPU::clearDepth(float depth, const glm::uvec2 & offset, const glm::uvec2 & size){
+	assert(_context.inRenderPass);
+	assert(_state.depthStencil != nullptr);
+
+	VkClearAttachment attachment = {};
+	attachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	attachment.clearValue.depthStencil.depth = depth;
+	attachment.clearValue.depthStencil.stencil = 0u;
+
+	VkClearRect rect = {};
+	rect.rect.offset = { int32_t(offset.x), int32_t(offset.y) };
+	rect.rect.extent = { uint32_t(size.x), uint32_t(size.y) };
+	rect.baseArrayLayer = 0;
+	rect.layerCount = 1;
+	vkCmdClearAttachments(_context.getRenderCommandBuffer(), 1, &attachment, 1, &rect);
+}
+
 
 void GPU::setupBuffer(Buffer & buffer) {
 	if(buffer.gpu) {
@@ -1094,10 +1264,11 @@ void GPU::setupBuffer(Buffer & buffer) {
 	static const std::unordered_map<BufferType, VkBufferUsageFlags> types = {
 		{ BufferType::VERTEX, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT},
 		{ BufferType::INDEX, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT},
-		{ BufferType::UNIFORM, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT },
+		{ BufferType::UNIFORM, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
 		{ BufferType::CPUTOGPU, VK_BUFFER_USAGE_TRANSFER_SRC_BIT },
 		{ BufferType::GPUTOCPU, VK_BUFFER_USAGE_TRANSFER_DST_BIT },
-		{ BufferType::STORAGE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT}
+		{ BufferType::STORAGE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT},
+		{ BufferType::INDIRECT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT }
 	};
 	const VkBufferUsageFlags type = types.at(buffer.type);
 
@@ -1107,7 +1278,8 @@ void GPU::setupBuffer(Buffer & buffer) {
 		{ BufferType::UNIFORM, VMA_MEMORY_USAGE_CPU_TO_GPU  },
 		{ BufferType::CPUTOGPU, VMA_MEMORY_USAGE_CPU_ONLY },
 		{ BufferType::GPUTOCPU, VMA_MEMORY_USAGE_GPU_TO_CPU },
-		{ BufferType::STORAGE, VMA_MEMORY_USAGE_GPU_ONLY }
+		{ BufferType::STORAGE, VMA_MEMORY_USAGE_GPU_ONLY },
+		{ BufferType::INDIRECT, VMA_MEMORY_USAGE_CPU_TO_GPU }
 	};
 
 	const VmaMemoryUsage usage = usages.at(buffer.type);
@@ -1117,6 +1289,13 @@ void GPU::setupBuffer(Buffer & buffer) {
 	bufferInfo.size = buffer.size;
 	bufferInfo.usage = type;
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	// Buffers are often updated from the CPU, share them between queues instead of transferring ownership.
+	const uint32_t queueFamilies[] = { _context.graphicsId, _context.computeId };
+	if(_context.asyncCompute && (_context.computeId != _context.graphicsId)){
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = queueFamilies;
+	}
 
 	VmaAllocationCreateInfo allocInfo = {};
 	allocInfo.usage = usage;
@@ -1164,15 +1343,17 @@ void GPU::uploadBuffer(const Buffer & buffer, size_t size, uchar * data, size_t
 		return;
 	}
 
-	// Otherwise, create a transfer buffer.
-	Buffer transferBuffer(size, BufferType::CPUTOGPU, "BufferStaging");
-	transferBuffer.upload(size, data, 0);
+	// Otherwise, copy to staging memory.
+	const StagingAllocator::Region staging = _context.stagingAllocator.allocate(size, 4);
+	std::memcpy(staging.mapped, data, size);
+	_context.stagingAllocator.flush(staging, size);
 	// Copy operation.
 	VkBufferCopy copyRegion = {};
-	copyRegion.srcOffset = 0;
+	copyRegion.srcOffset = staging.offset;
 	copyRegion.dstOffset = offset;
 	copyRegion.size = size;
-	vkCmdCopyBuffer(_context.getUploadCommandBuffer(), transferBuffer.gpu->buffer, buffer.gpu->buffer, 1, &copyRegion);
+	vkCmdCopyBuffer(_context.getUploadCommandBuffer(), staging.buffer, buffer.gpu->buffer, 1, &copyRegion);
+	++_metrics.uploads;
 
 }
 
@@ -1373,6 +1554,106 @@ void GPU::drawMesh(const Mesh & mesh) {
 	++_metrics.drawCalls;
 }
 
+void GPU::drawMesh(const Mesh & mesh, const std::vector<glm::uvec2> & ranges) {
+	if(ranges.empty()){
+		return;
+	}
+	_state.mesh = mesh.gpu.get();
+
+	bindGraphicsPipelineIfNeeded();
+	_state.graphicsProgram->update();
+
+	vkCmdBindVertexBuffers(_context.getRenderCommandBuffer(), 0, uint32_t(mesh.gpu->state.offsets.size()), mesh.gpu->state.buffers.data(), mesh.gpu->state.offsets.data());
+	vkCmdBindIndexBuffer(_context.getRenderCommandBuffer(), mesh.gpu->indexBuffer->gpu->buffer, 0, VK_INDEX_TYPE_UINT32);
+	++_metrics.meshBindings;
+
+	for(const glm::uvec2 & range : ranges){
+		vkCmdDrawIndexed(_context.getRenderCommandBuffer(), uint32_t(range[1]), 1, uint32_t(range[0]), 0, 0);
+	}
+	_metrics.drawCalls += ranges.size();
+}
+
+void GPU::drawMeshInstanced(const Mesh & mesh, uint instanceCount, uint firstInstance) {
+	if(instanceCount == 0){
+		return;
+	}
+	_state.mesh = mesh.gpu.get();
+
+	bindGraphicsPipelineIfNeeded();
+	_state.graphicsProgram->update();
+
+	vkCmdBindVertexBuffers(_context.getRenderCommandBuffer(), 0, uint32_t(mesh.gpu->state.offsets.size()), mesh.gpu->state.buffers.data(), mesh.gpu->state.offsets.data());
+	vkCmdBindIndexBuffer(_context.getRenderCommandBuffer(), mesh.gpu->indexBuffer->gpu->buffer, 0, VK_INDEX_TYPE_UINT32);
+	++_metrics.meshBindings;
+
+	vkCmdDrawIndexed(_context.getRenderCommandBuffer(), static_cast<uint32_t>(mesh.gpu->count), instanceCount, 0, 0, firstInstance);
+	++_metrics.drawCalls;
+	_metrics.instances += instanceCount;
+}
+
+void GPU::drawIndirect(const Mesh & mesh, const Buffer & commands, size_t offset, uint drawCount) {
+	if(drawCount == 0){
+		return;
+	}
+	_state.mesh = mesh.gpu.get();
+
+	bindGraphicsPipelineIfNeeded();
+	_state.graphicsProgram->update();
+
+	vkCmdBindVertexBuffers(_context.getRenderCommandBuffer(), 0, uint32_t(mesh.gpu->state.offsets.size()), mesh.gpu->state.buffers.data(), mesh.gpu->state.offsets.data());
+	vkCmdBindIndexBuffer(_context.getRenderCommandBuffer(), mesh.gpu->indexBuffer->gpu->buffer, 0, VK_INDEX_TYPE_UINT32);
+	++_metrics.meshBindings;
+
+	const uint32_t stride = uint32_t(sizeof(VkDrawIndexedIndirectCommand));
+	static_assert(sizeof(DrawCommand) == sizeof(VkDrawIndexedIndirectCommand), "Draw command layout mismatch.");
+	// If commands can't specify their first instance, emit them directly when they are visible from the CPU.
+	if(!_context.indirectFirstInstance && commands.gpu->mapped){
+		const DrawCommand* cmds = reinterpret_cast<const DrawCommand*>(commands.gpu->mapped + offset);
+		for(uint did = 0; did < drawCount; ++did){
+			const DrawCommand& cmd = cmds[did];
+			vkCmdDrawIndexed(_context.getRenderCommandBuffer(), cmd.indexCount, cmd.instanceCount, cmd.firstIndex, cmd.vertexOffset, cmd.firstInstance);
+			_metrics.instances += cmd.instanceCount;
+		}
+		_metrics.drawCalls += drawCount;
+		return;
+	}
+	// Without multi-draw support, issue one call per command.
+	if(_context.multiDrawIndirect){
+		vkCmdDrawIndexedIndirect(_context.getRenderCommandBuffer(), commands.gpu->buffer, VkDeviceSize(offset), drawCount, stride);
+		++_metrics.drawCalls;
+	} else {
+		for(uint did = 0; did < drawCount; ++did){
+			vkCmdDrawIndexedIndirect(_context.getRenderCommandBuffer(), commands.gpu->buffer, VkDeviceSize(offset + did * stride), 1, stride);
+		}
+		_metrics.drawCalls += drawCount;
+	}
+	_metrics.indirectCommands += drawCount;
+}
+
+void GPU::drawIndirectCount(const Mesh & mesh, const Buffer & commands, size_t offset, const Buffer & count, size_t countOffset, uint maxDrawCount) {
+	if(maxDrawCount == 0){
+		return;
+	}
+	if(!_context.drawIndirectCount){
+		Log::Error() << Log::GPU << "Indirect draw count is not supported." << std::endl;
+		return;
+	}
+	_state.mesh = mesh.gpu.get();
+
+	bindGraphicsPipelineIfNeeded();
+	_state.graphicsProgram->update();
+
+	vkCmdBindVertexBuffers(_context.getRenderCommandBuffer(), 0, uint32_t(mesh.gpu->state.offsets.size()), mesh.gpu->state.buffers.data(), mesh.gpu->state.offsets.data());
+	vkCmdBindIndexBuffer(_context.getRenderCommandBuffer(), mesh.gpu->indexBuffer->gpu->buffer, 0, VK_INDEX_TYPE_UINT32);
+	++_metrics.meshBindings;
+
+	const uint32_t stride = uint32_t(sizeof(VkDrawIndexedIndirectCommand));
+	vkCmdDrawIndexedIndirectCount(_context.getRenderCommandBuffer(), commands.gpu->buffer, VkDeviceSize(offset), count.gpu->buffer, VkDeviceSize(countOffset), maxDrawCount, stride);
+	++_metrics.drawCalls;
+	// The real count is only known on the GPU.
+	_metrics.indirectCommands += maxDrawCount;
+}
+
 void GPU::drawTesselatedMesh(const Mesh & mesh, uint patchSize){
 	_state.patchSize = patchSize;
 	
@@ -1396,27 +1677,161 @@ void GPU::dispatch(uint width, uint height, uint depth){
 
 	endRenderingIfNeeded();
 	bindComputePipelineIfNeeded();
+	Program& program = *_state.computeProgram;
+	const bool async = _context.asyncStep == GPUContext::AsyncStep::COMPUTE;
+	// Textures have to be transferred to the compute queue first.
+	if(async){
+		GPU::acquireAsyncTextures(program);
+	}
 	// Ensure all resources are in the proper state for compute use (including
 	// synchronization with a previous compute shader).
-	_state.computeProgram->transitionResourcesTo(Program::Type::COMPUTE);
+	program.transitionResourcesTo(Program::Type::COMPUTE);
 	// Update and bind descriptors (after layout transitions)
-	_state.computeProgram->update();
+	program.update();
 	// Dispatch.
-	const glm::uvec3& localSize = _state.computeProgram->size();
+	const glm::uvec3& localSize = program.size();
 	const glm::uvec3 paddedSize = glm::uvec3(width, height, depth) + localSize - glm::uvec3(1u);
 	const glm::uvec3 groupSize = paddedSize / localSize;
 	vkCmdDispatch(_context.getRenderCommandBuffer(), groupSize[0], groupSize[1], groupSize[2]);
 
-	// Restore all resources to their graphic state.
-	// This is quite wasteful if resources are then used by another compute shader.
-	// But we can't restore resources just before a draw call because we can't have
-	// arbitrary layout barriers in a render pass...
-	// A solution would be to keep track of unrestored resources on the context
-	// and transition them before starting the next render pass.
-	_state.computeProgram->transitionResourcesTo(Program::Type::GRAPHICS);
+	// Resources are restored to their graphic state just before the next render pass,
+	// avoiding redundant transitions when they are used by successive compute shaders.
+	// Textures used by async compute are restored once the graphics queue has acquired them back.
+	if(async){
+		return;
+	}
+	for(const auto& texInfos : program._textures){
+		for(const Texture* tex : texInfos.second.textures){
+			GPUTexture* gpuTex = tex->gpu.get();
+			if(std::find(_context.computeTextures.begin(), _context.computeTextures.end(), gpuTex) == _context.computeTextures.end()){
+				_context.computeTextures.push_back(gpuTex);
+			}
+		}
+	}
+	_context.computeBarrier = true;
+}
+
+void GPU::beginAsyncCompute(){
+	if(!_context.asyncCompute){
+		return;
+	}
+	if(_context.asyncStep != GPUContext::AsyncStep::NONE){
+		Log::Error() << Log::GPU << "Async compute can only be started once per frame." << std::endl;
+		return;
+	}
+	endRenderingIfNeeded();
+	_context.asyncStep = GPUContext::AsyncStep::COMPUTE;
+	beginAsyncCommandBuffer();
+}
+
+void GPU::endAsyncCompute(){
+	if(_context.asyncStep != GPUContext::AsyncStep::COMPUTE){
+		return;
+	}
+	// Release textures back to the graphics queue.
+	if(_context.computeId != _context.graphicsId){
+		VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
+		for(const GPUTexture* texture : _context.asyncTextures){
+			VkUtils::queueOwnershipBarrier(commandBuffer, *texture, _context.computeId, _context.graphicsId, true);
+		}
+	}
+	_context.asyncStep = GPUContext::AsyncStep::OVERLAP;
+	beginAsyncCommandBuffer();
+}
+
+void GPU::waitAsyncCompute(){
+	endAsyncCompute();
+	if(_context.asyncStep != GPUContext::AsyncStep::OVERLAP){
+		return;
+	}
+	endRenderingIfNeeded();
+	_context.asyncStep = GPUContext::AsyncStep::RESUME;
+	beginAsyncCommandBuffer();
+	// Acquire textures from the compute queue, they will be restored before the next render pass.
+	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
+	for(GPUTexture* texture : _context.asyncTextures){
+		if(_context.computeId != _context.graphicsId){
+			VkUtils::queueOwnershipBarrier(commandBuffer, *texture, _context.computeId, _context.graphicsId, false);
+		}
+		if(std::find(_context.computeTextures.begin(), _context.computeTextures.end(), texture) == _context.computeTextures.end()){
+			_context.computeTextures.push_back(texture);
+		}
+	}
+}
+
+bool GPU::supportsAsyncCompute(){
+	return _context.asyncCompute;
+}
+
+void GPU::beginAsyncCommandBuffer(){
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_RET(vkBeginCommandBuffer(_context.getRenderCommandBuffer(), &beginInfo));
+	// Pipelines have to be bound again in the new command buffer.
+	_context.hadRenderPass = true;
+	_context.newRenderPass = true;
+}
+
+void GPU::acquireAsyncTextures(const Program & program){
+	// Release on the graphics queue before async compute starts, and acquire on the compute queue.
+	VkCommandBuffer& releaseBuffer = _context.renderCommandBuffers[_context.swapIndex];
+	VkCommandBuffer& acquireBuffer = _context.getRenderCommandBuffer();
+	for(const auto& texInfos : program._textures){
+		for(const Texture* tex : texInfos.second.textures){
+			GPUTexture* gpuTex = tex->gpu.get();
+			if(std::find(_context.asyncTextures.begin(), _context.asyncTextures.end(), gpuTex) != _context.asyncTextures.end()){
+				continue;
+			}
+			_context.asyncTextures.push_back(gpuTex);
+			// The texture can't be restored on the graphics queue until async compute is complete.
+			_context.computeTextures.erase(std::remove(_context.computeTextures.begin(), _context.computeTextures.end(), gpuTex), _context.computeTextures.end());
+
+			if(_context.computeId != _context.graphicsId){
+				VkUtils::queueOwnershipBarrier(releaseBuffer, *gpuTex, _context.graphicsId, _context.computeId, true);
+				VkUtils::queueOwnershipBarrier(acquireBuffer, *gpuTex, _context.graphicsId, _context.computeId, false);
+			}
+		}
+	}
+}
+
+void GPU::completeAsyncCompute(){
+	if(_context.asyncStep == GPUContext::AsyncStep::NONE){
+		return;
+	}
+	waitAsyncCompute();
+}
+
+void GPU::restoreComputeResourcesIfNeeded(){
+	if(_context.asyncStep == GPUContext::AsyncStep::COMPUTE){
+		return;
+	}
+	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
+	// Writes to buffers have to be complete, whether we will use them
+	// as index/vertex/uniform/storage/indirect buffers or in transfers.
+	if(_context.computeBarrier){
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		const VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr );
+		_context.computeBarrier = false;
+	}
+	// Move all textures back to their default layout.
+	for(GPUTexture* texture : _context.computeTextures){
+		const uint mipCount = uint(texture->layouts.size());
+		const uint layerCount = mipCount > 0 ? uint(texture->layouts[0].size()) : 0u;
+		VkUtils::imageLayoutBarrier(commandBuffer, *texture, texture->defaultLayout, 0, mipCount, 0, layerCount);
+	}
+	_context.computeTextures.clear();
 }
 
 void GPU::beginFrameCommandBuffers() {
+	// Command buffers can't be reset while the GPU is still executing them.
+	if(_context.validateSync && (vkGetFenceStatus(_context.device, _context.getFrameFence()) != VK_SUCCESS)){
+		Log::Error() << Log::GPU << "Command buffers " << _context.swapIndex << " reused while still in flight." << std::endl;
+	}
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
@@ -1427,23 +1842,33 @@ void GPU::beginFrameCommandBuffers() {
 }
 
 void GPU::submitFrameCommandBuffers() {
-	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
-	VkCommandBuffer& commandBufferUpload = _context.getUploadCommandBuffer();
-	VK_RET(vkEndCommandBuffer(commandBuffer));
-	VK_RET(vkEndCommandBuffer(commandBufferUpload));
-
-	// Submit them.
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	// Start with the uploads.
-	submitInfo.pCommandBuffers = &commandBufferUpload;
-	VK_RET(vkQueueSubmit(_context.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
-	VK_RET(vkQueueWaitIdle(_context.graphicsQueue));
-	// Then the rendering (as it might use uploaded data).
-	submitInfo.pCommandBuffers = &commandBuffer;
-	VK_RET(vkQueueSubmit(_context.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
-	VK_RET(vkQueueWaitIdle(_context.graphicsQueue));
+	completeAsyncCompute();
+	VkUtils::submitFrameCommandBuffers(_context, VK_NULL_HANDLE, VK_NULL_HANDLE);
+	++_metrics.submissions;
+}
+
+void GPU::waitForFrameResources(){
+	// Is the GPU still busy with the previous frame while we start recording a new one?
+	if(_context.frameCount > 1){
+		const uint previousIndex = (_context.swapIndex + _context.frameCount - 1) % _context.frameCount;
+		if(vkGetFenceStatus(_context.device, _context.frameFences[previousIndex]) == VK_NOT_READY){
+			++_metrics.overlappedFrames;
+		}
+	}
+
+	// Wait for the last frame that used the same command buffers to complete.
+	Query timer;
+	timer.begin();
+	VK_RET(vkWaitForFences(_context.device, 1, &_context.getFrameFence(), VK_TRUE, std::numeric_limits<uint64_t>::max()));
+	timer.end();
+	_metrics.frameWait += timer.value() / 1000u;
+	_context.stagingAllocator.releaseFrame();
+
+	// Periodically report overlap between CPU recording and GPU execution.
+	if(_context.validateSync && (_metrics.submissions != 0) && (_context.frameIndex % 256 == 0)){
+		const double overlap = 100.0 * double(_metrics.overlappedFrames) / double(_metrics.submissions);
+		Log::Info() << Log::GPU << "Frame " << _context.frameIndex << ": " << _context.frameCount << " frames in flight, GPU busy at frame start for " << overlap << "% of frames, CPU waited " << _metrics.frameWait << "us." << std::endl;
+	}
 }
 
 void GPU::flush(){
@@ -1451,6 +1876,10 @@ void GPU::flush(){
 
 	// End both command buffers.
 	GPU::submitFrameCommandBuffers();
+	// Wait for all queue work to be complete, as command buffers will be immediately reused.
+	// The fence also covers work submitted for previous frames on the same queue.
+	VK_RET(vkWaitForFences(_context.device, 1, &_context.getFrameFence(), VK_TRUE, std::numeric_limits<uint64_t>::max()));
+	_context.stagingAllocator.releaseFrame();
 
 	// Perform copies and destructions.
 	processAsyncTasks(true);
@@ -1466,12 +1895,21 @@ void GPU::nextFrame(){
 
 	_context.nextFrame();
 	_context.pipelineCache.freeOutdatedPipelines();
+	_context.descriptorCache.evict();
 
 	// Save and reset stats.
 	_metricsPrevious = _metrics;
 	_metrics.resetPerFrameMetrics();
 }
 
+uint GPU::framesInFlight(){
+	return _context.frameCount;
+}
+
+uint GPU::frameIndex(){
+	return uint(_context.swapIndex);
+}
+
 void GPU::deviceInfos(std::string & vendor, std::string & renderer, std::string & version, std::string & shaderVersion) {
 	vendor = renderer = version = shaderVersion = "";
 
@@ -1496,6 +1934,39 @@ void GPU::deviceInfos(std::string & vendor, std::string & renderer, std::string
 	}
 }
 
+bool GPU::supportsBlockCompression() {
+	return _context.blockCompression;
+}
+
+bool GPU::supportsBindless() {
+	return _context.bindless;
+}
+
+bool GPU::supportsIndirectFirstInstance() {
+	return _context.indirectFirstInstance;
+}
+
+bool GPU::supportsDrawIndirectCount() {
+	return _context.drawIndirectCount && _context.indirectFirstInstance;
+}
+
+uint GPU::registerBindlessTexture(const Texture & texture){
+	if(!_context.bindless || !texture.gpu){
+		return TextureTable::invalidSlot;
+	}
+	if(texture.gpu->bindlessSlot != TextureTable::invalidSlot){
+		return texture.gpu->bindlessSlot;
+	}
+	if(texture.shape != TextureShape::D2){
+		Log::Error() << Log::GPU << "Only 2D textures can be registered in the texture table (" << texture.name() << ")." << std::endl;
+		return TextureTable::invalidSlot;
+	}
+	// Sampled from the table without any barrier, make sure the texture is in the expected layout before rendering.
+	VkUtils::textureLayoutBarrier(_context.getUploadCommandBuffer(), texture, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	texture.gpu->bindlessSlot = _context.textureTable.registerTexture(texture);
+	return texture.gpu->bindlessSlot;
+}
+
 std::vector<std::string> GPU::supportedExtensions() {
 	std::vector<std::string> names;
 	names.emplace_back("-- Instance ------");
@@ -1613,6 +2084,8 @@ void GPU::blitDepth(const Texture & src, const Texture & dst) {
 
 void GPU::blit(const Texture & src, const Texture & dst, Filter filter) {
 	GPU::endRenderingIfNeeded();
+	// Transfers might read or overwrite the results of previous dispatches.
+	GPU::restoreComputeResourcesIfNeeded();
 	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
 
 	const glm::uvec2 srcSize(src.width, src.height);
@@ -1628,6 +2101,8 @@ void GPU::blit(const Texture & src, const Texture & dst, Filter filter) {
 
 void GPU::blit(const Texture & src, const Texture & dst, size_t lSrc, size_t lDst, Filter filter) {
 	GPU::endRenderingIfNeeded();
+	// Transfers might read or overwrite the results of previous dispatches.
+	GPU::restoreComputeResourcesIfNeeded();
 	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
 
 	const glm::uvec2 srcSize(src.width, src.height);
@@ -1641,6 +2116,8 @@ void GPU::blit(const Texture & src, const Texture & dst, size_t lSrc, size_t lDs
 
 void GPU::blit(const Texture & src, const Texture & dst, size_t lSrc, size_t lDst, size_t mipSrc, size_t mipDst, Filter filter) {
 	GPU::endRenderingIfNeeded();
+	// Transfers might read or overwrite the results of previous dispatches.
+	GPU::restoreComputeResourcesIfNeeded();
 	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
 
 	const glm::uvec2 srcSize(src.width, src.height);
@@ -1650,6 +2127,16 @@ void GPU::blit(const Texture & src, const Texture & dst, size_t lSrc, size_t lDs
 	_metrics.blitCount += 1;
 }
 
+void GPU::copy(const Texture & src, const Texture & dst, size_t lSrc, size_t lDst, const glm::uvec2 & offset, const glm::uvec2 & size) {
+	GPU::endRenderingIfNeeded();
+	// Transfers might read or overwrite the results of previous dispatches.
+	GPU::restoreComputeResourcesIfNeeded();
+	VkCommandBuffer& commandBuffer = _context.getRenderCommandBuffer();
+
+	VkUtils::copyTexture(commandBuffer, src, dst, 0, 0, uint(lSrc), uint(lDst), 1, offset, offset, size);
+	_metrics.blitCount += 1;
+}
+
 void GPU::endRenderingIfNeeded(){
 	// No active attachments.
 	if(_state.pass.depthStencil == Layout::NONE && _state.pass.colors[0] == Layout::NONE){
@@ -1706,16 +2193,37 @@ void GPU::cleanup(){
 	}
 
 	_context.textureTasks.clear();
+	_context.stagingAllocator.clean();
 
 	_context.frameIndex += 100;
 	processDestructionRequests();
 	
 	_context.pipelineCache.clean();
+	_context.descriptorCache.clean();
 	_context.descriptorAllocator.clean();
 	_context.samplerLibrary.clean();
+	_context.textureTable.clean();
 
 	assert(_context.resourcesToDelete.empty());
 
+	for(uint i = 0; i < _context.frameCount; ++i){
+		vkDestroyFence(_context.device, _context.frameFences[i], nullptr);
+		vkDestroySemaphore(_context.device, _context.uploadSemaphores[i], nullptr);
+	}
+	for(VkSemaphore& semaphore : _context.computeStartSemaphores){
+		vkDestroySemaphore(_context.device, semaphore, nullptr);
+	}
+	for(VkSemaphore& semaphore : _context.computeEndSemaphores){
+		vkDestroySemaphore(_context.device, semaphore, nullptr);
+	}
+	_context.frameFences.clear();
+	_context.uploadSemaphores.clear();
+	_context.computeStartSemaphores.clear();
+	_context.computeEndSemaphores.clear();
+
+	if(_context.computeCommandPool != _context.commandPool){
+		vkDestroyCommandPool(_context.device, _context.computeCommandPool, nullptr);
+	}
 	vkDestroyCommandPool(_context.device, _context.commandPool, nullptr);
 
 	vmaDestroyAllocator(_allocator);
@@ -1725,6 +2233,13 @@ void GPU::cleanup(){
 }
 
 void GPU::clean(GPUTexture & tex){
+	if(tex.bindlessSlot != TextureTable::invalidSlot){
+		_context.textureTable.release(tex.bindlessSlot);
+		tex.bindlessSlot = TextureTable::invalidSlot;
+	}
+	// Stop tracking the texture for compute restoration and queue transfers.
+	_context.computeTextures.erase(std::remove(_context.computeTextures.begin(), _context.computeTextures.end(), &tex), _context.computeTextures.end());
+	_context.asyncTextures.erase(std::remove(_context.asyncTextures.begin(), _context.asyncTextures.end(), &tex), _context.asyncTextures.end());
 	_context.resourcesToDelete.emplace_back();
 	ResourceToDelete& rsc = _context.resourcesToDelete.back();
 	rsc.view = tex.view;
@@ -1767,20 +2282,33 @@ void GPU::clean(GPUBuffer & buffer){
 	--_metrics.buffers;
 }
 
+void GPU::clean(GPUMemory & memory){
+	_context.resourcesToDelete.emplace_back();
+	ResourceToDelete& rsc = _context.resourcesToDelete.back();
+	rsc.data = memory.data;
+	rsc.frame = _context.frameIndex;
+	memory.data = VK_NULL_HANDLE;
+	memory.size = 0;
+}
+
 void GPU::clean(Program & program){
 	
 	vkDestroyPipelineLayout(_context.device, program._state.layout, nullptr);
 	// Skip the static samplers.
 	const size_t layoutCount = program._state.setLayouts.size();
 	if(layoutCount > 0){
-		// Skip the static samplers.
+		std::unordered_set<uint64_t> destroyedLayouts;
+		// Skip the static samplers and the global texture table.
 		for(size_t lid = 0; lid < layoutCount; ++lid){
-			if(lid == SAMPLERS_SET){
+			if(lid == SAMPLERS_SET || lid == BINDLESS_SET){
 				continue;
 			}
 			VkDescriptorSetLayout& setLayout = program._state.setLayouts[lid];
+			destroyedLayouts.insert(uint64_t(setLayout));
 			vkDestroyDescriptorSetLayout(_context.device, setLayout, nullptr);
 		}
+		// Cached descriptor sets using these layouts can't be reused.
+		_context.descriptorCache.invalidate(destroyedLayouts);
 	}
 	for(Program::Stage& stage : program._stages){
 		vkDestroyShaderModule(_context.device, stage.module, nullptr);
@@ -1792,17 +2320,23 @@ void GPU::clean(Program & program){
 void GPU::processDestructionRequests(){
 	const uint64_t currentFrame = _context.frameIndex;
 
-	if(_context.resourcesToDelete.empty() || (currentFrame < 2)){
+	const uint64_t frameCount = _context.frameCount;
+
+	if(_context.resourcesToDelete.empty() || (currentFrame < frameCount)){
 		return;
 	}
 
+	// Cached descriptor sets referencing destroyed resources will have to be released.
+	std::unordered_set<uint64_t> destroyedHandles;
+
 	while(!_context.resourcesToDelete.empty()){
 		ResourceToDelete& rsc = _context.resourcesToDelete.front();
 		// If the following resources are too recent, they might still be used by in flight frames.
-		if(rsc.frame >= currentFrame - 2){
+		if(rsc.frame >= currentFrame - frameCount){
 			break;
 		}
 		if(rsc.view != VK_NULL_HANDLE){
+			destroyedHandles.insert(uint64_t(rsc.view));
 			vkDestroyImageView(_context.device, rsc.view, nullptr);
 		}
 		if(rsc.sampler != VK_NULL_HANDLE){
@@ -1812,23 +2346,30 @@ void GPU::processDestructionRequests(){
 			vmaDestroyImage(_allocator, rsc.image, rsc.data);
 		}
 		if(rsc.buffer != VK_NULL_HANDLE){
+			destroyedHandles.insert(uint64_t(rsc.buffer));
 			vmaDestroyBuffer(_allocator, rsc.buffer, rsc.data);
 		}
+		if(rsc.image == VK_NULL_HANDLE && rsc.buffer == VK_NULL_HANDLE && rsc.data != VK_NULL_HANDLE){
+			vmaFreeMemory(_allocator, rsc.data);
+		}
 		_context.resourcesToDelete.pop_front();
 	}
+	_context.descriptorCache.invalidate(destroyedHandles);
 }
 
 void GPU::processAsyncTasks(bool forceAll){
 	const uint64_t currentFrame = _context.frameIndex;
 
-	if(_context.textureTasks.empty() || (!forceAll && (currentFrame < 2))){
+	const uint64_t frameCount = _context.frameCount;
+
+	if(_context.textureTasks.empty() || (!forceAll && (currentFrame < frameCount))){
 		return;
 	}
 
 	while(!_context.textureTasks.empty()){
 		AsyncTextureTask& tsk = _context.textureTasks.front();
 		// If the following requests are too recent, they might not have completed yet.
-		if(!forceAll && (tsk.frame + 2 >= currentFrame)){
+		if(!forceAll && (tsk.frame + frameCount >= currentFrame)){
 			break;
 		}
 
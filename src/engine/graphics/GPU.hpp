@@ -11,6 +11,7 @@
 
 // Forward declarations.
 class Window;
+class GPUMemory;
 struct GPUContext;
 
 /**
@@ -22,9 +23,14 @@ class GPU {
 	friend class GPUTexture; ///< Access to deletion notifier for cached state update.
 	friend class GPUBuffer; ///< Access to deletion notifier for cached state update.
 	friend class GPUMesh; ///< Access to deletion notifier for cached state update.
+	friend class GPUMemory; ///< Access to deletion notifier.
 	friend class Program; ///< Access to metrics.
 	friend class Swapchain; ///< Access to command buffers.
 	friend class PipelineCache; ///< Access to metrics.
+	friend class StagingAllocator; ///< Access to metrics.
+	friend class DescriptorCache; ///< Access to metrics.
+	friend class DrawBatcher; ///< Access to metrics.
+	friend class GPUCuller; ///< Access to metrics.
 
 public:
 
@@ -37,6 +43,11 @@ public:
 		unsigned long long buffers = 0; ///< Buffers created.
 		unsigned long long programs = 0; ///< Programs created.
 		unsigned long long pipelines = 0; ///< Pipelines created.
+		unsigned long long submissions = 0; ///< Frames submitted to the GPU.
+		unsigned long long overlappedFrames = 0; ///< Frames started while the GPU was still processing the previous one.
+		unsigned long long stagingWraps = 0; ///< Number of times the staging ring wrapped around.
+		unsigned long long stagingStalls = 0; ///< Waits on frames in flight to free staging space.
+		unsigned long long stagingOverflows = 0; ///< Uploads that required a dedicated staging buffer.
 
 		// Per-frame statistics.
 		unsigned long long drawCalls = 0; ///< Mesh draw call.
@@ -44,7 +55,15 @@ public:
 		unsigned long long pipelineBindings = 0; ///< Number of pipeline set operations.
 		unsigned long long renderPasses = 0; ///< Number of render passes.
 		unsigned long long meshBindings = 0; ///< Number of mesh bindings.
-		unsigned long long blitCount = 0; ///< Texture blitting operations.
+		unsigned long long blitCount = 0; ///< Texture blitting and copy operations.
+		unsigned long long frameWait = 0; ///< Time spent by the CPU waiting for the GPU to release frame resources, in microseconds.
+		unsigned long long stagedBytes = 0; ///< Bytes copied to staging memory for upload.
+		unsigned long long descriptorHits = 0; ///< Descriptor sets reused from the cache.
+		unsigned long long descriptorMisses = 0; ///< Descriptor sets allocated and written.
+		unsigned long long instances = 0; ///< Instances drawn by instanced draw calls.
+		unsigned long long indirectCommands = 0; ///< Draws read from indirect buffers.
+		unsigned long long batchedObjects = 0; ///< Object draws submitted to draw batches.
+		unsigned long long batches = 0; ///< Draw batches emitted (each replacing one or more object draws).
 
 		/// Reset metrics that are measured over one frame.
 		void resetPerFrameMetrics(){
@@ -54,6 +73,14 @@ public:
 			renderPasses = 0;
 			meshBindings = 0;
 			blitCount = 0;
+			frameWait = 0;
+			stagedBytes = 0;
+			descriptorHits = 0;
+			descriptorMisses = 0;
+			instances = 0;
+			indirectCommands = 0;
+			batchedObjects = 0;
+			batches = 0;
 		}
 	};
 	
@@ -176,8 +203,32 @@ public:
 
 	/** Create a GPU texture with a given layout and allocate it.
 	 \param texture the texture to setup on the GPU
+	 \param memory if non null, a memory block to create the texture in instead of allocating it, possibly shared with other textures
+	 \param offset the offset of the texture in the memory block, in bytes
 	 */
-	static void setupTexture(Texture & texture);
+	static void setupTexture(Texture & texture, const GPUMemory * memory = nullptr, uint64_t offset = 0);
+
+	/** Query the memory needed to store a texture, without allocating it.
+	 \param texture the texture to query (layout, size, shape and drawable flag should be set)
+	 \param size will contain the size in bytes
+	 \param alignment will contain the required alignment in bytes
+	 \param typeBits will contain the bitmask of compatible memory types
+	 */
+	static void getTextureRequirements(const Texture & texture, uint64_t & size, uint64_t & alignment, uint & typeBits);
+
+	/** Allocate a block of GPU memory that textures can be created in.
+	 \param memory the memory block to allocate
+	 \param size the size in bytes
+	 \param alignment the alignment in bytes
+	 \param typeBits the bitmask of allowed memory types
+	 */
+	static void setupMemory(GPUMemory & memory, uint64_t size, uint64_t alignment, uint typeBits);
+
+	/** Discard the content of a texture sharing its memory with other textures, before using it. This waits for all previous GPU work that could access the shared memory.
+	 \param texture the texture to discard
+	 \note Must be called outside of a render pass.
+	 */
+	static void discardTexture(Texture & texture);
 
 	/** Upload a texture images data to the GPU.
 	 \param texture the texture to upload
@@ -231,6 +282,14 @@ public:
 	 */
 	static void clearDepth(const Texture & texture, float depth);
 
+	/** Clear a region of the current depth attachment with a given depth.
+	 \param depth the depth to use
+	 \param offset the top-left corner of the region, in texels
+	 \param size the size of the region, in texels
+	 \warning This should be called while rendering to a depth attachment.
+	 */
+	static void clearDepth(float depth, const glm::uvec2 & offset, const glm::uvec2 & size);
+
 	/** Create and allocate a GPU buffer.
 	 \param buffer the buffer to setup on the GPU
 	 */
@@ -270,12 +329,46 @@ public:
 	 */
 	static void drawMesh(const Mesh & mesh);
 
+	/** Draw subsets of indexed geometry.
+	 \param mesh the mesh to draw
+	 \param ranges the index ranges to draw, each stored as (first index, index count)
+	 \note The mesh is bound once and one draw call is issued per range. Nothing is drawn if the list is empty.
+	 */
+	static void drawMesh(const Mesh & mesh, const std::vector<glm::uvec2> & ranges);
+
 	/** Draw tessellated geometry.
 	 \param mesh the mesh to tessellate and render
 	 \param patchSize number of vertices to use in a patch
 	 */
 	static void drawTesselatedMesh(const Mesh & mesh, uint patchSize);
 
+	/** Draw multiple instances of a mesh in a single draw call. Shaders can use gl_InstanceIndex to fetch per-instance data.
+	 \param mesh the mesh to draw
+	 \param instanceCount the number of instances to draw
+	 \param firstInstance the index of the first instance
+	 */
+	static void drawMeshInstanced(const Mesh & mesh, uint instanceCount, uint firstInstance = 0);
+
+	/** Draw a mesh multiple times, using draw parameters stored in a buffer.
+	 \param mesh the mesh to draw
+	 \param commands the buffer containing the draw commands (see DrawCommand)
+	 \param offset the offset in bytes of the first command in the buffer
+	 \param drawCount the number of commands to execute
+	 \note A non-zero first instance in commands requires device support (see supportsIndirectFirstInstance). Otherwise, commands stored in a CPU-visible buffer are emitted as direct draws.
+	 */
+	static void drawIndirect(const Mesh & mesh, const Buffer & commands, size_t offset, uint drawCount);
+
+	/** Draw a mesh multiple times, using draw parameters and a draw count stored in buffers, for instance written by a compute shader.
+	 \param mesh the mesh to draw
+	 \param commands the buffer containing the draw commands (see DrawCommand)
+	 \param offset the offset in bytes of the first command in the buffer
+	 \param count the buffer containing the number of commands to execute, as an unsigned integer
+	 \param countOffset the offset in bytes of the count in its buffer
+	 \param maxDrawCount the maximum number of commands to execute
+	 \note This requires device support (see supportsDrawIndirectCount).
+	 */
+	static void drawIndirectCount(const Mesh & mesh, const Buffer & commands, size_t offset, const Buffer & count, size_t countOffset, uint maxDrawCount);
+
 	/** Helper used to draw a fullscreen quad for texture processing.
 	 \details Instead of story two-triangles geometry, it uses a single triangle covering the whole screen. For instance:
 	 \verbatim
@@ -303,6 +396,23 @@ public:
 	 */
 	static void dispatch(uint width, uint height, uint depth);
 
+	/** Record the following dispatches on the async compute queue, where they will execute concurrently with the rendering recorded after endAsyncCompute. Textures used are transferred between queues automatically.
+	 \note Only one async compute region is supported per frame, and only dispatches can be recorded in it. If no separate compute queue is available, dispatches are recorded on the graphics queue as usual.
+	 */
+	static void beginAsyncCompute();
+
+	/** Stop recording dispatches on the async compute queue. The following rendering can execute concurrently with async compute work, and shouldn't use its resources.
+	 */
+	static void endAsyncCompute();
+
+	/** The following rendering will wait for the async compute work completion, and can use its results.
+	 \note This is done automatically when the frame is submitted.
+	 */
+	static void waitAsyncCompute();
+
+	/** \return true if compute work can be executed concurrently with rendering on a separate queue */
+	static bool supportsAsyncCompute();
+
 	/** Flush current GPU commands and wait for all processing to be done.
 	 */
 	static void flush();
@@ -311,6 +421,15 @@ public:
 	 */
 	static void nextFrame();
 
+	/** \return the number of frames that can be in flight at the same time
+	 \note Resources written each frame by the CPU should be duplicated this many times.
+	 */
+	static uint framesInFlight();
+
+	/** \return the index of the current frame among the frames in flight
+	 */
+	static uint frameIndex();
+
 	/** Query the GPU driver and API infos.
 	 \param vendor will contain the vendor name
 	 \param renderer will contain the renderer name
@@ -324,6 +443,32 @@ public:
 	 */
 	static std::vector<std::string> supportedExtensions();
 
+	/** Query if block-compressed texture layouts (BC1 to BC7) can be used.
+	 \return true if supported by the device
+	 */
+	static bool supportsBlockCompression();
+
+	/** Query if textures can be accessed by index in shaders, through the global texture table.
+	 \return true if supported by the device
+	 */
+	static bool supportsBindless();
+
+	/** Query if indirect draw commands can specify a non-zero first instance.
+	 \return true if supported by the device
+	 */
+	static bool supportsIndirectFirstInstance();
+
+	/** Query if indirect draws can read their draw count from a buffer, and specify a non-zero first instance.
+	 \return true if supported by the device
+	 */
+	static bool supportsDrawIndirectCount();
+
+	/** Register a 2D texture in the global texture table, for bindless access in shaders. The texture is released from the table when destroyed.
+	 \param texture the texture to register, already uploaded
+	 \return the index of the texture in the table (or the existing index if already registered)
+	 */
+	static uint registerBindlessTexture(const Texture & texture);
+
 	/** Set the current viewport.
 	 \param x horizontal coordinate
 	 \param y vertical coordinate
@@ -445,6 +590,17 @@ public:
 	 */
 	static void blit(const Texture & src, const Texture & dst, size_t lSrc, size_t lDst, size_t mipSrc, size_t mipDst, Filter filter);
 
+	/** Copy a region of a texture layer into the same region of another one, without filtering.
+	 \param src the source texture
+	 \param dst the destination texture
+	 \param lSrc the src layer to copy
+	 \param lDst the dst layer to copy to
+	 \param offset the top-left corner of the region, in texels
+	 \param size the size of the region, in texels
+	 \note Both textures should have compatible formats. Prefer this to blitting for depth textures, as blitting them is not always supported.
+	 */
+	static void copy(const Texture & src, const Texture & dst, size_t lSrc, size_t lDst, const glm::uvec2 & offset, const glm::uvec2 & size);
+
 	/** \return the opaque internal GPU context. */
 	static GPUContext* getInternal();
 
@@ -479,11 +635,28 @@ private:
 	/** Begin render and upload command buffers for this frame */
 	static void beginFrameCommandBuffers();
 
-	/** End and submit upload and render command buffers for this frame, guaranteeing sequential execution.
-	 \note This will wait for all queue work to be complete before returning.
+	/** Begin the command buffer of the current async compute step of the frame. */
+	static void beginAsyncCommandBuffer();
+
+	/** Transfer the textures used by the current compute program to the async compute queue, if they haven't been already during this frame.
+	 \param program the compute program
+	 */
+	static void acquireAsyncTextures(const Program & program);
+
+	/** Complete any async compute step started during the frame, before submission. */
+	static void completeAsyncCompute();
+
+	/** Make writes of previous dispatches visible to graphics and transfer operations, and restore the textures they used to their default layout. */
+	static void restoreComputeResourcesIfNeeded();
+
+	/** End and submit upload and render command buffers for this frame. Rendering waits on a semaphore signaled by the uploads, and the frame fence is signaled once both are complete.
+	 \note This does not wait for the GPU, see waitForFrameResources.
 	 */
 	static void submitFrameCommandBuffers();
 
+	/** Wait until the GPU has completed the last frame that used the current frame resources (command buffers, fence, semaphores), and update synchronization metrics. */
+	static void waitForFrameResources();
+
 	/** Clean a texture GPU object. 
 	 * \param tex the object to delete
 	 */
@@ -499,6 +672,11 @@ private:
 	 */
 	static void clean(GPUBuffer & buffer);
 
+	/** Clean a memory block.
+	 * \param memory the object to delete
+	 */
+	static void clean(GPUMemory & memory);
+
 	/** Clean a shader program object. 
 	 * \param program the object to delete
 	 */
@@ -133,6 +133,33 @@ bool VkUtils::getQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface, in
 	return false;
 }
 
+bool VkUtils::getAsyncComputeQueue(VkPhysicalDevice device, int graphicsFamily, int & computeFamily, uint & computeIndex){
+	computeFamily = -1;
+	computeIndex = 0;
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+	// Prefer a family dedicated to compute, usually mapped to separate hardware queues.
+	for(uint32_t i = 0; i < queueFamilyCount; ++i){
+		const VkQueueFamilyProperties& queueFamily = queueFamilies[i];
+		if(queueFamily.queueCount == 0){
+			continue;
+		}
+		if((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)){
+			computeFamily = int(i);
+			return true;
+		}
+	}
+	// Else use a second queue of the graphics family.
+	if(graphicsFamily >= 0 && queueFamilies[graphicsFamily].queueCount > 1){
+		computeFamily = graphicsFamily;
+		computeIndex = 1;
+		return true;
+	}
+	return false;
+}
+
 VKAPI_ATTR VkBool32 VKAPI_CALL vkDebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData){
 	(void)userData;
 
@@ -217,7 +244,16 @@ Layout VkUtils::convertFormat(const VkFormat& format){
 		{ VK_FORMAT_R16G16B16A16_SINT, Layout::RGBA16I },
 		{ VK_FORMAT_R16G16B16A16_UINT, Layout::RGBA16UI },
 		{ VK_FORMAT_R32G32B32A32_SINT, Layout::RGBA32I },
-		{ VK_FORMAT_R32G32B32A32_UINT, Layout::RGBA32UI }
+		{ VK_FORMAT_R32G32B32A32_UINT, Layout::RGBA32UI },
+		{ VK_FORMAT_BC1_RGBA_UNORM_BLOCK, Layout::BC1 },
+		{ VK_FORMAT_BC1_RGBA_SRGB_BLOCK, Layout::BC1_SRGB },
+		{ VK_FORMAT_BC3_UNORM_BLOCK, Layout::BC3 },
+		{ VK_FORMAT_BC3_SRGB_BLOCK, Layout::BC3_SRGB },
+		{ VK_FORMAT_BC4_UNORM_BLOCK, Layout::BC4 },
+		{ VK_FORMAT_BC5_UNORM_BLOCK, Layout::BC5 },
+		{ VK_FORMAT_BC6H_UFLOAT_BLOCK, Layout::BC6H },
+		{ VK_FORMAT_BC7_UNORM_BLOCK, Layout::BC7 },
+		{ VK_FORMAT_BC7_SRGB_BLOCK, Layout::BC7_SRGB }
 	};
 
 	return formatInfos.at(format);
@@ -266,6 +302,48 @@ void VkUtils::typesFromShape(const TextureShape & shape, VkImageType & imgType,
 	viewType = viewTypes.at(shape);
 }
 
+VkImageCreateInfo VkUtils::imageInfoFromTexture(const GPUContext & context, const Texture & texture, const GPUTexture & gpu){
+	const bool is3D = texture.shape & TextureShape::D3;
+	const bool isCube = texture.shape & TextureShape::Cube;
+	const bool isArray = texture.shape & TextureShape::Array;
+	const bool isDepth = gpu.aspect & VK_IMAGE_ASPECT_DEPTH_BIT;
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	if(texture.drawable){
+		usage |= isDepth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	}
+	// Check feature support for compute access
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(context.physicalDevice, gpu.format, &formatProperties);
+	if((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0) {
+		usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+	}
+
+	VkImageType imgType;
+	VkImageViewType viewType;
+	VkUtils::typesFromShape(texture.shape, imgType, viewType);
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = imgType;
+	imageInfo.extent.width = static_cast<uint32_t>(texture.width);
+	imageInfo.extent.height = static_cast<uint32_t>(texture.height);
+	imageInfo.extent.depth = is3D ? texture.depth : 1;
+	imageInfo.mipLevels = texture.levels;
+	imageInfo.arrayLayers = (isCube || isArray) ? texture.depth : 1;
+	imageInfo.format = gpu.format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.flags = 0;
+	if(isCube){
+		imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+	}
+	return imageInfo;
+}
+
 VkCommandBuffer VkUtils::beginSyncOperations(GPUContext & context){
 	// Create short-lived command buffer.
 	VkCommandBufferAllocateInfo allocInfo = {};
@@ -333,7 +411,7 @@ void VkUtils::imageLayoutBarrier(VkCommandBuffer& commandBuffer, GPUTexture& tex
 		{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, { VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT } },
 		{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL , {  (VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT } },
 		{ VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, { (VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT), VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT } },
-		{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, { VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT /*| VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT*/, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT  | VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT /*| VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT*/  } },
+		{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, { VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT  | VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT  } },
 		{ VK_IMAGE_LAYOUT_GENERAL, { VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT } },
 		{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, { 0,  VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT } },
 	};
@@ -398,6 +476,15 @@ void VkUtils::imageLayoutBarrier(VkCommandBuffer& commandBuffer, GPUTexture& tex
 		return;
 	}
 
+	// The async compute queue doesn't support graphics stages.
+	if(GPU::getInternal()->asyncStep == GPUContext::AsyncStep::COMPUTE){
+		const VkPipelineStageFlags computeStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		srcStage &= computeStages;
+		dstStage &= computeStages;
+		srcStage = srcStage != 0 ? srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		dstStage = dstStage != 0 ? dstStage : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	}
+
 	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, uint32_t(barriers.size()), barriers.data());
 
 }
@@ -416,6 +503,44 @@ void VkUtils::textureLayoutBarrier(VkCommandBuffer& commandBuffer, const Texture
 	VkUtils::imageLayoutBarrier(commandBuffer, *texture.gpu, newLayout, 0, texture.levels, 0, layers);
 }
 
+void VkUtils::queueOwnershipBarrier(VkCommandBuffer& commandBuffer, const GPUTexture& texture, uint32_t srcFamily, uint32_t dstFamily, bool release){
+	// Layouts are preserved, each subresource is transferred in its current layout.
+	std::vector<VkImageMemoryBarrier> barriers;
+	const uint mipCount = uint(texture.layouts.size());
+	for(uint mid = 0; mid < mipCount; ++mid){
+		const uint layerCount = uint(texture.layouts[mid].size());
+		for(uint lid = 0; lid < layerCount; ++lid){
+			const VkImageLayout layout = texture.layouts[mid][lid];
+			if(layout == VK_IMAGE_LAYOUT_UNDEFINED){
+				// No content to preserve.
+				continue;
+			}
+			barriers.emplace_back();
+			VkImageMemoryBarrier& barrier = barriers.back();
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = layout;
+			barrier.newLayout = layout;
+			barrier.srcQueueFamilyIndex = srcFamily;
+			barrier.dstQueueFamilyIndex = dstFamily;
+			barrier.image = texture.image;
+			barrier.subresourceRange.baseMipLevel = mid;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = lid;
+			barrier.subresourceRange.layerCount = 1;
+			barrier.subresourceRange.aspectMask = texture.aspect;
+			// Access masks are ignored on the other side of the transfer.
+			barrier.srcAccessMask = release ? VK_ACCESS_MEMORY_WRITE_BIT : 0;
+			barrier.dstAccessMask = release ? 0 : (VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+		}
+	}
+	if(barriers.empty()){
+		return;
+	}
+	const VkPipelineStageFlags srcStage = release ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	const VkPipelineStageFlags dstStage = release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, uint32_t(barriers.size()), barriers.data());
+}
+
 void VkUtils::createCommandBuffers(GPUContext & context, uint count){
 	// See if we can move their creation and deletion outside of the swapchain
 	context.renderCommandBuffers.resize(count);
@@ -446,6 +571,141 @@ void VkUtils::createCommandBuffers(GPUContext & context, uint count){
 	for(uint i = 0; i < count; ++i){
 		VkUtils::setDebugName(context, VK_OBJECT_TYPE_COMMAND_BUFFER, uint64_t(context.uploadCommandBuffers[i]), "Upload %u", i);
 	}
+
+	if(!context.asyncCompute){
+		return;
+	}
+	// Frames using async compute are split in three parts on the graphics queue, and one on the compute queue.
+	context.computeCommandBuffers.resize(count);
+	context.overlapCommandBuffers.resize(count);
+	context.resumeCommandBuffers.resize(count);
+	VkCommandBufferAllocateInfo allocInfo3 = {};
+	allocInfo3.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo3.commandPool = context.computeCommandPool;
+	allocInfo3.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo3.commandBufferCount = static_cast<uint32_t>(count);
+	if(vkAllocateCommandBuffers(context.device, &allocInfo3, context.computeCommandBuffers.data()) != VK_SUCCESS) {
+		Log::Error() << Log::GPU  << "Unable to create command buffers." << std::endl;
+		return;
+	}
+	if(vkAllocateCommandBuffers(context.device, &allocInfo2, context.overlapCommandBuffers.data()) != VK_SUCCESS) {
+		Log::Error() << Log::GPU  << "Unable to create command buffers." << std::endl;
+		return;
+	}
+	if(vkAllocateCommandBuffers(context.device, &allocInfo2, context.resumeCommandBuffers.data()) != VK_SUCCESS) {
+		Log::Error() << Log::GPU  << "Unable to create command buffers." << std::endl;
+		return;
+	}
+	for(uint i = 0; i < count; ++i){
+		VkUtils::setDebugName(context, VK_OBJECT_TYPE_COMMAND_BUFFER, uint64_t(context.computeCommandBuffers[i]), "Compute %u", i);
+		VkUtils::setDebugName(context, VK_OBJECT_TYPE_COMMAND_BUFFER, uint64_t(context.overlapCommandBuffers[i]), "Overlap %u", i);
+		VkUtils::setDebugName(context, VK_OBJECT_TYPE_COMMAND_BUFFER, uint64_t(context.resumeCommandBuffers[i]), "Resume %u", i);
+	}
+}
+
+void VkUtils::submitFrameCommandBuffers(GPUContext & context, VkSemaphore imageAvailable, VkSemaphore frameFinished){
+	// The render command buffer of the frame, regardless of the async compute step.
+	VkCommandBuffer& commandBuffer = context.renderCommandBuffers[context.swapIndex];
+	VkCommandBuffer& commandBufferUpload = context.getUploadCommandBuffer();
+	VK_RET(vkEndCommandBuffer(commandBuffer));
+	VK_RET(vkEndCommandBuffer(commandBufferUpload));
+
+	VkSemaphore& uploadSemaphore = context.uploadSemaphores[context.swapIndex];
+
+	// The fence guards the reuse of this frame command buffers and semaphores.
+	VkFence& fence = context.getFrameFence();
+	if(context.validateSync && (vkGetFenceStatus(context.device, fence) != VK_SUCCESS)){
+		Log::Error() << Log::GPU << "Frame " << context.frameIndex << " is submitted while resources of frame " << (context.frameIndex - context.frameCount) << " are still in use." << std::endl;
+	}
+	VK_RET(vkResetFences(context.device, 1, &fence));
+
+	VkSubmitInfo submitInfos[2] = {};
+	// Start with the uploads, signaling a semaphore once complete.
+	submitInfos[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfos[0].commandBufferCount = 1;
+	submitInfos[0].pCommandBuffers = &commandBufferUpload;
+	submitInfos[0].signalSemaphoreCount = 1;
+	submitInfos[0].pSignalSemaphores = &uploadSemaphore;
+
+	if(context.asyncStep == GPUContext::AsyncStep::NONE){
+		// Then the rendering, as it might use uploaded data (including layout transitions of uploaded images).
+		// If presenting, also wait for the backbuffer to be available.
+		const VkSemaphore waitSemaphores[] = { uploadSemaphore, imageAvailable };
+		const VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+		submitInfos[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfos[1].waitSemaphoreCount = imageAvailable != VK_NULL_HANDLE ? 2 : 1;
+		submitInfos[1].pWaitSemaphores = waitSemaphores;
+		submitInfos[1].pWaitDstStageMask = waitStages;
+		submitInfos[1].commandBufferCount = 1;
+		submitInfos[1].pCommandBuffers = &commandBuffer;
+		submitInfos[1].signalSemaphoreCount = frameFinished != VK_NULL_HANDLE ? 1 : 0;
+		submitInfos[1].pSignalSemaphores = &frameFinished;
+
+		VK_RET(vkQueueSubmit(context.graphicsQueue, 2, submitInfos, fence));
+		// Staging space used up to now will be released once the fence is signaled.
+		context.stagingAllocator.endFrame();
+		return;
+	}
+
+	// The frame has been split around async compute work.
+	assert(context.asyncStep == GPUContext::AsyncStep::RESUME);
+	VkCommandBuffer& commandBufferCompute = context.computeCommandBuffers[context.swapIndex];
+	VkCommandBuffer& commandBufferOverlap = context.overlapCommandBuffers[context.swapIndex];
+	VkCommandBuffer& commandBufferResume = context.resumeCommandBuffers[context.swapIndex];
+	VK_RET(vkEndCommandBuffer(commandBufferCompute));
+	VK_RET(vkEndCommandBuffer(commandBufferOverlap));
+	VK_RET(vkEndCommandBuffer(commandBufferResume));
+	VkSemaphore& computeStartSemaphore = context.computeStartSemaphores[context.swapIndex];
+	VkSemaphore& computeEndSemaphore = context.computeEndSemaphores[context.swapIndex];
+
+	// Rendering preceding async compute, signaling its start.
+	const VkSemaphore waitSemaphores[] = { uploadSemaphore, imageAvailable };
+	const VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+	submitInfos[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfos[1].waitSemaphoreCount = imageAvailable != VK_NULL_HANDLE ? 2 : 1;
+	submitInfos[1].pWaitSemaphores = waitSemaphores;
+	submitInfos[1].pWaitDstStageMask = waitStages;
+	submitInfos[1].commandBufferCount = 1;
+	submitInfos[1].pCommandBuffers = &commandBuffer;
+	submitInfos[1].signalSemaphoreCount = 1;
+	submitInfos[1].pSignalSemaphores = &computeStartSemaphore;
+	VK_RET(vkQueueSubmit(context.graphicsQueue, 2, submitInfos, VK_NULL_HANDLE));
+
+	// Async compute.
+	const VkPipelineStageFlags computeStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	VkSubmitInfo computeInfo = {};
+	computeInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	computeInfo.waitSemaphoreCount = 1;
+	computeInfo.pWaitSemaphores = &computeStartSemaphore;
+	computeInfo.pWaitDstStageMask = &computeStage;
+	computeInfo.commandBufferCount = 1;
+	computeInfo.pCommandBuffers = &commandBufferCompute;
+	computeInfo.signalSemaphoreCount = 1;
+	computeInfo.pSignalSemaphores = &computeEndSemaphore;
+	VK_RET(vkQueueSubmit(context.computeQueue, 1, &computeInfo, VK_NULL_HANDLE));
+
+	// Rendering executing concurrently, then rendering waiting for async compute completion.
+	VkSubmitInfo resumeInfos[2] = {};
+	resumeInfos[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	resumeInfos[0].commandBufferCount = 1;
+	resumeInfos[0].pCommandBuffers = &commandBufferOverlap;
+
+	const VkPipelineStageFlags resumeStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	resumeInfos[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	resumeInfos[1].waitSemaphoreCount = 1;
+	resumeInfos[1].pWaitSemaphores = &computeEndSemaphore;
+	resumeInfos[1].pWaitDstStageMask = &resumeStage;
+	resumeInfos[1].commandBufferCount = 1;
+	resumeInfos[1].pCommandBuffers = &commandBufferResume;
+	resumeInfos[1].signalSemaphoreCount = frameFinished != VK_NULL_HANDLE ? 1 : 0;
+	resumeInfos[1].pSignalSemaphores = &frameFinished;
+	// The resume command buffer completion implies the completion of all previous work of the frame, on both queues.
+	VK_RET(vkQueueSubmit(context.graphicsQueue, 2, resumeInfos, fence));
+
+	context.asyncStep = GPUContext::AsyncStep::NONE;
+	context.asyncTextures.clear();
+	// Staging space used up to now will be released once the fence is signaled.
+	context.stagingAllocator.endFrame();
 }
 
 
@@ -575,7 +835,16 @@ unsigned int VkUtils::getGPULayout(Layout typedFormat, VkFormat & format) {
 		{Layout::RGBA16I, { VK_FORMAT_R16G16B16A16_SINT, 4 }},
 		{Layout::RGBA16UI, { VK_FORMAT_R16G16B16A16_UINT, 4 }},
 		{Layout::RGBA32I, { VK_FORMAT_R32G32B32A32_SINT, 4 }},
-		{Layout::RGBA32UI, { VK_FORMAT_R32G32B32A32_UINT, 4 }}
+		{Layout::RGBA32UI, { VK_FORMAT_R32G32B32A32_UINT, 4 }},
+		{Layout::BC1, { VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 4 }},
+		{Layout::BC1_SRGB, { VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 4 }},
+		{Layout::BC3, { VK_FORMAT_BC3_UNORM_BLOCK, 4 }},
+		{Layout::BC3_SRGB, { VK_FORMAT_BC3_SRGB_BLOCK, 4 }},
+		{Layout::BC4, { VK_FORMAT_BC4_UNORM_BLOCK, 1 }},
+		{Layout::BC5, { VK_FORMAT_BC5_UNORM_BLOCK, 2 }},
+		{Layout::BC6H, { VK_FORMAT_BC6H_UFLOAT_BLOCK, 4 }},
+		{Layout::BC7, { VK_FORMAT_BC7_UNORM_BLOCK, 4 }},
+		{Layout::BC7_SRGB, { VK_FORMAT_BC7_SRGB_BLOCK, 4 }}
 	};
 
 	if(formatInfos.count(typedFormat) > 0) {
@@ -717,6 +986,40 @@ void VkUtils::blitTexture(VkCommandBuffer& commandBuffer, const Texture& src, co
 	VkUtils::imageLayoutBarrier(commandBuffer, *dst.gpu, dst.gpu->defaultLayout, mipStartDst, mipEffectiveCount, layerStartDst, layerEffectiveCount);
 }
 
+void VkUtils::copyTexture(VkCommandBuffer& commandBuffer, const Texture& src, const Texture& dst, uint mipSrc, uint mipDst, uint layerStartSrc, uint layerStartDst, uint layerCount, const glm::uvec2& srcOffset, const glm::uvec2& dstOffset, const glm::uvec2& size){
+
+	const uint srcLayers = src.shape != TextureShape::D3 ? src.depth : 1;
+	const uint dstLayers = dst.shape != TextureShape::D3 ? dst.depth : 1;
+	const uint layerEffectiveCount = std::min(std::min(srcLayers - layerStartSrc, dstLayers - layerStartDst), layerCount);
+
+	// Clamp the region to both textures.
+	const glm::uvec2 srcSize(std::max(src.width >> mipSrc, uint(1)), std::max(src.height >> mipSrc, uint(1)));
+	const glm::uvec2 dstSize(std::max(dst.width >> mipDst, uint(1)), std::max(dst.height >> mipDst, uint(1)));
+	const glm::uvec2 effectiveSize = glm::min(size, glm::min(srcSize - srcOffset, dstSize - dstOffset));
+	const uint depth = src.shape == TextureShape::D3 ? std::max(std::min(src.depth >> mipSrc, dst.depth >> mipDst), uint(1)) : 1;
+
+	VkUtils::imageLayoutBarrier(commandBuffer, *src.gpu, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mipSrc, 1, layerStartSrc, layerEffectiveCount);
+	VkUtils::imageLayoutBarrier(commandBuffer, *dst.gpu, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipDst, 1, layerStartDst, layerEffectiveCount);
+
+	VkImageCopy region = {};
+	region.srcOffset = { int32_t(srcOffset[0]), int32_t(srcOffset[1]), 0};
+	region.dstOffset = { int32_t(dstOffset[0]), int32_t(dstOffset[1]), 0};
+	region.extent = { effectiveSize[0], effectiveSize[1], depth};
+	region.srcSubresource.aspectMask = src.gpu->aspect;
+	region.dstSubresource.aspectMask = dst.gpu->aspect;
+	region.srcSubresource.mipLevel = uint32_t(mipSrc);
+	region.dstSubresource.mipLevel = uint32_t(mipDst);
+	region.srcSubresource.baseArrayLayer = uint32_t(layerStartSrc);
+	region.dstSubresource.baseArrayLayer = uint32_t(layerStartDst);
+	region.srcSubresource.layerCount = layerEffectiveCount;
+	region.dstSubresource.layerCount = layerEffectiveCount;
+
+	vkCmdCopyImage(commandBuffer, src.gpu->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst.gpu->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	VkUtils::imageLayoutBarrier(commandBuffer, *src.gpu, src.gpu->defaultLayout, mipSrc, 1, layerStartSrc, layerEffectiveCount);
+	VkUtils::imageLayoutBarrier(commandBuffer, *dst.gpu, dst.gpu->defaultLayout, mipDst, 1, layerStartDst, layerEffectiveCount);
+}
+
 
 void VkUtils::setDebugName(GPUContext& context, VkObjectType type, uint64_t handle, const char* format, ...){
 	if(!context.markersEnabled)
@@ -3,9 +3,12 @@
 #include "Common.hpp"
 #include "graphics/GPUObjects.hpp"
 #include "graphics/DescriptorAllocator.hpp"
+#include "graphics/DescriptorCache.hpp"
 #include "graphics/QueryAllocator.hpp"
 #include "graphics/PipelineCache.hpp"
 #include "graphics/SamplerLibrary.hpp"
+#include "graphics/StagingAllocator.hpp"
+#include "graphics/TextureTable.hpp"
 #include "resources/Buffer.hpp"
 
 #include <deque>
@@ -71,6 +74,14 @@ struct AsyncTextureTask {
  */
 struct GPUContext {
 
+	/// Recording step of the current frame, when using the async compute queue.
+	enum class AsyncStep : uint {
+		NONE, ///< No async compute work this frame, everything is recorded in the render command buffer.
+		COMPUTE, ///< Dispatches are recorded in the compute command buffer.
+		OVERLAP, ///< Rendering recorded in the overlap command buffer, executing concurrently with async compute.
+		RESUME ///< Rendering recorded in the resume command buffer, executing after async compute completion.
+	};
+
 	VkInstance instance = VK_NULL_HANDLE; ///< Native instance handle.
 	VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE; ///< Native debug extension handle.
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE; ///< Native physical device handle.
@@ -79,12 +90,24 @@ struct GPUContext {
 	VkCommandPool commandPool = VK_NULL_HANDLE; ///< Command pool for all frames.
 	std::vector<VkCommandBuffer> renderCommandBuffers; ///< Per-frame command buffers.
 	std::vector<VkCommandBuffer> uploadCommandBuffers; ///< Per-frame command buffers.
+	std::vector<VkFence> frameFences; ///< Per-frame fences signaled when all frame commands are complete.
+	std::vector<VkSemaphore> uploadSemaphores; ///< Per-frame semaphores signaled when uploads are complete, waited on by rendering.
+	VkCommandPool computeCommandPool = VK_NULL_HANDLE; ///< Command pool for the async compute queue (can be the main command pool).
+	std::vector<VkCommandBuffer> computeCommandBuffers; ///< Per-frame command buffers for async compute.
+	std::vector<VkCommandBuffer> overlapCommandBuffers; ///< Per-frame command buffers for rendering concurrently with async compute.
+	std::vector<VkCommandBuffer> resumeCommandBuffers; ///< Per-frame command buffers for rendering after async compute completion.
+	std::vector<VkSemaphore> computeStartSemaphores; ///< Per-frame semaphores signaled when rendering preceding async compute is complete.
+	std::vector<VkSemaphore> computeEndSemaphores; ///< Per-frame semaphores signaled when async compute is complete.
 	VkQueue graphicsQueue= VK_NULL_HANDLE; ///< Graphics submission queue.
 	VkQueue presentQueue= VK_NULL_HANDLE; ///< Presentation submission queue.
+	VkQueue computeQueue= VK_NULL_HANDLE; ///< Async compute submission queue.
 	DescriptorAllocator descriptorAllocator; ///< Descriptor sets common allocator.
+	DescriptorCache descriptorCache; ///< Descriptor sets reused based on their bindings.
 	std::unordered_map<GPUQuery::Type, QueryAllocator> queryAllocators; ///< Per-type query buffered allocators.
 	PipelineCache pipelineCache; ///< Pipeline cache and creation.
 	SamplerLibrary samplerLibrary; ///< List of static samplers shared by all programs.
+	StagingAllocator stagingAllocator; ///< Ring allocator for upload staging memory.
+	TextureTable textureTable; ///< Global table of textures for bindless access.
 	
 	std::deque<ResourceToDelete> resourcesToDelete; ///< List of resources waiting for deletion.
 	std::deque<AsyncTextureTask> textureTasks; ///< List of async tasks waiting for completion.
@@ -95,6 +118,7 @@ struct GPUContext {
 
 	uint32_t graphicsId = 0; ///< Graphics queue index.
 	uint32_t presentId = 0; ///< Present queue index.
+	uint32_t computeId = 0; ///< Async compute queue index.
 
 	uint64_t frameIndex = 0; ///< Current frame index.
 	uint32_t swapIndex = 0; ///< Current buffered frame (in 0, frameCount-1).
@@ -102,11 +126,22 @@ struct GPUContext {
 	double timestep = 0.0; ///< Query timing timestep.
 	size_t uniformAlignment = 0; ///< Minimal buffer alignment.
 	bool portability = false; ///< If the portability extension is present, we have to enable it.
-	const uint frameCount = 2; ///< Number of buffered frames (should be lower or equal to the swapchain image count).
+	bool blockCompression = false; ///< Are block-compressed texture formats supported.
+	bool bindless = false; ///< Are descriptor indexing features available for the global texture table.
+	bool multiDrawIndirect = false; ///< Can multiple indirect draws be issued in one call.
+	bool indirectFirstInstance = false; ///< Can indirect draws specify their first instance.
+	bool drawIndirectCount = false; ///< Can indirect draws read their draw count from a buffer.
+	uint frameCount = 2; ///< Number of buffered frames (should be lower or equal to the swapchain image count).
 	bool newRenderPass = true; ///< Has a render pass just started (pipeline needs to be re-bound).
 	bool hadRenderPass = false; ///< Has a render pass just ended.
 	bool inRenderPass = false; ///< Is a rendering pass currently active.
 	bool markersEnabled = false; ///< Are debug markers and labels enabled.
+	bool validateSync = false; ///< Check frame fences before reusing per-frame resources, and log CPU/GPU overlap.
+	bool asyncCompute = false; ///< Is a compute queue distinct from the graphics queue available.
+	AsyncStep asyncStep = AsyncStep::NONE; ///< Current async compute recording step.
+	std::vector<GPUTexture*> asyncTextures; ///< Textures used by async compute during the current frame.
+	std::vector<GPUTexture*> computeTextures; ///< Textures used by dispatches that haven't been restored to their default layout yet.
+	bool computeBarrier = false; ///< Should compute writes be made visible to graphics stages before the next rendering.
 
 	/// Move to the next frame.
 	void nextFrame(){
@@ -114,8 +149,18 @@ struct GPUContext {
 		swapIndex = (uint32_t)(frameIndex % (uint64_t)frameCount);
 	}
 
-	/// \return the command buffer for the current frame.
+	/// \return the command buffer for the current frame and recording step.
 	VkCommandBuffer& getRenderCommandBuffer(){
+		switch(asyncStep){
+			case AsyncStep::COMPUTE:
+				return computeCommandBuffers[swapIndex];
+			case AsyncStep::OVERLAP:
+				return overlapCommandBuffers[swapIndex];
+			case AsyncStep::RESUME:
+				return resumeCommandBuffers[swapIndex];
+			default:
+				break;
+		}
 		return renderCommandBuffers[swapIndex];
 	}
 
@@ -124,6 +169,11 @@ struct GPUContext {
 		return uploadCommandBuffers[swapIndex];
 	}
 
+	/// \return the fence for the current frame.
+	VkFence& getFrameFence(){
+		return frameFences[swapIndex];
+	}
+
 };
 
 /** Callback for validation errors and warnings.
@@ -177,6 +227,15 @@ namespace VkUtils {
 	 */
 	bool getQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface, int & graphicsFamily, int & presentFamily);
 
+	/** Query a queue that can execute compute work concurrently with the graphics queue. A family dedicated to compute is preferred, otherwise a second queue from the graphics family is used.
+	 * \param device the physical device handle
+	 * \param graphicsFamily the graphics queue family index
+	 * \param computeFamily will contain the compute queue family index
+	 * \param computeIndex will contain the index of the queue in its family
+	 * \return true if such a queue is available
+	 */
+	bool getAsyncComputeQueue(VkPhysicalDevice device, int graphicsFamily, int & computeFamily, uint & computeIndex);
+
 	/** Convert Vulkan format to Rendu format
 	 * \param format Vulkan format
 	 * \return the Rendu format
@@ -199,6 +258,14 @@ namespace VkUtils {
 	 */
 	void typesFromShape(const TextureShape & shape, VkImageType & imgType, VkImageViewType & viewType);
 
+	/** Generate the image creation parameters for a texture.
+	 * \param context the GPU internal context
+	 * \param texture the texture to create (shape, size, layout, drawable)
+	 * \param gpu the texture GPU data (format and aspect)
+	 * \return the image creation info
+	 */
+	VkImageCreateInfo imageInfoFromTexture(const GPUContext & context, const Texture & texture, const GPUTexture & gpu);
+
 	/** Start a one-shot command buffer.
 	* \param context the GPU internal context
 	* \return the newly created command buffer
@@ -237,12 +304,30 @@ namespace VkUtils {
 	 */
 	void textureLayoutBarrier(VkCommandBuffer& commandBuffer, const Texture& texture, VkImageLayout newLayout);
 
+	/** Transfer the ownership of a texture between two queue families, preserving its current layouts. Both the release and the acquire barriers have to be recorded, on the source and destination queues respectively.
+	 * \param commandBuffer the command buffer to record the operation on
+	 * \param texture the texture to transfer
+	 * \param srcFamily the queue family releasing the texture
+	 * \param dstFamily the queue family acquiring the texture
+	 * \param release is this the release or the acquire barrier
+	 */
+	void queueOwnershipBarrier(VkCommandBuffer& commandBuffer, const GPUTexture& texture, uint32_t srcFamily, uint32_t dstFamily, bool release);
+
 	/** Create per-frame command buffers on the context.
 	 * \param context the GPU internal context
 	 * \param count number of command buffers to create
 	 */
 	void createCommandBuffers(GPUContext & context, uint count);
 
+	/** End and submit the current frame upload and render command buffers on the graphics queue.
+	 * Rendering waits on a semaphore signaled by the uploads, and the frame fence is signaled when both are complete.
+	 * If async compute was used, the compute command buffer is submitted on the compute queue after the render command buffer, and the resume command buffer waits for its completion.
+	 * \param context the GPU internal context
+	 * \param imageAvailable optional semaphore to wait on before rendering
+	 * \param frameFinished optional semaphore to signal once rendering is complete
+	 */
+	void submitFrameCommandBuffers(GPUContext & context, VkSemaphore imageAvailable, VkSemaphore frameFinished);
+
 	/** Log a Vulkan return code as a human-readable string.
 	 * \param status the status to check
 	 */
@@ -302,6 +387,22 @@ namespace VkUtils {
 	 */
 	void blitTexture(VkCommandBuffer& commandBuffer, const Texture& src, const Texture& dst, uint mipStartSrc, uint mipStartDst, uint mipCount, uint layerStartSrc, uint layerStartDst, uint layerCount, const glm::uvec2& srcBaseOffset, const glm::uvec2& srcBaseSize, const glm::uvec2& dstBaseOffset, const glm::uvec2& dstBaseSize, Filter filter);
 
+	/** Copy a texture region to a region of the same size in another texture, without filtering or format conversion.
+	 * \param commandBuffer the command buffer to record the operation on
+	 * \param src the source texture
+	 * \param dst the destination texture
+	 * \param mipSrc the mip to copy from
+	 * \param mipDst the mip to copy to
+	 * \param layerStartSrc first layer to copy from
+	 * \param layerStartDst first layer to copy to
+	 * \param layerCount number of layers to copy
+	 * \param srcOffset top-left corner pixel coordinates of the region to copy from
+	 * \param dstOffset top-left corner pixel coordinates of the region to copy to
+	 * \param size pixel dimensions of the region to copy
+	 * \note Both textures should have compatible formats. Unlike blitting, copying depth formats is always supported.
+	 */
+	void copyTexture(VkCommandBuffer& commandBuffer, const Texture& src, const Texture& dst, uint mipSrc, uint mipDst, uint layerStartSrc, uint layerStartDst, uint layerCount, const glm::uvec2& srcOffset, const glm::uvec2& dstOffset, const glm::uvec2& size);
+
 	/**
 	 Associate a debug name to a Vulkan object for validation layers and captures.
 	 \param context the GPU context
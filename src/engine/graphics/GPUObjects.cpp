@@ -29,17 +29,23 @@ unsigned int GPUTexture::getChannelsCount(const Layout& format){
 }
 
 bool GPUTexture::isSRGB(const Layout& format){
-	return format == Layout::SRGB8_ALPHA8 || format == Layout::SBGR8_ALPHA8;
+	return format == Layout::SRGB8_ALPHA8 || format == Layout::SBGR8_ALPHA8 || format == Layout::BC1_SRGB || format == Layout::BC3_SRGB || format == Layout::BC7_SRGB;
 }
 
 GPUBuffer::GPUBuffer(BufferType atype){
-	mappable = (atype == BufferType::UNIFORM || atype == BufferType::CPUTOGPU || atype == BufferType::GPUTOCPU);
+	mappable = (atype == BufferType::UNIFORM || atype == BufferType::CPUTOGPU || atype == BufferType::GPUTOCPU || atype == BufferType::INDIRECT);
 }
 
 void GPUBuffer::clean(){
 	GPU::clean(*this);
 }
 
+void GPUMemory::clean(){
+	if(data != VK_NULL_HANDLE){
+		GPU::clean(*this);
+	}
+}
+
 void GPUMesh::clean() {
 	if(vertexBuffer){
 		vertexBuffer->clean();
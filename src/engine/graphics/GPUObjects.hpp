@@ -75,6 +75,7 @@ public:
 	VkImageLayout defaultLayout; ///< Default layout to restore to in some cases.
 
 	bool owned = true; ///< Do we own our Vulkan data (not the case for swapchain images).
+	uint bindlessSlot = 0xFFFFFFFF; ///< Slot in the global texture table, if registered.
 
 };
 
@@ -118,6 +119,40 @@ public:
 };
 
 
+/**
+ \brief Store a block of GPU memory, that several textures can be created in.
+ \ingroup Graphics
+ */
+class GPUMemory {
+public:
+
+	/** Constructor. */
+	GPUMemory() = default;
+
+	/** Release the memory block. */
+	void clean();
+
+	/** Copy assignment operator (disabled).
+	 \return a reference to the object assigned to
+	 */
+	GPUMemory & operator=(const GPUMemory &) = delete;
+
+	/** Copy constructor (disabled). */
+	GPUMemory(const GPUMemory &) = delete;
+
+	/** Move assignment operator .
+	 \return a reference to the object assigned to
+	 */
+	GPUMemory & operator=(GPUMemory &&) = delete;
+
+	/** Move constructor. */
+	GPUMemory(GPUMemory &&) = delete;
+
+	VmaAllocation data = VK_NULL_HANDLE; ///< Internal allocation.
+	uint64_t size = 0; ///< Size of the block in bytes.
+};
+
+
 /**
  \brief Store vertices and triangles data on the GPU, linked by an array object.
  \ingroup Graphics
@@ -36,11 +36,24 @@ enum class BufferType : uint {
 	UNIFORM, ///< Uniform data.
 	CPUTOGPU, ///< Transfer.
 	GPUTOCPU, ///< Transfer.
-	STORAGE ///< Compute storage.
+	STORAGE, ///< Compute storage.
+	INDIRECT ///< Per-frame storage and indirect draw parameters, written from the CPU.
 };
 
 STD_HASH(BufferType);
 
+/**
+\brief Parameters of an indexed draw stored in a buffer, as expected by GPU::drawIndirect.
+\ingroup Graphics
+*/
+struct DrawCommand {
+	uint indexCount; ///< Number of indices to draw.
+	uint instanceCount; ///< Number of instances to draw.
+	uint firstIndex; ///< First index to draw.
+	int vertexOffset; ///< Offset added to indices.
+	uint firstInstance; ///< First instance index.
+};
+
 /**
 \brief The frequency at which a uniform buffer might be updated.
 \ingroup Resources
@@ -268,6 +281,15 @@ enum class Layout : uint {
 	RGBA16UI,
 	RGBA32I,
 	RGBA32UI,
+	BC1,
+	BC1_SRGB,
+	BC3,
+	BC3_SRGB,
+	BC4,
+	BC5,
+	BC6H,
+	BC7,
+	BC7_SRGB,
 	NONE
 };
 
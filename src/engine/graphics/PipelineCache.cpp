@@ -112,15 +112,16 @@ void PipelineCache::freeOutdatedPipelines(){
 	GPUContext* context = GPU::getInternal();
 
 	const uint64_t currentFrame = context->frameIndex;
+	const uint64_t frameCount = context->frameCount;
 
-	if(_pipelinesToDelete.empty() || (currentFrame < 2)){
+	if(_pipelinesToDelete.empty() || (currentFrame < frameCount)){
 		return;
 	}
 
 	while(!_pipelinesToDelete.empty()){
 		PipelineToDelete& pip = _pipelinesToDelete.front();
 		// If the following resources are too recent, they might still be used by in flight frames.
-		if(pip.frame >= currentFrame - 2){
+		if(pip.frame >= currentFrame - frameCount){
 			break;
 		}
 		vkDestroyPipeline(context->device, pip.pipeline, nullptr);
@@ -97,6 +97,7 @@ void Program::reflect(){
 #endif
 
 	// Merge all uniforms
+	_bindless = false;
 
 	for(const auto& stage : _stages){
 		for(const auto& buffer : stage.buffers){
@@ -148,6 +149,12 @@ void Program::reflect(){
 		for(const auto& image : stage.images){
 			const uint set = image.set;
 
+			// The global texture table is shared by all programs.
+			if(set == BINDLESS_SET){
+				_bindless = true;
+				continue;
+			}
+
 			if(set != IMAGES_SET){
 				Log::Error() << "Program " << name() << ": Image should be in set " << IMAGES_SET << " only, ignoring." << std::endl;
 				continue;
@@ -186,7 +193,8 @@ void Program::reflect(){
 		_dirtySets[IMAGES_SET] = true;
 	}
 
-	_state.setLayouts.resize(_currentSets.size());
+	// The global texture table is appended after the other sets if used.
+	_state.setLayouts.resize(_bindless ? (BINDLESS_SET + 1) : _currentSets.size());
 
 	// Basic uniforms buffer descriptors will use a dynamic offset.
 	uint maxDescriptorCount = 0;
@@ -270,6 +278,14 @@ void Program::reflect(){
 		_state.setLayouts[SAMPLERS_SET] = context->samplerLibrary.getLayout();
 	}
 
+	// Texture table
+	if(_bindless){
+		if(!context->bindless){
+			Log::Error() << Log::GPU << "Program " << name() << ": Bindless textures are not supported on this device." << std::endl;
+		}
+		_state.setLayouts[BINDLESS_SET] = context->textureTable.getLayout();
+	}
+
 	VkPipelineLayoutCreateInfo layoutInfo{};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	layoutInfo.setLayoutCount = uint32_t(_state.setLayouts.size());
@@ -294,12 +310,7 @@ void Program::reflect(){
 		desc->second.descriptorIndex = currentIndex;
 		++currentIndex;
 	}
-	// Dynamic uniforms are allocated only once.
-	context->descriptorAllocator.freeSet(_currentSets[UNIFORMS_SET]);
-	_currentSets[UNIFORMS_SET] = context->descriptorAllocator.allocateSet(_state.setLayouts[UNIFORMS_SET]);
-
-	VkUtils::setDebugName(*context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_currentSets[UNIFORMS_SET].handle), "%s-%s", "Uniforms", _name.c_str());
-
+	// Dynamic uniforms descriptors only change when the buffers move.
 	std::vector<VkDescriptorBufferInfo> infos(_dynamicBuffers.size());
 	std::vector<VkWriteDescriptorSet> writes;
 	uint tid = 0;
@@ -311,7 +322,6 @@ void Program::reflect(){
 
 		VkWriteDescriptorSet write{};
 		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		write.dstSet = _currentSets[UNIFORMS_SET].handle;
 		write.dstBinding = buffer.first;
 		write.dstArrayElement = 0;
 		write.descriptorCount = 1;
@@ -320,7 +330,7 @@ void Program::reflect(){
 		writes.push_back(write);
 		++tid;
 	}
-	vkUpdateDescriptorSets(context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+	_currentSets[UNIFORMS_SET] = context->descriptorCache.getSet(_state.setLayouts[UNIFORMS_SET], writes, "Uniforms-" + _name, _currentHashes[UNIFORMS_SET]);
 
 }
 
@@ -336,7 +346,7 @@ void Program::transitionResourcesTo(Program::Type type){
 		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
 		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
 		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
-		const VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		const VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr );
 
 		// Move all textures to shader read only optimal.
@@ -357,15 +367,15 @@ void Program::transitionResourcesTo(Program::Type type){
 		// For buffers, two possible cases.
 		// Either it was last used in a graphics program, and can't have been modified.
 		// Or it was used in a previous compute pass, and a memory barrier should be enough.
+		// Writes are also ordered, for buffers accumulated over multiple passes.
 		VkMemoryBarrier memoryBarrier = {};
 		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
 		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT ;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 		const VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
 		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr );
 
 		// Move sampled textures to shader read only optimal, and storage to general layout.
-		// \warning We might be missing some masks in the layout barrier when moving from a compute to a compute, investigate.
 		for(const auto& texInfos : _textures){
 			// Transition proper subresource.
 			const uint mip = texInfos.second.mip;
@@ -387,9 +397,18 @@ void Program::transitionResourcesTo(Program::Type type){
 void Program::update(){
 	GPUContext* context = GPU::getInternal();
 
+	// Keep the cached sets alive while they are bound. Sets released by the cache
+	// (unused for too long, invalidated or replaced) have to be retrieved again.
+	bool refreshDynamicDescriptors = false;
+	for(uint sid = 0; sid < _currentSets.size(); ++sid){
+		if(_currentSets[sid] != VK_NULL_HANDLE && !context->descriptorCache.touch(_currentHashes[sid], _currentSets[sid])){
+			_dirtySets[sid] = true;
+			refreshDynamicDescriptors |= (sid == UNIFORMS_SET);
+		}
+	}
+
 	// Upload all dirty uniform buffers, and the offsets.
 	if(_dirtySets[UNIFORMS_SET]){
-		bool refreshDynamicDescriptors = false;
 		for(const auto& buffer : _dynamicBuffers){
 			if(buffer.second.dirty){
 				bool newBuffer = buffer.second.buffer->upload();
@@ -401,12 +420,8 @@ void Program::update(){
 		_dirtySets[UNIFORMS_SET] = false;
 
 		if(refreshDynamicDescriptors){
-			// We can't just update the current descriptor set as it might be in use.
-			context->descriptorAllocator.freeSet(_currentSets[UNIFORMS_SET]);
-			_currentSets[UNIFORMS_SET] = context->descriptorAllocator.allocateSet(_state.setLayouts[UNIFORMS_SET]);
-
-			VkUtils::setDebugName(*context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_currentSets[UNIFORMS_SET].handle), "%s-%s", "Uniforms", _name.c_str());
-
+			// We can't just update the current descriptor set as it might be in use,
+			// retrieve a set matching the new buffers.
 			std::vector<VkDescriptorBufferInfo> infos(_dynamicBuffers.size());
 			std::vector<VkWriteDescriptorSet> writes;
 			uint tid = 0;
@@ -419,7 +434,6 @@ void Program::update(){
 
 				VkWriteDescriptorSet write{};
 				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				write.dstSet = _currentSets[UNIFORMS_SET].handle;
 				write.dstBinding = buffer.first;
 				write.dstArrayElement = 0;
 				write.descriptorCount = 1;
@@ -428,19 +442,13 @@ void Program::update(){
 				writes.push_back(write);
 				++tid;
 			}
-			vkUpdateDescriptorSets(context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+			_currentSets[UNIFORMS_SET] = context->descriptorCache.getSet(_state.setLayouts[UNIFORMS_SET], writes, "Uniforms-" + _name, _currentHashes[UNIFORMS_SET]);
 		}
 	}
 
 	// Update the texture descriptors
 	if(_dirtySets[IMAGES_SET]){
 
-		// We can't just update the current descriptor set as it might be in use.
-		context->descriptorAllocator.freeSet(_currentSets[IMAGES_SET]);
-		_currentSets[IMAGES_SET] = context->descriptorAllocator.allocateSet(_state.setLayouts[IMAGES_SET]);
-
-		VkUtils::setDebugName(*context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_currentSets[IMAGES_SET].handle), "%s set-%s", "Images", _name.c_str());
-
 		std::vector<std::vector<VkDescriptorImageInfo>> imageInfos(_textures.size());
 		std::vector<VkWriteDescriptorSet> writes;
 		uint tid = 0;
@@ -455,7 +463,6 @@ void Program::update(){
 
 			VkWriteDescriptorSet write{};
 			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write.dstSet = _currentSets[IMAGES_SET].handle;
 			write.dstBinding = image.first;
 			write.dstArrayElement = 0;
 			write.descriptorCount = image.second.count;
@@ -465,18 +472,14 @@ void Program::update(){
 			++tid;
 		}
 
-		vkUpdateDescriptorSets(context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+		// We can't just update the current descriptor set as it might be in use,
+		// retrieve a set with the same images used previously or allocate a new one.
+		_currentSets[IMAGES_SET] = context->descriptorCache.getSet(_state.setLayouts[IMAGES_SET], writes, "Images set-" + _name, _currentHashes[IMAGES_SET]);
 		_dirtySets[IMAGES_SET] = false;
 	}
 
 	// Update static buffer descriptors.
 	if(_dirtySets[BUFFERS_SET]){
-		// We can't just update the current descriptor set as it might be in use.
-		context->descriptorAllocator.freeSet(_currentSets[BUFFERS_SET]);
-		_currentSets[BUFFERS_SET] = context->descriptorAllocator.allocateSet(_state.setLayouts[BUFFERS_SET]);
-
-		VkUtils::setDebugName(*context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_currentSets[BUFFERS_SET].handle), "%s set-%s", "Buffers", _name.c_str());
-
 		std::vector<std::vector<VkDescriptorBufferInfo>> infos(_staticBuffers.size());
 		std::vector<VkWriteDescriptorSet> writes;
 		uint tid = 0;
@@ -498,7 +501,6 @@ void Program::update(){
 			
 			VkWriteDescriptorSet write{};
 			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write.dstSet = _currentSets[BUFFERS_SET].handle;
 			write.dstBinding = buffer.first;
 			write.dstArrayElement = 0;
 			write.descriptorCount = buffer.second.count;
@@ -508,7 +510,8 @@ void Program::update(){
 			++tid;
 		}
 
-		vkUpdateDescriptorSets(context->device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+		// We can't just update the current descriptor set as it might be in use.
+		_currentSets[BUFFERS_SET] = context->descriptorCache.getSet(_state.setLayouts[BUFFERS_SET], writes, "Buffers set-" + _name, _currentHashes[BUFFERS_SET]);
 		_dirtySets[BUFFERS_SET] = false;
 	}
 
@@ -517,18 +520,23 @@ void Program::update(){
 	VkCommandBuffer& commandBuffer = context->getRenderCommandBuffer();
 
 	// Set UNIFORMS_SET needs updated offsets.
-	vkCmdBindDescriptorSets(commandBuffer, bindPoint, _state.layout, UNIFORMS_SET, 1, &_currentSets[UNIFORMS_SET].handle, uint32_t(_currentOffsets.size()), _currentOffsets.data());
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, _state.layout, UNIFORMS_SET, 1, &_currentSets[UNIFORMS_SET], uint32_t(_currentOffsets.size()), _currentOffsets.data());
 
 	// Bind static samplers dummy set SAMPLERS_SET.
 	const VkDescriptorSet samplersHandle = context->samplerLibrary.getSetHandle();
 	vkCmdBindDescriptorSets(commandBuffer, bindPoint, _state.layout, SAMPLERS_SET, 1, &samplersHandle, 0, nullptr);
 
 	// Other sets are bound if present.
-	if(_currentSets[IMAGES_SET].handle != VK_NULL_HANDLE){
-		vkCmdBindDescriptorSets(commandBuffer, bindPoint, _state.layout, IMAGES_SET, 1, &_currentSets[IMAGES_SET].handle, 0, nullptr);
+	if(_currentSets[IMAGES_SET] != VK_NULL_HANDLE){
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, _state.layout, IMAGES_SET, 1, &_currentSets[IMAGES_SET], 0, nullptr);
+	}
+	if(_currentSets[BUFFERS_SET] != VK_NULL_HANDLE){
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, _state.layout, BUFFERS_SET, 1, &_currentSets[BUFFERS_SET], 0, nullptr);
 	}
-	if(_currentSets[BUFFERS_SET].handle != VK_NULL_HANDLE){
-		vkCmdBindDescriptorSets(commandBuffer, bindPoint, _state.layout, BUFFERS_SET, 1, &_currentSets[BUFFERS_SET].handle, 0, nullptr);
+	// Bind the global texture table if used.
+	if(_bindless){
+		const VkDescriptorSet tableHandle = context->textureTable.getSetHandle();
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, _state.layout, BINDLESS_SET, 1, &tableHandle, 0, nullptr);
 	}
 
 }
@@ -560,16 +568,11 @@ void Program::clean() {
 	_state.setLayouts.clear();
 	_state.layout = VK_NULL_HANDLE;
 	_dirtySets.fill(false);
+	_bindless = false;
 
-	for(uint i = 0; i < _currentSets.size(); ++i){
-		// Skip the shared static samplers set.
-		if(i == SAMPLERS_SET){
-			continue;
-		}
-		GPU::getInternal()->descriptorAllocator.freeSet(_currentSets[i]);
-		_currentSets[i].handle = VK_NULL_HANDLE;
-		_currentSets[i].pool = 0;
-	}
+	// Descriptor sets are owned by the descriptor cache.
+	_currentSets.fill(VK_NULL_HANDLE);
+	_currentHashes.fill(0);
 	_currentOffsets.clear();
 }
 
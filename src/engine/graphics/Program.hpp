@@ -21,11 +21,13 @@ VK_DEFINE_HANDLE(VkDescriptorSetLayout)
 #define SAMPLERS_SET 1
 #define IMAGES_SET 2
 #define BUFFERS_SET 3
+#define BINDLESS_SET 4
 
 /**
  \brief Represents a group of shaders used for rendering.
  \details Internally responsible for handling uniforms locations, shaders reloading and values caching.
  Uniform sets are predefined: set 0 is for dynamic uniforms, set 1 for image-samplers, set 2 for static/per-frame uniform buffers.
+ Programs can optionally access the global texture table in set 4, using an unsized texture array (see GPU::registerBindlessTexture).
  \ingroup Graphics
  */
 class Program {
@@ -479,10 +481,12 @@ private:
 	std::unordered_map<int, StaticBufferState> _staticBuffers; ///< Static uniform buffer definitions (set 3).
 
 	std::array<bool, 4> _dirtySets; ///< Marks which descriptor sets are dirty.
-	std::array<DescriptorSet, 4> _currentSets; ///< Descriptor sets.
+	std::array<VkDescriptorSet, 4> _currentSets; ///< Descriptor sets, retrieved from the descriptor cache.
+	std::array<uint64_t, 4> _currentHashes; ///< Descriptor sets hashes in the cache.
 	std::vector<uint32_t> _currentOffsets; ///< Offsets in the descriptor set for dynamic uniform buffers.
 
 	bool _reloaded = false; ///< Has the program been reloaded.
+	bool _bindless = false; ///< Does the program access the global texture table (set 4).
 	const Type _type; ///< Is this a compute shader.
 
 	friend class GPU; ///< Utilities will need to access GPU handle.
@@ -2,7 +2,9 @@
 #include "graphics/GPU.hpp"
 #include "graphics/GPUInternal.hpp"
 
+#include "resources/ResourcesManager.hpp"
 #include "system/TextUtilities.hpp"
+#include "system/System.hpp"
 
 #include <glslang/Public/ShaderLang.h>
 #include <glslang/SPIRV/GlslangToSpv.h>
@@ -10,6 +12,9 @@
 
 #include <map>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <cstring>
 
 // SPIRV compilation settings based on glslang standalone example
 static const TBuiltInResource defaultBuiltInResources = {
@@ -128,11 +133,24 @@ static const TBuiltInResource defaultBuiltInResources = {
 		   /* .generalConstantMatrixVectorIndexing = */ 1,
 	   }};
 
+std::unordered_map<uint64_t, ShaderCompiler::CacheEntry> ShaderCompiler::_cache;
+std::mutex ShaderCompiler::_cacheMutex;
+std::string ShaderCompiler::_cacheDirectory;
+
+/// Version of the compiler settings and cache format, stored in cached files.
+static const uint32_t cacheVersion = 1;
+
+ShaderCompiler::Job::Job(const std::string & asource, ShaderType atype, Program::Stage * astage) :
+	source(asource), type(atype), stage(astage) {
+}
+
 bool ShaderCompiler::init(){
+	_cacheDirectory = Resources::manager().getCachePath("shaders");
 	return glslang::InitializeProcess();
 }
 
 void ShaderCompiler::cleanup(){
+	_cache.clear();
 	glslang::FinalizeProcess();
 }
 
@@ -147,9 +165,77 @@ void ShaderCompiler::clean(Program::Stage & stage){
 void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program::Stage & stage, bool generateModule, std::string & finalLog) {
 
 	// Add GLSL version.
-	std::string outputProg = "#version 450\n#extension GL_ARB_separate_shader_objects : enable\n#extension GL_EXT_samplerless_texture_functions : enable\n#line 1 0\n";
+	std::string outputProg = "#version 450\n#extension GL_ARB_separate_shader_objects : enable\n#extension GL_EXT_samplerless_texture_functions : enable\n#extension GL_EXT_nonuniform_qualifier : enable\n#line 1 0\n";
 	outputProg.append(prog);
 
+	finalLog = "";
+	// The cache key depends on the full shader content, its type and the compiler settings.
+	std::vector<uint64_t> keys = { System::hash64(outputProg.data(), outputProg.size()), uint64_t(type), uint64_t(cacheVersion) };
+	const uint64_t hash = System::hash64(keys.data(), keys.size() * sizeof(uint64_t));
+
+	CacheEntry entry;
+	if(!loadFromCache(hash, entry)){
+		if(!compileToSpirv(outputProg, type, entry.spirv, finalLog)){
+			return;
+		}
+		reflect(entry.spirv, entry.reflection);
+		saveToCache(hash, entry);
+	}
+	stage.images = entry.reflection.images;
+	stage.buffers = entry.reflection.buffers;
+	stage.size = entry.reflection.size;
+
+	if(generateModule){
+		VkShaderModuleCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = entry.spirv.size() * sizeof(uint32_t);
+		createInfo.pCode = entry.spirv.data();
+		VkShaderModule shaderModule;
+		GPUContext* context = GPU::getInternal();
+		if(vkCreateShaderModule(context->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+			finalLog = "Unable to create shader module.";
+			return;
+		}
+		stage.module = shaderModule;
+	} else {
+		stage.module = VK_NULL_HANDLE;
+	}
+
+}
+
+void ShaderCompiler::compile(std::vector<Job> & jobs, bool generateModule) {
+	// Each worker picks the next available job until all are done.
+	std::atomic<size_t> nextJob(0);
+	auto worker = [&jobs, &nextJob, generateModule](){
+		for(size_t jid = nextJob++; jid < jobs.size(); jid = nextJob++){
+			Job & job = jobs[jid];
+			if(job.source.empty()){
+				continue;
+			}
+			if(job.stage){
+				compile(job.source, job.type, *job.stage, generateModule, job.log);
+			} else {
+				Program::Stage stage;
+				compile(job.source, job.type, stage, false, job.log);
+			}
+		}
+	};
+
+	// The calling thread also processes jobs.
+	const size_t availableThreadsCount = size_t(std::max(int(std::thread::hardware_concurrency()), 1));
+	const size_t threadCount = std::min(availableThreadsCount, jobs.size());
+	std::vector<std::thread> threads;
+	for(size_t tid = 1; tid < threadCount; ++tid){
+		threads.emplace_back(worker);
+	}
+	worker();
+	for(std::thread & thread : threads){
+		thread.join();
+	}
+}
+
+bool ShaderCompiler::compileToSpirv(const std::string & prog, ShaderType type, std::vector<uint32_t> & spirv, std::string & finalLog) {
+
 	// Create shader object.
 	static const std::unordered_map<ShaderType, EShLanguage> types = {
 		{ShaderType::VERTEX, EShLangVertex},
@@ -158,7 +244,7 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 		{ShaderType::TESSEVAL, EShLangTessEvaluation},
 		{ShaderType::COMPUTE, EShLangCompute}
 	};
-	const char* progStr = outputProg.c_str();
+	const char* progStr = prog.c_str();
 	const EShLanguage stageDest = types.at(type);
 	glslang::TShader shader(stageDest);
 	shader.setStrings(&progStr, 1);
@@ -167,8 +253,6 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 	shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_1);
 	shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_3);
 
-
-	finalLog = "";
 	const EShMessages messages = (EShMessages)(EShMsgDefault | EShMsgSpvRules | EShMsgVulkanRules);
 	bool success = shader.parse(&defaultBuiltInResources, 110, true, messages);
 	if(!success){
@@ -176,7 +260,7 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 		TextUtilities::replace(infoLogString, "\n", "\n\t");
 		infoLogString.insert(0, "\t");
 		finalLog = infoLogString;
-		return;
+		return false;
 	}
 
 	glslang::TProgram program;
@@ -185,14 +269,13 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 	if(!success){
 		std::string infoLogString(program.getInfoLog());
 		finalLog = infoLogString;
-		return;
+		return false;
 	}
 	if(!program.mapIO()){
 		finalLog = "Unable to map IO.";
-		return;
+		return false;
 	}
 
-	std::vector<uint32_t> spirv;
 	glslang::SpvOptions spvOptions;
 	spvOptions.generateDebugInfo = false;
 	spvOptions.disableOptimizer = false;
@@ -202,27 +285,183 @@ void ShaderCompiler::compile(const std::string & prog, ShaderType type, Program:
 	glslang::GlslangToSpv(*program.getIntermediate(stageDest), spirv, &spvOptions);
 	if(spirv.empty()){
 		finalLog = "Unable to generate SPIRV.";
+		return false;
+	}
+	return true;
+}
+
+bool ShaderCompiler::loadFromCache(uint64_t hash, CacheEntry & entry){
+	{
+		std::lock_guard<std::mutex> guard(_cacheMutex);
+		const auto entryIt = _cache.find(hash);
+		if(entryIt != _cache.end()){
+			entry = entryIt->second;
+			return true;
+		}
+	}
+	if(_cacheDirectory.empty()){
+		return false;
+	}
+	std::stringstream path;
+	path << _cacheDirectory << std::hex << hash << ".spv";
+	if(!Resources::externalFileExists(path.str())){
+		return false;
+	}
+	size_t size = 0;
+	char * data = Resources::loadRawDataFromExternalFile(path.str(), size);
+	const bool valid = data != nullptr && deserialize(data, size, entry);
+	delete[] data;
+	if(!valid){
+		return false;
+	}
+	std::lock_guard<std::mutex> guard(_cacheMutex);
+	_cache[hash] = entry;
+	return true;
+}
+
+void ShaderCompiler::saveToCache(uint64_t hash, const CacheEntry & entry){
+	{
+		std::lock_guard<std::mutex> guard(_cacheMutex);
+		_cache[hash] = entry;
+	}
+	if(_cacheDirectory.empty()){
 		return;
 	}
+	std::vector<char> data;
+	serialize(entry, data);
+	std::stringstream path;
+	path << _cacheDirectory << std::hex << hash << ".spv";
+	Resources::saveRawDataToExternalFile(path.str(), data.data(), data.size());
+}
+
+void ShaderCompiler::serialize(const CacheEntry & entry, std::vector<char> & data){
+	auto writeUint = [&data](uint32_t value){
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		data.insert(data.end(), bytes, bytes + sizeof(uint32_t));
+	};
+	auto writeString = [&data, &writeUint](const std::string & str){
+		writeUint(uint32_t(str.size()));
+		data.insert(data.end(), str.begin(), str.end());
+	};
 
-	reflect(spirv, stage);
+	// Header: magic, version, SPIR-V code.
+	writeUint(0x56505352u /* RSPV */);
+	writeUint(cacheVersion);
+	writeUint(uint32_t(entry.spirv.size()));
+	const char* code = reinterpret_cast<const char*>(entry.spirv.data());
+	data.insert(data.end(), code, code + entry.spirv.size() * sizeof(uint32_t));
 
-	if(generateModule){
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = spirv.size() * sizeof(uint32_t);
-		createInfo.pCode = spirv.data();
-		VkShaderModule shaderModule;
-		GPUContext* context = GPU::getInternal();
-		if(vkCreateShaderModule(context->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-			finalLog = "Unable to create shader module.";
-			return;
+	// Reflection.
+	const Program::Stage & stage = entry.reflection;
+	for(uint i = 0; i < 3; ++i){
+		writeUint(stage.size[i]);
+	}
+	writeUint(uint32_t(stage.images.size()));
+	for(const Program::ImageDef & image : stage.images){
+		writeString(image.name);
+		writeUint(uint32_t(image.shape));
+		writeUint(image.binding);
+		writeUint(image.set);
+		writeUint(image.count);
+		writeUint(image.storage ? 1u : 0u);
+	}
+	writeUint(uint32_t(stage.buffers.size()));
+	for(const Program::BufferDef & buffer : stage.buffers){
+		writeString(buffer.name);
+		writeUint(buffer.binding);
+		writeUint(buffer.size);
+		writeUint(buffer.set);
+		writeUint(buffer.count);
+		writeUint(buffer.storage ? 1u : 0u);
+		writeUint(uint32_t(buffer.members.size()));
+		for(const Program::UniformDef & member : buffer.members){
+			writeString(member.name);
+			writeUint(uint32_t(member.type));
+			writeUint(uint32_t(member.locations.size()));
+			for(const Program::UniformDef::Location & location : member.locations){
+				writeUint(location.binding);
+				writeUint(location.offset);
+			}
 		}
-		stage.module = shaderModule;
-	} else {
-		stage.module = VK_NULL_HANDLE;
 	}
+}
 
+bool ShaderCompiler::deserialize(const char * data, size_t size, CacheEntry & entry){
+	size_t offset = 0;
+	bool valid = true;
+	auto readUint = [data, size, &offset, &valid]() -> uint32_t {
+		uint32_t value = 0;
+		if(offset + sizeof(uint32_t) > size){
+			valid = false;
+			return value;
+		}
+		std::memcpy(&value, data + offset, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+		return value;
+	};
+	auto readString = [data, size, &offset, &valid, &readUint]() -> std::string {
+		const uint32_t length = readUint();
+		if(!valid || offset + length > size){
+			valid = false;
+			return "";
+		}
+		const std::string str(data + offset, length);
+		offset += length;
+		return str;
+	};
+
+	if(readUint() != 0x56505352u || readUint() != cacheVersion){
+		return false;
+	}
+	const uint32_t wordCount = readUint();
+	if(!valid || offset + size_t(wordCount) * sizeof(uint32_t) > size){
+		return false;
+	}
+	entry.spirv.resize(wordCount);
+	std::memcpy(entry.spirv.data(), data + offset, size_t(wordCount) * sizeof(uint32_t));
+	offset += size_t(wordCount) * sizeof(uint32_t);
+
+	Program::Stage & stage = entry.reflection;
+	for(uint i = 0; i < 3; ++i){
+		stage.size[i] = readUint();
+	}
+	const uint32_t imageCount = readUint();
+	for(uint32_t iid = 0; iid < imageCount && valid; ++iid){
+		stage.images.emplace_back();
+		Program::ImageDef & image = stage.images.back();
+		image.name = readString();
+		image.shape = TextureShape(readUint());
+		image.binding = readUint();
+		image.set = readUint();
+		image.count = readUint();
+		image.storage = readUint() != 0;
+	}
+	const uint32_t bufferCount = readUint();
+	for(uint32_t bid = 0; bid < bufferCount && valid; ++bid){
+		stage.buffers.emplace_back();
+		Program::BufferDef & buffer = stage.buffers.back();
+		buffer.name = readString();
+		buffer.binding = readUint();
+		buffer.size = readUint();
+		buffer.set = readUint();
+		buffer.count = readUint();
+		buffer.storage = readUint() != 0;
+		const uint32_t memberCount = readUint();
+		for(uint32_t mid = 0; mid < memberCount && valid; ++mid){
+			buffer.members.emplace_back();
+			Program::UniformDef & member = buffer.members.back();
+			member.name = readString();
+			member.type = Program::UniformDef::Type(readUint());
+			const uint32_t locationCount = readUint();
+			for(uint32_t lid = 0; lid < locationCount && valid; ++lid){
+				Program::UniformDef::Location location;
+				location.binding = readUint();
+				location.offset = readUint();
+				member.locations.push_back(location);
+			}
+		}
+	}
+	return valid && offset == size;
 }
 
 /// Internal reflection helpers
@@ -310,6 +549,11 @@ bool reflectImage(const spirv_cross::Compiler& compiler, const spirv_cross::Reso
 		def.shape = def.shape | TextureShape::Array;
 	}
 	if(type.array.size() > 0){
+		// The global texture table is the only unsized array allowed.
+		if(type.array.size() == 1 && type.array[0] == 0 && def.set == BINDLESS_SET){
+			def.count = 0;
+			return true;
+		}
 		if(type.array.size() > 1 || type.array[0] == 0){
 			Log::Warning() << Log::GPU << "Unsupported unsized/multi-level array of textures in shader." << std::endl;
 			return false;
@@ -4,6 +4,8 @@
 #include "graphics/GPUObjects.hpp"
 #include "Common.hpp"
 
+#include <mutex>
+
 /**
  \brief Relies on glslang to compile GLSL shaders to SPIR-V and SPIRV-Cross to generate reflection data.
  \ingroup Graphics
@@ -12,6 +14,22 @@ class ShaderCompiler {
 
 public:
 
+	/** \brief A shader compilation request, for concurrent compilation. */
+	struct Job {
+
+		/** Constructor.
+		 \param asource the content of the shader (the job is skipped if empty)
+		 \param atype the type of shader
+		 \param astage will be filled with reflection information and the compiled results (optional)
+		 */
+		Job(const std::string & asource, ShaderType atype, Program::Stage * astage = nullptr);
+
+		std::string source; ///< The content of the shader.
+		ShaderType type; ///< The type of shader.
+		Program::Stage * stage; ///< The stage to populate, or null to only populate the cache.
+		std::string log; ///< Compilation log.
+	};
+
 	/** Create a shader of a given type from a string. Extract additional informations from the shader.
 	 \param prog the content of the shader
 	 \param type the type of shader (vertex, fragment,...)
@@ -21,6 +39,13 @@ public:
 	 */
 	static void compile(const std::string & prog, ShaderType type, Program::Stage & stage, bool generateModule, std::string & finalLog);
 
+	/** Compile multiple shaders concurrently, jobs being distributed dynamically between worker threads.
+	 \param jobs the shaders to compile, will contain the compilation logs
+	 \param generateModule shoud Vulkan modules be generated for jobs with a stage
+	 \note Compiled results are cached, jobs without stage can be used to pre-warm the cache.
+	 */
+	static void compile(std::vector<Job> & jobs, bool generateModule);
+
 	/** Initialize the compiler library.
 	 * \return the success status
 	 */
@@ -36,10 +61,56 @@ public:
 	
 private:
 
+	/** \brief Compiled shader data, cached in memory and on disk. */
+	struct CacheEntry {
+		std::vector<uint32_t> spirv; ///< SPIR-V code.
+		Program::Stage reflection; ///< Reflection information (without module).
+	};
+
+	/** Compile a shader to SPIR-V.
+	 * \param prog the complete shader content
+	 * \param type the type of shader
+	 * \param spirv will contain the SPIR-V code
+	 * \param finalLog will contain the compilation log
+	 * \return true if the compilation succeeded
+	 */
+	static bool compileToSpirv(const std::string & prog, ShaderType type, std::vector<uint32_t> & spirv, std::string & finalLog);
+
 	/** Perform reflection on a compiled program and populate our reflection structures.
 	 * \param spirv the compiled SPIR-V program
 	 * \param stage will contain reflection data
 	 * */
 	static void reflect(const std::vector<uint32_t>& spirv, Program::Stage & stage);
 
+	/** Retrieve a compiled shader from the memory or disk cache.
+	 * \param hash the shader hash
+	 * \param entry will contain the compiled shader data
+	 * \return true if the shader was found
+	 */
+	static bool loadFromCache(uint64_t hash, CacheEntry & entry);
+
+	/** Store a compiled shader in the memory and disk caches.
+	 * \param hash the shader hash
+	 * \param entry the compiled shader data
+	 */
+	static void saveToCache(uint64_t hash, const CacheEntry & entry);
+
+	/** Serialize compiled shader data.
+	 * \param entry the compiled shader data
+	 * \param data will contain the binary representation
+	 */
+	static void serialize(const CacheEntry & entry, std::vector<char> & data);
+
+	/** Deserialize compiled shader data.
+	 * \param data the binary representation
+	 * \param size the data size in bytes
+	 * \param entry will contain the compiled shader data
+	 * \return true if the data was valid
+	 */
+	static bool deserialize(const char * data, size_t size, CacheEntry & entry);
+
+	static std::unordered_map<uint64_t, CacheEntry> _cache; ///< Compiled shaders cached in memory.
+	static std::mutex _cacheMutex; ///< Protect the cache from concurrent compilations.
+	static std::string _cacheDirectory; ///< Directory for the disk cache (disabled if empty).
+
 };
@@ -0,0 +1,95 @@
+#include "graphics/StagingAllocator.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/GPUInternal.hpp"
+
+void StagingAllocator::init(GPUContext* context, size_t size){
+	_context = context;
+	_size = size;
+	_head = 0;
+	_tail = 0;
+	_frameEnds.assign(_context->frameCount, 0);
+	_buffer.reset(new Buffer(_size, BufferType::CPUTOGPU, "Staging ring"));
+}
+
+StagingAllocator::Region StagingAllocator::allocate(size_t size, size_t alignment){
+	GPU::_metrics.stagedBytes += size;
+
+	Region region;
+	// Requests larger than a frame share of the ring would stall on all frames in flight.
+	bool overflow = size > _size / _context->frameCount;
+
+	if(!overflow){
+		uint64_t start = (_head + alignment - 1) & ~uint64_t(alignment - 1);
+		// A region can't be split between the end and the beginning of the ring.
+		size_t offset = size_t(start % _size);
+		if(offset + size > _size){
+			start += _size - offset;
+			offset = 0;
+		}
+		if(offset == 0 && start != 0){
+			++GPU::_metrics.stagingWraps;
+		}
+		// Wait for frames in flight to release enough space.
+		while(start + size > _tail + _size){
+			if(!waitForOldestFrame()){
+				// The current frame is using the whole ring.
+				overflow = true;
+				break;
+			}
+		}
+		if(!overflow){
+			_head = start + size;
+			region.buffer = _buffer->gpu->buffer;
+			region.offset = offset;
+			region.mapped = _buffer->gpu->mapped + offset;
+			return region;
+		}
+	}
+
+	// Dedicated buffer, its destruction will be deferred until the GPU is done with it.
+	region.overflow.reset(new Buffer(size, BufferType::CPUTOGPU, "Staging overflow"));
+	region.buffer = region.overflow->gpu->buffer;
+	region.offset = 0;
+	region.mapped = region.overflow->gpu->mapped;
+	++GPU::_metrics.stagingOverflows;
+	return region;
+}
+
+void StagingAllocator::flush(const Region& region, size_t size){
+	if(region.overflow){
+		GPU::flushBuffer(*region.overflow, size, 0);
+	} else {
+		GPU::flushBuffer(*_buffer, size, region.offset);
+	}
+}
+
+bool StagingAllocator::waitForOldestFrame(){
+	// Frames slots are used in order, the ones after the current slot are the oldest in flight.
+	const uint frameCount = _context->frameCount;
+	for(uint i = 1; i < frameCount; ++i){
+		const uint slot = (_context->swapIndex + i) % frameCount;
+		if(_frameEnds[slot] <= _tail){
+			continue;
+		}
+		VK_RET(vkWaitForFences(_context->device, 1, &_context->frameFences[slot], VK_TRUE, std::numeric_limits<uint64_t>::max()));
+		_tail = _frameEnds[slot];
+		++GPU::_metrics.stagingStalls;
+		return true;
+	}
+	return false;
+}
+
+void StagingAllocator::endFrame(){
+	_frameEnds[_context->swapIndex] = _head;
+}
+
+void StagingAllocator::releaseFrame(){
+	_tail = std::max(_tail, _frameEnds[_context->swapIndex]);
+}
+
+void StagingAllocator::clean(){
+	_buffer.reset();
+	_frameEnds.clear();
+	_head = 0;
+	_tail = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Common.hpp"
+#include "graphics/GPUObjects.hpp"
+#include "resources/Buffer.hpp"
+
+struct GPUContext;
+
+/** \brief Sub-allocate transfer regions for CPU to GPU uploads from a persistent, mapped ring buffer.
+ \details Each frame in flight appends its regions after the previous frame ones. Space is recycled once the frame fence has been waited on. If the ring is full, the allocator waits for older frames to complete (stall). Requests that still do not fit, or that are too large for the ring, get a dedicated staging buffer.
+ \ingroup Graphics
+ */
+class StagingAllocator {
+public:
+
+	/** \brief A region of staging memory where data can be written before being copied on the GPU. */
+	struct Region {
+		VkBuffer buffer = VK_NULL_HANDLE; ///< The buffer to copy from.
+		size_t offset = 0; ///< Offset of the region in the buffer.
+		char* mapped = nullptr; ///< CPU pointer to the beginning of the region.
+		std::unique_ptr<Buffer> overflow; ///< Dedicated buffer for large requests, released when the region is destroyed.
+	};
+
+	/** Setup the allocator.
+	 \param context the GPU context
+	 \param size the size of the ring buffer in bytes
+	 */
+	void init(GPUContext* context, size_t size);
+
+	/** Allocate a staging region for the current frame.
+	 \param size the size of the region in bytes
+	 \param alignment the alignment of the region offset in the buffer, in bytes (power of two)
+	 \return the region infos
+	 */
+	Region allocate(size_t size, size_t alignment);
+
+	/** Flush CPU writes to a region so that they are visible to the GPU.
+	 \param region the region to flush
+	 \param size the number of bytes written
+	 */
+	void flush(const Region& region, size_t size);
+
+	/** Mark the end of the current frame allocations, before its submission. */
+	void endFrame();
+
+	/** Release regions of the last submission that used the current frame slot. Its fence should have been waited on. */
+	void releaseFrame();
+
+	/** Release the ring buffer. */
+	void clean();
+
+private:
+
+	/** Wait for the oldest frame in flight that still uses part of the ring.
+	 \return true if a frame has been waited on
+	 */
+	bool waitForOldestFrame();
+
+	GPUContext* _context = nullptr; ///< The GPU context.
+	std::unique_ptr<Buffer> _buffer; ///< The persistent ring buffer.
+	std::vector<uint64_t> _frameEnds; ///< For each frame slot, position of the end of its last submitted allocations.
+	size_t _size = 0; ///< Ring size.
+	uint64_t _head = 0; ///< Total bytes allocated so far, the next allocation will start at _head modulo _size.
+	uint64_t _tail = 0; ///< Position of the oldest byte still potentially in use by the GPU.
+};
@@ -208,18 +208,13 @@ void Swapchain::setup(uint32_t width, uint32_t height){
 		VkUtils::setDebugName(*_context, VK_OBJECT_TYPE_IMAGE_VIEW, uint64_t(color.gpu->views[0].views[0]), "Swapchain color %u - mip0 -    level0", i);
 	}
 
-	// Semaphores and fences.
+	// Semaphores (per-frame fences are owned by the context).
 	_imagesAvailable.resize(_context->frameCount);
 	_framesFinished.resize(_imageCount);
-	_framesInFlight.resize(_context->frameCount);
 
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo = {};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 	for(size_t i = 0; i < _imagesAvailable.size(); i++) {
 		VkResult availRes = vkCreateSemaphore(_context->device, &semaphoreInfo, nullptr, &_imagesAvailable[i]);
 		VkUtils::setDebugName(*_context, VK_OBJECT_TYPE_SEMAPHORE, uint64_t(_imagesAvailable[i]), "Image available %u", i);
@@ -235,14 +230,6 @@ void Swapchain::setup(uint32_t width, uint32_t height){
 			Log::Error() << Log::GPU << "Unable to create semaphores." << std::endl;
 		}
 	}
-
-	for(size_t i = 0; i < _framesInFlight.size(); i++) {
-		VkResult inflightRes = vkCreateFence(_context->device, &fenceInfo, nullptr, &_framesInFlight[i]);
-		VkUtils::setDebugName(*_context, VK_OBJECT_TYPE_FENCE, uint64_t(_framesInFlight[i]), "Frame in flight %u", i);
-		if(inflightRes != VK_SUCCESS) {
-			Log::Error() << Log::GPU << "Unable to create fences." << std::endl;
-		}
-	}
 }
 
 void Swapchain::resize(uint width, uint height){
@@ -267,42 +254,17 @@ void Swapchain::getFormats(VkFormat& color, VkFormat& depth, VkFormat& stencil){
 bool Swapchain::finishFrame(){
 
 	GPU::endRenderingIfNeeded();
-
-	// If we have upload operations to perform, ensure they are all complete before
-	// we start executing the render command buffer.
-	VkMemoryBarrier uploadBarrier {};
-	uploadBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-	uploadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT ;
-	uploadBarrier.dstAccessMask = VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
-	vkCmdPipelineBarrier(_context->getUploadCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &uploadBarrier, 0, nullptr, 0, nullptr);
+	// Wait for async compute work, the backbuffer barrier is recorded in the last command buffer of the frame.
+	GPU::completeAsyncCompute();
 
 	// Make sure that the backbuffer is presentable.
 	VkUtils::imageLayoutBarrier(_context->getRenderCommandBuffer(), *(_backbuffer->gpu), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, 1, 0, 1);
 
-	// Finish the command buffers for this frame.
-	VK_RET(vkEndCommandBuffer(_context->getRenderCommandBuffer()));
-	VK_RET(vkEndCommandBuffer(_context->getUploadCommandBuffer()));
-
-	const VkCommandBuffer commandBuffers[] = {_context->getUploadCommandBuffer(), _context->getRenderCommandBuffer()};
-
-	// Submit both command buffers.
-	const uint swapIndex = _context->swapIndex;
-	// Maybe use VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT instead ?
-	VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &_imagesAvailable[swapIndex];
-	submitInfo.pWaitDstStageMask = waitStages;
-	submitInfo.commandBufferCount = 2;
-	submitInfo.pCommandBuffers = &commandBuffers[0];
-	// Semaphore for when the command buffer is done, so that we can present the image.
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores	= &_framesFinished[_imageIndex];
-	// Add the fence so that we don't reuse the command buffer while it's in use.
-	VK_RET(vkResetFences(_context->device, 1, &_framesInFlight[swapIndex]));
-	VK_RET(vkQueueSubmit(_context->graphicsQueue, 1, &submitInfo, _framesInFlight[swapIndex]));
+	// Submit both command buffers, uploads signal a semaphore that rendering waits on.
+	// Rendering also waits for the backbuffer to be available, and signals when the image can be presented.
+	// The frame fence is signaled once all is complete, so that we don't reuse the command buffers while they are in use.
+	VkUtils::submitFrameCommandBuffers(*_context, _imagesAvailable[_context->swapIndex], _framesFinished[_imageIndex]);
+	++GPU::_metrics.submissions;
 
 	// Present swap chain.
 	VkPresentInfoKHR presentInfo = {};
@@ -338,12 +300,12 @@ bool Swapchain::nextFrame(){
 		}
 	}  else {
 		// Before the first frame, we might still have performed upload operations (loading debug data for instance).
-		// End the command buffers, submit and wait on queue.
+		// End the command buffers and submit them, the frame fence will be waited on below.
 		GPU::submitFrameCommandBuffers();
 	}
 
 	// Wait for the current commands buffer to be done.
-	VK_RET(vkWaitForFences(_context->device, 1, &_framesInFlight[_context->swapIndex], VK_TRUE, std::numeric_limits<uint64_t>::max()));
+	GPU::waitForFrameResources();
 
 	// Acquire image from next frame.
 	// Use a semaphore to know when the image is available.
@@ -402,6 +364,11 @@ void Swapchain::clean() {
 
 	vkFreeCommandBuffers(_context->device, _context->commandPool, uint32_t(_context->renderCommandBuffers.size()), _context->renderCommandBuffers.data());
 	vkFreeCommandBuffers(_context->device, _context->commandPool, uint32_t(_context->uploadCommandBuffers.size()), _context->uploadCommandBuffers.data());
+	if(_context->asyncCompute){
+		vkFreeCommandBuffers(_context->device, _context->computeCommandPool, uint32_t(_context->computeCommandBuffers.size()), _context->computeCommandBuffers.data());
+		vkFreeCommandBuffers(_context->device, _context->commandPool, uint32_t(_context->overlapCommandBuffers.size()), _context->overlapCommandBuffers.data());
+		vkFreeCommandBuffers(_context->device, _context->commandPool, uint32_t(_context->resumeCommandBuffers.size()), _context->resumeCommandBuffers.data());
+	}
 	vkDestroySwapchainKHR(_context->device, _swapchain, nullptr);
 
 	for(size_t i = 0; i < _imagesAvailable.size(); ++i) {
@@ -410,7 +377,4 @@ void Swapchain::clean() {
 	for(size_t i = 0; i < _framesFinished.size(); ++i) {
 		vkDestroySemaphore(_context->device, _framesFinished[i], nullptr);
 	}
-	for(size_t i = 0; i < _framesInFlight.size(); ++i) {
-		vkDestroyFence(_context->device, _framesInFlight[i], nullptr);
-	}
 }
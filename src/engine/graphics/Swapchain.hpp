@@ -81,7 +81,6 @@ private:
 
 	std::vector<VkSemaphore> _imagesAvailable; ///< Semaphores signaling when swapchain images are available for a new frame.
 	std::vector<VkSemaphore> _framesFinished; ///< Semaphores signaling when a frame has been completed.
-	std::vector<VkFence> _framesInFlight; ///< Fences ensuring that frames are properly ordered.
 
 	uint _imageCount = 0; ///< Number of images in the swapchain.
 	uint _minImageCount = 0; ///< Minimum number of images required by the swapchain.
@@ -0,0 +1,123 @@
+#include "graphics/TextureTable.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/GPUInternal.hpp"
+#include "resources/Texture.hpp"
+
+bool TextureTable::init(GPUContext* context, uint capacity){
+	_context = context;
+	_capacity = capacity;
+	_next = 0;
+	_count = 0;
+	_freeSlots.clear();
+
+	// A single large array of sampled images, that can be partially populated and updated while bound.
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	binding.descriptorCount = _capacity;
+	binding.stageFlags = VK_SHADER_STAGE_ALL;
+
+	const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo = {};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	flagsInfo.bindingCount = 1;
+	flagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo setInfo = {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setInfo.pNext = &flagsInfo;
+	setInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	setInfo.bindingCount = 1;
+	setInfo.pBindings = &binding;
+
+	if(vkCreateDescriptorSetLayout(_context->device, &setInfo, nullptr, &_layout) != VK_SUCCESS){
+		Log::Error() << Log::GPU << "Unable to create texture table set layout." << std::endl;
+		return false;
+	}
+	VkUtils::setDebugName(*_context, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, uint64_t(_layout), "%s-%s", "Textures", "shared");
+
+	// The common pools don't allow update after bind, use a dedicated one.
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	poolSize.descriptorCount = _capacity;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if(vkCreateDescriptorPool(_context->device, &poolInfo, nullptr, &_pool) != VK_SUCCESS){
+		Log::Error() << Log::GPU << "Unable to create texture table pool." << std::endl;
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = _pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &_layout;
+
+	if(vkAllocateDescriptorSets(_context->device, &allocInfo, &_set) != VK_SUCCESS){
+		Log::Error() << Log::GPU << "Unable to allocate texture table set." << std::endl;
+		return false;
+	}
+	VkUtils::setDebugName(*_context, VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(_set), "%s set-%s", "Textures", "shared");
+	return true;
+}
+
+uint TextureTable::registerTexture(const Texture& texture){
+	uint slot = invalidSlot;
+	// Reuse the oldest released slot if no frame in flight can still reference it.
+	if(!_freeSlots.empty() && (_freeSlots.front().frame + _context->frameCount < _context->frameIndex)){
+		slot = _freeSlots.front().slot;
+		_freeSlots.pop_front();
+	} else if(_next < _capacity){
+		slot = _next++;
+	} else {
+		Log::Error() << Log::GPU << "Texture table is full, unable to register " << texture.name() << "." << std::endl;
+		return invalidSlot;
+	}
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageView = texture.gpu->view;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.sampler = VK_NULL_HANDLE;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = _set;
+	write.dstBinding = 0;
+	write.dstArrayElement = slot;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(_context->device, 1, &write, 0, nullptr);
+
+	++_count;
+	return slot;
+}
+
+void TextureTable::release(uint slot){
+	if(slot == invalidSlot){
+		return;
+	}
+	_freeSlots.push_back({slot, _context->frameIndex});
+	--_count;
+}
+
+void TextureTable::clean(){
+	if(_pool != VK_NULL_HANDLE){
+		vkDestroyDescriptorPool(_context->device, _pool, nullptr);
+	}
+	if(_layout != VK_NULL_HANDLE){
+		vkDestroyDescriptorSetLayout(_context->device, _layout, nullptr);
+	}
+	_pool = VK_NULL_HANDLE;
+	_layout = VK_NULL_HANDLE;
+	_set = VK_NULL_HANDLE;
+	_freeSlots.clear();
+	_next = 0;
+	_count = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Common.hpp"
+#include "graphics/GPUObjects.hpp"
+
+#include <deque>
+
+struct GPUContext;
+class Texture;
+
+/** \brief Global table of sampled 2D textures, accessed by index in shaders (bindless).
+ * All registered textures are stored in a unique, shared descriptor set (set #4) containing a large array of sampled images. Slots are allocated when a texture is registered and released when the texture is destroyed. Released slots are reused only once all frames in flight that could reference them have completed.
+ * \sa GPUShaders::Common::Bindless
+ * \ingroup Graphics
+ */
+class TextureTable {
+public:
+
+	/// Value of an unassigned slot.
+	static const uint invalidSlot = 0xFFFFFFFF;
+
+	/** Setup the table layout and descriptor set.
+	 \param context the GPU context
+	 \param capacity the maximum number of textures in the table
+	 \return true if the table was created
+	 */
+	bool init(GPUContext* context, uint capacity);
+
+	/** Register a texture in the table.
+	 \param texture the texture to register (should be a 2D texture in shader read-only layout)
+	 \return the slot of the texture in the table, or invalidSlot if the table is full
+	 */
+	uint registerTexture(const Texture& texture);
+
+	/** Release a texture slot. It will be reused once frames in flight are complete.
+	 \param slot the slot to release
+	 */
+	void release(uint slot);
+
+	/** Clean the table. */
+	void clean();
+
+	/** \return the table descriptor set layout */
+	VkDescriptorSetLayout getLayout() const { return _layout; }
+
+	/** \return the table descriptor set */
+	VkDescriptorSet getSetHandle() const { return _set; }
+
+	/** \return the number of currently registered textures */
+	uint count() const { return _count; }
+
+private:
+
+	/** \brief Released slot waiting for reuse. */
+	struct FreeSlot {
+		uint slot; ///< The slot index.
+		uint64_t frame; ///< The frame the slot was released.
+	};
+
+	GPUContext* _context = nullptr; ///< The GPU context.
+	VkDescriptorSetLayout _layout = VK_NULL_HANDLE; ///< Table descriptor set layout.
+	VkDescriptorPool _pool = VK_NULL_HANDLE; ///< Dedicated pool, allowing updates after binding.
+	VkDescriptorSet _set = VK_NULL_HANDLE; ///< Table descriptor set.
+	std::deque<FreeSlot> _freeSlots; ///< Released slots, in release order.
+	uint _capacity = 0; ///< Maximum number of slots.
+	uint _next = 0; ///< Next never used slot.
+	uint _count = 0; ///< Number of used slots.
+};
@@ -3,13 +3,15 @@
 #include "resources/Library.hpp"
 #include "resources/ResourcesManager.hpp"
 
-BoxBlur::BoxBlur(bool approximate, const std::string & name) : _intermediate(name + " Box blur") {
+BoxBlur::BoxBlur(bool approximate, const std::string & name) : _intermediate(name + " Box blur"), _storage(name + " Box blur storage") {
 
 	const std::string suffix = approximate ? "-approx" : "";
 	_blur2D = Resources::manager().getProgram2D("box-blur-2d" + suffix);
 	_blurArray = Resources::manager().getProgram2D("box-blur-2d-array" + suffix);
 	_blurCube = Resources::manager().getProgram("box-blur-cube" + suffix, "box-blur-cube", "box-blur-cube" + suffix);
 	_blurCubeArray = Resources::manager().getProgram("box-blur-cube-array" + suffix, "box-blur-cube","box-blur-cube-array" + suffix);
+	_blur2DCompute = Resources::manager().getProgramCompute("box-blur-2d-compute");
+	_blurArrayCompute = Resources::manager().getProgramCompute("box-blur-2d-array-compute");
 
 }
 
@@ -17,6 +19,26 @@ BoxBlur::BoxBlur(bool approximate, const std::string & name) : _intermediate(nam
 void BoxBlur::process(const Texture& src, Texture & dst) {
 	GPUMarker marker("Box blur");
 
+	const TextureShape & tgtShape = dst.shape;
+	if(_compute && (tgtShape == TextureShape::D2 || tgtShape == TextureShape::Array2D)){
+		// Storage images have a fixed format, the result is converted when copied to the destination.
+		if(!_storage.gpu || _storage.shape != tgtShape || _storage.depth != dst.depth){
+			_storage.setupAsDrawable(Layout::RGBA32F, dst.width, dst.height, tgtShape, 1, dst.depth);
+		}
+		if(_storage.width != dst.width || _storage.height != dst.height){
+			_storage.resize(dst.width, dst.height);
+		}
+		// All layers are processed in a single dispatch.
+		Program * program = tgtShape == TextureShape::D2 ? _blur2DCompute : _blurArrayCompute;
+		program->use();
+		program->texture(src, 0);
+		program->texture(_storage, 1, 0);
+		GPU::dispatch(_storage.width, _storage.height, _storage.depth);
+
+		GPU::blit(_storage, dst, Filter::NEAREST);
+		return;
+	}
+
 	GPU::setDepthState(false);
 	GPU::setBlendState(false);
 	GPU::setCullState(true, Faces::BACK);
@@ -32,7 +54,6 @@ void BoxBlur::process(const Texture& src, Texture & dst) {
 
 	GPU::setViewport(_intermediate);
 
-	const TextureShape & tgtShape = dst.shape;
 	if(tgtShape == TextureShape::D2){
 		_blur2D->use();
 		GPU::beginRender(Load::Operation::DONTCARE, &_intermediate);
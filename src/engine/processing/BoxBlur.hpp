@@ -6,7 +6,7 @@
 
 /**
  \brief Applies a box blur of fixed radius 2. Correspond to uniformly averaging values over a 5x5 square window.
- \details An approximate (checkboard pattern) version doing half as many fetches is available. his blur can be applied to 2D, cubemap, 2D arrays and cubemap arrays textures.
+ \details An approximate (checkboard pattern) version doing half as many fetches is available. his blur can be applied to 2D, cubemap, 2D arrays and cubemap arrays textures. 2D and 2D arrays textures can also be processed by a compute shader, where each workgroup loads a tile of texels in shared memory once and applies the blur separably.
  \ingroup Processing
  */
 class BoxBlur {
@@ -27,6 +27,12 @@ public:
 	 */
 	void process(const Texture & src, Texture & dst);
 
+	/** Toggle the compute shader implementation, for 2D and 2D arrays textures. Cubemaps are always processed by rasterization.
+	 \param compute use compute shaders
+	 \note The compute implementation always performs the exhaustive box blur.
+	 */
+	void useCompute(bool compute){ _compute = compute; }
+
 private:
 
 	/**
@@ -40,5 +46,9 @@ private:
 	Program * _blurArray;					///< Box blur program
 	Program * _blurCube;					///< Box blur program
 	Program * _blurCubeArray;				///< Box blur program
+	Program * _blur2DCompute;				///< Box blur compute program
+	Program * _blurArrayCompute;			///< Box blur compute program
 	Texture _intermediate; 					///< Intermediate texture.
+	Texture _storage; 						///< Intermediate storage texture, for compute shaders.
+	bool _compute = false;					///< Use compute shaders when possible.
 };
@@ -8,6 +8,9 @@ ConvolutionPyramid::ConvolutionPyramid(uint width, uint height, uint inoutPaddin
 	_downscale = Resources::manager().getProgram2D("downscale");
 	_upscale   = Resources::manager().getProgram2D("upscale");
 	_filter	= Resources::manager().getProgram2D("filter");
+	_downscaleCompute = Resources::manager().getProgramCompute("downscale-compute");
+	_upscaleCompute	  = Resources::manager().getProgramCompute("upscale-compute");
+	_filterCompute	  = Resources::manager().getProgramCompute("filter-compute");
 	_padder	= Resources::manager().getProgram2D("passthrough-shift");
 
 	// Pre and post process texture.
@@ -55,6 +58,25 @@ void ConvolutionPyramid::process(const Texture& texture) {
 	GPU::drawQuad();
 	GPU::endRender();
 
+	// Filter and combine all levels.
+	if(_compute) {
+		computePyramid();
+	} else {
+		rasterPyramid();
+	}
+
+	// Compensate the initial padding.
+	GPU::beginRender(Load::Operation::DONTCARE, &_shifted);
+	GPU::setViewport(_shifted);
+	_padder->use();
+	// Need to also compensate for the potential extra padding.
+	_padder->uniform("padding", -_size - _padding);
+	_padder->texture(_levelsOut[0], 0);
+	GPU::drawQuad();
+	GPU::endRender();
+}
+
+void ConvolutionPyramid::rasterPyramid() {
 	// Then iterate over all levels, cascading down the filtered results.
 	/// \note Those filters are separable, and could be applied in two passes (vertical and horizontal) to reduce the texture fetches count.
 	// Send parameters.
@@ -113,16 +135,50 @@ void ConvolutionPyramid::process(const Texture& texture) {
 		GPU::drawQuad();
 		GPU::endRender();
 	}
+}
 
-	// Compensate the initial padding.
-	GPU::beginRender(Load::Operation::DONTCARE, &_shifted);
-	GPU::setViewport(_shifted);
-	_padder->use();
-	// Need to also compensate for the potential extra padding.
-	_padder->uniform("padding", -_size - _padding);
-	_padder->texture(_levelsOut[0], 0);
-	GPU::drawQuad();
-	GPU::endRender();
+void ConvolutionPyramid::computePyramid() {
+	// Do: l[i] = downscale(filter(l[i-1], h1)), the filter being applied separately in shared memory.
+	_downscaleCompute->use();
+	_downscaleCompute->uniform("h1[0]", _h1[0]);
+	_downscaleCompute->uniform("h1[1]", _h1[1]);
+	_downscaleCompute->uniform("h1[2]", _h1[2]);
+	_downscaleCompute->uniform("h1[3]", _h1[3]);
+	_downscaleCompute->uniform("h1[4]", _h1[4]);
+	for(size_t i = 1; i < _levelsIn.size(); ++i) {
+		// The padded region is filled with 0s by the shader.
+		_downscaleCompute->texture(_levelsIn[i - 1], 0);
+		_downscaleCompute->texture(_levelsIn[i], 1, 0);
+		GPU::dispatch(_levelsIn[i].width, _levelsIn[i].height, 1);
+	}
+
+	// Do:  f[end] = filter(l[end], g)
+	const auto & lastLevel = _levelsOut.back();
+	_filterCompute->use();
+	_filterCompute->uniform("g[0]", _g[0]);
+	_filterCompute->uniform("g[1]", _g[1]);
+	_filterCompute->uniform("g[2]", _g[2]);
+	_filterCompute->texture(_levelsIn.back(), 0);
+	_filterCompute->texture(lastLevel, 1, 0);
+	GPU::dispatch(lastLevel.width, lastLevel.height, 1);
+
+	// Do: f[i] = filter(l[i], g) + filter(upscale(f[i+1], h2)
+	_upscaleCompute->use();
+	_upscaleCompute->uniform("h1[0]", _h1[0]);
+	_upscaleCompute->uniform("h1[1]", _h1[1]);
+	_upscaleCompute->uniform("h1[2]", _h1[2]);
+	_upscaleCompute->uniform("h1[3]", _h1[3]);
+	_upscaleCompute->uniform("h1[4]", _h1[4]);
+	_upscaleCompute->uniform("g[0]", _g[0]);
+	_upscaleCompute->uniform("g[1]", _g[1]);
+	_upscaleCompute->uniform("g[2]", _g[2]);
+	_upscaleCompute->uniform("h2", _h2);
+	for(int i = int(_levelsOut.size() - 2); i >= 0; --i) {
+		_upscaleCompute->texture(_levelsIn[i], 0);
+		_upscaleCompute->texture(_levelsOut[i + 1], 1);
+		_upscaleCompute->texture(_levelsOut[i], 2, 0);
+		GPU::dispatch(_levelsOut[i].width, _levelsOut[i].height, 1);
+	}
 }
 
 void ConvolutionPyramid::setFilters(const float h1[5], float h2, const float g[3]) {
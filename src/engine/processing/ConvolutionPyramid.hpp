@@ -8,6 +8,7 @@
  This is the basis of the technique described in Convolution Pyramids, Farbman et al., 2011.
  A set of filter parameters can be estimated through an offline optimization for each desired task:
  gradient field integration, seamless image cloning, background filling, or scattered data interpolation.
+ The pyramid can also be processed by compute shaders, applying the separable filters on tiles loaded in shared memory.
  \ingroup Processing
  */
 class ConvolutionPyramid {
@@ -55,11 +56,26 @@ public:
 	 */
 	unsigned int height() { return _resolution[1]; }
 
+	/** Toggle the compute shader implementation of the pyramid levels processing.
+	 \param compute use compute shaders
+	 */
+	void useCompute(bool compute){ _compute = compute; }
+
 private:
+
+	/** Filter and combine the pyramid levels using rasterization. */
+	void rasterPyramid();
+
+	/** Filter and combine the pyramid levels using compute shaders. */
+	void computePyramid();
+
 	Program * _downscale; ///< Pyramid descending pass shader.
 	Program * _upscale;   ///< Pyramid ascending pass shader.
 	Program * _filter;	///< Filtering shader for the last pyramid level.
 	Program * _padder;	///< Padding helper shader.
+	Program * _downscaleCompute; ///< Pyramid descending pass compute shader.
+	Program * _upscaleCompute;   ///< Pyramid ascending pass compute shader.
+	Program * _filterCompute;	 ///< Filtering compute shader for the last pyramid level.
 
 	Texture _shifted;				  ///< Contains the input data padded to the right size.
 	std::vector<Texture> _levelsIn;  ///< The initial levels of the pyramid.
@@ -72,4 +88,5 @@ private:
 	glm::ivec2 _resolution = glm::ivec2(0); ///< Resolution expected for the input texture.
 	const int _size		   = 5;				///< Size of the filter.
 	int _padding		   = 0;				///< Additional padding.
+	bool _compute		   = false;			///< Use compute shaders.
 };
@@ -12,6 +12,8 @@ FloodFiller::FloodFiller(uint width, uint height)
 
 	_extract		= Resources::manager().getProgram2D("extract-seeds");
 	_floodfill		= Resources::manager().getProgram2D("flood-fill");
+	_floodfillCompute = Resources::manager().getProgramCompute("flood-fill-compute");
+	_floodfillFused	  = Resources::manager().getProgramCompute("flood-fill-fused-compute");
 	_compositeDist  = Resources::manager().getProgram2D("distance-seeds");
 	_compositeColor = Resources::manager().getProgram2D("color-seeds");
 }
@@ -54,6 +56,10 @@ Texture* FloodFiller::extractAndPropagate(const Texture& texture) {
 	GPU::drawQuad();
 	GPU::endRender();
 
+	if(_compute){
+		return propagateCompute();
+	}
+
 	Texture* result = &_ping;
 	// Propagate closest seeds with decreasing step size.
 	_floodfill->use();
@@ -74,6 +80,48 @@ Texture* FloodFiller::extractAndPropagate(const Texture& texture) {
 	return result;
 }
 
+Texture* FloodFiller::propagateCompute() {
+	// The last three steps (4, 2 and 1) are performed by a single fused pass if possible.
+	const int fusedCount = 3;
+	const int stepCount = _iterations >= fusedCount ? (_iterations - fusedCount) : _iterations;
+
+	Texture* result = &_ping;
+	_floodfillCompute->use();
+	for(int i = 0; i < stepCount; ++i) {
+		const int step = int(std::pow(2, std::max(0, _iterations - i - 1)));
+
+		Texture* src = (i%2 == 0) ? &_ping : &_pong;
+		Texture* dst = (i%2 == 0) ? &_pong : &_ping;
+		_floodfillCompute->uniform("stepDist", step);
+		_floodfillCompute->texture(*src, 0);
+		_floodfillCompute->texture(*dst, 1, 0);
+		GPU::dispatch(dst->width, dst->height, 1);
+
+		result = dst;
+	}
+	if(stepCount == _iterations){
+		return result;
+	}
+
+	Texture* dst = (result == &_ping) ? &_pong : &_ping;
+	_floodfillFused->use();
+	_floodfillFused->texture(*result, 0);
+	_floodfillFused->texture(*dst, 1, 0);
+	GPU::dispatch(dst->width, dst->height, 1);
+	return dst;
+}
+
+void FloodFiller::useCompute(bool compute) {
+	if(compute == _compute){
+		return;
+	}
+	_compute = compute;
+	// Storage images need a format supported by all devices.
+	const Layout format = _compute ? Layout::RG32UI : Layout::RG16UI;
+	_ping.setupAsDrawable(format, _ping.width, _ping.height);
+	_pong.setupAsDrawable(format, _pong.width, _pong.height);
+}
+
 void FloodFiller::resize(uint width, uint height) {
 	_iterations = int(std::ceil(std::log2(std::max(width, height))));
 	_ping.resize(width, height);
@@ -6,6 +6,7 @@
 /**
  \brief Perform an approximate flood fill on the GPU, outputing a color filled image or a distance map.
  Implement the method described in Jump Flooding in GPU with Applications to Voronoi Diagram and Distance Transform, Rong et al., 2006.
+ The flooding steps can also be performed by compute shaders, the last three steps being fused in a single pass that keeps intermediate seeds in shared memory.
  \ingroup Processing
  */
 class FloodFiller {
@@ -36,6 +37,11 @@ public:
 	 */
 	void resize(uint width, uint height);
 
+	/** Toggle the compute shader implementation of the flooding steps.
+	 \param compute use compute shaders
+	 */
+	void useCompute(bool compute);
+
 	/** The GPU ID of the filter result.
 	 \return the ID of the result texture
 	 */
@@ -48,8 +54,15 @@ private:
 	 */
 	Texture* extractAndPropagate(const Texture& texture);
 
+	/** Propagate seeds using compute shaders.
+	 \return the internal texture containing the final result
+	 */
+	Texture* propagateCompute();
+
 	Program * _extract;		 ///< Extract the flood fill seeds.
 	Program * _floodfill;		 ///< Perform one pass of the flood fill.
+	Program * _floodfillCompute; ///< Perform one pass of the flood fill in a compute shader.
+	Program * _floodfillFused;	 ///< Perform the last three passes of the flood fill in a compute shader.
 	Program * _compositeColor; ///< Generate the color image from the flood-fill seed map.
 	Program * _compositeDist;  ///< Generate the normalized distance map from the flood-fill seed map.
 
@@ -58,4 +71,5 @@ private:
 	Texture _final; ///< Texture containing the result.
 
 	int _iterations; ///< Number of iterations to perform (derived from input size).
+	bool _compute = false; ///< Use compute shaders.
 };
@@ -7,6 +7,8 @@ GaussianBlur::GaussianBlur(uint radius, uint downscale, const std::string & name
 	_passthrough 		= Resources::manager().getProgram("passthrough");
 	_blurProgramDown	= Resources::manager().getProgram2D("blur-dual-filter-down");
 	_blurProgramUp		= Resources::manager().getProgram2D("blur-dual-filter-up");
+	_blurComputeDown	= Resources::manager().getProgramCompute("blur-dual-filter-down-compute");
+	_blurComputeUp		= Resources::manager().getProgramCompute("blur-dual-filter-up-compute");
 
 	for(size_t i = 0; i < radius; ++i) {
 		_levels.emplace_back(name + " Gaussian blur level " + std::to_string(i));
@@ -26,9 +28,10 @@ void GaussianBlur::process(const Texture& src, Texture & dst) {
 
 	const uint width = dst.width / _downscale;
 	const uint height = dst.height / _downscale;
-	if(!_levels[0].gpu || _levels[0].format != dst.format){
+	const Layout format = levelsFormat(dst.format);
+	if(!_levels[0].gpu || _levels[0].format != format){
 		for(size_t i = 0; i < _levels.size(); ++i) {
-			_levels[i].setupAsDrawable(dst.format, uint(width / std::pow(2, i)), uint(height / std::pow(2, i)));
+			_levels[i].setupAsDrawable(format, uint(width / std::pow(2, i)), uint(height / std::pow(2, i)));
 		}
 	}
 	if(_levels[0].width != width || _levels[0].height != height){
@@ -36,39 +39,94 @@ void GaussianBlur::process(const Texture& src, Texture & dst) {
 	}
 
 	// First, copy the input texture to the first texture level.
-	GPU::beginRender(Load::Operation::DONTCARE, &_levels[0]);
-	GPU::setViewport(_levels[0]);
-
-	_passthrough->use();
-	_passthrough->texture(src, 0);
-	GPU::drawQuad();
-	GPU::endRender();
+	copy(src, _levels[0]);
 
 	// Downscale filter.
-	_blurProgramDown->use();
 	for(size_t d = 1; d < _levels.size(); ++d) {
 		GPUMarker marker("Blur down");
-		GPU::beginRender(glm::vec4(0.0f), &_levels[d]);
-		GPU::setViewport(_levels[d]);
-		_blurProgramDown->texture(_levels[d - 1], 0);
-		GPU::drawQuad();
-		GPU::endRender();
+		filter(_blurProgramDown, _blurComputeDown, _levels[d - 1], _levels[d], glm::vec4(0.0f));
 	}
 
 	// Upscale filter.
-	_blurProgramUp->use();
 	for(int d = int(_levels.size()) - 2; d >= 0; --d) {
 		GPUMarker marker("Blur up");
-		GPU::beginRender(glm::vec4(0.0f), &_levels[d]);
-		GPU::setViewport(_levels[d]);
-		_blurProgramUp->texture(_levels[d + 1], 0);
-		GPU::drawQuad();
-		GPU::endRender();
+		filter(_blurProgramUp, _blurComputeUp, _levels[d + 1], _levels[d], glm::vec4(0.0f));
 	}
 	// Copy from the last texture used to the destination.
 	GPU::blit(_levels[0], dst, Filter::LINEAR);
 }
 
+void GaussianBlur::process(RenderGraph & graph, RenderGraph::Resource src, RenderGraph::Resource dst) {
+	if(_levels.empty()) {
+		return;
+	}
+
+	const RenderGraph::Description target = graph.description(dst);
+	const uint width = target.width / _downscale;
+	const uint height = target.height / _downscale;
+	std::vector<RenderGraph::Resource> levels(_levels.size());
+	for(size_t i = 0; i < _levels.size(); ++i) {
+		levels[i] = graph.createTexture(_levels[i].name(), levelsFormat(target.format), uint(width / std::pow(2, i)), uint(height / std::pow(2, i)));
+	}
+
+	// First, copy the input texture to the first texture level.
+	const RenderGraph::Resource first = levels[0];
+	graph.addPass("Gaussian blur", { src }, { first }, [this, &graph, src, first](){
+		GPU::setDepthState(false);
+		GPU::setBlendState(false);
+		GPU::setCullState(true, Faces::BACK);
+		copy(graph.texture(src), graph.texture(first));
+	});
+
+	// Downscale filter.
+	for(size_t d = 1; d < levels.size(); ++d) {
+		const RenderGraph::Resource input = levels[d - 1];
+		const RenderGraph::Resource output = levels[d];
+		graph.addPass("Blur down", { input }, { output }, [this, &graph, input, output](){
+			filter(_blurProgramDown, _blurComputeDown, graph.texture(input), graph.texture(output), glm::vec4(0.0f));
+		});
+	}
+
+	// Upscale filter.
+	for(int d = int(levels.size()) - 2; d >= 0; --d) {
+		const RenderGraph::Resource input = levels[d + 1];
+		const RenderGraph::Resource output = levels[d];
+		graph.addPass("Blur up", { input }, { output }, [this, &graph, input, output](){
+			filter(_blurProgramUp, _blurComputeUp, graph.texture(input), graph.texture(output), glm::vec4(0.0f));
+		});
+	}
+
+	// Copy from the last texture used to the destination.
+	graph.addPass("Blur copy", { first }, { dst }, [&graph, first, dst](){
+		GPU::blit(graph.texture(first), graph.texture(dst), Filter::LINEAR);
+	});
+}
+
+void GaussianBlur::filter(Program * program, Program * compute, const Texture & src, const Texture & dst, const Load & colorOp) {
+	if(_compute){
+		compute->use();
+		compute->texture(src, 0);
+		compute->texture(dst, 1, 0);
+		GPU::dispatch(dst.width, dst.height, 1);
+		return;
+	}
+	GPU::beginRender(colorOp, &dst);
+	GPU::setViewport(dst);
+	program->use();
+	program->texture(src, 0);
+	GPU::drawQuad();
+	GPU::endRender();
+}
+
+void GaussianBlur::copy(const Texture & src, const Texture & dst) {
+	if(_compute){
+		// No need for a render pass, a linear blit of the first layer and mip performs the same resampling.
+		GPU::blit(src, dst, 0, 0, 0, 0, Filter::LINEAR);
+		return;
+	}
+	filter(_passthrough, nullptr, src, dst, Load::Operation::DONTCARE);
+}
+
 void GaussianBlur::resize(uint width, uint height) {
 	const uint dwidth = width/_downscale;
 	const uint dheight = height/_downscale;
@@ -2,6 +2,7 @@
 
 #include "resources/Texture.hpp"
 #include "graphics/Program.hpp"
+#include "renderers/RenderGraph.hpp"
 #include "Common.hpp"
 
 /**
@@ -10,6 +11,7 @@
  The input texture is downscaled a number of times, using a custom filter as described by Marius Bjørge in the 'Bandwidth-Efficient Rendering' presentation, Siggraph 2015
  (https://community.arm.com/cfs-file/__key/communityserver-blogs-components-weblogfiles/00-00-00-20-66/siggraph2015_2D00_mmg_2D00_marius_2D00_slides.pdf).
  The image is then upscaled again with a second custom filter.
+ Both filters can also be applied by compute shaders, writing directly to the levels without going through render passes; the levels then use a fixed half-float format.
  
  \see GPU::Frag::Blur-dual-filter-down, GPU::Frag::Blur-dual-filter-up
  \ingroup Processing
@@ -33,8 +35,44 @@ public:
 	 */
 	void process(const Texture& src, Texture & dst);
 
+	/**
+	 Add the blurring passes to a render graph, the pyramid levels being transient textures of the graph.
+	 \note It is possible to use the same texture as input and output.
+	 \param graph the render graph to add passes to
+	 \param src the texture to process
+	 \param dst the destination texture
+	 */
+	void process(RenderGraph & graph, RenderGraph::Resource src, RenderGraph::Resource dst);
+
+	/** Toggle the compute shader implementation.
+	 \param compute use compute shaders
+	 */
+	void useCompute(bool compute){ _compute = compute; }
+
 private:
 
+	/**
+	 Apply a filter program to a texture.
+	 \param program the filter program
+	 \param compute the equivalent compute program
+	 \param src the texture to filter
+	 \param dst the destination texture
+	 \param colorOp the operation to perform on the destination
+	 */
+	void filter(Program * program, Program * compute, const Texture & src, const Texture & dst, const Load & colorOp);
+
+	/**
+	 Copy a texture to the first level of the pyramid, resizing it.
+	 \param src the texture to copy
+	 \param dst the first level
+	 */
+	void copy(const Texture & src, const Texture & dst);
+
+	/** \param format the destination format
+	 \return the format to use for the pyramid levels
+	 */
+	Layout levelsFormat(const Layout & format) const { return _compute ? Layout::RGBA16F : format; }
+
 	/**
 	  Handle screen resizing if needed.
 	 \param width the new width to use
@@ -45,6 +83,9 @@ private:
 	Program * _blurProgramDown;						///< The downscaling filter.
 	Program * _blurProgramUp;						///< The upscaling filter.
 	Program * _passthrough;							///< The copy program.
+	Program * _blurComputeDown;						///< The downscaling filter compute program.
+	Program * _blurComputeUp;						///< The upscaling filter compute program.
 	std::vector<Texture> _levels; 					///< Downscaled pyramid textures.
 	uint _downscale = 1;							///< Initial downscaling factor.
+	bool _compute = false;							///< Use compute shaders.
 };
@@ -29,6 +29,11 @@ public:
 	 */
 	void resize(uint width, uint height);
 
+	/** Toggle the compute shader implementation of the convolution pyramid.
+	 \param compute use compute shaders
+	 */
+	void useCompute(bool compute){ _pyramid.useCompute(compute); }
+
 	/** The ID of the texture containing the integration result.
 	 \return the result texture ID.
 	 */
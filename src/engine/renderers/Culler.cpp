@@ -2,9 +2,10 @@
 #include "resources/Bounds.hpp"
 #include "scene/Material.hpp"
 
-Culler::Culler(const std::vector<Object> & objects) : _objects(objects), _frustum(glm::mat4(1.0f)) {
+Culler::Culler(const std::vector<Object> & objects, const ObjectsHierarchy * hierarchy) : _objects(objects), _hierarchy(hierarchy), _frustum(glm::mat4(1.0f)) {
 	_order.resize(objects.size(), -1);
 	_distances.resize(objects.size());
+	_ranges.resize(objects.size());
 	_maxCount = (unsigned long)(objects.size());
 }
 
@@ -21,15 +22,17 @@ const Culler::List & Culler::cull(const glm::mat4 & view, const glm::mat4 & proj
 	}
 
 
+	gatherVisibles(proj * view);
+
 	// Culling, looking only at the first maxCount objects at most.
 	size_t cid = 0;
-	const size_t allowedCount = std::min(objCount, size_t(_maxCount));
-	for(size_t oid = 0; oid < allowedCount; ++oid){
-		// If the object falls inside the frustum, store its index in the result list.
-		if(_frustum.intersects(_objects[oid].boundingBox())){
-			_order[cid] = long(oid);
-			++cid;
+	const long allowedCount = long(std::min(objCount, size_t(_maxCount)));
+	for(const long oid : _visibles){
+		if(oid >= allowedCount){
+			break;
 		}
+		_order[cid] = oid;
+		++cid;
 	}
 	// Fill the rest of the result with -1s.
 	for(size_t ocid = cid; ocid < objCount; ++ocid){
@@ -81,23 +84,22 @@ const Culler::List & Culler::cullAndSort(const glm::mat4 & view, const glm::mat4
 		{ Material::TransparentIrid, 	2 },
 	};
 
-	// Culling and distance computation.
+	gatherVisibles(proj * view);
+
+	// Distance computation for objects inside the frustum.
 	size_t cid = 0;
-	for(size_t oid = 0; oid < objCount; ++oid){
-		// If the object falls inside the frustum, compute its distance.
+	for(const long oid : _visibles){
 		const BoundingBox & bbox = _objects[oid].boundingBox();
-		if(_frustum.intersects(bbox)){
-			_distances[cid].id = long(oid);
+		_distances[cid].id = oid;
 
-			const Material::Type & type = _objects[oid].material().type();
-			const double sign = orders.at(type) == Ordering::FRONT_TO_BACK ? 1.0 : -1.0;
-			const glm::vec3 dist = pos - bbox.getCentroid();
+		const Material::Type & type = _objects[oid].material().type();
+		const double sign = orders.at(type) == Ordering::FRONT_TO_BACK ? 1.0 : -1.0;
+		const glm::vec3 dist = pos - bbox.getCentroid();
 
-			_distances[cid].distance = sign * double(glm::dot(dist, dist));
-			_distances[cid].material = sets.at(type);
+		_distances[cid].distance = sign * double(glm::dot(dist, dist));
+		_distances[cid].material = sets.at(type);
 
-			++cid;
-		}
+		++cid;
 	}
 	// Sort wrt distances.
 	std::sort(_distances.begin(), _distances.begin() + cid, [](const DistPair & a, const DistPair & b){
@@ -125,11 +127,124 @@ const Culler::List & Culler::cullAndSort(const glm::mat4 & view, const glm::mat4
 	return _order;
 }
 
+void Culler::prepare(const std::vector<glm::mat4> & viewProjs){
+	_preparedViews.clear();
+	_preparedVisibles.clear();
+	if(!hierarchyAvailable()){
+		return;
+	}
+	std::vector<Frustum> frustums;
+	frustums.reserve(viewProjs.size());
+	for(const glm::mat4 & viewProj : viewProjs){
+		frustums.emplace_back(viewProj);
+	}
+	_hierarchy->query(frustums, _preparedVisibles);
+	_preparedViews = viewProjs;
+}
+
+bool Culler::hierarchyAvailable() const {
+	// The hierarchy might be out of sync with the objects if the scene has been modified.
+	return _useHierarchy && _hierarchy && _hierarchy->built() && _hierarchy->count() == _objects.size();
+}
+
+void Culler::gatherVisibles(const glm::mat4 & viewProj){
+	if(hierarchyAvailable()){
+		// Reuse the result of a prepared view, only once.
+		const auto prepared = std::find(_preparedViews.begin(), _preparedViews.end(), viewProj);
+		if(!_freezeFrustum && prepared != _preparedViews.end()){
+			const long vid = long(std::distance(_preparedViews.begin(), prepared));
+			std::swap(_visibles, _preparedVisibles[vid]);
+			_preparedViews.erase(prepared);
+			_preparedVisibles.erase(_preparedVisibles.begin() + vid);
+		} else {
+			_hierarchy->query(_frustum, _visibles);
+		}
+		// Keep a deterministic order.
+		std::sort(_visibles.begin(), _visibles.end());
+		return;
+	}
+	const size_t objCount = _objects.size();
+	_visibles.clear();
+	for(size_t oid = 0; oid < objCount; ++oid){
+		// If the object falls inside the frustum, store its index.
+		if(_frustum.intersects(_objects[oid].boundingBox())){
+			_visibles.push_back(long(oid));
+		}
+	}
+}
+
+void Culler::cullClusters(const List & visibles, const glm::vec3 & pos){
+	// Handle scene changes.
+	const size_t objCount = _objects.size();
+	if(_ranges.size() != objCount){
+		_ranges.resize(objCount);
+	}
+	_clusterMetrics = ClusterMetrics();
+
+	for(const long & objectId : visibles){
+		// Once we get a -1, there is no other object to process.
+		if(objectId == -1){
+			break;
+		}
+		const Object & object = _objects[objectId];
+		const Mesh & mesh = *object.mesh();
+		const uint indexCount = uint(mesh.metrics().indices);
+		Ranges & ranges = _ranges[objectId];
+		ranges.clear();
+		_clusterMetrics.triangles += indexCount / 3;
+
+		// Objects without clusters are drawn entirely.
+		if(!_cullClusters || mesh.meshlets.empty()){
+			ranges.emplace_back(0u, indexCount);
+			continue;
+		}
+
+		const glm::mat4 & model = object.model();
+		// Conservative radius scaling, in case of non-uniform scaling.
+		const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		// The backface test is performed in model space, as the side of a plane is preserved by affine transformations.
+		const bool cullBackfaces = !object.material().twoSided();
+		const glm::vec3 localPos = glm::vec3(glm::inverse(model) * glm::vec4(pos, 1.0f));
+
+		for(const Mesh::Meshlet & meshlet : mesh.meshlets){
+			++_clusterMetrics.clusters;
+			bool visible = true;
+			if(cullBackfaces){
+				const glm::vec3 dir = meshlet.bounds.center - localPos;
+				visible = glm::dot(dir, meshlet.coneAxis) < (meshlet.coneCutoff * glm::length(dir) + meshlet.bounds.radius);
+			}
+			if(visible){
+				const BoundingSphere sphere(glm::vec3(model * glm::vec4(meshlet.bounds.center, 1.0f)), scale * meshlet.bounds.radius);
+				visible = _frustum.intersects(sphere);
+			}
+			if(!visible){
+				++_clusterMetrics.culledClusters;
+				_clusterMetrics.culledTriangles += meshlet.indexCount / 3;
+				continue;
+			}
+			// Merge with the previous range if contiguous, to limit the number of draw calls.
+			if(!ranges.empty() && (ranges.back()[0] + ranges.back()[1] == meshlet.firstIndex)){
+				ranges.back()[1] += meshlet.indexCount;
+			} else {
+				ranges.emplace_back(meshlet.firstIndex, meshlet.indexCount);
+			}
+		}
+	}
+}
+
 void Culler::interface(){
 	ImGui::Checkbox("Freeze culling", &_freezeFrustum);
 	ImGui::SameLine();
 	// Custom ImGui input for a ulong.
 	const unsigned long step = 1, stepFast = 100;
 	ImGui::InputScalar("Max objects", ImGuiDataType_U64, (void*)&_maxCount, (void*)(&step), (void*)(&stepFast), "%u", 0);
+	ImGui::Checkbox("Cull clusters", &_cullClusters);
+	if(_hierarchy){
+		ImGui::SameLine();
+		ImGui::Checkbox("Use hierarchy", &_useHierarchy);
+	}
+	ImGui::Text("Objects: %lu visible / %lu", _visibles.size(), _objects.size());
+	ImGui::Text("Clusters: %lu culled / %lu", _clusterMetrics.culledClusters, _clusterMetrics.clusters);
+	ImGui::Text("Triangles: %lu culled / %lu", _clusterMetrics.culledTriangles, _clusterMetrics.triangles);
 
 }
@@ -2,6 +2,7 @@
 
 #include "Common.hpp"
 #include "scene/Object.hpp"
+#include "scene/ObjectsHierarchy.hpp"
 
 /**
  \brief Select and sort objects based on visibility and distance criteria.
@@ -13,11 +14,21 @@ class Culler {
 public:
 
 	using List = std::vector<long>; ///< Indices of selected objects.
+	using Ranges = std::vector<glm::uvec2>; ///< Index ranges (first index, index count) of an object mesh.
+
+	/** \brief Statistics on the last clusters culling. */
+	struct ClusterMetrics {
+		size_t clusters = 0; ///< Number of clusters tested.
+		size_t culledClusters = 0; ///< Number of clusters rejected.
+		size_t triangles = 0; ///< Number of triangles in the visible objects.
+		size_t culledTriangles = 0; ///< Number of triangles rejected.
+	};
 
 	/** Constructor
 	 \param objects the list of objects to process
+	 \param hierarchy optional bounding volume hierarchy over the objects, used to accelerate frustum culling
 	 */
-	Culler(const std::vector<Object> & objects);
+	Culler(const std::vector<Object> & objects, const ObjectsHierarchy * hierarchy = nullptr);
 
 	/** Detect objects that are inside the view frustum. This returns the indices of the objects that are visible in a list padded to the objects count with -1s.
 	 \param view the view matrix
@@ -36,6 +47,28 @@ public:
 	 */
 	const List & cullAndSort(const glm::mat4 & view, const glm::mat4 & proj, const glm::vec3 & pos);
 
+	/** Refine the visible objects by culling their meshlets against the current view frustum and their normal cone. For each visible object, this builds a list of index ranges to draw, merging contiguous clusters.
+	 \param visibles indices of the visible objects, as returned by cull or cullAndSort
+	 \param pos the camera position in world space
+	 \note Objects with no meshlets (or two-sided objects for the backface test) are not refined.
+	 */
+	void cullClusters(const List & visibles, const glm::vec3 & pos);
+
+	/** Detect objects inside several view frustums in a single traversal of the hierarchy, ahead of processing each view. The next call to cull or cullAndSort with one of these views will reuse its result.
+	 \param viewProjs the view-projection matrix of each view
+	 \note Prepared views that have not been used are discarded at the next call.
+	 */
+	void prepare(const std::vector<glm::mat4> & viewProjs);
+
+	/** Query the index ranges to draw for an object, after clusters culling.
+	 \param objectId the index of the object, as returned by cull or cullAndSort
+	 \return the list of index ranges (empty if all clusters were culled)
+	 */
+	const Ranges & ranges(long objectId) const { return _ranges[objectId]; }
+
+	/** \return statistics on the last clusters culling */
+	const ClusterMetrics & clusterMetrics() const { return _clusterMetrics; }
+
 	/** Display culling options GUI. */
 	void interface();
 
@@ -63,8 +96,21 @@ private:
 		BACK_TO_FRONT  ///< Furthest first.
 	};
 
+	/** Find all objects intersecting the current frustum, using the hierarchy or a prepared view if available.
+	 The result is stored in _visibles, sorted by increasing index.
+	 \param viewProj the view-projection matrix of the current view
+	 */
+	void gatherVisibles(const glm::mat4 & viewProj);
+
+	/** \return true if the hierarchy can be used to find visible objects */
+	bool hierarchyAvailable() const;
+
 	const std::vector<Object> & _objects; ///< Reference to the objects to process.
+	const ObjectsHierarchy * _hierarchy; ///< Optional hierarchy over the objects.
 	List _order; ///< Will contain the indices of the objects selected.
+	List _visibles; ///< Intermediate storage for objects intersecting the frustum.
+	std::vector<glm::mat4> _preparedViews; ///< View-projection matrices of the views culled ahead of time.
+	std::vector<List> _preparedVisibles; ///< Objects intersecting each prepared view.
 
 	/** Information for object sorting. */
 	struct DistPair {
@@ -73,9 +119,13 @@ private:
 		long material = -1; ///< Material set (lower is closer).
 	};
 	std::vector<DistPair> _distances; ///< Intermediate storage for sorting.
+	std::vector<Ranges> _ranges; ///< Per-object index ranges to draw.
+	ClusterMetrics _clusterMetrics; ///< Clusters culling statistics.
 
 	Frustum _frustum; ///< Current view frustum.
 	unsigned long _maxCount; ///< Maximum number of objects to select
 	bool _freezeFrustum = false; ///< Should the frustum not be updated.
+	bool _cullClusters = true; ///< Should meshlets be culled individually.
+	bool _useHierarchy = true; ///< Should the hierarchy be used if available.
 
 };
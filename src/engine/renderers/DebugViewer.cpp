@@ -216,7 +216,16 @@ void DebugViewer::registerTexture(const std::string& name, const Texture* tex, T
 		STRENUM(RGBA16I),
 		STRENUM(RGBA16UI),
 		STRENUM(RGBA32I),
-		STRENUM(RGBA32UI)
+		STRENUM(RGBA32UI),
+		STRENUM(BC1),
+		STRENUM(BC1_SRGB),
+		STRENUM(BC3),
+		STRENUM(BC3_SRGB),
+		STRENUM(BC4),
+		STRENUM(BC5),
+		STRENUM(BC6H),
+		STRENUM(BC7),
+		STRENUM(BC7_SRGB)
 	};
 
 	#undef STRENUM
@@ -349,6 +358,11 @@ void DebugViewer::displayMetrics(){
 			ImGui::Text("Buffers: %llu", metrics.buffers);
 			ImGui::Text("Programs: %llu", metrics.programs);
 			ImGui::Text("Pipelines: %llu", metrics.pipelines);
+			ImGui::Text("Frames submitted: %llu", metrics.submissions);
+			ImGui::Text("Frames overlapping GPU work: %llu", metrics.overlappedFrames);
+			ImGui::Text("Staging wraps: %llu", metrics.stagingWraps);
+			ImGui::Text("Staging stalls: %llu", metrics.stagingStalls);
+			ImGui::Text("Staging overflows: %llu", metrics.stagingOverflows);
 		}
 		if(ImGui::CollapsingHeader("Per-frame", ImGuiTreeNodeFlags_DefaultOpen)){
 			ImGui::Text("Blits: %llu", metrics.blitCount);
@@ -357,6 +371,12 @@ void DebugViewer::displayMetrics(){
 			ImGui::Text("Mesh bindings: %llu", metrics.meshBindings);
 			ImGui::Text("Screen quads: %llu", metrics.quadCalls);
 			ImGui::Text("Draw calls: %llu", metrics.drawCalls);
+			ImGui::Text("CPU wait (us): %llu", metrics.frameWait);
+			ImGui::Text("Staged bytes: %llu", metrics.stagedBytes);
+			ImGui::Text("Descriptor sets reused: %llu", metrics.descriptorHits);
+			ImGui::Text("Descriptor sets written: %llu", metrics.descriptorMisses);
+			ImGui::Text("Instances: %llu, indirect draws: %llu", metrics.instances, metrics.indirectCommands);
+			ImGui::Text("Batched objects: %llu in %llu batches", metrics.batchedObjects, metrics.batches);
 		}
 	}
 	ImGui::End();
@@ -535,6 +555,8 @@ void DebugViewer::displayMesh(MeshInfos & mesh) {
 		ImGui::Text("UVs: %lu", metrics.texcoords);
 		ImGui::NextColumn();
 		ImGui::Text("Indices: %lu", metrics.indices);
+		ImGui::NextColumn();
+		ImGui::Text("Meshlets: %lu", metrics.meshlets);
 		ImGui::Columns();
 		const auto & bbox = mesh.mesh->bbox;
 		if(!bbox.empty()){
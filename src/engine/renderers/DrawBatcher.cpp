@@ -0,0 +1,147 @@
+#include "renderers/DrawBatcher.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/GPUInternal.hpp"
+
+#include <algorithm>
+
+DrawBatcher::DrawBatcher(const std::string & name) : _name(name) {
+	GPUContext* context = GPU::getInternal();
+	// One copy per frame in flight, allocated at the first upload.
+	_frames.resize(context->frameCount);
+}
+
+void DrawBatcher::clear(){
+	_draws.clear();
+	_ranges.clear();
+	_batches.clear();
+}
+
+void DrawBatcher::add(Program * program, const Object & object, const glm::mat4 & view, const glm::mat4 & proj, const Culler::Ranges & ranges){
+	// Fully culled object.
+	if(ranges.empty()){
+		return;
+	}
+	_draws.emplace_back();
+	Draw & draw = _draws.back();
+	draw.program = program;
+	draw.object = &object;
+	draw.instance.mv = view * object.model();
+	draw.instance.mvp = proj * draw.instance.mv;
+	draw.instance.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(draw.instance.mv))));
+	draw.firstRange = uint(_ranges.size());
+	draw.rangeCount = uint(ranges.size());
+	const uint indexCount = uint(object.mesh()->metrics().indices);
+	draw.complete = ranges.size() == 1 && ranges[0][0] == 0 && ranges[0][1] == indexCount;
+	_ranges.insert(_ranges.end(), ranges.begin(), ranges.end());
+}
+
+bool DrawBatcher::sameState(const Draw & a, const Draw & b){
+	return a.program == b.program && a.object->mesh() == b.object->mesh()
+		&& &a.object->material() == &b.object->material() && a.object->useTexCoords() == b.object->useTexCoords();
+}
+
+void DrawBatcher::upload(){
+	_batches.clear();
+	if(_draws.empty()){
+		return;
+	}
+	GPUContext* context = GPU::getInternal();
+
+	// Sort draws by state, complete meshes first in each group. Keep submission order otherwise.
+	_order.resize(_draws.size());
+	for(uint did = 0; did < _order.size(); ++did){
+		_order[did] = did;
+	}
+	std::stable_sort(_order.begin(), _order.end(), [this](uint ia, uint ib){
+		const Draw & a = _draws[ia];
+		const Draw & b = _draws[ib];
+		if(a.program != b.program){
+			return a.program < b.program;
+		}
+		if(a.object->mesh() != b.object->mesh()){
+			return a.object->mesh() < b.object->mesh();
+		}
+		if(&a.object->material() != &b.object->material()){
+			return &a.object->material() < &b.object->material();
+		}
+		if(a.object->useTexCoords() != b.object->useTexCoords()){
+			return a.object->useTexCoords();
+		}
+		return a.complete && !b.complete;
+	});
+
+	// Reset the per-frame storage at the first upload of a frame, the GPU is done with it.
+	_current = uint(context->swapIndex);
+	FrameData & frame = _frames[_current];
+	if(frame.frame != context->frameIndex){
+		frame.frame = context->frameIndex;
+		frame.instanceCount = 0;
+		frame.commandCount = 0;
+	}
+
+	// Grow the storage if needed, there is at most one instance per draw and one command per range.
+	// Replaced buffers are kept alive until the frames using them are complete.
+	const size_t instanceTotal = frame.instanceCount + _draws.size();
+	if(!frame.instances || frame.instances->size < instanceTotal * sizeof(Instance)){
+		const size_t capacity = std::max(size_t(1024), 2 * _draws.size());
+		frame.instances.reset(new Buffer(capacity * sizeof(Instance), BufferType::INDIRECT, _name + " instances"));
+		frame.instanceCount = 0;
+	}
+	const size_t commandTotal = frame.commandCount + _ranges.size();
+	if(!frame.commands || frame.commands->size < commandTotal * sizeof(DrawCommand)){
+		const size_t capacity = std::max(size_t(1024), 2 * _ranges.size());
+		frame.commands.reset(new Buffer(capacity * sizeof(DrawCommand), BufferType::INDIRECT, _name + " commands"));
+		frame.commandCount = 0;
+	}
+
+	// Build batches and commands.
+	_instances.clear();
+	_commands.clear();
+	const size_t drawCount = _order.size();
+	size_t start = 0;
+	while(start < drawCount){
+		size_t end = start + 1;
+		while(end < drawCount && sameState(_draws[_order[start]], _draws[_order[end]])){
+			++end;
+		}
+
+		Batch batch;
+		batch.program = _draws[_order[start]].program;
+		batch.object = _draws[_order[start]].object;
+		batch.firstCommand = uint(frame.commandCount + _commands.size());
+		batch.commandCount = 0;
+		batch.objectCount = uint(end - start);
+
+		for(size_t oid = start; oid < end; ++oid){
+			const Draw & draw = _draws[_order[oid]];
+			const uint instanceId = uint(frame.instanceCount + _instances.size());
+			_instances.push_back(draw.instance);
+			// Complete meshes are sorted first, merge them in a single instanced command.
+			if(draw.complete && batch.commandCount != 0){
+				++_commands.back().instanceCount;
+				continue;
+			}
+			for(uint rid = 0; rid < draw.rangeCount; ++rid){
+				const glm::uvec2 & range = _ranges[draw.firstRange + rid];
+				_commands.push_back({range[1], 1u, range[0], 0, instanceId});
+				++batch.commandCount;
+			}
+		}
+		_batches.push_back(batch);
+		start = end;
+	}
+
+	// Upload after the data written by previous passes in the same frame.
+	frame.instances->upload(_instances, frame.instanceCount * sizeof(Instance));
+	frame.commands->upload(_commands, frame.commandCount * sizeof(DrawCommand));
+	frame.instanceCount += _instances.size();
+	frame.commandCount += _commands.size();
+
+	GPU::_metrics.batchedObjects += _draws.size();
+	GPU::_metrics.batches += _batches.size();
+}
+
+void DrawBatcher::draw(const Batch & batch) const {
+	const FrameData & frame = _frames[_current];
+	GPU::drawIndirect(*batch.object->mesh(), *frame.commands, batch.firstCommand * sizeof(DrawCommand), batch.commandCount);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Common.hpp"
+#include "scene/Object.hpp"
+#include "renderers/Culler.hpp"
+#include "resources/Buffer.hpp"
+#include "graphics/Program.hpp"
+
+/**
+ \brief Group object draws sharing the same program, mesh and material into batches, drawn with instanced indirect draw calls.
+ \details Per-instance transformations are written in a storage buffer, and each batch is drawn using a list of indirect commands. Objects drawing their complete mesh are merged into a single instanced command, while objects with culled clusters use one command per index range. Instance and command data is stored in per-frame buffers, that grow as needed.
+
+ Shaders can retrieve the instance data using gl_InstanceIndex:
+ \verbatim
+ struct Instance {
+	mat4 mvp; mat4 mv; mat4 normalMatrix;
+ };
+ layout(std430, set = 3, binding = ...) readonly buffer Instances {
+	Instance instances[];
+ };
+ \endverbatim
+ \see GPUShaders::Vert::Object_instanced_forward
+ \ingroup Renderers
+ */
+class DrawBatcher {
+
+public:
+
+	/** \brief Per-instance data, as stored in the instances buffer. */
+	struct Instance {
+		glm::mat4 mvp; ///< Model-view-projection matrix.
+		glm::mat4 mv; ///< Model-view matrix.
+		glm::mat4 normalMatrix; ///< Normal transformation matrix (in a 4x4 matrix).
+	};
+
+	/** \brief A group of draws sharing the same state. */
+	struct Batch {
+		Program * program; ///< The program to use.
+		const Object * object; ///< First object in the batch, representative of the shared mesh and material.
+		uint firstCommand; ///< Index of the first command in the commands buffer.
+		uint commandCount; ///< Number of commands.
+		uint objectCount; ///< Number of objects drawn.
+	};
+
+	/** Constructor.
+	 \param name the debug name
+	 */
+	explicit DrawBatcher(const std::string & name);
+
+	/** Remove all registered draws, to start a new pass. */
+	void clear();
+
+	/** Register an object draw.
+	 \param program the program to render the object with
+	 \param object the object to draw
+	 \param view the view matrix
+	 \param proj the projection matrix
+	 \param ranges the index ranges of the object mesh to draw
+	 */
+	void add(Program * program, const Object & object, const glm::mat4 & view, const glm::mat4 & proj, const Culler::Ranges & ranges);
+
+	/** Build the batches from the registered draws, and upload instance data and commands. */
+	void upload();
+
+	/** \return the batches built by the last upload */
+	const std::vector<Batch> & batches() const { return _batches; }
+
+	/** \return the buffer containing per-instance data, to bind to the batches programs */
+	const Buffer & instances() const { return *_frames[_current].instances; }
+
+	/** Issue the draw commands of a batch. The batch program should be in use, with all resources bound.
+	 \param batch the batch to draw
+	 */
+	void draw(const Batch & batch) const;
+
+private:
+
+	/** \brief Registered object draw. */
+	struct Draw {
+		Program * program; ///< Program to use.
+		const Object * object; ///< The object.
+		Instance instance; ///< Per-instance data.
+		uint firstRange; ///< First range in the ranges list.
+		uint rangeCount; ///< Number of ranges.
+		bool complete; ///< Is the complete mesh drawn.
+	};
+
+	/** \brief Per-frame GPU storage. */
+	struct FrameData {
+		std::unique_ptr<Buffer> instances; ///< Instances buffer.
+		std::unique_ptr<Buffer> commands; ///< Commands buffer.
+		size_t instanceCount = 0; ///< Number of instances used in the current frame.
+		size_t commandCount = 0; ///< Number of commands used in the current frame.
+		uint64_t frame = 0; ///< Frame during which the data was last written.
+	};
+
+	/** Check if two draws can be batched together.
+	 \param a first draw
+	 \param b second draw
+	 \return true if both draws share the same state
+	 */
+	static bool sameState(const Draw & a, const Draw & b);
+
+	std::string _name; ///< Debug name.
+	std::vector<Draw> _draws; ///< Registered draws.
+	std::vector<glm::uvec2> _ranges; ///< Index ranges of all registered draws.
+	std::vector<uint> _order; ///< Draws sorted by state.
+	std::vector<Instance> _instances; ///< Instances to upload.
+	std::vector<DrawCommand> _commands; ///< Commands to upload.
+	std::vector<Batch> _batches; ///< Current batches.
+	std::vector<FrameData> _frames; ///< Per-frame in flight storage.
+	uint _current = 0; ///< Current frame storage.
+};
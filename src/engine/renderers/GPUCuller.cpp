@@ -0,0 +1,185 @@
+#include "renderers/GPUCuller.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/GPUInternal.hpp"
+#include "resources/ResourcesManager.hpp"
+
+#include <map>
+#include <tuple>
+
+GPUCuller::GPUCuller(const std::vector<Object> & objects, const std::vector<long> & selection, const std::string & name) :
+	_objects(objects), _hiZ(name + " Hi-Z") {
+
+	_cullProgram = Resources::manager().getProgramCompute("cull_objects");
+	_downsampleProgram = Resources::manager().getProgramCompute("hiz_downsample");
+
+	// Group objects sharing the same mesh and material, preserving the selection order in each group.
+	using GroupKey = std::tuple<const Mesh *, const Material *, bool>;
+	std::map<GroupKey, uint> groupIds;
+	std::vector<std::vector<long>> groupObjects;
+	for(const long objectId : selection){
+		const Object & object = _objects[objectId];
+		const GroupKey key(object.mesh(), &object.material(), object.useTexCoords());
+		auto entry = groupIds.find(key);
+		if(entry == groupIds.end()){
+			entry = groupIds.emplace(key, uint(groupObjects.size())).first;
+			groupObjects.emplace_back();
+		}
+		groupObjects[entry->second].push_back(objectId);
+	}
+
+	// Generate items, contiguous for each group.
+	std::vector<Item> items;
+	std::vector<uint> groupStarts;
+	for(uint gid = 0; gid < groupObjects.size(); ++gid){
+		Group group;
+		group.object = &_objects[groupObjects[gid][0]];
+		group.firstItem = uint(items.size());
+		group.objectCount = uint(groupObjects[gid].size());
+		groupStarts.push_back(group.firstItem);
+
+		for(const long objectId : groupObjects[gid]){
+			const Object & object = _objects[objectId];
+			const Mesh & mesh = *object.mesh();
+			const uint objectIndex = uint(_selection.size());
+			_selection.push_back(objectId);
+			if(object.animated()){
+				_animated.push_back(long(objectIndex));
+			}
+			// Objects without meshlets are tested as a whole.
+			if(mesh.meshlets.empty()){
+				const BoundingSphere sphere = mesh.bbox.getSphere();
+				items.push_back({glm::vec4(sphere.center, sphere.radius), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), 0u, uint(mesh.metrics().indices), objectIndex, gid});
+				continue;
+			}
+			// The backface test is skipped for two-sided objects.
+			const bool twoSided = object.material().twoSided();
+			for(const Mesh::Meshlet & meshlet : mesh.meshlets){
+				const glm::vec4 cone(meshlet.coneAxis, twoSided ? 1.0f : meshlet.coneCutoff);
+				items.push_back({glm::vec4(meshlet.bounds.center, meshlet.bounds.radius), cone, meshlet.firstIndex, meshlet.indexCount, objectIndex, gid});
+			}
+		}
+		group.itemCount = uint(items.size()) - group.firstItem;
+		_groups.push_back(group);
+	}
+	_itemCount = uint(items.size());
+
+	// Initial transformations, only animated objects will be updated afterwards.
+	_objectData.resize(_selection.size());
+	for(size_t oid = 0; oid < _selection.size(); ++oid){
+		const glm::mat4 & model = _objects[_selection[oid]].model();
+		_objectData[oid].model = model;
+		_objectData[oid].normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+	}
+	_zeroCounts.resize(std::max(_groups.size(), size_t(1)), 0u);
+
+	// At least one entry, to avoid creating empty buffers.
+	items.resize(std::max(items.size(), size_t(1)), {glm::vec4(0.0f), glm::vec4(1.0f), 0u, 0u, 0u, 0u});
+	groupStarts.resize(_zeroCounts.size(), 0u);
+	_items.reset(new Buffer(items.size() * sizeof(Item), BufferType::STORAGE, name + " items"));
+	_items->upload(items);
+	_groupStarts.reset(new Buffer(groupStarts.size() * sizeof(uint), BufferType::STORAGE, name + " groups"));
+	_groupStarts->upload(groupStarts);
+
+	// One copy of the dynamic data per frame in flight.
+	GPUContext* context = GPU::getInternal();
+	_frames.resize(context->frameCount);
+	const size_t objectCount = std::max(_objectData.size(), size_t(1));
+	for(FrameData & frame : _frames){
+		frame.objects.reset(new Buffer(objectCount * sizeof(ObjectData), BufferType::INDIRECT, name + " objects"));
+		frame.counts.reset(new Buffer(_zeroCounts.size() * sizeof(uint), BufferType::INDIRECT, name + " counts"));
+		frame.commands.reset(new Buffer(items.size() * sizeof(DrawCommand), BufferType::STORAGE, name + " commands"));
+		frame.instances.reset(new Buffer(items.size() * sizeof(glm::mat4) * 3, BufferType::STORAGE, name + " instances"));
+	}
+}
+
+void GPUCuller::cull(const glm::mat4 & view, const glm::mat4 & proj, const glm::vec3 & pos){
+	GPUContext* context = GPU::getInternal();
+	_current = uint(context->swapIndex);
+	FrameData & frame = _frames[_current];
+
+	// Refresh animated objects.
+	for(const long oid : _animated){
+		const glm::mat4 & model = _objects[_selection[oid]].model();
+		_objectData[oid].model = model;
+		_objectData[oid].normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+	}
+	if(!_objectData.empty()){
+		frame.objects->upload(_objectData);
+	}
+	// The GPU is done with this frame data, reset the counts.
+	frame.counts->upload(_zeroCounts);
+
+	if(_itemCount == 0){
+		return;
+	}
+
+	GPUMarker marker("GPU culling");
+	_cullProgram->use();
+	_cullProgram->uniform("v", view);
+	_cullProgram->uniform("p", proj);
+	_cullProgram->uniform("previousVP", _hiZViewProj);
+	_cullProgram->uniform("cameraPos", pos);
+	_cullProgram->uniform("itemCount", _itemCount);
+	_cullProgram->uniform("useHiZ", _useHiZ && _hiZReady);
+	_cullProgram->uniform("useCones", _useCones);
+	_cullProgram->buffer(*_items, 0);
+	_cullProgram->buffer(*frame.objects, 1);
+	_cullProgram->buffer(*frame.commands, 2);
+	_cullProgram->buffer(*frame.instances, 3);
+	_cullProgram->buffer(*frame.counts, 4);
+	_cullProgram->buffer(*_groupStarts, 5);
+	if(_hiZReady){
+		_cullProgram->texture(_hiZ, 0);
+	} else {
+		_cullProgram->defaultTexture(0);
+	}
+	GPU::dispatch(_itemCount, 1, 1);
+}
+
+void GPUCuller::updateDepth(const Texture & depth, const glm::mat4 & view, const glm::mat4 & proj){
+	if(!_useHiZ){
+		_hiZReady = false;
+		return;
+	}
+	GPUMarker marker("Hi-Z pyramid");
+
+	// Allocate the full pyramid at the depth resolution.
+	const uint levels = uint(std::floor(std::log2(std::min(depth.width, depth.height)))) + 1u;
+	if(!_hiZ.gpu){
+		_hiZ.setupAsDrawable(Layout::R32F, depth.width, depth.height, TextureShape::D2, levels);
+	} else if(_hiZ.width != depth.width || _hiZ.height != depth.height){
+		_hiZ.levels = levels;
+		_hiZ.resize(depth.width, depth.height);
+	}
+
+	_downsampleProgram->use();
+	// The first level is a copy of the depth buffer.
+	_downsampleProgram->texture(depth, 0);
+	_downsampleProgram->texture(_hiZ, 1, 0);
+	GPU::dispatch(_hiZ.width, _hiZ.height, 1);
+	// Each next level keeps the farthest depth of the texels it covers.
+	for(uint level = 1; level < _hiZ.levels; ++level){
+		const uint w = std::max(_hiZ.width >> level, 1u);
+		const uint h = std::max(_hiZ.height >> level, 1u);
+		_downsampleProgram->texture(_hiZ, 0, level - 1);
+		_downsampleProgram->texture(_hiZ, 1, level);
+		GPU::dispatch(w, h, 1);
+	}
+	_hiZViewProj = proj * view;
+	_hiZReady = true;
+}
+
+void GPUCuller::draw(const Group & group) const {
+	const FrameData & frame = _frames[_current];
+	const size_t groupIndex = size_t(&group - _groups.data());
+	GPU::drawIndirectCount(*group.object->mesh(), *frame.commands, group.firstItem * sizeof(DrawCommand), *frame.counts, groupIndex * sizeof(uint), group.itemCount);
+	GPU::_metrics.batchedObjects += group.objectCount;
+	++GPU::_metrics.batches;
+}
+
+void GPUCuller::interface(){
+	ImGui::Checkbox("Occlusion culling", &_useHiZ);
+	ImGui::SameLine();
+	ImGui::Checkbox("Cull back-facing clusters", &_useCones);
+	ImGui::Text("GPU culling: %lu items in %lu groups", size_t(_itemCount), _groups.size());
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Common.hpp"
+#include "scene/Object.hpp"
+#include "scene/Material.hpp"
+#include "resources/Buffer.hpp"
+#include "resources/Texture.hpp"
+#include "graphics/Program.hpp"
+
+/**
+ \brief Cull objects and their meshlets on the GPU, and compact the visible ones in indirect draw commands.
+ \details Objects are grouped by mesh and material when created. Each frame, a compute shader tests every item (a meshlet, or a whole mesh without meshlets) against its normal cone, the view frustum and a hierarchical depth pyramid built from the previous frame depth. Surviving items are appended to the commands range of their group, along with their transformations, and the number of commands per group is written in a count buffer. Each group is then drawn with a single indirect call, whatever the number of objects it contains.
+
+ Instance data uses the same layout as the one produced by DrawBatcher, so the same shaders can be used.
+ \see GPUShaders::Comp::Cull_objects, GPUShaders::Comp::Hiz_downsample
+ \note This requires support for indirect draws with a count buffer (see GPU::supportsDrawIndirectCount).
+ \ingroup Renderers
+ */
+class GPUCuller {
+
+public:
+
+	/** \brief Objects sharing the same mesh and material, drawn together. */
+	struct Group {
+		const Object * object; ///< First object in the group, representative of the shared mesh and material.
+		uint firstItem; ///< Index of the first item (and command) of the group.
+		uint itemCount; ///< Number of items, maximum number of commands.
+		uint objectCount; ///< Number of objects in the group.
+	};
+
+	/** Constructor.
+	 \param objects the scene objects
+	 \param selection indices of the objects to cull on the GPU
+	 \param name the debug name
+	 \note The objects list should not be modified while the culler is in use.
+	 */
+	GPUCuller(const std::vector<Object> & objects, const std::vector<long> & selection, const std::string & name);
+
+	/** Test all items against the current view and previous frame depth, and write the draw commands. This has to be called outside of a render pass.
+	 \param view the view matrix
+	 \param proj the projection matrix
+	 \param pos the camera position in world space
+	 */
+	void cull(const glm::mat4 & view, const glm::mat4 & proj, const glm::vec3 & pos);
+
+	/** Build the hierarchical depth pyramid used to cull objects in the next frame.
+	 \param depth the depth buffer rendered with the culled objects
+	 \param view the view matrix used to render the depth
+	 \param proj the projection matrix used to render the depth
+	 */
+	void updateDepth(const Texture & depth, const glm::mat4 & view, const glm::mat4 & proj);
+
+	/** \return the groups of objects, to draw after culling */
+	const std::vector<Group> & groups() const { return _groups; }
+
+	/** \return the buffer containing per-instance data written by the last culling, to bind to the groups programs */
+	const Buffer & instances() const { return *_frames[_current].instances; }
+
+	/** Issue the draw commands of a group. The group program should be in use, with all resources bound.
+	 \param group the group to draw
+	 */
+	void draw(const Group & group) const;
+
+	/** Display culling options GUI. */
+	void interface();
+
+	/** Copy assignment operator (disabled).
+	 \return a reference to the object assigned to
+	 */
+	GPUCuller & operator=(const GPUCuller &) = delete;
+
+	/** Copy constructor (disabled). */
+	GPUCuller(const GPUCuller &) = delete;
+
+	/** Move assignment operator (disabled).
+	 \return a reference to the object assigned to
+	 */
+	GPUCuller & operator=(GPUCuller &&) = delete;
+
+	/** Move constructor (disabled). */
+	GPUCuller(GPUCuller &&) = delete;
+
+private:
+
+	/** \brief An object meshlet (or whole mesh), as stored in the items buffer. */
+	struct Item {
+		glm::vec4 bounds; ///< Bounding sphere center and radius, in model space.
+		glm::vec4 cone; ///< Normal cone axis and cutoff, in model space.
+		uint firstIndex; ///< First index in the mesh index buffer.
+		uint indexCount; ///< Number of indices.
+		uint object; ///< Index of the object in the objects buffer.
+		uint group; ///< Index of the group.
+	};
+
+	/** \brief Object transformations, as stored in the objects buffer. */
+	struct ObjectData {
+		glm::mat4 model; ///< Model matrix.
+		glm::mat4 normalMatrix; ///< Normal matrix in world space (in a 4x4 matrix).
+	};
+
+	/** \brief Per-frame GPU storage. */
+	struct FrameData {
+		std::unique_ptr<Buffer> objects; ///< Objects transformations.
+		std::unique_ptr<Buffer> counts; ///< Number of commands per group.
+		std::unique_ptr<Buffer> commands; ///< Commands, written by the GPU.
+		std::unique_ptr<Buffer> instances; ///< Instances, written by the GPU.
+	};
+
+	const std::vector<Object> & _objects; ///< Reference to the scene objects.
+	std::vector<long> _selection; ///< Indices of the objects handled, in objects buffer order.
+	std::vector<long> _animated; ///< Positions of the animated objects in the selection.
+	std::vector<ObjectData> _objectData; ///< Current objects transformations.
+	std::vector<uint> _zeroCounts; ///< Counts reset data.
+	std::vector<Group> _groups; ///< Groups of objects.
+	std::unique_ptr<Buffer> _items; ///< Items to test.
+	std::unique_ptr<Buffer> _groupStarts; ///< First item of each group.
+	std::vector<FrameData> _frames; ///< Per-frame in flight storage.
+	uint _current = 0; ///< Current frame storage.
+	uint _itemCount = 0; ///< Total number of items.
+
+	Program * _cullProgram; ///< Culling compute program.
+	Program * _downsampleProgram; ///< Depth pyramid generation program.
+	Texture _hiZ; ///< Hierarchical depth pyramid, storing the farthest depth.
+	glm::mat4 _hiZViewProj = glm::mat4(1.0f); ///< View-projection matrix used to render the depth pyramid.
+	bool _hiZReady = false; ///< Has the depth pyramid been generated.
+
+	bool _useHiZ = true; ///< Should items be tested against the previous frame depth.
+	bool _useCones = true; ///< Should back-facing meshlets be culled.
+};
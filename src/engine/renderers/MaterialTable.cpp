@@ -0,0 +1,48 @@
+#include "renderers/MaterialTable.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/TextureTable.hpp"
+#include "resources/ResourcesManager.hpp"
+
+MaterialTable::MaterialTable(const std::vector<Material> & materials, const std::string & name){
+
+	// Textures that can't be registered (table full) are replaced by the default texture.
+	const uint defaultSlot = GPU::registerBindlessTexture(*Resources::manager().getDefaultTexture(TextureShape::D2));
+	_valid = defaultSlot != TextureTable::invalidSlot;
+	if(!_valid){
+		Log::Error() << Log::GPU << "Unable to register the default texture in the texture table." << std::endl;
+	}
+	// At least one entry, to avoid creating an empty buffer.
+	std::vector<glm::uvec4> slots(std::max(materials.size(), size_t(1)), glm::uvec4(defaultSlot));
+
+	for(size_t mid = 0; mid < materials.size(); ++mid){
+		const Material & material = materials[mid];
+		_indices[&material] = uint(mid);
+
+		const std::vector<const Texture *> & textures = material.textures();
+		const size_t textureCount = std::min(textures.size(), size_t(4));
+		for(size_t tid = 0; tid < textureCount; ++tid){
+			uint slot = GPU::registerBindlessTexture(*textures[tid]);
+			if(slot == TextureTable::invalidSlot){
+				Log::Warning() << Log::GPU << "Unable to register texture " << textures[tid]->name() << " in the texture table, using the default texture." << std::endl;
+				slot = defaultSlot;
+			}
+			slots[mid][tid] = slot;
+		}
+		// Unused entries point to a valid texture.
+		for(size_t tid = textureCount; tid < 4; ++tid){
+			slots[mid][tid] = slots[mid][0];
+		}
+	}
+
+	_data.reset(new Buffer(slots.size() * sizeof(glm::uvec4), BufferType::STORAGE, name + " materials"));
+	_data->upload(slots);
+}
+
+uint MaterialTable::index(const Material & material) const {
+	auto entry = _indices.find(&material);
+	if(entry == _indices.end()){
+		Log::Error() << "Material is not in the table." << std::endl;
+		return 0;
+	}
+	return entry->second;
+}
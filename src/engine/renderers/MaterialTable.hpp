@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Common.hpp"
+#include "scene/Material.hpp"
+#include "resources/Buffer.hpp"
+
+/**
+ \brief Register the textures of a list of materials in the global texture table, and store their slots in a GPU buffer.
+ \details Each material is represented by a uvec4 of texture slots, in the order of its textures (unused entries point to the first texture). Shaders can then retrieve a material textures from its index, without rebinding any texture between draw calls.
+ \see GPUShaders::Common::Bindless
+ \ingroup Renderers
+ */
+class MaterialTable {
+
+public:
+
+	/** Constructor. Register all materials textures and upload the slots buffer.
+	 \param materials the materials to register
+	 \param name debug name
+	 \note This requires bindless support on the device (see GPU::supportsBindless).
+	 */
+	MaterialTable(const std::vector<Material> & materials, const std::string & name);
+
+	/** Query the index of a material in the table.
+	 \param material the material
+	 \return the material index in the buffer
+	 */
+	uint index(const Material & material) const;
+
+	/** \return false if some textures could not be registered nor replaced by a default texture, in which case the table should not be used */
+	bool valid() const { return _valid; }
+
+	/** \return the buffer containing the texture slots of each material */
+	const Buffer & data() const { return *_data; }
+
+private:
+
+	std::unordered_map<const Material *, uint> _indices; ///< Index of each material in the buffer.
+	std::unique_ptr<Buffer> _data; ///< Materials texture slots.
+	bool _valid = true; ///< Do all slots point to registered textures.
+};
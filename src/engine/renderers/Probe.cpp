@@ -3,6 +3,7 @@
 #include "graphics/GPU.hpp"
 #include "resources/Library.hpp"
 #include "scene/LightProbe.hpp"
+#include "system/System.hpp"
 
 Probe::Probe(LightProbe & probe, std::shared_ptr<Renderer> renderer, uint size, uint mips, const glm::vec2 & clippingPlanes) :
 	_result("Probe"), _copy("Probe copy") {
@@ -10,6 +11,9 @@ Probe::Probe(LightProbe & probe, std::shared_ptr<Renderer> renderer, uint size,
 	_result.setupAsDrawable(Layout::RGBA16F, size, size, TextureShape::Cube, mips);
 	GPU::clearTexture(_result, glm::vec4(0.0f));
 	_position	 = probe.position();
+	const glm::mat4 areaFrame = glm::rotate(glm::translate(glm::mat4(1.0f), _position), probe.rotation(), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::vec3 areaSize = probe.size() + probe.fade();
+	_area = BoundingBox(-areaSize, areaSize).transformed(areaFrame);
 	_radianceCompute = Resources::manager().getProgramCompute("radiance_convo");
 	// Texture used to compute irradiance spherical harmonics.
 	_copy.setupAsDrawable(_renderer->outputColorFormat(), 16, 16, TextureShape::Cube, 1);
@@ -32,8 +36,22 @@ void Probe::update(uint budget){
 	// Simple state machine:
 	// (draw a face) ^ 6 -> ((convolve a face) ^ 6) ^ (mip count)) -> (dispatch irradiance compute)
 
+	// Cull all faces drawn during this update at once.
+	if(_currentState == ProbeState::DRAW_FACES && budget > 0){
+		const uint faceCount = std::min(budget, 6u - _substepDraw);
+		std::vector<const Camera *> cameras(faceCount);
+		for(uint i = 0; i < faceCount; ++i){
+			cameras[i] = &_cameras[_substepDraw + i];
+		}
+		_renderer->prepareViews(cameras);
+	}
+
 	// Follow steps while we have budget.
 	while(budget > 0){
+		// In async mode, wait for updateCompute to perform the compute steps.
+		if(_async && _currentState != ProbeState::DRAW_FACES){
+			break;
+		}
 		switch (_currentState) {
 			case ProbeState::DRAW_FACES:
 			{
@@ -45,6 +63,10 @@ void Probe::update(uint budget){
 				if(_substepDraw >= 6){
 					_substepDraw = 0;
 					_currentState = ProbeState::CONVOLVE_RADIANCE;
+					// Blits are not available on the compute queue, downscale now.
+					if(_async){
+						downscaleRadiance();
+					}
 				}
 				break;
 			}
@@ -66,6 +88,7 @@ void Probe::update(uint budget){
 			{
 				GPUMarker marker("Probe irradiance");
 				// Generate irradiance.
+				downscaleRadiance();
 				estimateIrradiance(5.0f);
 				_currentState = ProbeState::DRAW_FACES;
 				break;
@@ -77,6 +100,33 @@ void Probe::update(uint budget){
 	}
 }
 
+void Probe::useAsyncCompute(bool async){
+	// Complete pending compute steps before switching.
+	if(_async && !async){
+		updateCompute();
+	}
+	_async = async;
+}
+
+void Probe::updateCompute(){
+	if(!_async || _currentState == ProbeState::DRAW_FACES){
+		return;
+	}
+	// All faces have been drawn and downscaled, run all compute steps at once.
+	{
+		GPUMarker marker("Probe convolve");
+		for(uint level = 1; level < _result.levels; ++level){
+			convolveRadiance(1.2f, level);
+		}
+	}
+	{
+		GPUMarker marker("Probe irradiance");
+		estimateIrradiance(5.0f);
+	}
+	_substepRadiance = 1;
+	_currentState = ProbeState::DRAW_FACES;
+}
+
 void Probe::convolveRadiance(float clamp, uint level) {
 
 	GPU::setDepthState(false);
@@ -98,11 +148,14 @@ void Probe::convolveRadiance(float clamp, uint level) {
 
 }
 
-void Probe::estimateIrradiance(float clamp) {
+void Probe::downscaleRadiance() {
 	// Downscale radiance to a smaller texture.
 	for(uint lid = 0; lid < 6; ++lid) {
 		GPU::blit(_result, _copy, lid, lid, 0, 0, Filter::LINEAR);
 	}
+}
+
+void Probe::estimateIrradiance(float clamp) {
 	// Dispatch pr-face coefficients accumulation and reduction/SH projection.
 	_irradianceCompute->use();
 	_irradianceCompute->texture(_copy, 0);
@@ -113,69 +166,121 @@ void Probe::estimateIrradiance(float clamp) {
 
 }
 
+std::unordered_map<uint, std::shared_ptr<const Probe::SHTable>> Probe::_shTables;
+std::mutex Probe::_shTableLock;
+
+std::shared_ptr<const Probe::SHTable> Probe::shTable(uint side){
+	std::lock_guard<std::mutex> guard(_shTableLock);
+	const auto existing = _shTables.find(side);
+	if(existing != _shTables.end()){
+		return existing->second;
+	}
+	std::shared_ptr<SHTable> table(new SHTable());
+	table->side = side;
+	table->texels.resize(size_t(side) * size_t(side));
+	float weightSum = 0.0f;
+	for(uint y = 0; y < side; ++y) {
+		const float v = -1.0f + 1.0f / float(side) + float(y) * 2.0f / float(side);
+		for(uint x = 0; x < side; ++x) {
+			const float u = -1.0f + 1.0f / float(side) + float(x) * 2.0f / float(side);
+			// Normalization factor.
+			const float fTmp   = 1.0f + u * u + v * v;
+			const float norm   = std::sqrt(fTmp);
+			const float weight = 4.0f / (norm * fTmp);
+			// Direction along the face axis, horizontal and vertical directions.
+			table->texels[size_t(y) * side + x] = glm::vec4(1.0f, u, v, weight * norm) / norm;
+			weightSum += weight;
+		}
+	}
+	// All faces share the same weights.
+	table->weightSum = 6.0f * weightSum;
+	_shTables[side] = table;
+	return table;
+}
+
 void Probe::extractIrradianceSHCoeffs(const Texture & cubemap, float clamp, std::vector<glm::vec3> & shCoeffs) {
 	shCoeffs.resize(9);
 
-	// Indices conversions from cubemap UVs to direction.
+	// Conversions from cubemap face coordinates (axis, horizontal, vertical) to direction.
 	static const std::vector<int> axisIndices  = {0, 0, 1, 1, 2, 2};
 	static const std::vector<float> axisMul	   = {1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f};
 	static const std::vector<int> horizIndices = {2, 2, 0, 0, 0, 0};
 	static const std::vector<float> horizMul   = {-1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f};
 	static const std::vector<int> vertIndices  = {1, 1, 2, 2, 1, 1};
 	static const std::vector<float> vertMul	   = {1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f};
+	std::array<glm::mat3, 6> frames;
+	for(uint i = 0; i < 6; ++i) {
+		frames[i] = glm::mat3(0.0f);
+		frames[i][0][axisIndices[i]]  = axisMul[i];
+		frames[i][1][horizIndices[i]] = horizMul[i];
+		frames[i][2][vertIndices[i]]  = vertMul[i];
+	}
 
-	// Spherical harmonics coefficients.
-	std::array<glm::vec3, 9> LCoeffs = {};
-	LCoeffs.fill(glm::vec3(0.0f, 0.0f, 0.0f));
-	const float y0 = 0.282095f;
-	const float y1 = 0.488603f;
-	const float y2 = 1.092548f;
-	const float y3 = 0.315392f;
-	const float y4 = 0.546274f;
-
-	float denom		= 0.0f;
 	const uint side = cubemap.width;
-	for(uint i = 0; i < 6; ++i) {
-		const auto & currentSide = cubemap.images[i];
-		for(uint y = 0; y < side; ++y) {
-			for(uint x = 0; x < side; ++x) {
-
-				const float v		 = -1.0f + 1.0f / float(side) + float(y) * 2.0f / float(side);
-				const float u		 = -1.0f + 1.0f / float(side) + float(x) * 2.0f / float(side);
-				glm::vec3 pos		 = glm::vec3(0.0f, 0.0f, 0.0f);
-				pos[axisIndices[i]]	 = axisMul[i];
-				pos[horizIndices[i]] = horizMul[i] * u;
-				pos[vertIndices[i]]	 = vertMul[i] * v;
-				pos					 = glm::normalize(pos);
-				// Normalization factor.
-				const float fTmp   = 1.0f + u * u + v * v;
-				const float weight = 4.0f / (sqrt(fTmp) * fTmp);
-				denom += weight;
-				// HDR color.
-				const glm::vec3 & rgb = currentSide.rgb(x, y);
-				const glm::vec3 hdr = weight * glm::min(rgb, clamp);
+	const std::shared_ptr<const SHTable> table = shTable(side);
+
+	// Spherical harmonics coefficients, accumulated for each row of each face.
+	// Padded to four channels so that the accumulation can be vectorized.
+	using Coeffs = std::array<glm::vec4, 9>;
+	std::vector<Coeffs> rowCoeffs(6 * size_t(side));
+	System::forParallel(0, rowCoeffs.size(), [&cubemap, &frames, &table, &rowCoeffs, side, clamp](size_t rid){
+		const float y0 = 0.282095f;
+		const float y1 = 0.488603f;
+		const float y2 = 1.092548f;
+		const float y3 = 0.315392f;
+		const float y4 = 0.546274f;
+
+		const uint i = uint(rid / side);
+		const uint y = uint(rid % side);
+		const Image & currentSide = cubemap.images[i];
+		const glm::mat3 & frame = frames[i];
+		const glm::vec4 * texels = &table->texels[size_t(y) * side];
+
+		Coeffs LCoeffs;
+		LCoeffs.fill(glm::vec4(0.0f));
+		for(uint x = 0; x < side; ++x) {
+			const glm::vec4 & texel = texels[x];
+			const glm::vec3 pos = frame * glm::vec3(texel);
+			// HDR color.
+			const glm::vec4 hdr = glm::vec4(texel.w * glm::min(currentSide.rgb(x, y), clamp), 0.0f);
+			// Evaluate the basis first.
+			const float basis[9] = {
 				// Y0,0  = 0.282095
-				LCoeffs[0] += hdr * y0;
+				y0,
 				// Y1,-1 = 0.488603 y
-				LCoeffs[1] += hdr * (y1 * pos[1]);
+				y1 * pos[1],
 				// Y1,0  = 0.488603 z
-				LCoeffs[2] += hdr * (y1 * pos[2]);
+				y1 * pos[2],
 				// Y1,1  = 0.488603 x
-				LCoeffs[3] += hdr * (y1 * pos[0]);
+				y1 * pos[0],
 				// Y2,-2 = 1.092548 xy
-				LCoeffs[4] += hdr * (y2 * (pos[0] * pos[1]));
+				y2 * (pos[0] * pos[1]),
 				// Y2,-1 = 1.092548 yz
-				LCoeffs[5] += hdr * (y2 * pos[1] * pos[2]);
+				y2 * pos[1] * pos[2],
 				// Y2,0  = 0.315392 (3z^2 - 1)
-				LCoeffs[6] += hdr * (y3 * (3.0f * pos[2] * pos[2] - 1.0f));
+				y3 * (3.0f * pos[2] * pos[2] - 1.0f),
 				// Y2,1  = 1.092548 xz
-				LCoeffs[7] += hdr * (y2 * pos[0] * pos[2]);
+				y2 * pos[0] * pos[2],
 				// Y2,2  = 0.546274 (x^2 - y^2)
-				LCoeffs[8] += hdr * (y4 * (pos[0] * pos[0] - pos[1] * pos[1]));
+				y4 * (pos[0] * pos[0] - pos[1] * pos[1]),
+			};
+			for(uint k = 0; k < 9; ++k) {
+				LCoeffs[k] += basis[k] * hdr;
 			}
 		}
+		rowCoeffs[rid] = LCoeffs;
+	});
+
+	// Reduce rows in a fixed order, for deterministic results.
+	std::array<glm::vec3, 9> LCoeffs = {};
+	LCoeffs.fill(glm::vec3(0.0f, 0.0f, 0.0f));
+	for(const Coeffs & row : rowCoeffs) {
+		for(uint k = 0; k < 9; ++k) {
+			LCoeffs[k] += glm::vec3(row[k]);
+		}
 	}
 	// Normalization.
+	const float denom = table->weightSum;
 	for(auto & coeff : LCoeffs) {
 		coeff *= 4.0 / denom;
 	}
@@ -200,6 +305,22 @@ void Probe::extractIrradianceSHCoeffs(const Texture & cubemap, float clamp, std:
 }
 
 uint Probe::totalBudget() const {
-	/* draw faces + convolve each level + generate irradiance */
-	return 6 + _result.levels + 1;
+	/* draw faces (+ convolve each level + generate irradiance) */
+	return _async ? 6 : (6 + _result.levels + 1);
+}
+
+uint Probe::remainingBudget() const {
+	// Convolve each level but the first, then generate irradiance.
+	const uint computeSteps = _async ? 0 : _result.levels;
+	switch(_currentState){
+		case ProbeState::DRAW_FACES:
+			return (6 - _substepDraw) + computeSteps;
+		case ProbeState::CONVOLVE_RADIANCE:
+			return _async ? 0 : (_result.levels - _substepRadiance + 1);
+		case ProbeState::GENERATE_IRRADIANCE:
+			return _async ? 0 : 1;
+		default:
+			break;
+	}
+	return 0;
 }
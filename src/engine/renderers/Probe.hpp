@@ -7,6 +7,9 @@
 #include "input/Camera.hpp"
 #include "Common.hpp"
 
+#include <mutex>
+#include <unordered_map>
+
 class LightProbe;
 
 /**
@@ -35,9 +38,35 @@ public:
 	 Each internal step (drawing a part of the environment, generating the convolved radiance, integrating the irradiance) has a given budget. Depending on the allocated budget, the probe will entirely update more or less fast. */
 	void update(uint budget);
 
-	/** \return the total number of steps to completely update the probe data */
+	/** Perform the radiance convolution and irradiance estimation in a separate call, so that they can be executed on the async compute queue.
+	 In this mode, update only draws the faces of the probe, and updateCompute should be called each frame.
+	 \param async should the compute steps be performed by updateCompute
+	 */
+	void useAsyncCompute(bool async);
+
+	/** If all faces have been drawn, perform the radiance convolution of all levels and the irradiance estimation, using only dispatches.
+	 \note This can be called between GPU::beginAsyncCompute and GPU::endAsyncCompute, and has no effect if the probe is not using async compute.
+	 */
+	void updateCompute();
+
+	/** \return true if all faces have been drawn and the compute steps are waiting for updateCompute */
+	bool pendingCompute() const { return _async && _currentState != ProbeState::DRAW_FACES; }
+
+	/** \return the total number of steps to completely update the probe data (only the faces drawing when using async compute) */
 	uint totalBudget() const;
 
+	/** \return the number of steps left to complete the current update (only the faces drawing when using async compute) */
+	uint remainingBudget() const;
+
+	/** \return true if no update is in progress */
+	bool idle() const { return _currentState == ProbeState::DRAW_FACES && _substepDraw == 0; }
+
+	/** \return the probe location */
+	const glm::vec3 & position() const { return _position; }
+
+	/** \return the bounding box of the probe area of effect */
+	const BoundingBox & area() const { return _area; }
+
 	/** Copy assignment operator (disabled).
 	 \return a reference to the object assigned to
 	 */
@@ -65,18 +94,35 @@ public:
 	\param cubemap the cubemap to extract SH coefficients from
 	\param clamp maximum intensity value, useful to avoid temporal instabilities
 	\param shCoeffs will contain the irradiance SH representation
+	\note Rows of all faces are processed in parallel, using per-texel directions and weights cached for the cubemap resolution.
 	 */
 	static void extractIrradianceSHCoeffs(const Texture & cubemap, float clamp, std::vector<glm::vec3> & shCoeffs);
 	
 private:
 
+	/** \brief Per-texel data for the SH projection of a cubemap, shared by all faces. */
+	struct SHTable {
+		std::vector<glm::vec4> texels; ///< For each texel of a face, normalized direction in the face frame (xyz) and solid angle weight (w).
+		float weightSum = 0.0f; ///< Sum of the weights over the six faces.
+		uint side = 0; ///< Face resolution.
+	};
+
+	/** Retrieve the SH projection table for a given resolution, computing it if needed.
+	 \param side the cubemap face resolution
+	 \return the table
+	 */
+	static std::shared_ptr<const SHTable> shTable(uint side);
+
 	/** Perform BRDF pre-integration of the probe radiance for increasing roughness and store them in the mip levels.
 	 \param clamp maximum intensity value, useful to avoid ringing artifacts
 	 \param layer first layer to process (in 1, mip count - 1)
 	 */
 	void convolveRadiance(float clamp, uint layer);
 
-	/** Estimate the SH representation of the cubemap irradiance. The estimation is done on the GPU.
+	/** Downscale the cubemap content before estimating irradiance. */
+	void downscaleRadiance();
+
+	/** Estimate the SH representation of the downscaled cubemap irradiance. The estimation is done on the GPU.
 	 \param clamp maximum intensity value, useful to avoid temporal instabilities
 	 */
 	void estimateIrradiance(float clamp);
@@ -88,6 +134,7 @@ private:
 
 	std::array<Camera, 6> _cameras; ///< Camera for each face.
 	glm::vec3 _position; ///< The probe location.
+	BoundingBox _area; ///< The probe area of effect.
 	Program* _radianceCompute; ///< Radiance preconvolution shader.
 	Program* _irradianceCompute; ///< Irradiance SH projection shader.
 
@@ -101,4 +148,8 @@ private:
 	ProbeState _currentState = ProbeState::DRAW_FACES; ///< Current update state.
 	uint _substepDraw = 0; ///< If drawing, current face.
 	uint _substepRadiance = 1; ///< If convolving radiance, current level.
+	bool _async = false; ///< Are compute steps performed in updateCompute.
+
+	static std::unordered_map<uint, std::shared_ptr<const SHTable>> _shTables; ///< SH projection tables for each face resolution used.
+	static std::mutex _shTableLock; ///< Lock for the shared SH projection tables.
 };
@@ -0,0 +1,220 @@
+#include "renderers/ProbeScheduler.hpp"
+#include "scene/Scene.hpp"
+#include "input/Camera.hpp"
+#include "scene/lights/DirectionalLight.hpp"
+#include "scene/lights/PointLight.hpp"
+#include "scene/lights/SpotLight.hpp"
+
+#include <algorithm>
+
+void ProbeScheduler::clear(){
+	_entries.clear();
+	_candidates.clear();
+	_boxes.clear();
+	_lights.clear();
+	_statistics = Statistics();
+}
+
+void ProbeScheduler::add(Probe & probe){
+	_entries.emplace_back();
+	Entry & entry = _entries.back();
+	entry.probe = &probe;
+	entry.outdatedSince = _frame;
+}
+
+void ProbeScheduler::updateCompute(){
+	for(Entry & entry : _entries){
+		entry.probe->updateCompute();
+	}
+}
+
+bool ProbeScheduler::pendingCompute() const {
+	for(const Entry & entry : _entries){
+		if(entry.probe->pendingCompute()){
+			return true;
+		}
+	}
+	return false;
+}
+
+void ProbeScheduler::LightBounds::draw(const DirectionalLight *){
+	state.infinite = true;
+}
+
+void ProbeScheduler::LightBounds::draw(const PointLight * light){
+	const glm::vec3 radius(light->radius());
+	state.bounds = BoundingBox(light->position() - radius, light->position() + radius);
+	state.infinite = false;
+}
+
+void ProbeScheduler::LightBounds::draw(const SpotLight * light){
+	const glm::vec3 radius(light->radius());
+	state.bounds = BoundingBox(light->position() - radius, light->position() + radius);
+	state.infinite = false;
+}
+
+ProbeScheduler::LightState ProbeScheduler::lightState(Light & light){
+	LightBounds visitor;
+	light.draw(visitor);
+	visitor.state.vp = light.vp();
+	visitor.state.model = light.model();
+	visitor.state.color = light.intensity();
+	return visitor.state;
+}
+
+void ProbeScheduler::invalidate(Entry & entry){
+	// Probes already outdated keep waiting since the first change.
+	if(!entry.dirty && !entry.inProgress){
+		entry.outdatedSince = _frame;
+	}
+	entry.dirty = true;
+}
+
+void ProbeScheduler::detectChanges(const Scene & scene){
+	const size_t objectCount = scene.objects.size();
+	if(_boxes.size() != objectCount){
+		_boxes.resize(objectCount);
+		for(size_t oid = 0; oid < objectCount; ++oid){
+			_boxes[oid] = scene.objects[oid].boundingBox();
+		}
+	}
+	const size_t lightCount = scene.lights.size();
+	if(_lights.size() != lightCount){
+		_lights.resize(lightCount);
+		for(size_t lid = 0; lid < lightCount; ++lid){
+			_lights[lid] = lightState(*scene.lights[lid]);
+		}
+	}
+	// Nothing can change in a static scene.
+	if(!scene.animated()){
+		return;
+	}
+	// Lights that have changed this frame, affecting probes in their region of influence before or after the change.
+	for(size_t lid = 0; lid < lightCount; ++lid){
+		Light & light = *scene.lights[lid];
+		if(!light.animated()){
+			continue;
+		}
+		const LightState state = lightState(light);
+		LightState & previous = _lights[lid];
+		if(state.vp == previous.vp && state.model == previous.model && state.color == previous.color){
+			continue;
+		}
+		for(Entry & entry : _entries){
+			const BoundingBox & area = entry.probe->area();
+			if(state.infinite || previous.infinite || area.intersects(state.bounds) || area.intersects(previous.bounds)){
+				invalidate(entry);
+			}
+		}
+		previous = state;
+	}
+	// Objects that have moved into or out of a probe area.
+	for(size_t oid = 0; oid < objectCount; ++oid){
+		const Object & object = scene.objects[oid];
+		if(!object.moved()){
+			continue;
+		}
+		const BoundingBox & box = object.boundingBox();
+		for(Entry & entry : _entries){
+			const BoundingBox & area = entry.probe->area();
+			if(area.intersects(box) || area.intersects(_boxes[oid])){
+				invalidate(entry);
+			}
+		}
+		_boxes[oid] = box;
+	}
+}
+
+void ProbeScheduler::update(const Scene & scene, const Camera & camera, bool animated){
+	++_frame;
+	// Objects and lights are left untouched while the animation is paused.
+	if(animated){
+		detectChanges(scene);
+	}
+
+	// Find outdated probes.
+	const Frustum frustum(camera.projection() * camera.view());
+	const glm::vec3 & eye = camera.position();
+	_candidates.clear();
+	_statistics = Statistics();
+	_statistics.probes = uint(_entries.size());
+	const size_t probeCount = _entries.size();
+	for(size_t pid = 0; pid < probeCount; ++pid){
+		Entry & entry = _entries[pid];
+		// An update started in a previous frame has completed. If the surroundings
+		// have changed since it started, the probe is still dirty.
+		if(entry.inProgress && entry.probe->idle()){
+			entry.inProgress = false;
+			entry.valid = true;
+		}
+		if(!entry.inProgress && !entry.dirty){
+			continue;
+		}
+		_candidates.push_back(pid);
+		const uint age = uint(_frame - entry.outdatedSince);
+		++_statistics.outdated;
+		_statistics.maxAge = std::max(_statistics.maxAge, age);
+		_statistics.averageAge += float(age);
+		// Waiting time, boosted for probes in view, attenuated with the distance.
+		const float visibility = frustum.intersects(entry.probe->area()) ? 4.0f : 1.0f;
+		const float distance = glm::distance(eye, entry.probe->position());
+		entry.score = float(1 + _frame - entry.lastUpdate) * visibility / (1.0f + distance);
+	}
+	if(_statistics.outdated != 0){
+		_statistics.averageAge /= float(_statistics.outdated);
+	}
+
+	// Complete updates in progress first, then probes that have never been rendered, then by priority.
+	std::stable_sort(_candidates.begin(), _candidates.end(), [this](size_t a, size_t b){
+		const Entry & entryA = _entries[a];
+		const Entry & entryB = _entries[b];
+		if(entryA.inProgress != entryB.inProgress){
+			return entryA.inProgress;
+		}
+		if(entryA.valid != entryB.valid){
+			return !entryA.valid;
+		}
+		return entryA.score > entryB.score;
+	});
+
+	// Convert the time budget into steps, at least one if something is outdated.
+	uint budget = 1;
+	if(_stepCost > 0.0f){
+		budget = std::max(1u, uint(_budget / _stepCost));
+	}
+
+	// The timer runs every frame so that delayed timings stay consistent with the step counts.
+	_timer.begin();
+	for(const size_t pid : _candidates){
+		if(budget == 0){
+			break;
+		}
+		Entry & entry = _entries[pid];
+		// Probes waiting for their async compute steps have nothing to draw.
+		const uint remaining = entry.probe->remainingBudget();
+		if(remaining == 0){
+			continue;
+		}
+		if(!entry.inProgress){
+			entry.inProgress = true;
+			entry.dirty = false;
+			entry.lastUpdate = _frame;
+		}
+		const uint steps = std::min(budget, remaining);
+		entry.probe->update(steps);
+		budget -= steps;
+		_statistics.steps += steps;
+		++_statistics.updated;
+	}
+	_timer.end();
+
+	// Timings are delayed by a few frames, estimate the cost of a step from averages over recent frames.
+	const float smoothing = 0.9f;
+	_statistics.time = float(_timer.value()) / 1000000.0f;
+	_averageTime = smoothing * _averageTime + (1.0f - smoothing) * _statistics.time;
+	_averageSteps = smoothing * _averageSteps + (1.0f - smoothing) * float(_statistics.steps);
+	if(_averageSteps > 0.1f && _averageTime > 0.0f){
+		_stepCost = _averageTime / _averageSteps;
+	}
+	_statistics.stepCost = _stepCost;
+}
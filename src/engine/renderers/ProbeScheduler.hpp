@@ -0,0 +1,139 @@
+#pragma once
+
+#include "renderers/Probe.hpp"
+#include "renderers/LightRenderer.hpp"
+#include "resources/Bounds.hpp"
+#include "graphics/GPUTypes.hpp"
+#include "Common.hpp"
+
+class Scene;
+class Light;
+class Camera;
+
+/**
+ \brief Distribute the update steps of a set of probes over frames, within a GPU time budget.
+ \details A probe is outdated when an object moving in its area of effect or a light changing in its area of influence could have changed its surroundings; probes in static surroundings are left untouched. Each frame, the time spent updating probes is measured and used to estimate the cost of a single update step. Outdated probes are then updated, as many steps as the budget allows: probes that have started an update complete it first, then probes that have never been rendered, then probes ranked by how long they have been waiting, whether they are visible, and how close they are to the camera.
+ \note The cost estimate relies on GPU timings read back a few frames later, it adapts over a couple of frames when the load changes. When using async compute, only the faces drawing is counted against the budget.
+ \ingroup Renderers
+ */
+class ProbeScheduler {
+public:
+
+	/** \brief Freshness of the probes after the last update. */
+	struct Statistics {
+		uint probes = 0; ///< Number of registered probes.
+		uint outdated = 0; ///< Number of probes whose content does not reflect their surroundings.
+		uint updated = 0; ///< Number of probes that received update steps.
+		uint steps = 0; ///< Number of update steps performed.
+		float stepCost = 0.0f; ///< Estimated cost of an update step, in milliseconds.
+		float time = 0.0f; ///< Measured time spent updating probes, in milliseconds.
+		uint maxAge = 0; ///< Largest number of frames an outdated probe has been waiting for.
+		float averageAge = 0.0f; ///< Average number of frames outdated probes have been waiting for.
+	};
+
+	/** Remove all probes. */
+	void clear();
+
+	/** Register a probe, it will be considered outdated until its first complete update.
+	 \param probe the probe to schedule
+	 */
+	void add(Probe & probe);
+
+	/** Set the GPU time allocated to probe updates each frame. At least one step is always performed if a probe is outdated.
+	 \param budget the time in milliseconds
+	 */
+	void setBudget(float budget){ _budget = budget; }
+
+	/** \return the GPU time allocated to probe updates each frame, in milliseconds */
+	float budget() const { return _budget; }
+
+	/** Perform the compute steps of the probes whose faces have all been drawn.
+	 \note This can be called between GPU::beginAsyncCompute and GPU::endAsyncCompute.
+	 */
+	void updateCompute();
+
+	/** \return true if at least one probe has compute steps to perform in updateCompute */
+	bool pendingCompute() const;
+
+	/** Detect outdated probes and perform update steps within the budget.
+	 \param scene the scene the probes are capturing
+	 \param camera the main viewpoint, used to prioritize probes
+	 \param animated has the scene been animated since the last update, if not change detection is skipped (for instance when the animation is paused)
+	 */
+	void update(const Scene & scene, const Camera & camera, bool animated);
+
+	/** \return freshness statistics on the last update */
+	const Statistics & statistics() const { return _statistics; }
+
+private:
+
+	/** \brief Scheduling state of a probe. */
+	struct Entry {
+		Probe * probe = nullptr; ///< The probe.
+		uint64_t lastUpdate = 0; ///< Frame at which the probe last started an update.
+		uint64_t outdatedSince = 0; ///< Frame at which the probe content stopped reflecting its surroundings.
+		float score = 0.0f; ///< Priority for the current frame.
+		bool valid = false; ///< Has the probe ever been completely updated.
+		bool dirty = true; ///< Have the surroundings changed since the last update started.
+		bool inProgress = false; ///< Is an update in progress.
+	};
+
+	/** \brief Region lit by a light, and the parameters used to detect changes. */
+	struct LightState {
+		BoundingBox bounds; ///< Bounds of the lit region.
+		glm::mat4 vp; ///< Light view projection matrix.
+		glm::mat4 model; ///< Light model matrix.
+		glm::vec3 color; ///< Light intensity.
+		bool infinite = false; ///< Does the light affect the whole scene.
+	};
+
+	/** \brief Compute the region lit by a light, based on its type. */
+	class LightBounds final : public LightRenderer {
+	public:
+
+		/** Directional lights affect the whole scene.
+		 \param light the light to visit.
+		 */
+		void draw(const DirectionalLight * light) override;
+
+		/** Point lights affect the sphere of their radius.
+		 \param light the light to visit.
+		 */
+		void draw(const PointLight * light) override;
+
+		/** Spot lights cones are contained in the sphere of their radius.
+		 \param light the light to visit.
+		 */
+		void draw(const SpotLight * light) override;
+
+		LightState state; ///< The last visited light state.
+	};
+
+	/** Capture the current state of a light.
+	 \param light the light
+	 \return the light state
+	 */
+	static LightState lightState(Light & light);
+
+	/** Mark a probe as dirty, keeping track of the frame at which it became outdated.
+	 \param entry the probe state
+	 */
+	void invalidate(Entry & entry);
+
+	/** Mark the probes affected by changes in the scene as dirty.
+	 \param scene the scene the probes are capturing
+	 */
+	void detectChanges(const Scene & scene);
+
+	std::vector<Entry> _entries; ///< Registered probes.
+	std::vector<size_t> _candidates; ///< Outdated probes, for selection.
+	std::vector<BoundingBox> _boxes; ///< Objects bounding boxes at the previous update.
+	std::vector<LightState> _lights; ///< Lights state at the previous update.
+	GPUQuery _timer; ///< Time spent updating probes.
+	Statistics _statistics; ///< Freshness statistics.
+	uint64_t _frame = 0; ///< Update counter.
+	float _budget = 1.0f; ///< Time allocated each frame, in milliseconds.
+	float _averageTime = 0.0f; ///< Moving average of the measured time, in milliseconds.
+	float _averageSteps = 0.0f; ///< Moving average of the number of steps performed.
+	float _stepCost = 0.0f; ///< Estimated cost of a step, in milliseconds, 0 if unknown.
+};
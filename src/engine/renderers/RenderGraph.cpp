@@ -0,0 +1,282 @@
+#include "renderers/RenderGraph.hpp"
+#include "renderers/DebugViewer.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/GPUObjects.hpp"
+
+#include <algorithm>
+
+RenderGraph::RenderGraph(const std::string & name) : _name(name), _memory(new GPUMemory()) {
+}
+
+void RenderGraph::reset(){
+	_textures.clear();
+	_passes.clear();
+}
+
+RenderGraph::Resource RenderGraph::importTexture(const Texture & texture){
+	for(size_t rid = 0; rid < _textures.size(); ++rid){
+		if(_textures[rid].imported == &texture){
+			return Resource(rid);
+		}
+	}
+	_textures.emplace_back();
+	Declaration & declaration = _textures.back();
+	declaration.name = texture.name();
+	declaration.description.format = texture.format;
+	declaration.description.width = texture.width;
+	declaration.description.height = texture.height;
+	declaration.imported = &texture;
+	return Resource(_textures.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::createTexture(const std::string & name, Layout format, uint width, uint height){
+	_textures.emplace_back();
+	Declaration & declaration = _textures.back();
+	declaration.name = name;
+	declaration.description.format = format;
+	declaration.description.width = std::max(width, 1u);
+	declaration.description.height = std::max(height, 1u);
+	return Resource(_textures.size() - 1);
+}
+
+void RenderGraph::addPass(const std::string & name, const std::vector<Resource> & reads, const std::vector<Resource> & writes, const Execute & execute){
+	_passes.emplace_back();
+	Pass & pass = _passes.back();
+	pass.name = name;
+	pass.reads = reads;
+	pass.writes = writes;
+	pass.execute = execute;
+}
+
+void RenderGraph::compile(){
+	const uint passCount = uint(_passes.size());
+	const size_t textureCount = _textures.size();
+
+	// Walk the passes backwards, keeping only those writing to imported textures or to textures read by kept passes.
+	std::vector<bool> needed(textureCount, false);
+	for(size_t rid = 0; rid < textureCount; ++rid){
+		needed[rid] = _textures[rid].imported != nullptr;
+	}
+	_statistics.passes = 0;
+	_statistics.culledPasses = 0;
+	for(uint pid = passCount; pid > 0; --pid){
+		Pass & pass = _passes[pid - 1];
+		pass.discards.clear();
+		pass.culled = true;
+		for(const Resource rid : pass.writes){
+			if(needed[rid]){
+				pass.culled = false;
+				break;
+			}
+		}
+		if(pass.culled){
+			++_statistics.culledPasses;
+			continue;
+		}
+		++_statistics.passes;
+		for(const Resource rid : pass.reads){
+			needed[rid] = true;
+		}
+	}
+
+	// Lifetime of each transient texture.
+	for(uint pid = 0; pid < passCount; ++pid){
+		const Pass & pass = _passes[pid];
+		if(pass.culled){
+			continue;
+		}
+		for(const std::vector<Resource> * list : { &pass.reads, &pass.writes }){
+			for(const Resource rid : *list){
+				Declaration & declaration = _textures[rid];
+				if(!declaration.used){
+					declaration.used = true;
+					declaration.first = pid;
+				}
+				declaration.last = pid;
+			}
+		}
+	}
+	std::vector<Resource> used;
+	for(size_t rid = 0; rid < textureCount; ++rid){
+		const Declaration & declaration = _textures[rid];
+		if(declaration.used && declaration.imported == nullptr){
+			used.push_back(Resource(rid));
+		}
+	}
+
+	// Reuse the existing allocations if the transient textures and their lifetimes are unchanged.
+	bool identical = used.size() == _allocations.size();
+	for(size_t aid = 0; identical && aid < used.size(); ++aid){
+		const Declaration & declaration = _textures[used[aid]];
+		const Allocation & allocation = _allocations[aid];
+		identical = declaration.name == allocation.name
+			&& declaration.description.format == allocation.description.format
+			&& declaration.description.width == allocation.description.width
+			&& declaration.description.height == allocation.description.height
+			&& declaration.first == allocation.first
+			&& declaration.last == allocation.last;
+	}
+	if(!identical){
+		allocate(used);
+	}
+
+	for(size_t aid = 0; aid < used.size(); ++aid){
+		_textures[used[aid]].allocation = uint(aid);
+		// Textures sharing memory have to wait for the previous owner before being written to.
+		if(_allocations[aid].aliased){
+			_passes[_allocations[aid].first].discards.push_back(uint(aid));
+		}
+	}
+}
+
+void RenderGraph::allocate(const std::vector<Resource> & used){
+	clean();
+
+	const size_t count = used.size();
+	_allocations.resize(count);
+	uint typeBits = 0xFFFFFFFF;
+	uint64_t alignment = 1;
+	_statistics.separateMemory = 0;
+	for(size_t aid = 0; aid < count; ++aid){
+		const Declaration & declaration = _textures[used[aid]];
+		Allocation & allocation = _allocations[aid];
+		allocation.name = declaration.name;
+		allocation.description = declaration.description;
+		allocation.first = declaration.first;
+		allocation.last = declaration.last;
+
+		allocation.texture.reset(new Texture(declaration.name));
+		Texture & texture = *allocation.texture;
+		texture.width = declaration.description.width;
+		texture.height = declaration.description.height;
+		texture.format = declaration.description.format;
+		texture.drawable = true;
+
+		uint textureTypeBits = 0;
+		GPU::getTextureRequirements(texture, allocation.size, allocation.alignment, textureTypeBits);
+		typeBits &= textureTypeBits;
+		alignment = std::max(alignment, allocation.alignment);
+		_statistics.separateMemory += allocation.size;
+	}
+	_statistics.textures = uint(count);
+
+	if(typeBits == 0){
+		// No memory type can host all textures, fallback to separate allocations.
+		Log::Warning() << Log::GPU << "Render graph " << _name << ": unable to alias transient textures." << std::endl;
+		for(Allocation & allocation : _allocations){
+			GPU::setupTexture(*allocation.texture);
+			DebugViewer::trackDefault(allocation.texture.get());
+		}
+		_statistics.aliasedMemory = _statistics.separateMemory;
+		return;
+	}
+
+	// Place larger textures first, at the lowest offset that doesn't overlap a texture alive at the same time.
+	std::vector<size_t> order(count);
+	for(size_t aid = 0; aid < count; ++aid){
+		order[aid] = aid;
+	}
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b){
+		return _allocations[a].size > _allocations[b].size;
+	});
+
+	std::vector<size_t> placed;
+	std::vector<uint64_t> candidates;
+	uint64_t memorySize = 0;
+	for(const size_t aid : order){
+		Allocation & allocation = _allocations[aid];
+		// Candidate locations are the start of the block and the end of each placed texture.
+		candidates.assign(1, 0u);
+		for(const size_t pid : placed){
+			const Allocation & other = _allocations[pid];
+			const uint64_t end = other.offset + other.size;
+			candidates.push_back(((end + allocation.alignment - 1) / allocation.alignment) * allocation.alignment);
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for(const uint64_t offset : candidates){
+			bool free = true;
+			for(const size_t pid : placed){
+				const Allocation & other = _allocations[pid];
+				const bool overlapInTime = allocation.first <= other.last && other.first <= allocation.last;
+				const bool overlapInMemory = offset < other.offset + other.size && other.offset < offset + allocation.size;
+				if(overlapInTime && overlapInMemory){
+					free = false;
+					break;
+				}
+			}
+			if(free){
+				allocation.offset = offset;
+				break;
+			}
+		}
+		placed.push_back(aid);
+		memorySize = std::max(memorySize, allocation.offset + allocation.size);
+	}
+
+	// Flag textures sharing memory with others.
+	for(size_t aid = 0; aid < count; ++aid){
+		Allocation & allocation = _allocations[aid];
+		for(size_t oid = 0; oid < count; ++oid){
+			const Allocation & other = _allocations[oid];
+			if(oid != aid && allocation.offset < other.offset + other.size && other.offset < allocation.offset + allocation.size){
+				allocation.aliased = true;
+				break;
+			}
+		}
+	}
+
+	_statistics.aliasedMemory = memorySize;
+	if(memorySize == 0){
+		return;
+	}
+	GPU::setupMemory(*_memory, memorySize, alignment, typeBits);
+	for(Allocation & allocation : _allocations){
+		GPU::setupTexture(*allocation.texture, _memory.get(), allocation.offset);
+		DebugViewer::trackDefault(allocation.texture.get());
+	}
+
+	const double mb = 1.0 / (1024.0 * 1024.0);
+	Log::Verbose() << Log::GPU << "Render graph " << _name << ": " << count << " transient textures, " << (double(memorySize) * mb) << "MB allocated instead of " << (double(_statistics.separateMemory) * mb) << "MB." << std::endl;
+}
+
+void RenderGraph::execute(){
+	const size_t passCount = _passes.size();
+	for(size_t pid = 0; pid < passCount; ++pid){
+		const Pass & pass = _passes[pid];
+		if(pass.culled){
+			continue;
+		}
+		for(const uint aid : pass.discards){
+			GPU::discardTexture(*_allocations[aid].texture);
+		}
+		GPUMarker marker(pass.name);
+		pass.execute();
+	}
+}
+
+const Texture & RenderGraph::texture(Resource resource) const {
+	const Declaration & declaration = _textures[resource];
+	if(declaration.imported){
+		return *declaration.imported;
+	}
+	assert(declaration.used);
+	return *_allocations[declaration.allocation].texture;
+}
+
+const RenderGraph::Description & RenderGraph::description(Resource resource) const {
+	return _textures[resource].description;
+}
+
+void RenderGraph::clean(){
+	// Textures are destroyed before the memory they are bound to.
+	_allocations.clear();
+	_memory->clean();
+	_statistics.aliasedMemory = 0;
+	_statistics.separateMemory = 0;
+	_statistics.textures = 0;
+}
+
+RenderGraph::~RenderGraph(){
+	clean();
+}
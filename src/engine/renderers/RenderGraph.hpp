@@ -0,0 +1,164 @@
+#pragma once
+
+#include "resources/Texture.hpp"
+#include "Common.hpp"
+
+#include <functional>
+
+class GPUMemory;
+
+/**
+ \brief Schedule rendering passes that declare the textures they read and write, and allocate the transient textures they use.
+ \details The graph is declared again each frame: textures owned elsewhere are imported, textures only used during the frame are declared as transient, and each pass lists the textures it reads and writes, along with a function recording its commands. When compiling, passes that do not contribute to an imported texture are culled, and the lifetime of each transient texture is computed, from the first to the last pass using it. Transient textures with disjoint lifetimes are placed at the same location in a shared memory block. Allocations are kept from one frame to the next as long as the declared textures and their lifetimes are unchanged.
+
+ Layout transitions between passes are handled by the GPU layer texture state tracking; the graph only inserts a barrier before the first pass using a texture that shares its memory with others.
+ \ingroup Renderers
+ */
+class RenderGraph {
+public:
+
+	/// Handle to a texture in the graph.
+	using Resource = uint;
+
+	/// Function recording the commands of a pass.
+	using Execute = std::function<void()>;
+
+	/** \brief Transient texture description. */
+	struct Description {
+		Layout format = Layout::NONE; ///< Texture layout.
+		uint width = 0; ///< Width in pixels.
+		uint height = 0; ///< Height in pixels.
+	};
+
+	/** \brief Statistics on the last compiled graph. */
+	struct Statistics {
+		uint64_t separateMemory = 0; ///< Memory needed if each transient texture had its own allocation, in bytes.
+		uint64_t aliasedMemory = 0; ///< Memory actually allocated for transient textures, in bytes.
+		uint textures = 0; ///< Number of transient textures allocated.
+		uint passes = 0; ///< Number of passes executed.
+		uint culledPasses = 0; ///< Number of passes culled.
+	};
+
+	/** Constructor.
+	 \param name the graph debug name
+	 */
+	explicit RenderGraph(const std::string & name);
+
+	/** Remove all declared passes and textures, before declaring the graph again. Allocations are preserved until the next compilation. */
+	void reset();
+
+	/** Register a texture owned elsewhere. Passes writing to imported textures are never culled.
+	 \param texture the texture to import
+	 \return the texture handle
+	 \note Importing the same texture twice returns the same handle.
+	 */
+	Resource importTexture(const Texture & texture);
+
+	/** Declare a transient 2D texture, whose content is only valid between the first and last passes using it in the current frame.
+	 \param name the texture debug name
+	 \param format the texture layout
+	 \param width the texture width
+	 \param height the texture height
+	 \return the texture handle
+	 */
+	Resource createTexture(const std::string & name, Layout format, uint width, uint height);
+
+	/** Declare a pass. Passes are executed in declaration order.
+	 \param name the pass name, used as a GPU marker
+	 \param reads the textures read by the pass
+	 \param writes the textures written by the pass
+	 \param execute the function recording the pass commands
+	 */
+	void addPass(const std::string & name, const std::vector<Resource> & reads, const std::vector<Resource> & writes, const Execute & execute);
+
+	/** Cull unused passes, compute transient textures lifetimes and allocate them if needed. */
+	void compile();
+
+	/** Execute all passes that have not been culled. */
+	void execute();
+
+	/** Query the texture corresponding to a handle, only valid during execution.
+	 \param resource the texture handle
+	 \return the texture
+	 */
+	const Texture & texture(Resource resource) const;
+
+	/** Query the description of a texture.
+	 \param resource the texture handle
+	 \return the texture description
+	 */
+	const Description & description(Resource resource) const;
+
+	/** \return statistics on the last compiled graph */
+	const Statistics & statistics() const { return _statistics; }
+
+	/** Release all allocated textures. */
+	void clean();
+
+	/** Destructor. */
+	~RenderGraph();
+
+	/** Copy constructor (disabled). */
+	RenderGraph(const RenderGraph &) = delete;
+
+	/** Copy assignment (disabled).
+	 \return a reference to the object assigned to
+	 */
+	RenderGraph & operator=(const RenderGraph &) = delete;
+
+	/** Move constructor (disabled). */
+	RenderGraph(RenderGraph &&) = delete;
+
+	/** Move assignment (disabled).
+	 \return a reference to the object assigned to
+	 */
+	RenderGraph & operator=(RenderGraph &&) = delete;
+
+private:
+
+	/** \brief A declared texture. */
+	struct Declaration {
+		std::string name; ///< Debug name.
+		Description description; ///< Layout and size.
+		const Texture * imported = nullptr; ///< The imported texture, or null for transient textures.
+		uint first = 0; ///< First pass using the texture.
+		uint last = 0; ///< Last pass using the texture.
+		bool used = false; ///< Is the texture used by a pass that has not been culled.
+		uint allocation = 0; ///< Index of the allocated texture, for transient textures.
+	};
+
+	/** \brief A declared pass. */
+	struct Pass {
+		std::string name; ///< Debug name.
+		std::vector<Resource> reads; ///< Textures read.
+		std::vector<Resource> writes; ///< Textures written.
+		Execute execute; ///< Commands recording.
+		std::vector<uint> discards; ///< Allocated textures taking over shared memory at this pass.
+		bool culled = false; ///< Is the pass culled.
+	};
+
+	/** \brief A transient texture allocated in the shared memory block. */
+	struct Allocation {
+		std::string name; ///< Debug name.
+		Description description; ///< Layout and size.
+		uint first = 0; ///< First pass using the texture.
+		uint last = 0; ///< Last pass using the texture.
+		uint64_t size = 0; ///< Size in memory, in bytes.
+		uint64_t alignment = 0; ///< Alignment in memory, in bytes.
+		uint64_t offset = 0; ///< Offset in the memory block, in bytes.
+		bool aliased = false; ///< Is the memory range shared with other textures.
+		std::unique_ptr<Texture> texture; ///< The texture.
+	};
+
+	/** Allocate all transient textures used by the graph, and place them in a shared memory block.
+	 \param used the transient textures to allocate
+	 */
+	void allocate(const std::vector<Resource> & used);
+
+	std::string _name; ///< Debug name.
+	std::vector<Declaration> _textures; ///< Declared textures.
+	std::vector<Pass> _passes; ///< Declared passes.
+	std::vector<Allocation> _allocations; ///< Allocated transient textures.
+	std::unique_ptr<GPUMemory> _memory; ///< Shared memory block.
+	Statistics _statistics; ///< Statistics on the last compilation.
+};
@@ -16,3 +16,6 @@ void Renderer::interface(){
 
 void Renderer::resize(uint, uint){
 }
+
+void Renderer::prepareViews(const std::vector<const Camera *> &){
+}
@@ -23,6 +23,11 @@ public:
 	 \param layer the layer to write to in the target
 	 */
 	virtual void draw(const Camera & camera, Texture* dstColor, Texture* dstDepth, uint layer = 0);
+
+	/** Prepare the next draws from several viewpoints at once, for instance by culling the scene for all of them in a single pass.
+	 \param cameras the viewpoints that will be drawn next
+	 */
+	virtual void prepareViews(const std::vector<const Camera *> & cameras);
 	
 	/** Handle a window resize event.
 	 \param width the new width
@@ -1,63 +1,151 @@
 #include "BasicShadowMap.hpp"
 #include "scene/Scene.hpp"
 #include "graphics/GPU.hpp"
+#include "scene/lights/SpotLight.hpp"
+#include "input/Camera.hpp"
 
-BasicShadowMap2DArray::BasicShadowMap2DArray(const std::vector<std::shared_ptr<Light>> & lights, const glm::vec2 & resolution, ShadowMode mode) : _map("Shadow map 2D array"){
+BasicShadowMapAtlas::BasicShadowMapAtlas(const std::vector<std::shared_ptr<Light>> & lights, uint size, ShadowMode mode) : _map("Shadow map atlas"), _cache("Shadow map atlas cache"), _atlas(size, 64, size / 2), _mode(mode) {
 	_lights = lights;
+	// Use a single layer array to keep the same shaders as other 2D shadow maps.
 	/// \bug The depth buffer will contain extra garbage data and can't be used as an input to the light pass currently.
-	_map.setupAsDrawable(Layout::DEPTH_COMPONENT32F, uint(resolution.x), uint(resolution.y), TextureShape::Array2D, 1, uint(lights.size()));
+	_map.setupAsDrawable(Layout::DEPTH_COMPONENT32F, size, size, TextureShape::Array2D, 1, 1);
+	_cache.setup(_map, _lights.size());
 
 	_program = Resources::manager().getProgram("object_depth_array", "light_shadow_vertex", "light_shadow_basic");
+	// Initial allocation, with the largest tiles possible.
+	_sizes.assign(_lights.size(), _atlas.maxTileSize());
+	_atlas.pack(_sizes, _changed);
 	for(size_t lid = 0; lid < _lights.size(); ++lid){
-		_lights[lid]->registerShadowMap(&_map, mode, lid);
+		registerTile(lid);
+	}
+}
+
+void BasicShadowMapAtlas::setViewpoint(const Camera & camera){
+	_view = camera.view();
+	_proj = camera.projection();
+	_hasViewpoint = true;
+}
+
+uint BasicShadowMapAtlas::requestedSize(const Light & light) const {
+	const uint maxSize = _atlas.maxTileSize();
+	// Directional lights cover the whole screen.
+	const SpotLight * spot = dynamic_cast<const SpotLight *>(&light);
+	if(!_hasViewpoint || spot == nullptr){
+		return maxSize;
+	}
+	// Spot lights outside of the view only need a coarse map.
+	const Frustum frustum(_proj * _view);
+	if(!frustum.intersects(BoundingSphere(spot->position(), spot->radius()))){
+		return 0;
+	}
+	const glm::vec3 center = glm::vec3(_view * glm::vec4(spot->position(), 1.0f));
+	const float radius = spot->radius();
+	const float distance2 = glm::dot(center, center);
+	if(distance2 <= radius * radius){
+		return maxSize;
 	}
+	// Projected radius of the light sphere, relative to the screen half-height.
+	const float coverage = radius * _proj[1][1] / std::sqrt(distance2 - radius * radius);
+	return uint(std::min(coverage, 1.0f) * float(maxSize));
 }
 
-void BasicShadowMap2DArray::draw(const Scene & scene) {
+void BasicShadowMapAtlas::registerTile(size_t lid){
+	const ShadowAtlas::Tile & tile = _atlas.tile(lid);
+	if(tile.size == 0){
+		_lights[lid]->registerShadowMap(nullptr, ShadowMode::NONE);
+		return;
+	}
+	const glm::vec2 minUV = glm::vec2(tile.offset) / float(_atlas.size());
+	const glm::vec2 maxUV = glm::vec2(tile.offset + tile.size) / float(_atlas.size());
+	_lights[lid]->registerShadowMap(&_map, _mode, 0, minUV, maxUV);
+}
+
+void BasicShadowMapAtlas::draw(const Scene & scene) {
+
+	// Update tiles based on the lights screen coverage.
+	for(size_t lid = 0; lid < _lights.size(); ++lid){
+		_sizes[lid] = requestedSize(*_lights[lid]);
+	}
+	_atlas.pack(_sizes, _changed);
+	for(const size_t lid : _changed){
+		registerTile(lid);
+		_cache.invalidate(uint(lid));
+	}
+
+	// Cull shadow casters for all shadow views at once.
+	_frustums.clear();
+	_vps.clear();
+	_slots.clear();
+	for(uint lid = 0; lid < uint(_lights.size()); ++lid){
+		const auto & light = _lights[lid];
+		if(light->castsShadow() && _atlas.tile(lid).size != 0){
+			_frustums.emplace_back(light->vp());
+			_vps.push_back(light->vp());
+			_slots.push_back(lid);
+		}
+	}
+	scene.hierarchy().query(_frustums, _visibles, true);
+
+	// Only update views that have changed.
+	_cache.select(scene, _animated, _slots, _vps, _visibles, _updates);
+	if(_updates.empty()){
+		return;
+	}
 
 	GPU::setDepthState(true, TestFunction::LESS, true);
 	GPU::setBlendState(false);
 	GPU::setCullState(true, Faces::BACK);
 
-	GPU::setViewport(_map);
 	_program->use();
 	_program->defaultTexture(0);
 
-	for(uint lid = 0; lid < uint(_lights.size()); ++lid){
-		const auto & light = _lights[lid];
-		if(!light->castsShadow()){
-			continue;
+	for(const ShadowCache::Update & update : _updates){
+		const ShadowAtlas::Tile & tile = _atlas.tile(_slots[update.view]);
+		const glm::uvec2 tileSize(tile.size);
+		const ObjectsHierarchy::List & casters = _visibles[update.view];
+		// Render static casters in the cache if the light has moved.
+		if(update.refreshStatic){
+			GPU::beginRender(0, 0, Load::Operation::LOAD, Load::Operation::DONTCARE, &_cache.map());
+			GPU::setViewport(int(tile.offset.x), int(tile.offset.y), int(tile.size), int(tile.size));
+			GPU::clearDepth(1.0f, tile.offset, tileSize);
+			drawCasters(scene, casters, _vps[update.view], false);
+			GPU::endRender();
 		}
-		GPU::beginRender(lid, 0, 1.f, Load::Operation::DONTCARE, &_map);
-		const Frustum lightFrustum(light->vp());
-
-		for(auto & object : scene.objects) {
-			if(!object.castsShadow()) {
-				continue;
-			}
-			// Frustum culling.
-			if(!lightFrustum.intersects(object.boundingBox())){
-				continue;
-			}
-			const Material& mat = object.material();
-			GPU::setCullState(!mat.twoSided(), Faces::BACK);
-
-			_program->uniform("hasMask", mat.masked());
-			if(mat.masked()) {
-				_program->texture(mat.textures()[0], 0);
-			}
-			const glm::mat4 lightMVP = light->vp() * object.model();
-			_program->uniform("mvp", lightMVP);
-			GPU::drawMesh(*(object.mesh()));
+		// Restore static casters and render dynamic casters on top.
+		GPU::copy(_cache.map(), _map, 0, 0, tile.offset, tileSize);
+		if(update.hasDynamic){
+			GPU::beginRender(0, 0, Load::Operation::LOAD, Load::Operation::DONTCARE, &_map);
+			GPU::setViewport(int(tile.offset.x), int(tile.offset.y), int(tile.size), int(tile.size));
+			drawCasters(scene, casters, _vps[update.view], true);
+			GPU::endRender();
 		}
-		GPU::endRender();
 	}
 
 }
 
-BasicShadowMapCubeArray::BasicShadowMapCubeArray(const std::vector<std::shared_ptr<PointLight>> & lights, int side, ShadowMode mode) : _map("Shadow map cube array"){
+void BasicShadowMapAtlas::drawCasters(const Scene & scene, const ObjectsHierarchy::List & casters, const glm::mat4 & vp, bool animated){
+	for(const long objectId : casters) {
+		const Object & object = scene.objects[objectId];
+		if(object.animated() != animated){
+			continue;
+		}
+		const Material& mat = object.material();
+		GPU::setCullState(!mat.twoSided(), Faces::BACK);
+
+		_program->uniform("hasMask", mat.masked());
+		if(mat.masked()) {
+			_program->texture(mat.textures()[0], 0);
+		}
+		const glm::mat4 lightMVP = vp * object.model();
+		_program->uniform("mvp", lightMVP);
+		GPU::drawMesh(*(object.mesh()));
+	}
+}
+
+BasicShadowMapCubeArray::BasicShadowMapCubeArray(const std::vector<std::shared_ptr<PointLight>> & lights, int side, ShadowMode mode) : _map("Shadow map cube array"), _cache("Shadow map cube array cache"){
 	_lights = lights;
 	_map.setupAsDrawable(Layout::DEPTH_COMPONENT32F, side, side, TextureShape::ArrayCube, 1, uint(lights.size()));
+	_cache.setup(_map, _map.depth);
 	_program = Resources::manager().getProgram("object_cube_depth_array", "light_shadow_linear_vertex", "light_shadow_linear_basic");
 	for(size_t lid = 0; lid < _lights.size(); ++lid){
 		_lights[lid]->registerShadowMap(&_map, mode, lid);
@@ -66,6 +154,30 @@ BasicShadowMapCubeArray::BasicShadowMapCubeArray(const std::vector<std::shared_p
 
 void BasicShadowMapCubeArray::draw(const Scene & scene) {
 
+	// Cull shadow casters for all shadow views at once.
+	_frustums.clear();
+	_vps.clear();
+	_layers.clear();
+	for(uint lid = 0; lid < uint(_lights.size()); ++lid){
+		const auto & light = _lights[lid];
+		if(!light->castsShadow()){
+			continue;
+		}
+		const auto & faces = light->vpFaces();
+		for(uint i = 0; i < 6; ++i){
+			_frustums.emplace_back(faces[i]);
+			_vps.push_back(faces[i]);
+			_layers.push_back(lid * 6 + i);
+		}
+	}
+	scene.hierarchy().query(_frustums, _visibles, true);
+
+	// Only update faces that have changed.
+	_cache.select(scene, _animated, _layers, _vps, _visibles, _updates);
+	if(_updates.empty()){
+		return;
+	}
+
 	GPU::setDepthState(true, TestFunction::LESS, true);
 	GPU::setCullState(true, Faces::BACK);
 	GPU::setBlendState(false);
@@ -73,43 +185,46 @@ void BasicShadowMapCubeArray::draw(const Scene & scene) {
 	_program->use();
 	_program->defaultTexture(0);
 
-	for(uint lid = 0; lid < uint(_lights.size()); ++lid){
-		const auto & light = _lights[lid];
-		if(!light->castsShadow()){
-			continue;
-		}
-		// Udpate the light vp matrices.
-		const auto & faces = light->vpFaces();
+	for(const ShadowCache::Update & update : _updates){
+		const uint layer = _layers[update.view];
+		const auto & light = _lights[layer / 6];
+		const ObjectsHierarchy::List & casters = _visibles[update.view];
 
 		// Pass the world space light position, and the projection matrix far plane.
 		_program->uniform("lightPositionWorld", light->position());
 		_program->uniform("lightFarPlane", light->farPlane());
-		for(uint i = 0; i < 6; ++i){
-			// We render each face sequentially, culling objects that are not visible.
-			GPU::beginRender(lid * 6 + i, 0, 1.f, Load::Operation::DONTCARE, &_map);
-			const Frustum lightFrustum(faces[i]);
-
-			for(auto & object : scene.objects) {
-				if(!object.castsShadow()) {
-					continue;
-				}
-				// Frustum culling.
-				if(!lightFrustum.intersects(object.boundingBox())){
-					continue;
-				}
-				const Material& mat = object.material();
-				GPU::setCullState(!mat.twoSided(), Faces::BACK);
-				const glm::mat4 mvp = faces[i] * object.model();
-				_program->uniform("mvp", mvp);
-				_program->uniform("m", object.model());
-				_program->uniform("hasMask", mat.masked());
-				if(mat.masked()) {
-					_program->texture(mat.textures()[0], 0);
-				}
-				GPU::drawMesh(*(object.mesh()));
-			}
+		// Render static casters in the cache if the light has moved.
+		if(update.refreshStatic){
+			GPU::beginRender(layer, 0, 1.f, Load::Operation::DONTCARE, &_cache.map());
+			drawCasters(scene, casters, _vps[update.view], false);
 			GPU::endRender();
 		}
+		// Restore static casters and render dynamic casters on top.
+		GPU::copy(_cache.map(), _map, layer, layer, glm::uvec2(0), glm::uvec2(_map.width, _map.height));
+		if(update.hasDynamic){
+			GPU::beginRender(layer, 0, Load::Operation::LOAD, Load::Operation::DONTCARE, &_map);
+			drawCasters(scene, casters, _vps[update.view], true);
+			GPU::endRender();
+		}
+	}
+}
+
+void BasicShadowMapCubeArray::drawCasters(const Scene & scene, const ObjectsHierarchy::List & casters, const glm::mat4 & vp, bool animated){
+	for(const long objectId : casters) {
+		const Object & object = scene.objects[objectId];
+		if(object.animated() != animated){
+			continue;
+		}
+		const Material& mat = object.material();
+		GPU::setCullState(!mat.twoSided(), Faces::BACK);
+		const glm::mat4 mvp = vp * object.model();
+		_program->uniform("mvp", mvp);
+		_program->uniform("m", object.model());
+		_program->uniform("hasMask", mat.masked());
+		if(mat.masked()) {
+			_program->texture(mat.textures()[0], 0);
+		}
+		GPU::drawMesh(*(object.mesh()));
 	}
 }
 
@@ -1,35 +1,85 @@
 #pragma once
 
 #include "renderers/shadowmaps/ShadowMap.hpp"
+#include "renderers/shadowmaps/ShadowCache.hpp"
+#include "renderers/shadowmaps/ShadowAtlas.hpp"
 #include "scene/lights/Light.hpp"
 #include "scene/lights/PointLight.hpp"
 
 /**
- \brief A 2D shadow map array, can be used for directional and spot lights. The shadow map will register itself with the associated lights.
+ \brief A 2D shadow map atlas, can be used for directional and spot lights. The shadow map will register itself with the associated lights.
+ \details Each light receives a square tile of the atlas, sized based on the light coverage of the screen as seen from the viewpoint. Tiles are re-packed each frame, only moving lights whose size has changed. Static casters are cached, and only views that have changed are updated.
+ \see ShadowAtlas, ShadowCache
  \ingroup Renderers
  */
-class BasicShadowMap2DArray : public ShadowMap {
+class BasicShadowMapAtlas : public ShadowMap {
 public:
 	/** Constructor.
 	 \param lights the lights to generate the associated shadow maps for
-	 \param resolution the shadow map resolution
+	 \param size the atlas side length
 	 \param mode the type of shadow map technique used
 	 */
-	explicit BasicShadowMap2DArray(const std::vector<std::shared_ptr<Light>> & lights, const glm::vec2 & resolution, ShadowMode mode);
+	explicit BasicShadowMapAtlas(const std::vector<std::shared_ptr<Light>> & lights, uint size, ShadowMode mode);
 	
 	/** \copydoc ShadowMap::draw  */
 	void draw(const Scene & scene) override;
 
+	/** \copydoc ShadowMap::setBudget  */
+	void setBudget(uint budget) override { _cache.setBudget(budget); }
+
+	/** \copydoc ShadowMap::setViewpoint  */
+	void setViewpoint(const Camera & camera) override;
+
+	/** \copydoc ShadowMap::setAnimated  */
+	void setAnimated(bool animated) override { _animated = animated; }
+
+	/** \copydoc ShadowMap::cachesStatic  */
+	bool cachesStatic() const override { return true; }
+
 private:
-	
+
+	/** Estimate the tile size a light should receive, based on its screen coverage.
+	 \param light the light
+	 \return the tile side length, in texels
+	 */
+	uint requestedSize(const Light & light) const;
+
+	/** Register the current atlas tile of a light with it.
+	 \param lid the light index
+	 */
+	void registerTile(size_t lid);
+
+	/** Render shadow casters in a tile.
+	 \param scene the scene containing the casters
+	 \param casters the casters to consider
+	 \param vp the light view-projection matrix
+	 \param animated render only animated casters if true, only static casters otherwise
+	 */
+	void drawCasters(const Scene & scene, const ObjectsHierarchy::List & casters, const glm::mat4 & vp, bool animated);
+
 	std::vector<std::shared_ptr<Light>> _lights; ///< The associated light.
 	Program * _program;			///< Shadow program.
 	Texture _map;	///< Shadow map result.
+	ShadowCache _cache; ///< Static casters cache.
+	ShadowAtlas _atlas; ///< Tiles allocator.
+	ShadowMode _mode; ///< Shadow technique.
+	glm::mat4 _view = glm::mat4(1.0f); ///< Viewpoint view matrix.
+	glm::mat4 _proj = glm::mat4(1.0f); ///< Viewpoint projection matrix.
+	bool _hasViewpoint = false; ///< Has a viewpoint been set.
+	bool _animated = true; ///< Has the scene been animated since the last draw.
+	std::vector<uint> _sizes; ///< Requested tile size for each light.
+	std::vector<size_t> _changed; ///< Lights whose tile changed.
+	std::vector<Frustum> _frustums; ///< Frustums of the shadow views to render.
+	std::vector<glm::mat4> _vps; ///< View-projection matrices of the shadow views.
+	std::vector<uint> _slots; ///< Light index of each view.
+	std::vector<ObjectsHierarchy::List> _visibles; ///< Visible shadow casters for each view.
+	std::vector<ShadowCache::Update> _updates; ///< Views to update this frame.
 	
 };
 
 /**
- \brief A cube shadow map array, can be used for point lights. Each face of the map is updated sequentially. The shadow map will register itself with the associated lights.
+ \brief A cube shadow map array, can be used for point lights. Each face of the map is updated sequentially. The shadow map will register itself with the associated lights. Static casters are cached, and only faces that have changed are updated.
+ \see ShadowCache
  \ingroup Renderers
  */
 class BasicShadowMapCubeArray : public ShadowMap {
@@ -43,12 +93,36 @@ public:
 	
 	/** \copydoc ShadowMap::draw  */
 	void draw(const Scene & scene) override;
+
+	/** \copydoc ShadowMap::setBudget  */
+	void setBudget(uint budget) override { _cache.setBudget(budget); }
+
+	/** \copydoc ShadowMap::setAnimated  */
+	void setAnimated(bool animated) override { _animated = animated; }
+
+	/** \copydoc ShadowMap::cachesStatic  */
+	bool cachesStatic() const override { return true; }
 	
 private:
+
+	/** Render shadow casters in a face.
+	 \param scene the scene containing the casters
+	 \param casters the casters to consider
+	 \param vp the face view-projection matrix
+	 \param animated render only animated casters if true, only static casters otherwise
+	 */
+	void drawCasters(const Scene & scene, const ObjectsHierarchy::List & casters, const glm::mat4 & vp, bool animated);
 	
 	std::vector<std::shared_ptr<PointLight>> _lights; ///< The associated lights.
 	Program * _program;			///< Shadow program.
 	Texture _map;	///< Shadow map result.
+	ShadowCache _cache; ///< Static casters cache.
+	std::vector<Frustum> _frustums; ///< Frustums of the shadow views to render.
+	std::vector<glm::mat4> _vps; ///< View-projection matrices of the shadow views.
+	std::vector<uint> _layers; ///< Shadow map layer of each view.
+	std::vector<ObjectsHierarchy::List> _visibles; ///< Visible shadow casters for each view.
+	std::vector<ShadowCache::Update> _updates; ///< Views to update this frame.
+	bool _animated = true; ///< Has the scene been animated since the last draw.
 	
 };
 
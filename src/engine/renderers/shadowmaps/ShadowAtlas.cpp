@@ -0,0 +1,179 @@
+#include "renderers/shadowmaps/ShadowAtlas.hpp"
+
+#include <algorithm>
+
+ShadowAtlas::ShadowAtlas(uint size, uint minTileSize, uint maxTileSize) : _size(size) {
+	_maxTileLevel = 0;
+	while((_size >> _maxTileLevel) > maxTileSize && (_size >> _maxTileLevel) > 1){
+		++_maxTileLevel;
+	}
+	_minTileLevel = _maxTileLevel;
+	while((_size >> _minTileLevel) > minTileSize && (_size >> _minTileLevel) > 1){
+		++_minTileLevel;
+	}
+	_free.resize(_minTileLevel + 1);
+	reset();
+}
+
+uint ShadowAtlas::level(uint size) const {
+	uint level = _minTileLevel;
+	while(level > _maxTileLevel && (_size >> level) < size){
+		--level;
+	}
+	return level;
+}
+
+void ShadowAtlas::pack(const std::vector<uint> & sizes, std::vector<size_t> & changed){
+	const size_t count = sizes.size();
+	_tiles.resize(count);
+	_previous = _tiles;
+	_levels.resize(count);
+	_pending.clear();
+	changed.clear();
+
+	// Total requested area, to know if a complete re-packing can satisfy all requests.
+	const uint64_t atlasArea = uint64_t(_size) * uint64_t(_size);
+	uint64_t requestedArea = 0;
+	for(size_t eid = 0; eid < count; ++eid){
+		_levels[eid] = level(sizes[eid]);
+		const uint64_t side = _size >> _levels[eid];
+		requestedArea += side * side;
+	}
+	// If the atlas is too small, halve all requests until they fit.
+	bool reduced = true;
+	while(requestedArea > atlasArea && reduced){
+		reduced = false;
+		requestedArea = 0;
+		for(size_t eid = 0; eid < count; ++eid){
+			if(_levels[eid] < _minTileLevel){
+				++_levels[eid];
+				reduced = true;
+			}
+			const uint64_t side = _size >> _levels[eid];
+			requestedArea += side * side;
+		}
+	}
+
+	for(size_t eid = 0; eid < count; ++eid){
+		const uint target = _levels[eid];
+		Tile & tile = _tiles[eid];
+		if(tile.size != 0){
+			// Grow immediately, but only shrink when the tile is more than twice too large, to avoid oscillations.
+			const uint current = level(tile.size);
+			if(current == target || current + 1 == target){
+				continue;
+			}
+			release(current, tile.offset);
+			tile.size = 0;
+		}
+		_pending.push_back(eid);
+	}
+
+	// Allocate larger tiles first.
+	std::stable_sort(_pending.begin(), _pending.end(), [this](size_t a, size_t b){
+		return _levels[a] < _levels[b];
+	});
+	bool complete = true;
+	for(const size_t eid : _pending){
+		complete = place(eid, _levels[eid]) && complete;
+	}
+
+	// Power-of-two squares sorted by decreasing size always fit in a quadtree if their total area is small enough.
+	if(!complete && requestedArea <= atlasArea){
+		reset();
+		_pending.resize(count);
+		for(size_t eid = 0; eid < count; ++eid){
+			_pending[eid] = eid;
+			_tiles[eid].size = 0;
+		}
+		std::stable_sort(_pending.begin(), _pending.end(), [this](size_t a, size_t b){
+			return _levels[a] < _levels[b];
+		});
+		for(const size_t eid : _pending){
+			place(eid, _levels[eid]);
+		}
+	}
+
+	for(size_t eid = 0; eid < count; ++eid){
+		const Tile & tile = _tiles[eid];
+		const Tile & previous = _previous[eid];
+		if(tile.size != previous.size || tile.offset != previous.offset){
+			changed.push_back(eid);
+		}
+	}
+}
+
+bool ShadowAtlas::allocate(uint level, glm::uvec2 & offset){
+	std::vector<glm::uvec2> & freeTiles = _free[level];
+	if(!freeTiles.empty()){
+		offset = freeTiles.back();
+		freeTiles.pop_back();
+		return true;
+	}
+	if(level == 0){
+		return false;
+	}
+	// Split a larger tile, keeping the other three quarters free.
+	glm::uvec2 parent;
+	if(!allocate(level - 1, parent)){
+		return false;
+	}
+	const uint side = _size >> level;
+	freeTiles.emplace_back(parent.x + side, parent.y + side);
+	freeTiles.emplace_back(parent.x, parent.y + side);
+	freeTiles.emplace_back(parent.x + side, parent.y);
+	offset = parent;
+	return true;
+}
+
+void ShadowAtlas::release(uint level, const glm::uvec2 & offset){
+	std::vector<glm::uvec2> & freeTiles = _free[level];
+	if(level > 0){
+		// Merge with the three siblings if they are all free.
+		const uint parentSide = _size >> (level - 1);
+		const uint side = _size >> level;
+		const glm::uvec2 parent = (offset / parentSide) * parentSide;
+		std::array<std::vector<glm::uvec2>::iterator, 3> siblings;
+		uint found = 0;
+		for(uint sid = 0; sid < 4; ++sid){
+			const glm::uvec2 sibling = parent + side * glm::uvec2(sid % 2, sid / 2);
+			if(sibling == offset){
+				continue;
+			}
+			auto entry = std::find(freeTiles.begin(), freeTiles.end(), sibling);
+			if(entry == freeTiles.end()){
+				break;
+			}
+			siblings[found++] = entry;
+		}
+		if(found == 3){
+			// Erase from the back to keep iterators valid.
+			std::sort(siblings.begin(), siblings.end());
+			for(int sid = 2; sid >= 0; --sid){
+				freeTiles.erase(siblings[sid]);
+			}
+			release(level - 1, parent);
+			return;
+		}
+	}
+	freeTiles.push_back(offset);
+}
+
+bool ShadowAtlas::place(size_t entry, uint level){
+	Tile & tile = _tiles[entry];
+	for(uint lid = level; lid <= _minTileLevel; ++lid){
+		if(allocate(lid, tile.offset)){
+			tile.size = _size >> lid;
+			return lid == level;
+		}
+	}
+	tile.size = 0;
+	return false;
+}
+
+void ShadowAtlas::reset(){
+	for(auto & freeTiles : _free){
+		freeTiles.clear();
+	}
+	_free[0].emplace_back(0u, 0u);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Common.hpp"
+
+/**
+ \brief Allocate square tiles of power-of-two sizes in a shadow atlas texture, using a quadtree.
+ \details Tiles are re-packed incrementally: entries keep their tile as long as its size is close to the requested one, and only entries whose size changed are moved. If fragmentation prevents an allocation, the whole atlas is re-packed from scratch. If the atlas is too small for all requests, all tile sizes are reduced, and some entries might receive no tile at all.
+ \ingroup Renderers
+ */
+class ShadowAtlas {
+public:
+
+	/** \brief A square region of the atlas. */
+	struct Tile {
+		glm::uvec2 offset = glm::uvec2(0u); ///< Top-left corner, in texels.
+		uint size = 0; ///< Side length in texels, 0 if no tile is allocated.
+	};
+
+	/** Constructor.
+	 \param size the atlas side length, in texels (power of two)
+	 \param minTileSize the smallest tile side length (power of two)
+	 \param maxTileSize the largest tile side length (power of two)
+	 */
+	ShadowAtlas(uint size, uint minTileSize, uint maxTileSize);
+
+	/** Allocate tiles for a list of entries, reusing existing tiles when possible.
+	 \param sizes the requested tile side length for each entry, in texels
+	 \param changed will be filled with the indices of the entries whose tile has changed
+	 */
+	void pack(const std::vector<uint> & sizes, std::vector<size_t> & changed);
+
+	/** Query the tile allocated to an entry.
+	 \param entry the entry index
+	 \return the tile
+	 */
+	const Tile & tile(size_t entry) const { return _tiles[entry]; }
+
+	/** \return the atlas side length, in texels */
+	uint size() const { return _size; }
+
+	/** \return the largest tile side length, in texels */
+	uint maxTileSize() const { return _size >> _maxTileLevel; }
+
+private:
+
+	/** Find the quadtree level of the smallest tile containing a given size.
+	 \param size the side length in texels
+	 \return the level, clamped to the allowed tile sizes
+	 */
+	uint level(uint size) const;
+
+	/** Allocate a tile at a given level, splitting larger free tiles if needed.
+	 \param level the quadtree level
+	 \param offset will contain the top-left corner of the tile
+	 \return true if a tile was available
+	 */
+	bool allocate(uint level, glm::uvec2 & offset);
+
+	/** Release a tile, merging it with its siblings if they are all free.
+	 \param level the quadtree level
+	 \param offset the top-left corner of the tile
+	 */
+	void release(uint level, const glm::uvec2 & offset);
+
+	/** Allocate a tile for an entry, at the requested level or the largest smaller one available.
+	 \param entry the entry index
+	 \param level the requested quadtree level
+	 \return true if the requested level was allocated
+	 */
+	bool place(size_t entry, uint level);
+
+	/** Release all tiles. */
+	void reset();
+
+	std::vector<Tile> _tiles; ///< Tile of each entry.
+	std::vector<Tile> _previous; ///< Tiles before the current packing.
+	std::vector<uint> _levels; ///< Requested level of each entry.
+	std::vector<size_t> _pending; ///< Entries to allocate.
+	std::vector<std::vector<glm::uvec2>> _free; ///< Free tiles at each level.
+	uint _size; ///< Atlas side length.
+	uint _maxTileLevel; ///< Level of the largest tiles.
+	uint _minTileLevel; ///< Level of the smallest tiles.
+};
@@ -0,0 +1,109 @@
+#include "renderers/shadowmaps/ShadowCache.hpp"
+#include "scene/Scene.hpp"
+
+ShadowCache::ShadowCache(const std::string & name) : _map(name) {
+}
+
+void ShadowCache::setup(const Texture & map, size_t slotCount){
+	// Cube arrays are allocated with a number of cubes, not of layers.
+	const uint count = map.shape == TextureShape::ArrayCube ? (map.depth / 6) : map.depth;
+	_map.setupAsDrawable(map.format, map.width, map.height, map.shape, 1, count);
+	_views.assign(slotCount, View());
+}
+
+void ShadowCache::select(const Scene & scene, bool animated, const std::vector<uint> & slots, const std::vector<glm::mat4> & vps, const std::vector<ObjectsHierarchy::List> & visibles, std::vector<Update> & updates){
+	updates.clear();
+	_candidates.clear();
+	++_selection;
+
+	// Find outdated views.
+	size_t forced = 0;
+	const size_t viewCount = slots.size();
+	for(size_t vid = 0; vid < viewCount; ++vid){
+		View & view = _views[slots[vid]];
+		// The light has moved, static casters have to be rendered again.
+		if(view.vp != vps[vid]){
+			view.dirtyStatic = true;
+		}
+		// Nothing can move in a static or paused scene.
+		if(animated && scene.animated()){
+			// Visible casters that have moved.
+			for(const long objectId : visibles[vid]){
+				const Object & object = scene.objects[objectId];
+				if(!object.moved()){
+					continue;
+				}
+				if(object.animated()){
+					view.dirty = true;
+				} else {
+					view.dirtyStatic = true;
+				}
+			}
+			// Dynamic casters rendered in the view that have moved, maybe out of it.
+			for(const long objectId : view.dynamics){
+				if(scene.objects[objectId].moved()){
+					view.dirty = true;
+					break;
+				}
+			}
+		}
+		view.dirty = view.dirty || view.dirtyStatic;
+		if(view.dirty){
+			_candidates.push_back(vid);
+			forced += view.valid ? 0 : 1;
+		}
+	}
+
+	// Views that have never been rendered first, then the ones waiting for the longest time.
+	std::stable_sort(_candidates.begin(), _candidates.end(), [this, &slots](size_t a, size_t b){
+		const View & viewA = _views[slots[a]];
+		const View & viewB = _views[slots[b]];
+		if(viewA.valid != viewB.valid){
+			return !viewA.valid;
+		}
+		return viewA.lastUpdate < viewB.lastUpdate;
+	});
+	size_t count = _candidates.size();
+	if(_budget != 0){
+		count = std::min(count, std::max(size_t(_budget), forced));
+	}
+
+	for(size_t cid = 0; cid < count; ++cid){
+		const size_t vid = _candidates[cid];
+		View & view = _views[slots[vid]];
+
+		Update update;
+		update.view = vid;
+		update.refreshStatic = view.dirtyStatic || !view.valid;
+		// Keep track of the dynamic casters that will be rendered.
+		view.dynamics.clear();
+		for(const long objectId : visibles[vid]){
+			if(scene.objects[objectId].animated()){
+				view.dynamics.push_back(objectId);
+			}
+		}
+		update.hasDynamic = !view.dynamics.empty();
+		updates.push_back(update);
+
+		view.vp = vps[vid];
+		view.lastUpdate = _selection;
+		view.valid = true;
+		view.dirtyStatic = false;
+		view.dirty = false;
+	}
+}
+
+void ShadowCache::invalidate(){
+	for(View & view : _views){
+		view.valid = false;
+		view.dirtyStatic = true;
+		view.dirty = true;
+	}
+}
+
+void ShadowCache::invalidate(uint slot){
+	View & view = _views[slot];
+	view.valid = false;
+	view.dirtyStatic = true;
+	view.dirty = true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "resources/Texture.hpp"
+#include "scene/ObjectsHierarchy.hpp"
+
+#include "Common.hpp"
+
+class Scene;
+
+/**
+ \brief Keep track of the content of each view of a shadow map array, to only re-render views that have changed.
+ \details Static shadow casters (objects without animations) are rendered once in a cache texture. Each frame, views whose light has moved re-render their static layer, and views containing moving casters restore their static layer before drawing dynamic casters on top. Views that have not changed are left untouched. The number of views updated each frame can be limited by a budget, in which case the views that have been waiting the longest are updated first.
+ \note Static objects moved outside of animations are only detected in views they are still visible in, call invalidate() to force a complete update.
+ \ingroup Renderers
+ */
+class ShadowCache {
+public:
+
+	/** \brief A view update to perform. */
+	struct Update {
+		size_t view = 0; ///< Index of the view in the list passed to select.
+		bool refreshStatic = false; ///< Should the static casters be rendered again in the cache.
+		bool hasDynamic = false; ///< Are there dynamic casters to render on top of the cache.
+	};
+
+	/** Constructor.
+	 \param name the debug name of the cache texture
+	 */
+	explicit ShadowCache(const std::string & name);
+
+	/** Allocate the cache texture, matching a shadow map layout.
+	 \param map the shadow map to cache
+	 \param slotCount the number of regions (layers or atlas tiles) of the shadow map that can receive a view
+	 */
+	void setup(const Texture & map, size_t slotCount);
+
+	/** Determine which views should be updated this frame.
+	 \param scene the scene containing the shadow casters
+	 \param animated has the scene been animated since the last selection, if not moved casters are ignored (for instance when the animation is paused)
+	 \param slots for each view, the region of the shadow map it is rendered to
+	 \param vps for each view, its view-projection matrix
+	 \param visibles for each view, the visible shadow casters
+	 \param updates will be filled with the views to update
+	 */
+	void select(const Scene & scene, bool animated, const std::vector<uint> & slots, const std::vector<glm::mat4> & vps, const std::vector<ObjectsHierarchy::List> & visibles, std::vector<Update> & updates);
+
+	/** Mark all views as outdated, they will be entirely rendered at the next selection regardless of the budget. */
+	void invalidate();
+
+	/** Mark a view as outdated, it will be entirely rendered at the next selection regardless of the budget.
+	 \param slot the region of the shadow map the view is rendered to
+	 */
+	void invalidate(uint slot);
+
+	/** Set the maximum number of views to update each frame. Outdated views that have never been rendered are always updated.
+	 \param budget the number of views, 0 for no limit
+	 */
+	void setBudget(uint budget){ _budget = budget; }
+
+	/** \return the cache texture, containing the static casters depth for each slot */
+	const Texture & map() const { return _map; }
+
+private:
+
+	/** \brief State of a shadow map region. */
+	struct View {
+		glm::mat4 vp = glm::mat4(1.0f); ///< View-projection matrix used to render the static casters.
+		std::vector<long> dynamics; ///< Dynamic casters rendered in the region.
+		uint64_t lastUpdate = 0; ///< Selection during which the region was last updated.
+		bool valid = false; ///< Has the region ever been rendered.
+		bool dirtyStatic = true; ///< Should the static casters be rendered again.
+		bool dirty = true; ///< Should the region be updated.
+	};
+
+	Texture _map; ///< Static casters depth.
+	std::vector<View> _views; ///< State of each slot.
+	std::vector<size_t> _candidates; ///< Outdated views, for selection.
+	uint64_t _selection = 0; ///< Selection counter.
+	uint _budget = 0; ///< Maximum number of views updated per selection.
+};
@@ -2,10 +2,12 @@
 
 #include "processing/BoxBlur.hpp"
 #include "resources/Texture.hpp"
+#include "scene/ObjectsHierarchy.hpp"
 
 #include "Common.hpp"
 
 class Scene;
+class Camera;
 
 /**
 \brief Available shadow mapping techniques.
@@ -31,6 +33,24 @@ public:
 	 \param scene the objcts to draw in the map.
 	 */
 	virtual void draw(const Scene & scene) = 0;
+
+	/** Set the maximum number of shadow views to update each frame, for shadow maps that support caching.
+	 \param budget the number of views, 0 for no limit
+	 */
+	virtual void setBudget(uint budget){ (void)budget; }
+
+	/** Set the viewpoint the shadows will be seen from, for shadow maps that adapt their resolution to the lights screen coverage.
+	 \param camera the main camera
+	 */
+	virtual void setViewpoint(const Camera & camera){ (void)camera; }
+
+	/** Indicate if the scene has been animated since the last update, for shadow maps that support caching. If not, moved casters are ignored.
+	 \param animated has the scene been animated
+	 */
+	virtual void setAnimated(bool animated){ (void)animated; }
+
+	/** \return true if the shadow map only re-renders views that have changed, and can be drawn every frame. Other shadow maps should only be drawn when the scene is animated. */
+	virtual bool cachesStatic() const { return false; }
 	
 	/** Destructor. */
 	virtual ~ShadowMap() = default;
@@ -26,6 +26,16 @@ void VarianceShadowMap2DArray::draw(const Scene & scene) {
 	_program->use();
 	_program->defaultTexture(0);
 
+	// Cull shadow casters for all shadow views at once.
+	_frustums.clear();
+	for(const auto & light : _lights){
+		if(light->castsShadow()){
+			_frustums.emplace_back(light->vp());
+		}
+	}
+	scene.hierarchy().query(_frustums, _visibles, true);
+
+	size_t vid = 0;
 	for(uint lid = 0; lid < uint(_lights.size()); ++lid){
 		const auto & light = _lights[lid];
 		if(!light->castsShadow()){
@@ -34,16 +44,8 @@ void VarianceShadowMap2DArray::draw(const Scene & scene) {
 
 		GPU::beginRender(lid, 0, 1.0f, Load::Operation::DONTCARE, &_mapDepth, glm::vec4(1.0f), &_map);
 
-		const Frustum lightFrustum(light->vp());
-
-		for(auto & object : scene.objects) {
-			if(!object.castsShadow()) {
-				continue;
-			}
-			// Frustum culling.
-			if(!lightFrustum.intersects(object.boundingBox())){
-				continue;
-			}
+		for(const long objectId : _visibles[vid]) {
+			const Object & object = scene.objects[objectId];
 			const Material& mat = object.material();
 			GPU::setCullState(!mat.twoSided(), Faces::BACK);
 
@@ -56,6 +58,7 @@ void VarianceShadowMap2DArray::draw(const Scene & scene) {
 			GPU::drawMesh(*(object.mesh()));
 		}
 		GPU::endRender();
+		++vid;
 	}
 	
 	// Apply box blur.
@@ -85,6 +88,19 @@ void VarianceShadowMapCubeArray::draw(const Scene & scene) {
 	_program->use();
 	_program->defaultTexture(0);
 
+	// Cull shadow casters for all shadow views at once.
+	_frustums.clear();
+	for(const auto & light : _lights){
+		if(!light->castsShadow()){
+			continue;
+		}
+		for(const glm::mat4 & face : light->vpFaces()){
+			_frustums.emplace_back(face);
+		}
+	}
+	scene.hierarchy().query(_frustums, _visibles, true);
+
+	size_t vid = 0;
 	for(uint lid = 0; lid < uint(_lights.size()); ++lid){
 		const auto & light = _lights[lid];
 		if(!light->castsShadow()){
@@ -99,16 +115,8 @@ void VarianceShadowMapCubeArray::draw(const Scene & scene) {
 		for(uint i = 0; i < 6; ++i){
 			// We render each face sequentially, culling objects that are not visible.
 			GPU::beginRender(lid * 6 + i, 0, 1.0f, Load::Operation::DONTCARE, &_mapDepth, glm::vec4(1.0f), &_map);
-			const Frustum lightFrustum(faces[i]);
-
-			for(auto & object : scene.objects) {
-				if(!object.castsShadow()) {
-					continue;
-				}
-				// Frustum culling.
-				if(!lightFrustum.intersects(object.boundingBox())){
-					continue;
-				}
+			for(const long objectId : _visibles[vid]) {
+				const Object & object = scene.objects[objectId];
 				const Material& mat = object.material();
 				GPU::setCullState(!mat.twoSided(), Faces::BACK);
 				const glm::mat4 mvp = faces[i] * object.model();
@@ -121,6 +129,7 @@ void VarianceShadowMapCubeArray::draw(const Scene & scene) {
 				GPU::drawMesh(*(object.mesh()));
 			}
 			GPU::endRender();
+			++vid;
 		}
 	}
 	// Apply box blur.
@@ -24,6 +24,8 @@ private:
 	std::vector<std::shared_ptr<Light>> _lights; ///< The associated light.
 	Program * _program;			///< Shadow program.
 	Texture _map;				///< Raw shadow map result.
+	std::vector<Frustum> _frustums; ///< Frustums of the shadow views to render.
+	std::vector<ObjectsHierarchy::List> _visibles; ///< Visible shadow casters for each view.
 	Texture _mapDepth;			///< Shadow map depth buffer.
 	std::unique_ptr<BoxBlur> _blur;		///< Blur filter.
 	
@@ -49,6 +51,8 @@ private:
 	std::vector<std::shared_ptr<PointLight>> _lights; ///< The associated lights.
 	Program * _program;			///< Shadow program.
 	Texture _map;				///< Raw shadow map result.
+	std::vector<Frustum> _frustums; ///< Frustums of the shadow views to render.
+	std::vector<ObjectsHierarchy::List> _visibles; ///< Visible shadow casters for each view.
 	Texture _mapDepth;			///< Shadow map depth buffer.
 	std::unique_ptr<BoxBlur> _blur;		///< Blur filter.
 	
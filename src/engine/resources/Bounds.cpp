@@ -80,11 +80,31 @@ bool BoundingBox::contains(const glm::vec3 & point) const {
 	return glm::all(glm::greaterThanEqual(point, minis)) && glm::all(glm::lessThanEqual(point, maxis));
 }
 
+bool BoundingBox::intersects(const BoundingBox & box) const {
+	return glm::all(glm::lessThanEqual(box.minis, maxis)) && glm::all(glm::lessThanEqual(minis, box.maxis));
+}
+
 bool BoundingBox::empty() const {
 	// Use the first component of minis as a canary.
 	return minis[0] == std::numeric_limits<float>::max();
 }
 
+void BoundingBoxes::resize(size_t count) {
+	for(uint i = 0; i < 3; ++i){
+		centers[i].resize(count);
+		extents[i].resize(count);
+	}
+}
+
+void BoundingBoxes::set(size_t id, const BoundingBox & box) {
+	const glm::vec3 center = box.getCentroid();
+	const glm::vec3 extent = 0.5f * box.getSize();
+	for(uint i = 0; i < 3; ++i){
+		centers[i][id] = center[i];
+		extents[i][id] = extent[i];
+	}
+}
+
 Frustum::Frustum(const glm::mat4 & vp){
 	// We have to access rows easily, so transpose.
 	const glm::mat4 tvp = glm::transpose(vp);
@@ -97,6 +117,10 @@ Frustum::Frustum(const glm::mat4 & vp){
 	_planes[BOTTOM] = tvp[3] + tvp[1];
 	_planes[NEAR]   = tvp[2];
 	_planes[FAR]    = tvp[3] - tvp[2];
+	// Normalize the planes so that distances to them can be evaluated directly.
+	for(uint pid = 0; pid < FrustumPlane::COUNT; ++pid){
+		_planes[pid] /= glm::length(glm::vec3(_planes[pid]));
+	}
 
 	// Reproject the 8 corners of the frustum from NDC to world space.
 	static const std::array<glm::vec4, 8> ndcCorner = {
@@ -134,6 +158,64 @@ bool Frustum::intersects(const BoundingBox & box) const {
 	return true;
 }
 
+bool Frustum::intersects(const BoundingSphere & sphere) const {
+	const glm::vec4 center(sphere.center, 1.0f);
+	// The sphere is outside if it is fully in the "outside" half-space of any plane.
+	for(uint pid = 0; pid < FrustumPlane::COUNT; ++pid){
+		if(glm::dot(_planes[pid], center) < -sphere.radius){
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t Frustum::intersects(const BoundingBoxes & boxes, size_t first, size_t count, uchar * results) const {
+	const float * cx = boxes.centers[0].data() + first;
+	const float * cy = boxes.centers[1].data() + first;
+	const float * cz = boxes.centers[2].data() + first;
+	const float * ex = boxes.extents[0].data() + first;
+	const float * ey = boxes.extents[1].data() + first;
+	const float * ez = boxes.extents[2].data() + first;
+
+	// Process boxes in small batches that stay in cache while testing the six planes.
+	const size_t batchSize = 64;
+	size_t visibleCount = 0;
+	for(size_t bid = 0; bid < count; bid += batchSize){
+		const size_t bEnd = std::min(count, bid + batchSize);
+		for(size_t i = bid; i < bEnd; ++i){
+			results[i] = 1;
+		}
+		for(uint pid = 0; pid < FrustumPlane::COUNT; ++pid){
+			const glm::vec4 & plane = _planes[pid];
+			const glm::vec3 absNormal = glm::abs(glm::vec3(plane));
+			// A box is fully outside a plane if its center is further away than its projected half size.
+			for(size_t i = bid; i < bEnd; ++i){
+				const float dist = plane[0] * cx[i] + plane[1] * cy[i] + plane[2] * cz[i] + plane[3];
+				const float radius = absNormal[0] * ex[i] + absNormal[1] * ey[i] + absNormal[2] * ez[i];
+				results[i] &= uchar(dist >= -radius);
+			}
+		}
+		for(size_t i = bid; i < bEnd; ++i){
+			visibleCount += results[i];
+		}
+	}
+	return visibleCount;
+}
+
+bool Frustum::contains(const BoundingBox & box) const {
+	const glm::vec3 center = box.getCentroid();
+	const glm::vec3 extent = 0.5f * box.getSize();
+	// The box is inside if its closest corner to each plane is in the "inside" half-space.
+	for(uint pid = 0; pid < FrustumPlane::COUNT; ++pid){
+		const glm::vec3 normal(_planes[pid]);
+		const float radius = glm::dot(glm::abs(normal), extent);
+		if(glm::dot(normal, center) + _planes[pid][3] < radius){
+			return false;
+		}
+	}
+	return true;
+}
+
 glm::mat4 Frustum::perspective(float fov, float ratio, float near, float far){
 	glm::mat4 projection = glm::perspective(fov, ratio, near, far);
 	projection[0][1] *= -1.0f;
@@ -92,6 +92,12 @@ public:
 	 */
 	bool contains(const glm::vec3 & point) const;
 
+	/** Indicates if another box overlaps the bounding box.
+	 \param box the box to check
+	 \return true if the two boxes intersect
+	 */
+	bool intersects(const BoundingBox & box) const;
+
 	/** \return true if no point has been added to the bounding box */
 	bool empty() const;
 
@@ -99,6 +105,30 @@ public:
 	glm::vec3 maxis = glm::vec3(std::numeric_limits<float>::lowest()); ///< Higher-top-right corner of the box.
 };
 
+/**
+ \brief Store a list of axis-aligned boxes as separate arrays of center and half-size coordinates, to test many boxes at once.
+ \ingroup Resources
+ */
+class BoundingBoxes {
+public:
+
+	/** Resize the list.
+	 \param count the new number of boxes
+	 */
+	void resize(size_t count);
+
+	/** Set the box at a given position.
+	 \param id the box index
+	 \param box the box to store
+	 */
+	void set(size_t id, const BoundingBox & box);
+
+	/** \return the number of boxes */
+	size_t size() const { return centers[0].size(); }
+
+	std::array<std::vector<float>, 3> centers; ///< Box centers, one array per coordinate.
+	std::array<std::vector<float>, 3> extents; ///< Box half sizes, one array per coordinate.
+};
 
 /** \brief Represent a 3D frustum, volume defined by the intersection of six planes.
   \ingroup Resources
@@ -117,6 +147,28 @@ public:
 	*/
 	bool intersects(const BoundingBox & box) const;
 
+	/** Indicate if a bounding sphere intersect this frustum.
+	\param sphere the bounding sphere to test
+	\return true if the bounding sphere intersects the frustum.
+	*/
+	bool intersects(const BoundingSphere & sphere) const;
+
+	/** Indicate which boxes of a list intersect this frustum. The test is equivalent to the single box one, but is performed on batches of boxes without branching, so that it can be vectorized.
+	\param boxes the list of boxes
+	\param first index of the first box to test
+	\param count number of boxes to test
+	\param results will be set to 1 for each box intersecting the frustum, 0 otherwise (should contain at least count elements)
+	\return the number of boxes intersecting the frustum
+	*/
+	size_t intersects(const BoundingBoxes & boxes, size_t first, size_t count, uchar * results) const;
+
+	/** Indicate if a bounding box is fully inside this frustum.
+	\param box the bounding box to test
+	\return true if the bounding box is contained in the frustum.
+	\note This is conservative: a box contained in the frustum but straddling one of its planes will be rejected.
+	*/
+	bool contains(const BoundingBox & box) const;
+
 	/** Generate a perspective projection matrix, correctly oriented for the rendering API.
 	 \param fov vertical field of view in radians
 	 \param ratio aspect ratio
@@ -144,6 +196,6 @@ private:
 		LEFT = 0, RIGHT = 1, TOP = 2, BOTTOM = 3, NEAR = 4, FAR = 5, COUNT = 6
 	};
 
-	std::array<glm::vec4, FrustumPlane::COUNT> _planes; ///< Frustum hyperplane coefficients.
+	std::array<glm::vec4, FrustumPlane::COUNT> _planes; ///< Frustum hyperplane coefficients, normalized.
 	std::array<glm::vec3, 8> _corners; ///< Frustum corners.
 };
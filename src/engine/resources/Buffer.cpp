@@ -51,10 +51,12 @@ void Buffer::download(size_t sizeInBytes, unsigned char * data, size_t offset){
 
 UniformBufferBase::UniformBufferBase(size_t sizeInBytes, UniformFrequency use, const std::string& name) : Buffer(BufferType::UNIFORM, name), _baseSize(sizeInBytes)
 {
+	GPUContext* context = GPU::getInternal();
 	// Number of instances of the buffer stored internally, based on usage.
 	int multipler = 1;
 	if(use == UniformFrequency::FRAME){
-		multipler = 2;
+		// One copy per frame in flight.
+		multipler = int(context->frameCount);
 	} else if(use == UniformFrequency::VIEW){
 		multipler = 16;
 		_wrapAround = false;
@@ -64,7 +66,6 @@ UniformBufferBase::UniformBufferBase(size_t sizeInBytes, UniformFrequency use, c
 	}
 
 	// Compute expected alignment.
-	GPUContext* context = GPU::getInternal();
 	_alignment = (sizeInBytes + context->uniformAlignment - 1) & ~(context->uniformAlignment - 1);
 
 	// Total size.
@@ -84,6 +85,18 @@ UniformBufferBase::UniformBufferBase(size_t sizeInBytes, UniformFrequency use, c
 
 bool UniformBufferBase::upload(unsigned char * data){
 
+	const bool newBuffer = advance();
+
+	// Copy data.
+	std::memcpy(gpu->mapped + _offset, data, _baseSize);
+
+	GPU::flushBuffer(*this, _offset, _baseSize);
+	return newBuffer;
+
+}
+
+bool UniformBufferBase::advance(){
+
 	bool newBuffer = false;
 	// Move to the next copy in the buffer, wrapping around.
 	_offset += _alignment;
@@ -98,13 +111,7 @@ bool UniformBufferBase::upload(unsigned char * data){
 		}
 		_offset = 0;
 	}
-
-	// Copy data.
-	std::memcpy(gpu->mapped + _offset, data, _baseSize);
-
-	GPU::flushBuffer(*this, _offset, _baseSize);
 	return newBuffer;
-
 }
 
 void UniformBufferBase::clean(){
@@ -119,6 +119,12 @@ public:
 	 */
 	bool upload(unsigned char * data);
 
+	/** Move to the next instance of the data without uploading anything, for instance when the GPU will write it.
+	 Buffering will be handled based on the update frequency.
+	 \return true if a new GPU buffer was allocated internally
+	 */
+	bool advance();
+
 	/** Clean the buffer. */
 	void clean();
 
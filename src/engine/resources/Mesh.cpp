@@ -288,6 +288,7 @@ void Mesh::clearGeometry() {
 
 void Mesh::clean() {
 	clearGeometry();
+	meshlets.clear();
 	bbox = BoundingBox();
 	if(gpu) {
 		gpu->clean();
@@ -507,6 +508,88 @@ void Mesh::computeTangentsAndBitangents(bool force) {
 	updateMetrics();
 }
 
+void Mesh::computeMeshlets(uint maxVertices, uint maxTriangles) {
+	meshlets.clear();
+	if(positions.empty() || indices.empty()) {
+		_metrics.meshlets = meshlets.size();
+		return;
+	}
+	// Keep track of the last meshlet each vertex was added to, to count unique vertices.
+	std::vector<long> lastMeshlet(positions.size(), -1);
+	std::vector<glm::vec3> faceNormals;
+	faceNormals.reserve(maxTriangles);
+
+	uint vertexCount = 0;
+	BoundingBox box;
+	meshlets.emplace_back();
+
+	// Helper to finalize the bounds and cone of the current meshlet.
+	auto finishMeshlet = [this, &faceNormals, &box](){
+		Meshlet & meshlet = meshlets.back();
+		meshlet.bounds = box.getSphere();
+		// Average normal direction.
+		glm::vec3 axis(0.0f);
+		for(const glm::vec3 & n : faceNormals) {
+			axis += n;
+		}
+		const float axisLength = glm::length(axis);
+		if(axisLength < 1e-6f) {
+			// Normals cancel each other, no backface rejection possible.
+			return;
+		}
+		meshlet.coneAxis = axis / axisLength;
+		// Find the widest deviation from the average.
+		float minDot = 1.0f;
+		for(const glm::vec3 & n : faceNormals) {
+			minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+		}
+		// Wide cones are almost never rejected, skip them.
+		if(minDot <= 0.1f) {
+			return;
+		}
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	};
+
+	const size_t indexCount = indices.size();
+	for(size_t tid = 0; tid + 2 < indexCount; tid += 3) {
+		const unsigned int i0 = indices[tid + 0];
+		const unsigned int i1 = indices[tid + 1];
+		const unsigned int i2 = indices[tid + 2];
+		long mid = long(meshlets.size()) - 1;
+		// Count the vertices that the triangle would add to the current meshlet.
+		const uint newVertices = (lastMeshlet[i0] != mid ? 1u : 0u) + (lastMeshlet[i1] != mid ? 1u : 0u) + (lastMeshlet[i2] != mid ? 1u : 0u);
+		const uint triangleCount = meshlets.back().indexCount / 3;
+		if(triangleCount != 0 && (vertexCount + newVertices > maxVertices || triangleCount + 1 > maxTriangles)) {
+			// Start a new meshlet.
+			finishMeshlet();
+			meshlets.emplace_back();
+			meshlets.back().firstIndex = uint(tid);
+			faceNormals.clear();
+			box = BoundingBox();
+			vertexCount = 0;
+			++mid;
+		}
+		// Register the triangle.
+		for(const unsigned int vid : {i0, i1, i2}) {
+			if(lastMeshlet[vid] != mid) {
+				lastMeshlet[vid] = mid;
+				box.merge(positions[vid]);
+				++vertexCount;
+			}
+		}
+		meshlets.back().indexCount += 3;
+		// Degenerate triangles don't contribute to the cone.
+		const glm::vec3 normal = glm::cross(positions[i1] - positions[i0], positions[i2] - positions[i0]);
+		const float area = glm::length(normal);
+		if(area > 0.0f) {
+			faceNormals.push_back(normal / area);
+		}
+	}
+	finishMeshlet();
+
+	_metrics.meshlets = meshlets.size();
+}
+
 int Mesh::saveAsObj(const std::string & path, bool defaultUVs) {
 
 	std::ofstream objFile(path);
@@ -579,6 +662,7 @@ void Mesh::updateMetrics(){
 	_metrics.colors = colors.size();
 	_metrics.texcoords = texcoords.size();
 	_metrics.indices = indices.size();
+	_metrics.meshlets = meshlets.size();
 }
 
 Mesh & Mesh::operator=(Mesh &&) = default;
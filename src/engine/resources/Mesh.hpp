@@ -31,6 +31,19 @@ public:
 		size_t colors = 0; ///< Color count.
 		size_t texcoords = 0; ///< UV count.
 		size_t indices = 0; ///< Index count.
+		size_t meshlets = 0; ///< Meshlet count.
+	};
+
+	/** \brief A cluster of triangles stored contiguously in the index buffer, with bounds for fine-grained culling.
+	 \details The normal cone can be used to reject clusters that are entirely back-facing: the cluster is not visible from a camera at position \p c if
+	 \p dot(center-c,coneAxis) >= coneCutoff*length(center-c)+radius
+	 */
+	struct Meshlet {
+		BoundingSphere bounds; ///< Bounding sphere of the cluster vertices, in model space.
+		glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f); ///< Average normal of the cluster triangles, in model space.
+		float coneCutoff = 1.0f; ///< Sine of the normal cone half-angle (1 if the cluster can't be rejected).
+		uint firstIndex = 0; ///< Index of the first cluster element in the index buffer.
+		uint indexCount = 0; ///< Number of cluster elements in the index buffer.
 	};
 
 	/** Default constructor.
@@ -69,6 +82,13 @@ public:
 	 */
 	void computeTangentsAndBitangents(bool force);
 
+	/** Split the mesh triangles into meshlets, following the index buffer order, and compute their bounds and normal cones.
+	 \param maxVertices the maximum number of unique vertices in a meshlet
+	 \param maxTriangles the maximum number of triangles in a meshlet
+	 \note Meshlets are preserved when clearing the CPU geometry.
+	 */
+	void computeMeshlets(uint maxVertices = 64, uint maxTriangles = 124);
+
 	/** Save an OBJ mesh on disk.
 	 \param path the path to the mesh
 	 \param defaultUVs if the mesh has no UVs, should default ones be used.
@@ -130,7 +150,8 @@ public:
 	std::vector<glm::vec3> colors;	 ///< The vertex colors.
 	std::vector<glm::vec2> texcoords;  ///< The texture coordinates.
 	std::vector<unsigned int> indices; ///< The triangular faces indices.
-	
+	std::vector<Meshlet> meshlets; ///< The triangle clusters (optional).
+
 	BoundingBox bbox;			  ///< The mesh bounding box in model space.
 	std::unique_ptr<GPUMesh> gpu; ///< The GPU buffers infos (optional).
 
@@ -1,6 +1,9 @@
 #include "resources/ResourcesManager.hpp"
 #include "resources/Mesh.hpp"
+#include "resources/TextureCodec.hpp"
 #include "graphics/GPUObjects.hpp"
+#include "graphics/GPU.hpp"
+#include "graphics/ShaderCompiler.hpp"
 #include "system/TextUtilities.hpp"
 #include "system/System.hpp"
 
@@ -305,7 +308,22 @@ std::string Resources::getStringWithIncludes(const std::string& filename) {
 
 const Mesh * Resources::getMesh(const std::string & name, Storage options) {
 	if(_meshes.count(name) > 0) {
-		return &_meshes.at(name);
+		Mesh & mesh = _meshes.at(name);
+		// Build clusters if requested and the mesh was first loaded without them.
+		if((options & Storage::CLUSTERS) && mesh.meshlets.empty() && mesh.metrics().indices > 0) {
+			if(!mesh.indices.empty()) {
+				mesh.computeMeshlets();
+			} else {
+				// The CPU geometry has been cleared, reload the positions and indices temporarily.
+				std::stringstream meshStream(getString(name + ".obj"));
+				Mesh geometry(meshStream, Mesh::Load::Indexed, name);
+				mesh.positions = std::move(geometry.positions);
+				mesh.indices = std::move(geometry.indices);
+				mesh.computeMeshlets();
+				mesh.clearGeometry();
+			}
+		}
+		return &mesh;
 	}
 
 	const std::string meshText = getString(name + ".obj");
@@ -326,6 +344,10 @@ const Mesh * Resources::getMesh(const std::string & name, Storage options) {
 	mesh.computeTangentsAndBitangents(forceFrame);
 	// Compute bounding box.
 	mesh.computeBoundingBox();
+	// Build clusters if requested.
+	if(options & Storage::CLUSTERS) {
+		mesh.computeMeshlets();
+	}
 
 	if(options & Storage::GPU) {
 		// Setup GL buffers and attributes.
@@ -480,12 +502,32 @@ const Texture * Resources::getTexture(const std::string & name, const Layout & f
 		return nullptr;
 	}
 
+	// Fallback to an uncompressed layout if block compression is not available.
+	Layout layout = format;
+	if(TextureCodec::isCompressed(format) && (options & Storage::GPU) && !GPU::supportsBlockCompression()) {
+		Log::Warning() << Log::Resources << "Block compression is not supported, texture \"" << name << "\" will be uncompressed." << std::endl;
+		layout = TextureCodec::uncompressedLayout(format);
+	}
+
 	// Format and orientation.
-	const uint channels = GPUTexture::getChannelsCount(format);
+	const uint channels = GPUTexture::getChannelsCount(layout);
 	// We know the texture is not in the list, we insert.
 	_textures.insert(std::make_pair<>(keyName, Texture(keyName)));
 	Texture & texture  = _textures.at(keyName);
 
+	// Compressed GPU-only textures and their mipmaps are cached on disk, to skip decoding and encoding.
+	const bool useCache = !isColorString && TextureCodec::isCompressed(layout) && (options == Storage::GPU) && !_cachePath.empty();
+	std::string cachePath;
+	if(useCache) {
+		cachePath = getTextureCachePath(name, layout, paths);
+		if(TextureCodec::load(cachePath, texture) && texture.format == layout) {
+			texture.upload(layout, false);
+			texture.clearImages();
+			return &_textures.at(keyName);
+		}
+		texture.packed.clear();
+	}
+
 	if(isColorString){
 		// For now we assume only one level and a 2D image.
 		const auto toks = TextUtilities::split(name, ",", true);
@@ -530,7 +572,10 @@ const Texture * Resources::getTexture(const std::string & name, const Layout & f
 	// If GPU mode, send them to the GPU.
 	if(options & Storage::GPU) {
 		// If only one level was given, generate the mipmaps.
-		texture.upload(format, texture.levels == 1);
+		texture.upload(layout, texture.levels == 1);
+		if(useCache && !texture.packed.empty()) {
+			TextureCodec::save(cachePath, texture);
+		}
 	}
 	// If GPU only, clear the CPU data.
 	if(!(options & Storage::CPU)) {
@@ -539,6 +584,41 @@ const Texture * Resources::getTexture(const std::string & name, const Layout & f
 	return &_textures.at(keyName);
 }
 
+void Resources::setCachePath(const std::string & path) {
+	_cachePath = path;
+}
+
+std::string Resources::getCachePath(const std::string & category) {
+	if(_cachePath.empty()) {
+		return "";
+	}
+	// Directories might already exist.
+	System::createDirectory(_cachePath);
+	const std::string path = _cachePath + "/" + category + "/";
+	System::createDirectory(path);
+	return path;
+}
+
+std::string Resources::getTextureCachePath(const std::string & name, const Layout & format, const std::vector<std::vector<std::string>> & paths) {
+	// The cache entry depends on the images content, the layout and the encoder version.
+	std::vector<uint64_t> hashes = { uint64_t(format), uint64_t(TextureCodec::version) };
+	for(const auto & levelPaths : paths) {
+		for(const auto & filePath : levelPaths) {
+			size_t rawSize = 0;
+			char * rawContent = getRawData(filePath, rawSize);
+			hashes.push_back(rawContent ? System::hash64(rawContent, rawSize) : 0);
+			delete[] rawContent;
+		}
+	}
+	const uint64_t hash = System::hash64(hashes.data(), hashes.size() * sizeof(uint64_t));
+
+	std::string baseName = name;
+	TextUtilities::replace(baseName, "/\\:. ", '_');
+	std::stringstream path;
+	path << getCachePath("textures") << baseName << "_" << std::hex << hash << ".rtex";
+	return path.str();
+}
+
 const Texture * Resources::getDefaultTexture(TextureShape shape){
 
 	static const std::unordered_map<TextureShape, std::string> names = {
@@ -642,19 +722,33 @@ Program * Resources::getProgramCompute(const std::string & name) {
 }
 
 void Resources::reload() {
+	// Gather the shaders of all programs.
+	std::vector<ShaderCompiler::Job> jobs;
 	for(auto & prog : _programs) {
 		const ProgramInfos & infos = _progInfos.at(prog.first);
 		if(prog.second.type() == Program::Type::COMPUTE){
 			// Compute program.
-			const std::string cContent = getStringWithIncludes(infos.computeName + ".comp");
-			prog.second.reload(cContent);
+			jobs.emplace_back(getStringWithIncludes(infos.computeName + ".comp"), ShaderType::COMPUTE);
 		} else {
 			// Graphics program.
-			const std::string vContent = getStringWithIncludes(infos.vertexName + ".vert");
-			const std::string fContent = getStringWithIncludes(infos.fragmentName + ".frag");
-			const std::string tcContent = infos.tessContName.empty() ? "" : getStringWithIncludes(infos.tessContName + ".tessc");
-			const std::string teContent = infos.tessEvalName.empty() ? "" : getStringWithIncludes(infos.tessEvalName + ".tesse");
-			prog.second.reload(vContent, fContent, tcContent, teContent);
+			jobs.emplace_back(getStringWithIncludes(infos.vertexName + ".vert"), ShaderType::VERTEX);
+			jobs.emplace_back(getStringWithIncludes(infos.fragmentName + ".frag"), ShaderType::FRAGMENT);
+			jobs.emplace_back(infos.tessContName.empty() ? "" : getStringWithIncludes(infos.tessContName + ".tessc"), ShaderType::TESSCONTROL);
+			jobs.emplace_back(infos.tessEvalName.empty() ? "" : getStringWithIncludes(infos.tessEvalName + ".tesse"), ShaderType::TESSEVAL);
+		}
+	}
+	// Compile all of them concurrently to populate the shader cache.
+	ShaderCompiler::compile(jobs, false);
+
+	// Programs can then be recreated from the cache.
+	size_t jobId = 0;
+	for(auto & prog : _programs) {
+		if(prog.second.type() == Program::Type::COMPUTE){
+			prog.second.reload(jobs[jobId].source);
+			jobId += 1;
+		} else {
+			prog.second.reload(jobs[jobId].source, jobs[jobId + 1].source, jobs[jobId + 2].source, jobs[jobId + 3].source);
+			jobId += 4;
 		}
 	}
 	Log::Info() << Log::Resources << "Shader programs reloaded." << std::endl;
@@ -16,7 +16,8 @@ enum class Storage : uint {
 	GPU  = 1,		   ///< Store on the GPU
 	CPU  = 2,		   ///< Store on the CPU
 	BOTH = (GPU | CPU), ///< Store on both the CPU and GPU
-	FORCE_FRAME = 4 ///< For meshes, force computation of a local frame
+	FORCE_FRAME = 4, ///< For meshes, force computation of a local frame
+	CLUSTERS = 8 ///< For meshes, split the triangles in meshlets for finer culling
 };
 
 /** Combining operator for Storage.
@@ -61,6 +62,17 @@ public:
 	 */
 	void addResources(const std::string & path);
 
+	/** Set the directory where processed resources (compiled shaders, compressed textures) are cached.
+	 \param path the cache directory, or an empty string to disable caching
+	 */
+	void setCachePath(const std::string & path);
+
+	/** Get the cache directory for a category of resources, creating it if needed.
+	 \param category the name of the category subdirectory
+	 \return the path to the directory (ending with a separator), or an empty string if caching is disabled
+	 */
+	std::string getCachePath(const std::string & category);
+
 	/** Reload all shader programs.
 	 */
 	void reload();
@@ -125,6 +137,14 @@ private:
 	 */
 	char * getRawData(const std::string & path, size_t & size);
 
+	/** Generate the path of the cached compressed version of a texture, based on its layout and source images content.
+	 \param name the texture name
+	 \param format the compressed layout
+	 \param paths the source images paths, for each level
+	 \return the path to the cache file
+	 */
+	std::string getTextureCachePath(const std::string & name, const Layout & format, const std::vector<std::vector<std::string>> & paths);
+
 public:
 	/** Get a text file resource.
 	 \param filename the file name
@@ -299,4 +319,5 @@ private:
 	std::unordered_map<std::string, Data> _blobs;  	   ///< Loaded binary blobs, identified by name.
 	std::unordered_map<std::string, Program> _programs;  ///< Loaded shader programs, identified by name.
 	std::unordered_map<std::string, ProgramInfos> _progInfos;  ///< Additional info to support shader reloading.
+	std::string _cachePath; ///< Root directory for cached processed resources.
 };
@@ -1,4 +1,5 @@
 #include "resources/Texture.hpp"
+#include "resources/TextureCodec.hpp"
 #include "graphics/GPUObjects.hpp"
 #include "graphics/GPU.hpp"
 #include "graphics/GPUInternal.hpp"
@@ -18,12 +19,18 @@ void Texture::upload(const Layout & layout, bool updateMipmaps) {
 	format = layout;
 	drawable = false;
 
+	// Block-compressed layouts can't be rendered to, encode them and their mipmaps on the CPU.
+	const bool compressed = TextureCodec::isCompressed(layout);
+	if(compressed && packed.empty()) {
+		TextureCodec::compress(*this, layout, updateMipmaps);
+	}
+
 	// Create texture.
 	GPU::setupTexture(*this);
 	GPU::uploadTexture(*this);
 
 	// Generate mipmaps pyramid automatically.
-	if(updateMipmaps) {
+	if(updateMipmaps && !compressed) {
 		GPU::generateMipMaps(*this);
 	}
 
@@ -45,6 +52,7 @@ uint Texture::getMaxMipLevel() const {
 
 void Texture::clearImages() {
 	images.clear();
+	packed.clear();
 }
 
 void Texture::allocateImages(uint channels, uint firstMip, uint mipCount){
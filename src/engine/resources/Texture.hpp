@@ -23,7 +23,7 @@ public:
 	 */
 	void upload(const Layout & layout, bool updateMipmaps);
 
-	/** Clear CPU images data. */
+	/** Clear CPU images and packed data. */
 	void clearImages();
 
 	/** Allocate the CPU images in the mip range defined as input. Images outside the given range will be left untouched if present, or created empty if not.
@@ -94,6 +94,7 @@ public:
 	~Texture();
 	
 	std::vector<Image> images;		 ///< The images CPU data (optional).
+	std::vector<uchar> packed;		 ///< The images data packed in the texture layout, for all levels (optional, used for compressed layouts).
 	std::unique_ptr<GPUTexture> gpu; ///< The GPU data (optional).
 	
 	uint width  = 0; ///< The texture width.
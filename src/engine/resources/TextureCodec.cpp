@@ -0,0 +1,655 @@
+#include "resources/TextureCodec.hpp"
+#include "resources/ResourcesManager.hpp"
+#include "system/System.hpp"
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/color_space.hpp>
+#include <unordered_map>
+#include <cstring>
+
+bool TextureCodec::isCompressed(const Layout & format){
+	return format == Layout::BC1 || format == Layout::BC1_SRGB || format == Layout::BC3 || format == Layout::BC3_SRGB
+		|| format == Layout::BC4 || format == Layout::BC5 || format == Layout::BC6H || format == Layout::BC7 || format == Layout::BC7_SRGB;
+}
+
+bool TextureCodec::isPackable(const Layout & format){
+	PackInfos infos;
+	return getPackInfos(format, infos);
+}
+
+bool TextureCodec::isSRGB(const Layout & format){
+	return format == Layout::SRGB8_ALPHA8 || format == Layout::SBGR8_ALPHA8 || format == Layout::BC1_SRGB || format == Layout::BC3_SRGB || format == Layout::BC7_SRGB;
+}
+
+Layout TextureCodec::uncompressedLayout(const Layout & format){
+	switch(format){
+		case Layout::BC1:
+		case Layout::BC3:
+		case Layout::BC7:
+			return Layout::RGBA8;
+		case Layout::BC1_SRGB:
+		case Layout::BC3_SRGB:
+		case Layout::BC7_SRGB:
+			return Layout::SRGB8_ALPHA8;
+		case Layout::BC4:
+			return Layout::R8;
+		case Layout::BC5:
+			return Layout::RG8;
+		case Layout::BC6H:
+			return Layout::RGBA16F;
+		default:
+			return format;
+	}
+}
+
+bool TextureCodec::getPackInfos(const Layout & format, PackInfos & infos){
+	static const std::unordered_map<Layout, PackInfos> packInfos = {
+		{Layout::R8, {1, 1, Encoding::UNORM, false}},
+		{Layout::RG8, {2, 1, Encoding::UNORM, false}},
+		{Layout::RGBA8, {4, 1, Encoding::UNORM, false}},
+		{Layout::SRGB8_ALPHA8, {4, 1, Encoding::UNORM, false}},
+		{Layout::BGRA8, {4, 1, Encoding::UNORM, true}},
+		{Layout::SBGR8_ALPHA8, {4, 1, Encoding::UNORM, true}},
+		{Layout::R16, {1, 2, Encoding::UNORM, false}},
+		{Layout::RG16, {2, 2, Encoding::UNORM, false}},
+		{Layout::RGBA16, {4, 2, Encoding::UNORM, false}},
+		{Layout::R8_SNORM, {1, 1, Encoding::SNORM, false}},
+		{Layout::RG8_SNORM, {2, 1, Encoding::SNORM, false}},
+		{Layout::RGBA8_SNORM, {4, 1, Encoding::SNORM, false}},
+		{Layout::R16_SNORM, {1, 2, Encoding::SNORM, false}},
+		{Layout::RG16_SNORM, {2, 2, Encoding::SNORM, false}},
+		{Layout::R16F, {1, 2, Encoding::HALF, false}},
+		{Layout::RG16F, {2, 2, Encoding::HALF, false}},
+		{Layout::RGBA16F, {4, 2, Encoding::HALF, false}},
+		{Layout::R32F, {1, 4, Encoding::FLOAT, false}},
+		{Layout::RG32F, {2, 4, Encoding::FLOAT, false}},
+		{Layout::RGBA32F, {4, 4, Encoding::FLOAT, false}},
+	};
+	const auto infosIt = packInfos.find(format);
+	if(infosIt == packInfos.end()){
+		return false;
+	}
+	infos = infosIt->second;
+	return true;
+}
+
+size_t TextureCodec::imageSize(const Layout & format, uint width, uint height){
+	if(isCompressed(format)){
+		const size_t blockSize = (format == Layout::BC1 || format == Layout::BC1_SRGB || format == Layout::BC4) ? 8 : 16;
+		return size_t((width + 3) / 4) * size_t((height + 3) / 4) * blockSize;
+	}
+	PackInfos infos;
+	if(!getPackInfos(format, infos)){
+		return 0;
+	}
+	return size_t(width) * size_t(height) * infos.channels * infos.bytes;
+}
+
+void TextureCodec::pack(const Image & image, const Layout & format, uchar * dst){
+	PackInfos infos;
+	if(!getPackInfos(format, infos)){
+		Log::Error() << Log::Resources << "Unsupported layout for packing." << std::endl;
+		return;
+	}
+	const uint channels = std::min(infos.channels, image.components);
+	const size_t texelSize = infos.channels * infos.bytes;
+
+	auto packRow = [&image, &infos, channels, texelSize, dst](size_t y){
+		for(size_t x = 0; x < image.width; ++x){
+			const size_t pid = y * image.width + x;
+			const float * src = &image.pixels[pid * image.components];
+			uchar * texel = dst + pid * texelSize;
+			for(uint cid = 0; cid < channels; ++cid){
+				// Red and blue are swapped in BGRA layouts.
+				const uint did = (infos.swizzle && cid != 3) ? (2 - cid) : cid;
+				uchar * comp = texel + did * infos.bytes;
+				const float val = src[cid];
+				switch(infos.encoding){
+					case Encoding::UNORM:
+						if(infos.bytes == 1){
+							*comp = uchar(glm::clamp(val, 0.0f, 1.0f) * 255.0f + 0.5f);
+						} else {
+							const uint16_t comp16 = uint16_t(glm::clamp(val, 0.0f, 1.0f) * 65535.0f + 0.5f);
+							std::memcpy(comp, &comp16, sizeof(uint16_t));
+						}
+						break;
+					case Encoding::SNORM:
+						if(infos.bytes == 1){
+							const int8_t comp8 = int8_t(std::round(glm::clamp(val, -1.0f, 1.0f) * 127.0f));
+							std::memcpy(comp, &comp8, sizeof(int8_t));
+						} else {
+							const int16_t comp16 = int16_t(std::round(glm::clamp(val, -1.0f, 1.0f) * 32767.0f));
+							std::memcpy(comp, &comp16, sizeof(int16_t));
+						}
+						break;
+					case Encoding::HALF:
+					{
+						const uint16_t half = glm::packHalf1x16(val);
+						std::memcpy(comp, &half, sizeof(uint16_t));
+						break;
+					}
+					case Encoding::FLOAT:
+						std::memcpy(comp, &val, sizeof(float));
+						break;
+				}
+			}
+			// Missing channels are set to zero.
+			for(uint cid = channels; cid < infos.channels; ++cid){
+				std::memset(texel + cid * infos.bytes, 0, infos.bytes);
+			}
+		}
+	};
+
+	// Spawning threads is only worth it for large images.
+	if(size_t(image.width) * size_t(image.height) >= 65536){
+		System::forParallel(0, image.height, packRow);
+	} else {
+		for(size_t y = 0; y < image.height; ++y){
+			packRow(y);
+		}
+	}
+}
+
+bool TextureCodec::generateMipmaps(Texture & texture, bool srgb){
+	if(texture.shape & TextureShape::D3){
+		Log::Warning() << Log::Resources << "CPU mipmaps generation is not supported for 3D textures." << std::endl;
+		return false;
+	}
+	const uint layers = texture.depth;
+	if(texture.images.size() < layers){
+		Log::Error() << Log::Resources << "Missing images for mipmaps generation." << std::endl;
+		return false;
+	}
+	// Discard existing levels.
+	texture.images.resize(layers);
+
+	for(uint mid = 1; mid < texture.levels; ++mid){
+		const uint w = std::max<uint>(texture.width >> mid, 1u);
+		const uint h = std::max<uint>(texture.height >> mid, 1u);
+		for(uint lid = 0; lid < layers; ++lid){
+			texture.images.emplace_back(w, h, texture.images[(mid - 1) * layers + lid].components);
+			// Access after insertion, the vector might have been reallocated.
+			const Image & src = texture.images[(mid - 1) * layers + lid];
+			Image & dst = texture.images.back();
+			const uint channels = std::min(src.components, 4u);
+			// Average each 2x2 footprint, in linear space for sRGB colors.
+			for(uint y = 0; y < h; ++y){
+				for(uint x = 0; x < w; ++x){
+					glm::vec4 sum(0.0f);
+					for(uint dy = 0; dy < 2; ++dy){
+						for(uint dx = 0; dx < 2; ++dx){
+							const uint sx = std::min(2 * x + dx, src.width - 1);
+							const uint sy = std::min(2 * y + dy, src.height - 1);
+							const float * texel = &src.pixels[(sy * src.width + sx) * src.components];
+							glm::vec4 color(0.0f);
+							for(uint cid = 0; cid < channels; ++cid){
+								color[cid] = texel[cid];
+							}
+							if(srgb){
+								color = glm::vec4(glm::convertSRGBToLinear(glm::vec3(color)), color.a);
+							}
+							sum += color;
+						}
+					}
+					glm::vec4 avg = 0.25f * sum;
+					if(srgb){
+						avg = glm::vec4(glm::convertLinearToSRGB(glm::vec3(avg)), avg.a);
+					}
+					float * texel = &dst.pixels[(y * w + x) * src.components];
+					for(uint cid = 0; cid < channels; ++cid){
+						texel[cid] = avg[cid];
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool TextureCodec::compress(Texture & texture, const Layout & format, bool generateMips){
+	if(!isCompressed(format)){
+		Log::Error() << Log::Resources << "Layout is not block-compressed." << std::endl;
+		return false;
+	}
+	if(texture.images.empty()){
+		Log::Error() << Log::Resources << "No images to compress for texture " << texture.name() << "." << std::endl;
+		return false;
+	}
+
+	if(generateMips && !generateMipmaps(texture, isSRGB(format))){
+		texture.levels = 1;
+	}
+
+	// Only keep complete levels.
+	const bool is3D = texture.shape & TextureShape::D3;
+	size_t imageCount = 0;
+	uint levels = 0;
+	for(uint mid = 0; mid < texture.levels; ++mid){
+		const size_t levelCount = is3D ? std::max<uint>(texture.depth >> mid, 1u) : texture.depth;
+		if(imageCount + levelCount > texture.images.size()){
+			break;
+		}
+		imageCount += levelCount;
+		++levels;
+	}
+	if(levels != texture.levels){
+		Log::Warning() << Log::Resources << "Texture " << texture.name() << " only has " << levels << " levels available on the CPU for compression." << std::endl;
+		texture.levels = levels;
+	}
+
+	size_t totalSize = 0;
+	for(size_t iid = 0; iid < imageCount; ++iid){
+		totalSize += imageSize(format, texture.images[iid].width, texture.images[iid].height);
+	}
+	texture.packed.resize(totalSize);
+
+	size_t offset = 0;
+	for(size_t iid = 0; iid < imageCount; ++iid){
+		const Image & image = texture.images[iid];
+		encode(image, format, texture.packed.data() + offset);
+		offset += imageSize(format, image.width, image.height);
+	}
+	return true;
+}
+
+void TextureCodec::encode(const Image & image, const Layout & format, uchar * dst){
+	const uint blocksX = (image.width + 3) / 4;
+	const uint blocksY = (image.height + 3) / 4;
+	const size_t blockSize = imageSize(format, 4, 4);
+
+	auto encodeRow = [&image, &format, dst, blocksX, blockSize](size_t by){
+		Block block;
+		for(uint bx = 0; bx < blocksX; ++bx){
+			uchar * blockDst = dst + (by * blocksX + bx) * blockSize;
+			std::memset(blockDst, 0, blockSize);
+			fetchBlock(image, 4 * bx, 4 * uint(by), block);
+			switch(format){
+				case Layout::BC1:
+				case Layout::BC1_SRGB:
+					encodeBC1(block, true, blockDst);
+					break;
+				case Layout::BC3:
+				case Layout::BC3_SRGB:
+					encodeBC4(block, 3, blockDst);
+					encodeBC1(block, false, blockDst + 8);
+					break;
+				case Layout::BC4:
+					encodeBC4(block, 0, blockDst);
+					break;
+				case Layout::BC5:
+					encodeBC4(block, 0, blockDst);
+					encodeBC4(block, 1, blockDst + 8);
+					break;
+				case Layout::BC6H:
+					encodeBC6H(block, blockDst);
+					break;
+				case Layout::BC7:
+				case Layout::BC7_SRGB:
+					encodeBC7(block, blockDst);
+					break;
+				default:
+					break;
+			}
+		}
+	};
+
+	// Spawning threads is only worth it for large images.
+	if(size_t(blocksX) * size_t(blocksY) >= 1024){
+		System::forParallel(0, blocksY, encodeRow);
+	} else {
+		for(size_t by = 0; by < blocksY; ++by){
+			encodeRow(by);
+		}
+	}
+}
+
+void TextureCodec::fetchBlock(const Image & image, uint x, uint y, Block & block){
+	const uint channels = std::min(image.components, 4u);
+	for(uint dy = 0; dy < 4; ++dy){
+		// Duplicate border texels for partial blocks.
+		const uint sy = std::min(y + dy, image.height - 1);
+		for(uint dx = 0; dx < 4; ++dx){
+			const uint sx = std::min(x + dx, image.width - 1);
+			const float * texel = &image.pixels[(sy * image.width + sx) * image.components];
+			glm::vec4 & dst = block[dy * 4 + dx];
+			dst = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			for(uint cid = 0; cid < channels; ++cid){
+				dst[cid] = texel[cid];
+			}
+		}
+	}
+}
+
+void TextureCodec::writeBits(uchar * dst, uint & offset, uint value, uint count){
+	for(uint bid = 0; bid < count; ++bid, ++offset){
+		if((value >> bid) & 1u){
+			dst[offset / 8] |= uchar(1u << (offset % 8));
+		}
+	}
+}
+
+void TextureCodec::principalEndpoints(const glm::vec4 * points, uint count, glm::vec4 & e0, glm::vec4 & e1){
+	glm::vec4 mean(0.0f);
+	glm::vec4 minPoint(std::numeric_limits<float>::max());
+	glm::vec4 maxPoint(std::numeric_limits<float>::lowest());
+	for(uint pid = 0; pid < count; ++pid){
+		mean += points[pid];
+		minPoint = glm::min(minPoint, points[pid]);
+		maxPoint = glm::max(maxPoint, points[pid]);
+	}
+	mean /= float(count);
+
+	glm::mat4 covariance(0.0f);
+	for(uint pid = 0; pid < count; ++pid){
+		const glm::vec4 delta = points[pid] - mean;
+		covariance += glm::outerProduct(delta, delta);
+	}
+	// Power iterations, starting from the bounding box diagonal.
+	glm::vec4 axis = maxPoint - minPoint;
+	if(glm::dot(axis, axis) < 1e-12f){
+		e0 = e1 = mean;
+		return;
+	}
+	for(uint iid = 0; iid < 8; ++iid){
+		const glm::vec4 next = covariance * axis;
+		const float norm = glm::length(next);
+		if(norm < 1e-12f){
+			break;
+		}
+		axis = next / norm;
+	}
+	axis = glm::normalize(axis);
+
+	// Endpoints are the extreme projections along the axis.
+	float minT = std::numeric_limits<float>::max();
+	float maxT = std::numeric_limits<float>::lowest();
+	for(uint pid = 0; pid < count; ++pid){
+		const float t = glm::dot(points[pid] - mean, axis);
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+	e0 = mean + minT * axis;
+	e1 = mean + maxT * axis;
+}
+
+void TextureCodec::encodeBC1(const Block & block, bool alpha, uchar * dst){
+	// Transparent texels use the three colors mode.
+	std::array<glm::vec4, 16> colors;
+	uint count = 0;
+	bool transparent = false;
+	for(uint pid = 0; pid < 16; ++pid){
+		if(alpha && block[pid].a < 0.5f){
+			transparent = true;
+			continue;
+		}
+		colors[count++] = glm::vec4(glm::clamp(glm::vec3(block[pid]), 0.0f, 1.0f), 0.0f);
+	}
+
+	glm::vec4 e0(0.0f);
+	glm::vec4 e1(0.0f);
+	if(count != 0){
+		principalEndpoints(colors.data(), count, e0, e1);
+	}
+
+	// Quantize to 5:6:5.
+	const glm::vec3 scale(31.0f, 63.0f, 31.0f);
+	glm::uvec3 q0 = glm::uvec3(glm::round(glm::clamp(glm::vec3(e0), 0.0f, 1.0f) * scale));
+	glm::uvec3 q1 = glm::uvec3(glm::round(glm::clamp(glm::vec3(e1), 0.0f, 1.0f) * scale));
+	uint c0 = (q0.r << 11) | (q0.g << 5) | q0.b;
+	uint c1 = (q1.r << 11) | (q1.g << 5) | q1.b;
+	// Four colors mode requires c0 > c1, three colors mode c0 <= c1.
+	if((!transparent && c0 < c1) || (transparent && c0 > c1)){
+		std::swap(c0, c1);
+		std::swap(q0, q1);
+	}
+
+	const glm::vec3 p0 = glm::vec3(q0) / scale;
+	const glm::vec3 p1 = glm::vec3(q1) / scale;
+	std::array<glm::vec3, 4> palette;
+	palette[0] = p0;
+	palette[1] = p1;
+	const bool fourColors = !transparent && c0 != c1;
+	if(fourColors){
+		palette[2] = (2.0f * p0 + p1) / 3.0f;
+		palette[3] = (p0 + 2.0f * p1) / 3.0f;
+	} else {
+		palette[2] = 0.5f * (p0 + p1);
+		palette[3] = glm::vec3(0.0f);
+	}
+
+	uint indices = 0;
+	for(uint pid = 0; pid < 16; ++pid){
+		uint best = 3;
+		if(!(alpha && block[pid].a < 0.5f)){
+			best = 0;
+			float bestDist = std::numeric_limits<float>::max();
+			const uint paletteSize = fourColors ? 4 : 3;
+			for(uint cid = 0; cid < paletteSize; ++cid){
+				const glm::vec3 delta = glm::vec3(block[pid]) - palette[cid];
+				const float dist = glm::dot(delta, delta);
+				if(dist < bestDist){
+					bestDist = dist;
+					best = cid;
+				}
+			}
+		}
+		indices |= best << (2 * pid);
+	}
+
+	uint offset = 0;
+	writeBits(dst, offset, c0, 16);
+	writeBits(dst, offset, c1, 16);
+	writeBits(dst, offset, indices, 32);
+}
+
+void TextureCodec::encodeBC4(const Block & block, uint channel, uchar * dst){
+	float minVal = 1.0f;
+	float maxVal = 0.0f;
+	for(uint pid = 0; pid < 16; ++pid){
+		const float val = glm::clamp(block[pid][channel], 0.0f, 1.0f);
+		minVal = std::min(minVal, val);
+		maxVal = std::max(maxVal, val);
+	}
+	// r0 > r1 selects the eight values mode.
+	const uint r0 = uint(std::round(maxVal * 255.0f));
+	const uint r1 = uint(std::round(minVal * 255.0f));
+	std::array<float, 8> palette;
+	palette.fill(float(r0));
+	palette[1] = float(r1);
+	for(uint vid = 2; vid < 8; ++vid){
+		palette[vid] = (float(8 - vid) * float(r0) + float(vid - 1) * float(r1)) / 7.0f;
+	}
+
+	uint offset = 0;
+	writeBits(dst, offset, r0, 8);
+	writeBits(dst, offset, r1, 8);
+	for(uint pid = 0; pid < 16; ++pid){
+		const float val = glm::clamp(block[pid][channel], 0.0f, 1.0f) * 255.0f;
+		uint best = 0;
+		if(r0 != r1){
+			float bestDist = std::numeric_limits<float>::max();
+			for(uint vid = 0; vid < 8; ++vid){
+				const float dist = std::abs(val - palette[vid]);
+				if(dist < bestDist){
+					bestDist = dist;
+					best = vid;
+				}
+			}
+		}
+		writeBits(dst, offset, best, 3);
+	}
+}
+
+void TextureCodec::encodeBC6H(const Block & block, uchar * dst){
+	// Endpoints are interpolated on the half float bits, scaled to 16 bits.
+	std::array<glm::vec4, 16> values;
+	for(uint pid = 0; pid < 16; ++pid){
+		for(uint cid = 0; cid < 3; ++cid){
+			const uint half = std::min<uint>(glm::packHalf1x16(std::max(block[pid][cid], 0.0f)), 0x7BFF);
+			values[pid][cid] = float(half) * 64.0f / 31.0f;
+		}
+		values[pid][3] = 0.0f;
+	}
+	glm::vec4 e0, e1;
+	principalEndpoints(values.data(), 16, e0, e1);
+
+	// Quantize endpoints to 10 bits, and compute their unquantized values.
+	std::array<glm::uvec3, 2> endpoints;
+	std::array<glm::vec3, 2> unquantized;
+	for(uint eid = 0; eid < 2; ++eid){
+		const glm::vec4 & e = eid == 0 ? e0 : e1;
+		for(uint cid = 0; cid < 3; ++cid){
+			const uint q = uint(glm::clamp(std::round((e[cid] - 32.0f) / 64.0f), 0.0f, 1023.0f));
+			endpoints[eid][cid] = q;
+			unquantized[eid][cid] = q == 0 ? 0.0f : (q == 1023 ? 65535.0f : float(q * 64 + 32));
+		}
+	}
+
+	static const std::array<uint, 16> weights = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	std::array<uint, 16> indices;
+	for(uint pid = 0; pid < 16; ++pid){
+		float bestDist = std::numeric_limits<float>::max();
+		for(uint wid = 0; wid < 16; ++wid){
+			const float w = float(weights[wid]) / 64.0f;
+			const glm::vec3 delta = glm::vec3(values[pid]) - glm::mix(unquantized[0], unquantized[1], w);
+			const float dist = glm::dot(delta, delta);
+			if(dist < bestDist){
+				bestDist = dist;
+				indices[pid] = wid;
+			}
+		}
+	}
+	// The first index most significant bit is implicitly zero.
+	if(indices[0] >= 8){
+		std::swap(endpoints[0], endpoints[1]);
+		for(uint & index : indices){
+			index = 15 - index;
+		}
+	}
+
+	uint offset = 0;
+	// Mode 11: one region, 10 bits endpoints.
+	writeBits(dst, offset, 0x3, 5);
+	for(uint eid = 0; eid < 2; ++eid){
+		for(uint cid = 0; cid < 3; ++cid){
+			writeBits(dst, offset, endpoints[eid][cid], 10);
+		}
+	}
+	for(uint pid = 0; pid < 16; ++pid){
+		writeBits(dst, offset, indices[pid], pid == 0 ? 3 : 4);
+	}
+}
+
+void TextureCodec::encodeBC7(const Block & block, uchar * dst){
+	std::array<glm::vec4, 16> values;
+	for(uint pid = 0; pid < 16; ++pid){
+		values[pid] = glm::clamp(block[pid], 0.0f, 1.0f) * 255.0f;
+	}
+	glm::vec4 e0, e1;
+	principalEndpoints(values.data(), 16, e0, e1);
+
+	// Quantize endpoints to 7 bits and a shared least significant bit.
+	std::array<glm::uvec4, 2> endpoints;
+	std::array<uint, 2> pbits;
+	std::array<glm::vec4, 2> unquantized;
+	for(uint eid = 0; eid < 2; ++eid){
+		const glm::vec4 e = glm::clamp(eid == 0 ? e0 : e1, 0.0f, 255.0f);
+		float bestError = std::numeric_limits<float>::max();
+		for(uint p = 0; p < 2; ++p){
+			const glm::uvec4 q = glm::uvec4(glm::clamp(glm::round((e - float(p)) / 2.0f), 0.0f, 127.0f));
+			const glm::vec4 v = glm::vec4((q << 1u) | glm::uvec4(p));
+			const glm::vec4 delta = v - e;
+			const float error = glm::dot(delta, delta);
+			if(error < bestError){
+				bestError = error;
+				endpoints[eid] = q;
+				pbits[eid] = p;
+				unquantized[eid] = v;
+			}
+		}
+	}
+
+	static const std::array<uint, 16> weights = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	std::array<uint, 16> indices;
+	for(uint pid = 0; pid < 16; ++pid){
+		float bestDist = std::numeric_limits<float>::max();
+		for(uint wid = 0; wid < 16; ++wid){
+			const float w = float(weights[wid]) / 64.0f;
+			const glm::vec4 delta = values[pid] - glm::mix(unquantized[0], unquantized[1], w);
+			const float dist = glm::dot(delta, delta);
+			if(dist < bestDist){
+				bestDist = dist;
+				indices[pid] = wid;
+			}
+		}
+	}
+	// The first index most significant bit is implicitly zero.
+	if(indices[0] >= 8){
+		std::swap(endpoints[0], endpoints[1]);
+		std::swap(pbits[0], pbits[1]);
+		for(uint & index : indices){
+			index = 15 - index;
+		}
+	}
+
+	uint offset = 0;
+	// Mode 6: one subset, RGBA 7 bits endpoints with unique p-bits, 4 bits indices.
+	writeBits(dst, offset, 1u << 6, 7);
+	for(uint cid = 0; cid < 4; ++cid){
+		writeBits(dst, offset, endpoints[0][cid], 7);
+		writeBits(dst, offset, endpoints[1][cid], 7);
+	}
+	writeBits(dst, offset, pbits[0], 1);
+	writeBits(dst, offset, pbits[1], 1);
+	for(uint pid = 0; pid < 16; ++pid){
+		writeBits(dst, offset, indices[pid], pid == 0 ? 3 : 4);
+	}
+}
+
+void TextureCodec::save(const std::string & path, const Texture & texture){
+	// Header: magic, version, layout, shape, dimensions, levels, data size.
+	const std::array<uint32_t, 8> header = {
+		0x58455452u /* RTEX */, version, uint32_t(texture.format), uint32_t(texture.shape),
+		texture.width, texture.height, texture.depth, texture.levels
+	};
+	const uint64_t dataSize = texture.packed.size();
+	std::vector<char> content(sizeof(header) + sizeof(uint64_t) + dataSize);
+	std::memcpy(content.data(), header.data(), sizeof(header));
+	std::memcpy(content.data() + sizeof(header), &dataSize, sizeof(uint64_t));
+	if(dataSize != 0){
+		std::memcpy(content.data() + sizeof(header) + sizeof(uint64_t), texture.packed.data(), dataSize);
+	}
+	Resources::saveRawDataToExternalFile(path, content.data(), content.size());
+}
+
+bool TextureCodec::load(const std::string & path, Texture & texture){
+	if(!Resources::externalFileExists(path)){
+		return false;
+	}
+	size_t size = 0;
+	char * content = Resources::loadRawDataFromExternalFile(path, size);
+	if(content == nullptr){
+		return false;
+	}
+	std::array<uint32_t, 8> header;
+	uint64_t dataSize = 0;
+	bool valid = size >= sizeof(header) + sizeof(uint64_t);
+	if(valid){
+		std::memcpy(header.data(), content, sizeof(header));
+		std::memcpy(&dataSize, content + sizeof(header), sizeof(uint64_t));
+		valid = header[0] == 0x58455452u && header[1] == version && (size - sizeof(header) - sizeof(uint64_t)) == dataSize;
+	}
+	if(valid){
+		texture.format = Layout(header[2]);
+		texture.shape = TextureShape(header[3]);
+		texture.width = header[4];
+		texture.height = header[5];
+		texture.depth = header[6];
+		texture.levels = header[7];
+		texture.packed.resize(dataSize);
+		std::memcpy(texture.packed.data(), content + sizeof(header) + sizeof(uint64_t), dataSize);
+	} else {
+		Log::Warning() << Log::Resources << "Invalid texture container at path \"" << path << "\"." << std::endl;
+	}
+	delete[] content;
+	return valid;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "resources/Texture.hpp"
+#include "Common.hpp"
+
+/**
+ \brief Convert CPU float images to the packed representation expected by the GPU for a given layout, including block-compressed formats (BC1, BC3, BC4, BC5, BC6H and BC7).
+ \details Compressed textures can be stored with their complete mip chain in a simple binary container, to skip decoding and encoding at the next load.
+ \ingroup Resources
+ */
+class TextureCodec {
+public:
+
+	/// Version of the encoders and container, stored in cached files.
+	static const uint version = 1;
+
+	/** Check if a layout is block-compressed.
+	 \param format the layout to check
+	 \return true if compressed
+	 */
+	static bool isCompressed(const Layout & format);
+
+	/** Check if float image data can be directly packed in the given uncompressed layout on the CPU.
+	 \param format the layout to check
+	 \return true if the layout is supported
+	 */
+	static bool isPackable(const Layout & format);
+
+	/** Check if a layout stores color values in the sRGB color space.
+	 \param format the layout to check
+	 \return true if sRGB encoded
+	 */
+	static bool isSRGB(const Layout & format);
+
+	/** Get the uncompressed layout closest to a compressed one, to use when block compression is not supported.
+	 \param format the compressed layout
+	 \return the uncompressed equivalent (or the input layout if not compressed)
+	 */
+	static Layout uncompressedLayout(const Layout & format);
+
+	/** Compute the size of an image once packed.
+	 \param format the packed layout
+	 \param width the image width
+	 \param height the image height
+	 \return the size in bytes, 0 if the layout is neither compressed nor packable
+	 */
+	static size_t imageSize(const Layout & format, uint width, uint height);
+
+	/** Pack an image in an uncompressed layout.
+	 \param image the image to pack
+	 \param format the target layout (see isPackable)
+	 \param dst the destination, should be at least imageSize() bytes
+	 */
+	static void pack(const Image & image, const Layout & format, uchar * dst);
+
+	/** Generate the mip chain of a texture on the CPU, using a box filter.
+	 \param texture the texture, with one level of images
+	 \param srgb are the image values sRGB encoded
+	 \return true if mips were generated
+	 \note 3D textures are not supported.
+	 */
+	static bool generateMipmaps(Texture & texture, bool srgb);
+
+	/** Encode the texture images in a block-compressed layout, filling the texture packed data.
+	 \param texture the texture to compress
+	 \param format the compressed layout
+	 \param generateMips should the mip chain be generated first
+	 \return true if the encoding succeeded
+	 */
+	static bool compress(Texture & texture, const Layout & format, bool generateMips);
+
+	/** Save a texture packed data and its description to a container file.
+	 \param path the file path
+	 \param texture the texture to save
+	 */
+	static void save(const std::string & path, const Texture & texture);
+
+	/** Load a texture packed data and description from a container file.
+	 \param path the file path
+	 \param texture the texture to populate
+	 \return true if the file was valid and loaded
+	 */
+	static bool load(const std::string & path, Texture & texture);
+
+private:
+
+	/** \brief Encoding of each component of a packed texel. */
+	enum class Encoding {
+		UNORM, SNORM, HALF, FLOAT
+	};
+
+	/** \brief Description of an uncompressed packed layout. */
+	struct PackInfos {
+		uint channels; ///< Number of channels.
+		uint bytes; ///< Size of a component in bytes.
+		Encoding encoding; ///< Component encoding.
+		bool swizzle; ///< Are the red and blue channels swapped.
+	};
+
+	/** Retrieve the description of a packable layout.
+	 \param format the layout
+	 \param infos will contain the layout description
+	 \return true if the layout is packable
+	 */
+	static bool getPackInfos(const Layout & format, PackInfos & infos);
+
+	/** Write bits in a zero-initialized block, least significant first.
+	 \param dst the block data
+	 \param offset the current bit position, will be advanced
+	 \param value the bits to write
+	 \param count the number of bits to write
+	 */
+	static void writeBits(uchar * dst, uint & offset, uint value, uint count);
+
+	/** Estimate two endpoints encompassing a set of points along their principal axis.
+	 \param points the points
+	 \param count the number of points
+	 \param e0 will contain the first endpoint
+	 \param e1 will contain the second endpoint
+	 */
+	static void principalEndpoints(const glm::vec4 * points, uint count, glm::vec4 & e0, glm::vec4 & e1);
+
+	/** \brief Pixels of a 4x4 block. */
+	using Block = std::array<glm::vec4, 16>;
+
+	/** Extract a 4x4 block from an image, clamping at the borders.
+	 \param image the source image
+	 \param x the block first column
+	 \param y the block first row
+	 \param block will contain the block pixels, missing channels are set to 0 (or 1 for alpha)
+	 */
+	static void fetchBlock(const Image & image, uint x, uint y, Block & block);
+
+	/** Encode a BC1 color block (8 bytes).
+	 \param block the block pixels
+	 \param alpha should pixels with alpha below 0.5 be encoded as transparent
+	 \param dst the destination
+	 */
+	static void encodeBC1(const Block & block, bool alpha, uchar * dst);
+
+	/** Encode a BC4 single channel block (8 bytes).
+	 \param block the block pixels
+	 \param channel the channel to encode
+	 \param dst the destination
+	 */
+	static void encodeBC4(const Block & block, uint channel, uchar * dst);
+
+	/** Encode a BC6H unsigned block in mode 11 (16 bytes).
+	 \param block the block pixels
+	 \param dst the destination
+	 */
+	static void encodeBC6H(const Block & block, uchar * dst);
+
+	/** Encode a BC7 block in mode 6 (16 bytes).
+	 \param block the block pixels
+	 \param dst the destination
+	 */
+	static void encodeBC7(const Block & block, uchar * dst);
+
+	/** Encode an image in a compressed layout.
+	 \param image the image to encode
+	 \param format the compressed layout
+	 \param dst the destination, should be at least imageSize() bytes
+	 */
+	static void encode(const Image & image, const Layout & format, uchar * dst);
+
+};
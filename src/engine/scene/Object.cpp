@@ -11,11 +11,15 @@ bool Object::decode(const KeyValues & params, Storage options) {
 
 	// We expect there is only one transformation in the parameters set.
 	_model.reset(Codable::decodeTransformation(params.elements));
-	
+
+	std::string meshString;
+	bool useClusters = false;
 	for(const auto & param : params.elements) {
 		if(param.key == "mesh" && !param.values.empty()) {
-			const std::string meshString = param.values[0];
-			_mesh						 = Resources::manager().getMesh(meshString, options);
+			meshString = param.values[0];
+
+		} else if(param.key == "clusters") {
+			useClusters = Codable::decodeBool(param);
 
 		} else if(param.key == "material" && !param.values.empty()) {
 			_materialName = param.values[0];
@@ -32,6 +36,10 @@ bool Object::decode(const KeyValues & params, Storage options) {
 		}
 	}
 
+	if(!meshString.empty()) {
+		_mesh = Resources::manager().getMesh(meshString, useClusters ? (options | Storage::CLUSTERS) : options);
+	}
+
 	if(_mesh == nullptr){
 		Log::Error() << Log::Resources << "Unable to load object (no mesh)." << std::endl;
 		_mesh = Resources::manager().getMesh("cube", options);
@@ -53,6 +61,10 @@ KeyValues Object::encode() const {
 	obj.elements.back().values = {Codable::encode(_castShadow)};
 	obj.elements.emplace_back("skipuvs");
 	obj.elements.back().values = {Codable::encode(_skipUVs)};
+	if(_mesh && !_mesh->meshlets.empty()){
+		obj.elements.emplace_back("clusters");
+		obj.elements.back().values = {Codable::encode(true)};
+	}
 	
 	if(_mesh){
 		obj.elements.emplace_back("mesh");
@@ -83,6 +95,8 @@ void Object::addAnimation(const std::shared_ptr<Animation> & anim) {
 void Object::set(const glm::mat4 & model){
 	_model.reset(model);
 	_dirtyBbox = true;
+	_moved = true;
+	_set = true;
 }
 
 void Object::update(double fullTime, double frameTime) {
@@ -90,7 +104,10 @@ void Object::update(double fullTime, double frameTime) {
 	for(auto & anim : _animations) {
 		model = anim->apply(model, fullTime, frameTime);
 	}
-	if(!_animations.empty()){
+	// A transformation set since the last update is still reported, in case it was set before the update.
+	_moved = _set || !_animations.empty();
+	_set = false;
+	if(_moved){
 		_dirtyBbox = true;
 	}
 	_model = model;
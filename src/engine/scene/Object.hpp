@@ -73,6 +73,11 @@ public:
 	 */
 	bool animated() const { return !_animations.empty(); }
 
+	/** Check if the object has moved during the last update.
+	 \return a boolean denoting if the transformation has changed
+	 */
+	bool moved() const { return _moved; }
+
 	/** Set the material to use for this object
 	 \param material the new material to use
 	 */
@@ -93,6 +98,7 @@ public:
 	 orientation: axisX,axisY,axisZ angle
 	 shadows: bool
 	 skipuvs: bool
+	 clusters: bool
 	 animations:
 	 	- animationtype: ...
 	 	- ...
@@ -136,6 +142,8 @@ protected:
 	mutable BoundingBox _bbox;							///< The world space object bounding box.
 	bool _castShadow = true;			 ///< Can the object casts shadows.
 	bool _skipUVs	 = false;			 ///< The object doesn't use UV coordinates.
+	bool _moved		 = false;			 ///< Has the object moved during the last update.
+	bool _set		 = false;			 ///< Has the transformation been set since the last update.
 
 	mutable bool _dirtyBbox  = true;	 ///< Has the bounding box been updated following an animation update.
 };
@@ -0,0 +1,297 @@
+#include "scene/ObjectsHierarchy.hpp"
+#include "system/System.hpp"
+#include <stack>
+
+void ObjectsHierarchy::build(const std::vector<Object> & objects) {
+
+	const size_t objCount = objects.size();
+	_nodes.clear();
+	_objectIds.resize(objCount);
+	_leaves.assign(objCount, 0);
+	_casters.resize(objCount);
+	_positions.resize(objCount);
+	_boxes.resize(objCount);
+	if(objCount == 0){
+		return;
+	}
+
+	// Cache boxes and centroids, to avoid accessing the objects during sorting.
+	std::vector<BoundingBox> boxes(objCount);
+	std::vector<glm::vec3> centroids(objCount);
+	for(size_t oid = 0; oid < objCount; ++oid) {
+		_objectIds[oid] = long(oid);
+		_casters[oid] = objects[oid].castsShadow();
+		boxes[oid] = objects[oid].boundingBox();
+		centroids[oid] = boxes[oid].getCentroid();
+	}
+
+	_nodes.emplace_back();
+	_nodes[0].count = objCount;
+
+	std::stack<size_t> remainingNodes;
+	remainingNodes.push(0);
+
+	while(!remainingNodes.empty()) {
+		const size_t nid = remainingNodes.top();
+		remainingNodes.pop();
+		const size_t begin = _nodes[nid].first;
+		const size_t count = _nodes[nid].count;
+
+		// Compute the global bounding box, and the bounds of the centroids.
+		BoundingBox global;
+		BoundingBox centers;
+		for(size_t oid = begin; oid < begin + count; ++oid) {
+			global.merge(boxes[_objectIds[oid]]);
+			centers.merge(centroids[_objectIds[oid]]);
+		}
+		_nodes[nid].box = global;
+
+		// If the objects count is low enough, we have a leaf.
+		if(count <= maxLeafSize) {
+			for(size_t oid = begin; oid < begin + count; ++oid) {
+				_leaves[_objectIds[oid]] = nid;
+			}
+			continue;
+		}
+
+		// Split at the median along the dimension where centroids are the most spread.
+		const glm::vec3 centersSize = centers.getSize();
+		const int axis = (centersSize.x >= centersSize.y && centersSize.x >= centersSize.z) ? 0 : (centersSize.y >= centersSize.z ? 1 : 2);
+		const size_t splitCount = count / 2;
+		std::nth_element(_objectIds.begin() + begin, _objectIds.begin() + begin + splitCount, _objectIds.begin() + begin + count, [&centroids, axis](long a, long b) {
+			return centroids[a][axis] < centroids[b][axis];
+		});
+
+		// Create the left and right sub-nodes.
+		// Can't keep a node reference because of emplace_back.
+		const size_t leftPos = _nodes.size();
+		_nodes.emplace_back();
+		_nodes[leftPos].first = begin;
+		_nodes[leftPos].count = splitCount;
+		_nodes[leftPos].parent = nid;
+
+		const size_t rightPos = _nodes.size();
+		_nodes.emplace_back();
+		_nodes[rightPos].first = begin + splitCount;
+		_nodes[rightPos].count = count - splitCount;
+		_nodes[rightPos].parent = nid;
+
+		_nodes[nid].left = leftPos;
+		_nodes[nid].right = rightPos;
+		remainingNodes.push(leftPos);
+		remainingNodes.push(rightPos);
+	}
+
+	// Store boxes in the final order, so that each leaf can be tested at once.
+	for(size_t pid = 0; pid < objCount; ++pid) {
+		const long oid = _objectIds[pid];
+		_positions[oid] = pid;
+		_boxes.set(pid, boxes[oid]);
+	}
+}
+
+void ObjectsHierarchy::refit(const std::vector<Object> & objects, const std::vector<size_t> & moved) {
+	if(moved.empty() || !built()){
+		return;
+	}
+	// Handle scene changes.
+	if(objects.size() != _objectIds.size()){
+		build(objects);
+		return;
+	}
+
+	_dirtyNodes.clear();
+	for(const size_t oid : moved) {
+		_boxes.set(_positions[oid], objects[oid].boundingBox());
+		_dirtyNodes.push_back(_leaves[oid]);
+	}
+	// Each leaf only has to be updated once.
+	std::sort(_dirtyNodes.begin(), _dirtyNodes.end());
+	_dirtyNodes.erase(std::unique(_dirtyNodes.begin(), _dirtyNodes.end()), _dirtyNodes.end());
+
+	// Recompute leaf boxes.
+	for(const size_t nid : _dirtyNodes) {
+		Node & node = _nodes[nid];
+		node.box = BoundingBox();
+		for(size_t oid = node.first; oid < node.first + node.count; ++oid) {
+			node.box.merge(objects[_objectIds[oid]].boundingBox());
+		}
+	}
+
+	// Collect all ancestors of the updated leaves.
+	const size_t leafCount = _dirtyNodes.size();
+	for(size_t did = 0; did < leafCount; ++did) {
+		size_t nid = _dirtyNodes[did];
+		while(nid != 0) {
+			nid = _nodes[nid].parent;
+			_dirtyNodes.push_back(nid);
+		}
+	}
+	// Children are always stored after their parent, process nodes bottom-up.
+	std::sort(_dirtyNodes.begin() + leafCount, _dirtyNodes.end(), std::greater<size_t>());
+	const auto last = std::unique(_dirtyNodes.begin() + leafCount, _dirtyNodes.end());
+	for(auto nit = _dirtyNodes.begin() + leafCount; nit != last; ++nit) {
+		Node & node = _nodes[*nit];
+		node.box = _nodes[node.left].box;
+		node.box.merge(_nodes[node.right].box);
+	}
+}
+
+void ObjectsHierarchy::query(const Frustum & frustum, List & visibles, bool castersOnly) const {
+	visibles.clear();
+	if(!built()){
+		return;
+	}
+
+	std::array<uchar, maxLeafSize> results;
+	std::stack<size_t> remainingNodes;
+	remainingNodes.push(0);
+	while(!remainingNodes.empty()) {
+		const Node & node = _nodes[remainingNodes.top()];
+		remainingNodes.pop();
+
+		if(!frustum.intersects(node.box)){
+			continue;
+		}
+		// Whole subtrees can be accepted if they are fully inside the frustum.
+		if(frustum.contains(node.box)){
+			appendAll(node, castersOnly, visibles);
+			continue;
+		}
+		if(node.left == 0) {
+			// Objects in a partially visible leaf are tested together.
+			frustum.intersects(_boxes, node.first, node.count, results.data());
+			for(size_t pid = 0; pid < node.count; ++pid) {
+				const long objectId = _objectIds[node.first + pid];
+				if(results[pid] && !(castersOnly && !_casters[objectId])){
+					visibles.push_back(objectId);
+				}
+			}
+			continue;
+		}
+		remainingNodes.push(node.left);
+		remainingNodes.push(node.right);
+	}
+}
+
+void ObjectsHierarchy::query(const std::vector<Frustum> & frustums, std::vector<List> & visibles, bool castersOnly) const {
+	const size_t viewCount = frustums.size();
+	visibles.resize(viewCount);
+	for(List & list : visibles){
+		list.clear();
+	}
+	if(!built() || viewCount == 0){
+		return;
+	}
+
+	// Split the hierarchy in independent subtrees, covering contiguous ranges of objects.
+	const size_t targetChunkCount = 32;
+	std::vector<size_t> chunks = { 0 };
+	std::vector<size_t> nextChunks;
+	while(chunks.size() < targetChunkCount) {
+		nextChunks.clear();
+		for(const size_t nid : chunks) {
+			const Node & node = _nodes[nid];
+			if(node.left == 0){
+				nextChunks.push_back(nid);
+				continue;
+			}
+			nextChunks.push_back(node.left);
+			nextChunks.push_back(node.right);
+		}
+		// Only leaves left.
+		if(nextChunks.size() == chunks.size()){
+			break;
+		}
+		std::swap(chunks, nextChunks);
+	}
+
+	// Each subtree is traversed once for all views, by groups of 64 views.
+	std::vector<std::vector<List>> chunkVisibles(chunks.size(), std::vector<List>(viewCount));
+	auto processChunk = [this, &chunks, &chunkVisibles, &frustums, viewCount, castersOnly](size_t cid) {
+		for(size_t firstView = 0; firstView < viewCount; firstView += 64) {
+			const size_t groupCount = std::min(viewCount - firstView, size_t(64));
+			queryViews(chunks[cid], frustums, firstView, groupCount, castersOnly, chunkVisibles[cid]);
+		}
+	};
+	// Spawning threads is only worth it for large amounts of tests.
+	if(count() * viewCount >= 65536) {
+		System::forParallel(0, chunks.size(), processChunk);
+	} else {
+		for(size_t cid = 0; cid < chunks.size(); ++cid) {
+			processChunk(cid);
+		}
+	}
+
+	// Merge results.
+	for(size_t vid = 0; vid < viewCount; ++vid) {
+		List & list = visibles[vid];
+		for(const std::vector<List> & chunkVisible : chunkVisibles) {
+			list.insert(list.end(), chunkVisible[vid].begin(), chunkVisible[vid].end());
+		}
+	}
+}
+
+void ObjectsHierarchy::queryViews(size_t root, const std::vector<Frustum> & frustums, size_t firstView, size_t viewCount, bool castersOnly, std::vector<List> & visibles) const {
+	std::array<uchar, maxLeafSize> results;
+	// Each node is associated with the views that might see it.
+	std::stack<std::pair<size_t, uint64_t>> remainingNodes;
+	const uint64_t allViews = viewCount == 64 ? ~uint64_t(0) : ((uint64_t(1) << viewCount) - 1);
+	remainingNodes.push(std::make_pair(root, allViews));
+
+	while(!remainingNodes.empty()) {
+		const Node & node = _nodes[remainingNodes.top().first];
+		const uint64_t views = remainingNodes.top().second;
+		remainingNodes.pop();
+
+		uint64_t partialViews = 0;
+		for(size_t vid = 0; vid < viewCount; ++vid) {
+			const uint64_t viewBit = uint64_t(1) << vid;
+			if(!(views & viewBit)){
+				continue;
+			}
+			const Frustum & frustum = frustums[firstView + vid];
+			if(!frustum.intersects(node.box)){
+				continue;
+			}
+			// Whole subtrees can be accepted if they are fully inside the frustum.
+			if(frustum.contains(node.box)){
+				appendAll(node, castersOnly, visibles[firstView + vid]);
+			} else {
+				partialViews |= viewBit;
+			}
+		}
+		if(partialViews == 0){
+			continue;
+		}
+		if(node.left != 0) {
+			remainingNodes.push(std::make_pair(node.left, partialViews));
+			remainingNodes.push(std::make_pair(node.right, partialViews));
+			continue;
+		}
+		// Objects in a partially visible leaf are tested together.
+		for(size_t vid = 0; vid < viewCount; ++vid) {
+			if(!(partialViews & (uint64_t(1) << vid))){
+				continue;
+			}
+			frustums[firstView + vid].intersects(_boxes, node.first, node.count, results.data());
+			List & list = visibles[firstView + vid];
+			for(size_t pid = 0; pid < node.count; ++pid) {
+				const long objectId = _objectIds[node.first + pid];
+				if(results[pid] && !(castersOnly && !_casters[objectId])){
+					list.push_back(objectId);
+				}
+			}
+		}
+	}
+}
+
+void ObjectsHierarchy::appendAll(const Node & node, bool castersOnly, List & visibles) const {
+	for(size_t pid = node.first; pid < node.first + node.count; ++pid) {
+		const long objectId = _objectIds[pid];
+		if(castersOnly && !_casters[objectId]){
+			continue;
+		}
+		visibles.push_back(objectId);
+	}
+}
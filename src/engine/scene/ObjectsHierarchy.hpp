@@ -0,0 +1,89 @@
+#pragma once
+
+#include "scene/Object.hpp"
+#include "resources/Bounds.hpp"
+#include "Common.hpp"
+
+/**
+ \brief Bounding volume hierarchy built over the world space bounding boxes of a list of objects.
+ \details The hierarchy can be refitted incrementally when some objects move, without rebuilding it. Frustum queries skip whole subtrees outside of the frustum and accept whole subtrees that are fully inside without testing their objects.
+ \ingroup Scene
+ */
+class ObjectsHierarchy {
+
+public:
+
+	using List = std::vector<long>; ///< Indices of selected objects.
+
+	/** Build the hierarchy from scratch.
+	 \param objects the objects to organize
+	 */
+	void build(const std::vector<Object> & objects);
+
+	/** Refit the hierarchy after some objects have moved, updating the bounding boxes of their ancestors.
+	 \param objects the objects the hierarchy was built from
+	 \param moved indices of the objects that have moved
+	 \note The hierarchy topology is not modified, large displacements can degrade queries efficiency.
+	 */
+	void refit(const std::vector<Object> & objects, const std::vector<size_t> & moved);
+
+	/** Find all objects that intersect a frustum.
+	 \param frustum the frustum to test against
+	 \param visibles will be filled with the indices of the visible objects, in no specific order
+	 \param castersOnly only consider objects casting shadows
+	 */
+	void query(const Frustum & frustum, List & visibles, bool castersOnly = false) const;
+
+	/** Find all objects that intersect each frustum of a list, in a single traversal of the hierarchy. Independent subtrees are processed in parallel for large scenes.
+	 \param frustums the frustums to test against
+	 \param visibles will be filled with, for each frustum, the indices of the visible objects, in no specific order
+	 \param castersOnly only consider objects casting shadows
+	 */
+	void query(const std::vector<Frustum> & frustums, std::vector<List> & visibles, bool castersOnly = false) const;
+
+	/** \return true if the hierarchy has been built */
+	bool built() const { return !_nodes.empty(); }
+
+	/** \return the number of objects in the hierarchy */
+	size_t count() const { return _objectIds.size(); }
+
+private:
+
+	/// Maximum number of objects in a leaf, tested together.
+	static const size_t maxLeafSize = 8;
+
+	/** Element of the hierarchy. */
+	struct Node {
+		BoundingBox box; ///< Bounding box of the contained objects.
+		size_t first = 0; ///< Index of the first object of the subtree in the objects list.
+		size_t count = 0; ///< Number of objects in the subtree.
+		size_t left = 0; ///< Index of the left child node, 0 if this is a leaf.
+		size_t right = 0; ///< Index of the right child node, 0 if this is a leaf.
+		size_t parent = 0; ///< Index of the parent node (0 for the root).
+	};
+
+	/** Traverse a subtree, testing a subset of frustums at once.
+	 \param root the index of the subtree root node
+	 \param frustums the frustums to test against
+	 \param firstView index of the first frustum to test
+	 \param viewCount number of frustums to test (at most 64)
+	 \param castersOnly only consider objects casting shadows
+	 \param visibles the per-frustum lists to append visible objects to
+	 */
+	void queryViews(size_t root, const std::vector<Frustum> & frustums, size_t firstView, size_t viewCount, bool castersOnly, std::vector<List> & visibles) const;
+
+	/** Append all objects of a node to a list.
+	 \param node the node to process
+	 \param castersOnly only consider objects casting shadows
+	 \param visibles the list to append objects to
+	 */
+	void appendAll(const Node & node, bool castersOnly, List & visibles) const;
+
+	std::vector<Node> _nodes; ///< Hierarchy nodes, the root is the first one and children are always after their parent.
+	std::vector<long> _objectIds; ///< Object indices, ordered so that each subtree covers a contiguous range.
+	BoundingBoxes _boxes; ///< Objects world space bounding boxes at the last update, in the same order as _objectIds.
+	std::vector<size_t> _positions; ///< For each object, its position in _objectIds.
+	std::vector<size_t> _leaves; ///< For each object, index of the leaf containing it.
+	std::vector<bool> _casters; ///< For each object, does it cast shadows.
+	std::vector<size_t> _dirtyNodes; ///< Intermediate storage for refitting.
+};
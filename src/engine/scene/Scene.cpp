@@ -104,11 +104,14 @@ bool Scene::init(Storage options) {
 	});
 
 	// Check if the scene is static.
-	for(const auto & obj : objects){
-		if(obj.animated()){
+	for(size_t oid = 0; oid < objects.size(); ++oid){
+		if(objects[oid].animated()){
 			_animated = true;
+			_dynamicObjects.push_back(oid);
 		}
 	}
+	// Build the culling hierarchy once objects are in their final order.
+	_hierarchy.build(objects);
 	// Check if there is a material transparent in the scene.
 	for(const auto& material : materials){
 		if((material.type() == Material::Type::Transparent) || (material.type() == Material::Type::TransparentIrid)){
@@ -313,5 +316,7 @@ void Scene::update(double fullTime, double frameTime) {
 	for(auto & object : objects) {
 		object.update(fullTime, frameTime);
 	}
+	// Only animated objects can have moved.
+	_hierarchy.refit(objects, _dynamicObjects);
 	background->update(fullTime, frameTime);
 }
@@ -3,6 +3,7 @@
 #include "scene/Object.hpp"
 #include "scene/Material.hpp"
 #include "scene/LightProbe.hpp"
+#include "scene/ObjectsHierarchy.hpp"
 #include "lights/Light.hpp"
 
 #include "resources/ResourcesManager.hpp"
@@ -62,6 +63,11 @@ public:
 	/** \return true if the scene contains transparent objects */
 	bool transparent() const { return _transparent; }
 
+	/** Get the bounding volume hierarchy over the scene objects, kept up to date with animations.
+	 \return the hierarchy
+	 */
+	const ObjectsHierarchy & hierarchy() const { return _hierarchy; }
+
 	std::vector<Object> objects;				///< The objects in the scene.
 	std::vector<Material> materials;			///< The materials in the scene.
 	std::vector<std::shared_ptr<Light>> lights; ///< Lights present in the scene.
@@ -152,6 +158,8 @@ private:
 	Material _backgroundMaterial;  			 ///< Background material, containing the optional textures to use.
 	Camera _camera;							 ///< The initial viewpoint on the scene.
 	BoundingBox _bbox;						 ///< The scene bounding box.
+	ObjectsHierarchy _hierarchy;			 ///< Objects bounding volume hierarchy.
+	std::vector<size_t> _dynamicObjects;	 ///< Indices of the animated objects.
 	glm::mat4 _sceneModel = glm::mat4(1.0f); ///< The scene global transformation.
 	std::string _name;						 ///< The scene file name.
 	bool _loaded = false;					 ///< Has the scene already been loaded from disk.
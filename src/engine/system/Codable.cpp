@@ -150,6 +150,14 @@ std::pair<std::string, Layout> Codable::decodeTexture(const KeyValues & param) {
 		{"srgbcube", Layout::SRGB8_ALPHA8},
 		{"rgbcube", Layout::RGBA8},
 		{"rgb32cube", Layout::RGBA16F},
+
+		{"srgbbc", Layout::BC7_SRGB},
+		{"rgbbc", Layout::BC7},
+		{"rgb32bc", Layout::BC6H},
+
+		{"srgbbccube", Layout::BC7_SRGB},
+		{"rgbbccube", Layout::BC7},
+		{"rgb32bccube", Layout::BC6H},
 	};
 	// Check if the required format exists.
 	if(layouts.count(param.key) == 0 || param.values.empty()) {
@@ -170,6 +178,14 @@ KeyValues Codable::encode(const Texture * texture){
 		{"srgbcube", Layout::SRGB8_ALPHA8},
 		{"rgbcube", Layout::RGBA8},
 		{"rgb32cube", Layout::RGBA16F},
+
+		{"srgbbc", Layout::BC7_SRGB},
+		{"rgbbc", Layout::BC7},
+		{"rgb32bc", Layout::BC6H},
+
+		{"srgbbccube", Layout::BC7_SRGB},
+		{"rgbbccube", Layout::BC7},
+		{"rgb32bccube", Layout::BC6H},
 	};
 	KeyValues token("rgb");
 	for(const auto & format : formats){
@@ -88,7 +88,7 @@ public:
 	 \verbatim
 	 texturetype: texturename
 	 \endverbatim
-	 (where texturetype can be one of 'rgb', 'srgb', 'rgb32', 'rgbcube', 'srgbcube', 'rgb32cube' depending on the desired format).
+	 (where texturetype can be one of 'rgb', 'srgb', 'rgb32', 'rgbcube', 'srgbcube', 'rgb32cube' depending on the desired format, with a 'bc' suffix before 'cube' for block-compressed variants: 'rgbbc', 'srgbbc', 'rgb32bc', 'rgbbccube', 'srgbbccube', 'rgb32bccube').
 	 \param param the parameters tuple
 	 \return the name of the texture and its format.
 	 */
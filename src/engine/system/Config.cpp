@@ -214,8 +214,16 @@ RenderingConfig::RenderingConfig(const std::vector<std::string> & argv) :
 			forceAspectRatio = true;
 		} else if(arg.key == "resources" && !values.empty()) {
 			resourcesPath = values[0];
+		} else if(arg.key == "cache") {
+			cachePath = values.empty() ? "" : values[0];
 		} else if(arg.key == "nodebug") {
 			trackDebug = false;
+		} else if(key == "frames-in-flight" && !values.empty()) {
+			framesInFlight = uint(glm::clamp(std::stoi(values[0]), 1, 3));
+		} else if(key == "sync-check") {
+			validateSync = true;
+		} else if(key == "no-async-compute") {
+			asyncCompute = false;
 		}
 	}
 
@@ -227,7 +235,11 @@ RenderingConfig::RenderingConfig(const std::vector<std::string> & argv) :
 	registerArgument("wxh", "", "Window dimensions.", std::vector<std::string> {"width", "height"});
 	registerArgument("force-aspect", "far", "Force window aspect ratio.");
 	registerArgument("resources", "", "Additional resources directory", "path");
+	registerArgument("cache", "", "Cache directory for compiled shaders and textures, disabled if empty", "path");
 	registerArgument("nodebug", "", "Disable resources tracking.");
+	registerArgument("frames-in-flight", "", "Number of frames recorded ahead of the GPU (1 to 3).", "count");
+	registerArgument("sync-check", "", "Validate frame synchronization and log CPU/GPU overlap.");
+	registerArgument("no-async-compute", "", "Record compute work on the graphics queue only.");
 }
 
 glm::vec2 RenderingConfig::renderingResolution(){
@@ -156,6 +156,18 @@ public:
 	/// Extra resources directory.
 	std::string resourcesPath;
 
+	/// Directory for cached compiled shaders and compressed textures (empty to disable).
+	std::string cachePath = "../../../cache";
+
 	/// Should resource tracking and monitoring be enabled.
 	bool trackDebug = true;
+
+	/// Number of frames the CPU can record ahead of the GPU (between 1 and 3).
+	unsigned int framesInFlight = 2;
+
+	/// Validate frame synchronization and log CPU/GPU overlap statistics.
+	bool validateSync = false;
+
+	/// Use a separate compute queue if available, to overlap compute work with rendering.
+	bool asyncCompute = true;
 };
@@ -77,6 +77,9 @@ public:
 			low				  = high;
 			high			  = temp;
 		}
+		if(high == low) {
+			return;
+		}
 		// Prepare the threads pool.
 		// Always leave one thread free.
 		const size_t availableThreadsCount = std::max(int(std::thread::hardware_concurrency())-1, 1);
@@ -95,8 +98,8 @@ public:
 
 		for(size_t tid = 0; tid < count; ++tid) {
 			// For each thread, call the same lambda with different bounds as arguments.
-			const size_t threadLow  = tid * span;
-			const size_t threadHigh = tid == (count-1) ? high : ((tid + 1) * span);
+			const size_t threadLow  = low + tid * span;
+			const size_t threadHigh = tid == (count-1) ? high : (low + (tid + 1) * span);
 			threads.emplace_back(launchThread, threadLow, threadHigh);
 		}
 		// Wait for all threads to finish.
@@ -77,6 +77,9 @@ _config(config), _allowEscape(escapeQuit) {
 	const float screenDensity = float(width) / float(_config.windowFrame[2]);
 	Input::manager().densityEvent(screenDensity);
 
+	// Compiled shaders and processed textures are shared between applications.
+	Resources::manager().setCachePath(_config.cachePath);
+
 	// Setup the GPU.
 	if(!GPU::setup(name)){
 		glfwDestroyWindow(_window);
@@ -0,0 +1,138 @@
+#include "scene/ObjectsHierarchy.hpp"
+#include "resources/Bounds.hpp"
+#include "resources/Mesh.hpp"
+#include "generation/Random.hpp"
+#include "system/Query.hpp"
+#include "Common.hpp"
+
+/**
+ \defgroup CullingBenchmark Culling Benchmark
+ \brief Measure the throughput of the frustum culling methods on a synthetic scene.
+ \ingroup Tools
+ */
+
+/** \brief Timings of a culling method.
+ \ingroup CullingBenchmark
+ */
+struct BenchmarkResult {
+	uint64_t duration = 0; ///< Total duration in nanoseconds.
+	size_t visibles = 0; ///< Total number of visible objects found, to check consistency.
+};
+
+/** Log the throughput of a culling method.
+ \param name the method name
+ \param result the timings of the method
+ \param tests the total number of objects tested
+ \ingroup CullingBenchmark
+ */
+void logResult(const std::string & name, const BenchmarkResult & result, size_t tests) {
+	const double micros = double(result.duration) / 1000.0;
+	Log::Info() << name << ": " << (double(tests) / std::max(micros, 1e-3)) << " objects culled per microsecond (" << (micros / 1000.0) << "ms, " << result.visibles << " visible)." << std::endl;
+}
+
+/**
+ The main function of the culling benchmark.
+ \param argc the number of input arguments.
+ \param argv a pointer to the raw input arguments.
+ \return a general error code.
+ \ingroup CullingBenchmark
+ */
+int main(int argc, char ** argv) {
+
+	// Optional arguments: number of objects and number of views.
+	const size_t objCount = argc > 1 ? size_t(std::stoul(argv[1])) : 50000;
+	const size_t viewCount = argc > 2 ? size_t(std::stoul(argv[2])) : 64;
+	Random::seed(0x0decafe);
+
+	// Generate a unit cube mesh, only its bounding box is needed.
+	Mesh cube("Cube");
+	cube.positions = { glm::vec3(-1.0f), glm::vec3(1.0f) };
+	cube.computeBoundingBox();
+
+	// Scatter objects in a large volume.
+	const float extent = 1000.0f;
+	std::vector<Object> objects;
+	objects.reserve(objCount);
+	for(size_t oid = 0; oid < objCount; ++oid) {
+		const glm::vec3 pos = extent * glm::vec3(Random::Float(-1.0f, 1.0f), Random::Float(-1.0f, 1.0f), Random::Float(-1.0f, 1.0f));
+		const float scale = Random::Float(0.5f, 4.0f);
+		objects.emplace_back(&cube, Random::Int(0, 3) != 0);
+		objects.back().set(glm::scale(glm::translate(glm::mat4(1.0f), pos), glm::vec3(scale)));
+	}
+
+	std::vector<BoundingBox> boxes(objCount);
+	BoundingBoxes boxesSoA;
+	boxesSoA.resize(objCount);
+	for(size_t oid = 0; oid < objCount; ++oid) {
+		boxes[oid] = objects[oid].boundingBox();
+		boxesSoA.set(oid, boxes[oid]);
+	}
+
+	ObjectsHierarchy hierarchy;
+	Query timer;
+	timer.begin();
+	hierarchy.build(objects);
+	timer.end();
+	Log::Info() << "Hierarchy built in " << (double(timer.value()) / 1000000.0) << "ms for " << objCount << " objects." << std::endl;
+
+	// Random views inside the volume.
+	std::vector<Frustum> frustums;
+	const glm::mat4 proj = Frustum::perspective(1.2f, 16.0f / 9.0f, 0.1f, 0.5f * extent);
+	for(size_t vid = 0; vid < viewCount; ++vid) {
+		const glm::vec3 eye = extent * glm::vec3(Random::Float(-1.0f, 1.0f), Random::Float(-1.0f, 1.0f), Random::Float(-1.0f, 1.0f));
+		const glm::mat4 view = glm::lookAt(eye, eye + Random::sampleSphere(), glm::vec3(0.0f, 1.0f, 0.0f));
+		frustums.emplace_back(proj * view);
+	}
+
+	BenchmarkResult scalar;
+	BenchmarkResult batched;
+	BenchmarkResult tree;
+	std::vector<uchar> results(objCount);
+	ObjectsHierarchy::List visibles;
+	visibles.reserve(objCount);
+
+	for(const Frustum & frustum : frustums) {
+		// Scalar test, one box at a time.
+		timer.begin();
+		size_t count = 0;
+		for(const BoundingBox & box : boxes) {
+			count += frustum.intersects(box) ? 1 : 0;
+		}
+		timer.end();
+		scalar.duration += timer.value();
+		scalar.visibles += count;
+
+		// Batched test on structure-of-arrays boxes.
+		timer.begin();
+		count = frustum.intersects(boxesSoA, 0, objCount, results.data());
+		timer.end();
+		batched.duration += timer.value();
+		batched.visibles += count;
+
+		// Hierarchy traversal.
+		timer.begin();
+		hierarchy.query(frustum, visibles);
+		timer.end();
+		tree.duration += timer.value();
+		tree.visibles += visibles.size();
+	}
+
+	// Hierarchy traversal for all views at once.
+	BenchmarkResult multi;
+	std::vector<ObjectsHierarchy::List> allVisibles;
+	timer.begin();
+	hierarchy.query(frustums, allVisibles);
+	timer.end();
+	multi.duration = timer.value();
+	for(const ObjectsHierarchy::List & list : allVisibles) {
+		multi.visibles += list.size();
+	}
+
+	const size_t tests = objCount * viewCount;
+	Log::Info() << "Culling " << objCount << " objects against " << viewCount << " views." << std::endl;
+	logResult("Scalar", scalar, tests);
+	logResult("Batched", batched, tests);
+	logResult("Hierarchy", tree, tests);
+	logResult("Hierarchy, all views", multi, tests);
+	return 0;
+}
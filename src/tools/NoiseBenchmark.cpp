@@ -0,0 +1,92 @@
+#include "generation/PerlinNoise.hpp"
+#include "generation/Random.hpp"
+#include "resources/Image.hpp"
+#include "system/Query.hpp"
+#include "system/System.hpp"
+#include "Common.hpp"
+
+/**
+ \defgroup NoiseBenchmark Noise Benchmark
+ \brief Measure the throughput of the Perlin noise and multi-layered noise generation.
+ \ingroup Tools
+ */
+
+/** Log the throughput of a noise generation method.
+ \param name the method name
+ \param duration the total duration in nanoseconds
+ \param samples the total number of noise samples evaluated
+ \ingroup NoiseBenchmark
+ */
+void logResult(const std::string & name, uint64_t duration, size_t samples) {
+	const double micros = double(duration) / 1000.0;
+	Log::Info() << name << ": " << (double(samples) / std::max(micros, 1e-3)) << " samples per microsecond (" << (micros / 1000.0) << "ms)." << std::endl;
+}
+
+/**
+ The main function of the noise benchmark.
+ \param argc the number of input arguments.
+ \param argv a pointer to the raw input arguments.
+ \return a general error code.
+ \ingroup NoiseBenchmark
+ */
+int main(int argc, char ** argv) {
+
+	// Optional arguments: image size and number of layers.
+	const uint size = argc > 1 ? uint(std::stoul(argv[1])) : 2048;
+	const int octaves = argc > 2 ? std::stoi(argv[2]) : 8;
+	const float gain = 0.5f;
+	const float lacunarity = 2.0f;
+	const float scale = 0.01f;
+	Random::seed(8429);
+
+	PerlinNoise perlin;
+	Query timer;
+	const size_t pixelCount = size_t(size) * size_t(size);
+
+	// Single layer.
+	Image single(size, size, 1);
+	timer.begin();
+	perlin.generate(single, 0, scale, 0.0f);
+	timer.end();
+	logResult("Single layer", timer.value(), pixelCount);
+
+	// Single periodic layer.
+	timer.begin();
+	perlin.generatePeriodic(single, 0, scale, 0.0f);
+	timer.end();
+	logResult("Single periodic layer", timer.value(), pixelCount);
+
+	// Layers generated one after the other in a temporary image, then accumulated.
+	Image separate(size, size, 1);
+	Image layer(size, size, 1);
+	timer.begin();
+	float layerScale = scale;
+	float weight = 1.0f;
+	for(int i = 0; i < octaves; ++i){
+		perlin.generate(layer, 0, layerScale, 0.0f);
+		System::forParallel(0, size_t(size), [&separate, &layer, weight, size](size_t y){
+			for(uint x = 0; x < size; ++x){
+				separate.r(int(x), int(y)) += weight * layer.r(int(x), int(y));
+			}
+		});
+		layerScale *= lacunarity;
+		weight *= gain;
+	}
+	timer.end();
+	logResult("Separate layers", timer.value(), pixelCount * size_t(octaves));
+
+	// All layers evaluated in a single pass.
+	Image fused(size, size, 1);
+	timer.begin();
+	perlin.generateLayers(fused, 0, octaves, gain, lacunarity, scale);
+	timer.end();
+	logResult("Fused layers", timer.value(), pixelCount * size_t(octaves));
+
+	// Both methods should produce the same result, up to floating point precision.
+	float maxError = 0.0f;
+	for(size_t pid = 0; pid < pixelCount; ++pid){
+		maxError = std::max(maxError, std::abs(separate.pixels[pid] - fused.pixels[pid]));
+	}
+	Log::Info() << "Generated " << size << "x" << size << " noise with " << octaves << " layers, max. difference: " << maxError << "." << std::endl;
+	return 0;
+}
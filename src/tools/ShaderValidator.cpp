@@ -85,7 +85,7 @@ bool processLog(const std::string & compilationLog, const std::vector<std::strin
 }
 
 /**
- Perform shader validation: load all shaders in the resources directory, compile them on the GPU and output error logs.
+ Perform shader validation: load all shaders in the resources directory, compile them on the GPU and output error logs. If a cache directory is given as a second argument, compiled shaders are stored in it.
  \param argc the number of input arguments.
  \param argv a pointer to the raw input arguments.
  \return a boolean denoting if at least one shader failed to compile.
@@ -99,6 +99,10 @@ int main(int argc, char ** argv) {
 		return 1;
 	}
 	Resources::manager().addResources(std::string(argv[1]));
+	// Optional shader cache directory, that will be pre-warmed for the applications.
+	if(argc > 2) {
+		Resources::manager().setCachePath(std::string(argv[2]));
+	}
 	
 	ShaderCompiler::init();
 
@@ -115,59 +119,71 @@ int main(int argc, char ** argv) {
 		{ShaderType::COMPUTE, "comp" }
 	};
 	bool encounteredIssues = false;
-	
+
+	// Load all shaders from disk.
+	std::vector<std::string> shaders;
+	std::vector<ShaderType> shaderTypes;
+	std::vector<std::vector<std::string>> allNames;
 	for(const auto & type : types) {
-		// Load shaders from disk.
 		std::vector<Resources::FileInfos> files;
 		Resources::manager().getFiles(type.second, files);
 		for (auto& file : files) {
-
-			std::string compilationLog;
 			// Keep track of the include files used.
 			// File with ID 0 is the base file, already set its name.
-			std::vector<std::string> names = { file.path };
+			allNames.push_back({ file.path });
 			// Load the shader.
 			const std::string fullName = file.name + "." + type.second;
-			const std::string shader = Resources::manager().getStringWithIncludes(fullName, names);
-			// Compile the shader.
-			Program::Stage stage;
-
-			ShaderCompiler::compile(shader, type.first, stage, false, compilationLog);
-			
-			// Replace the include names by the full paths.
-			for(size_t nid = 1; nid < names.size(); ++nid) {
-				auto& name = names[nid];
-				TextUtilities::splitExtension(name);
-				for(const auto& includeFile : includeFiles){
-					if(includeFile.name == name){
-						name = includeFile.path;
-						break;
-					}
+			shaders.push_back(Resources::manager().getStringWithIncludes(fullName, allNames.back()));
+			shaderTypes.push_back(type.first);
+		}
+	}
+
+	// Compile all shaders concurrently.
+	std::vector<Program::Stage> stages(shaders.size());
+	std::vector<ShaderCompiler::Job> jobs;
+	jobs.reserve(shaders.size());
+	for(size_t sid = 0; sid < shaders.size(); ++sid) {
+		jobs.emplace_back(shaders[sid], shaderTypes[sid], &stages[sid]);
+	}
+	ShaderCompiler::compile(jobs, false);
+
+	for(size_t sid = 0; sid < jobs.size(); ++sid) {
+		std::vector<std::string> & names = allNames[sid];
+		Program::Stage & stage = stages[sid];
+
+		// Replace the include names by the full paths.
+		for(size_t nid = 1; nid < names.size(); ++nid) {
+			auto& name = names[nid];
+			TextUtilities::splitExtension(name);
+			for(const auto& includeFile : includeFiles){
+				if(includeFile.name == name){
+					name = includeFile.path;
+					break;
 				}
 			}
-			// Process the log.
-			const bool newIssues = processLog(compilationLog, names);
-			encounteredIssues = encounteredIssues || newIssues;
-
-			// Extra validation.
-			for(const auto& image : stage.images){
-				if(image.set != IMAGES_SET){
-					const std::string message = "Images should always be in set " + std::to_string(IMAGES_SET) + ".";
-					outputError(names[0], 0, message);
-				}
+		}
+		// Process the log.
+		const bool newIssues = processLog(jobs[sid].log, names);
+		encounteredIssues = encounteredIssues || newIssues;
+
+		// Extra validation.
+		for(const auto& image : stage.images){
+			if(image.set != IMAGES_SET && image.set != BINDLESS_SET){
+				const std::string message = "Images should always be in set " + std::to_string(IMAGES_SET) + " (or " + std::to_string(BINDLESS_SET) + " for the texture table).";
+				outputError(names[0], 0, message);
 			}
-			for(const auto& buffer : stage.buffers){
-				const uint set = buffer.set;
-				// We only internally manage dynamic UBOs, in set UNIFORMS_SET. And static buffers are in set BUFFERS_SET.
-				if(set != UNIFORMS_SET && set != BUFFERS_SET){
-					const std::string dynID = std::to_string(UNIFORMS_SET);
-					const std::string statID = std::to_string(BUFFERS_SET);
-					outputError(names[0], 0, "Uniform buffer should always be in set " + dynID + " (dynamic) or " + statID + " (static)");
-				}
+		}
+		for(const auto& buffer : stage.buffers){
+			const uint set = buffer.set;
+			// We only internally manage dynamic UBOs, in set UNIFORMS_SET. And static buffers are in set BUFFERS_SET.
+			if(set != UNIFORMS_SET && set != BUFFERS_SET){
+				const std::string dynID = std::to_string(UNIFORMS_SET);
+				const std::string statID = std::to_string(BUFFERS_SET);
+				outputError(names[0], 0, "Uniform buffer should always be in set " + dynID + " (dynamic) or " + statID + " (static)");
 			}
-
-			ShaderCompiler::clean(stage);
 		}
+
+		ShaderCompiler::clean(stage);
 	}
 
 	ShaderCompiler::cleanup();
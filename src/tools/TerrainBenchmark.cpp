@@ -0,0 +1,53 @@
+#include "Terrain.hpp"
+#include "resources/ResourcesManager.hpp"
+#include "generation/Random.hpp"
+#include "system/Window.hpp"
+#include "system/Config.hpp"
+#include "system/Query.hpp"
+#include "Common.hpp"
+
+/**
+ \defgroup TerrainBenchmark Terrain Benchmark
+ \brief Measure the time taken to generate the island terrain map at increasing resolutions.
+ \ingroup Tools
+ */
+
+/**
+ The main function of the terrain benchmark.
+ \param argc the number of input arguments.
+ \param argv a pointer to the raw input arguments.
+ \return a general error code.
+ \ingroup TerrainBenchmark
+ */
+int main(int argc, char ** argv) {
+	// First, init/parse/load configuration.
+	RenderingConfig config(std::vector<std::string>(argv, argv + argc));
+	if(config.showHelp()) {
+		return 0;
+	}
+
+	// A hidden window is needed for the terrain textures and meshes.
+	Window window("Terrain benchmark", config, true, true);
+	Resources::manager().addResources("../../../resources/island");
+
+	const uint seed = 8429;
+	const std::array<uint, 4> resolutions = {1024, 2048, 4096, 8192};
+	const uint runs = 3;
+
+	Query timer;
+	for(const uint resolution : resolutions) {
+		// The constructor generates the map a first time.
+		Terrain terrain(resolution, seed);
+
+		uint64_t duration = 0;
+		for(uint rid = 0; rid < runs; ++rid) {
+			timer.begin();
+			terrain.generateMap();
+			timer.end();
+			duration += timer.value();
+		}
+		const double millis = double(duration) / double(runs) / 1000000.0;
+		Log::Info() << "Terrain " << resolution << "x" << resolution << ": generated in " << millis << "ms (average over " << runs << " runs)." << std::endl;
+	}
+	return 0;
+}